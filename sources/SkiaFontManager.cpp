@@ -18,33 +18,36 @@
 
 
 #include "SkiaFontManager.h"
+#include "util/Log.h"
+#include "util/ThreadPool.h"
+#include "profiling/StartupProfile.h"
+#include "profiling/Tracing.h"
 #include <core/SkStream.h>
 #include <core/SkTypeface.h>
 #include <ports/SkFontMgr_empty.h>
 #include <ports/SkFontMgr_directory.h>
 
+#include <future>
+#include <mutex>
+#include <string>
 
-static sk_sp<SkFontMgr> m_font_mgr;
-
-sk_sp<SkFontMgr> get_skia_font_manager()
-{
-  return m_font_mgr;
-}
 
-void set_global_skia_font_manager(sk_sp<SkFontMgr> mgr)
-{
-  m_font_mgr = mgr;
-}
+// The font manager itself is immutable and can be used from all threads. Only the pointer
+// has to be protected, as it may be replaced while render threads fetch it.
+static std::mutex m_font_mgr_mutex;
+static sk_sp<SkFontMgr> m_font_mgr;
 
-#include <iostream>
+// Font manager that is still being created by start_loading_fonts_from_directory().
+static std::shared_future<sk_sp<SkFontMgr>> m_pending_font_mgr;
 
-void list_fonts(sk_sp<SkFontMgr> fontMgr)
+// Creates a typeface of every style, which is slow. Only done for debug logging.
+static void list_fonts(sk_sp<SkFontMgr> fontMgr)
 {
   int familyCount = fontMgr->countFamilies();
   for (int i = 0; i < familyCount; ++i) {
     SkString familyName;
     fontMgr->getFamilyName(i, &familyName);
-    printf("Font Family: %s\n", familyName.c_str());
+    LOG_DEBUG("Font Family: %s", familyName.c_str());
 
     sk_sp<SkFontStyleSet> styleSet = fontMgr->createStyleSet(i);
     if (styleSet) {
@@ -53,22 +56,68 @@ void list_fonts(sk_sp<SkFontMgr> fontMgr)
         SkFontStyle style;
         SkString styleName;
         styleSet->getStyle(j, &style, &styleName);
-        printf("  Style: %s %d %d\n", styleName.c_str(), style.width(), style.weight());
 
-        auto typeface = styleSet->createTypeface(0);
-        int nGlyphs = typeface->countGlyphs();
-        printf("  nGlyphs: %d\n", nGlyphs);
+        auto typeface = styleSet->createTypeface(j);
+        LOG_DEBUG("  Style: %s %d %d, %d glyphs", styleName.c_str(), style.width(), style.weight(),
+                  typeface ? typeface->countGlyphs() : 0);
       }
     }
   }
 }
 
+sk_sp<SkFontMgr> get_skia_font_manager()
+{
+  std::lock_guard<std::mutex> lock(m_font_mgr_mutex);
+
+  if (m_pending_font_mgr.valid()) {
+    TRACE_SCOPE("wait for font indexing");
+    m_font_mgr = m_pending_font_mgr.get();
+    m_pending_font_mgr = {};
+
+    if (log_enabled(LogLevel::Debug)) {
+      list_fonts(m_font_mgr);
+    }
+  }
+
+  return m_font_mgr;
+}
+
+void set_global_skia_font_manager(sk_sp<SkFontMgr> mgr)
+{
+  std::lock_guard<std::mutex> lock(m_font_mgr_mutex);
+  m_font_mgr = mgr;
+  m_pending_font_mgr = {};
+}
+
+static sk_sp<SkFontMgr> make_font_manager(const std::string& font_directory)
+{
+  STARTUP_PHASE("font indexing");
+
+  return SkFontMgr_New_Custom_Directory(font_directory.c_str());
+}
+
 bool set_global_skia_font_manager_from_fonts_directory(const char* font_directory)
 {
-  auto mgr = SkFontMgr_New_Custom_Directory(font_directory);
+  auto mgr = make_font_manager(font_directory);
 
   set_global_skia_font_manager(mgr);
-  list_fonts(mgr);
+
+  if (log_enabled(LogLevel::Debug)) {
+    list_fonts(mgr);
+  }
 
   return true;
 }
+
+void start_loading_fonts_from_directory(const char* font_directory)
+{
+  auto task = std::make_shared<std::packaged_task<sk_sp<SkFontMgr>()>>(
+          [dir = std::string(font_directory)] { return make_font_manager(dir); });
+
+  {
+    std::lock_guard<std::mutex> lock(m_font_mgr_mutex);
+    m_pending_font_mgr = task->get_future().share();
+  }
+
+  background_thread_pool().enqueue([task] { (*task)(); });
+}
@@ -26,4 +26,8 @@ sk_sp<SkFontMgr> get_skia_font_manager();
 
 bool set_global_skia_font_manager_from_fonts_directory(const char* font_directory);
 
+// Indexes the font directory on a background thread. get_skia_font_manager() waits for it
+// if it is called before indexing has finished.
+void start_loading_fonts_from_directory(const char* font_directory);
+
 #endif
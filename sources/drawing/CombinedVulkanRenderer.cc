@@ -0,0 +1,291 @@
+/*
+ * Copyright (C) 2025 by Dirk Farin, Kronenstr. 49b, 70174 Stuttgart, Germany
+ *
+ * 2-Clause BSD
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer
+ *    in the documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "CombinedVulkanRenderer.h"
+#include "DrawingWindow_Skia_Vulkan.h"
+#include "PresentConfig.h"
+#include "TextMode.h"
+#include "SkiaFontManager.h"
+#include "ImageCache.h"
+#include "LayerCache.h"
+#include "TileCache.h"
+#include "profiling/Tracing.h"
+#include "profiling/FrameStats.h"
+
+#include <QVulkanDeviceFunctions>
+
+#include <core/SkCanvas.h>
+#include <core/SkFont.h>
+#include <core/SkPaint.h>
+#include <core/SkPath.h>
+#include <core/SkSurface.h>
+#include <core/SkTypeface.h>
+#include <gpu/ganesh/GrDirectContext.h>
+#include <gpu/ganesh/vk/GrVkTypes.h>
+#include <private/chromium/GrVkSecondaryCBDrawContext.h>
+
+#include <algorithm>
+#include <cstdio>
+
+
+static const int kPanelWidth = 300;
+static const int kPanelHeight = 110;
+static const int kTextHeight = 40;
+
+
+CombinedVulkanRenderer::CombinedVulkanRenderer(QVulkanWindow* w)
+    : NonSkiaVulkanRenderer(w, false)
+{
+  // The triangle is recorded inline into one secondary command buffer next to Skia's.
+  mRecordThreads = 1;
+  mGpuCulling = false;
+}
+
+
+void CombinedVulkanRenderer::initResources()
+{
+  NonSkiaVulkanRenderer::initResources();
+
+  mSkiaContext = make_skia_vulkan_context(mWindow);
+
+  mFont = SkFont(get_skia_font_manager()->legacyMakeTypeface(nullptr, {}), 14);
+
+  VkDevice dev = mWindow->device();
+
+  VkCommandPoolCreateInfo poolInfo{};
+  poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+  poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+  poolInfo.queueFamilyIndex = mWindow->graphicsQueueFamilyIndex();
+
+  VkResult err = mDeviceFunctions->vkCreateCommandPool(dev, &poolInfo, nullptr, &mCommandPool);
+  if (err != VK_SUCCESS)
+    qFatal("Failed to create command pool: %d", err);
+
+  for (int i = 0; i < mWindow->concurrentFrameCount(); i++) {
+    VkCommandBufferAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.commandPool = mCommandPool;
+    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+    allocInfo.commandBufferCount = 2;
+
+    VkCommandBuffer cbs[2];
+    err = mDeviceFunctions->vkAllocateCommandBuffers(dev, &allocInfo, cbs);
+    if (err != VK_SUCCESS)
+      qFatal("Failed to allocate secondary command buffers: %d", err);
+
+    mSlots[i].sceneCB = cbs[0];
+    mSlots[i].overlayCB = cbs[1];
+  }
+}
+
+
+void CombinedVulkanRenderer::releaseResources()
+{
+  // QVulkanWindow waits for the device to become idle before releasing the resources.
+  for (auto& slot : mSlots) {
+    if (slot.drawContext) {
+      slot.drawContext->releaseResources();
+      slot.drawContext = nullptr;
+    }
+
+    slot.sceneCB = VK_NULL_HANDLE;
+    slot.overlayCB = VK_NULL_HANDLE;
+  }
+
+  release_image_cache(mSkiaContext.get());
+  release_text_mode_cache(mSkiaContext.get());
+  release_tile_cache(mSkiaContext.get());
+  release_layer_cache(mSkiaContext.get());
+
+  if (mSkiaContext) {
+    mSkiaContext->releaseResourcesAndAbandonContext();
+    mSkiaContext = nullptr;
+  }
+
+  if (mCommandPool) {
+    mDeviceFunctions->vkDestroyCommandPool(mWindow->device(), mCommandPool, nullptr);
+    mCommandPool = VK_NULL_HANDLE;
+  }
+
+  NonSkiaVulkanRenderer::releaseResources();
+}
+
+
+void CombinedVulkanRenderer::startNextFrame()
+{
+  TRACE_SCOPE("CombinedVulkanRenderer::startNextFrame");
+
+  frame_stats().beginFrame();
+
+  wait_for_frames_in_flight(mWindow);
+
+  mGpuTimer.poll();
+
+  FrameSlot& slot = mSlots[mWindow->currentFrame()];
+
+  // Qt has waited for the fence of this frame slot, so the GPU is done with its command buffers.
+  if (slot.drawContext) {
+    slot.drawContext->releaseResources();
+    slot.drawContext = nullptr;
+  }
+
+  updateUploads(mWindow->currentCommandBuffer());
+
+  // --- native scene
+
+  {
+    TRACE_SCOPE("record scene");
+
+    beginSecondary(slot.sceneCB);
+    recordDraw(slot.sceneCB);
+    mDeviceFunctions->vkEndCommandBuffer(slot.sceneCB);
+  }
+
+  // --- Skia overlay
+
+  recordOverlay(slot);
+
+  // --- primary command buffer
+
+  VkCommandBuffer cmdBuf = mWindow->currentCommandBuffer();
+
+  mGpuTimer.begin(cmdBuf);
+  beginRenderPass(cmdBuf, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+
+  VkCommandBuffer secondaries[2] = {slot.sceneCB, slot.overlayCB};
+  mDeviceFunctions->vkCmdExecuteCommands(cmdBuf, 2, secondaries);
+
+  mDeviceFunctions->vkCmdEndRenderPass(cmdBuf);
+  mGpuTimer.end(cmdBuf);
+
+  present();
+
+  frame_stats().endFrame();
+}
+
+
+void CombinedVulkanRenderer::recordOverlay(FrameSlot& slot)
+{
+  TRACE_SCOPE("record overlay");
+
+  const QSize sz = mWindow->swapChainImageSize();
+
+  SkColorType colorType;
+  switch (mWindow->colorFormat()) {
+    case VK_FORMAT_R8G8B8A8_UNORM:
+      colorType = kRGBA_8888_SkColorType;
+      break;
+    case VK_FORMAT_B8G8R8A8_UNORM:
+      colorType = kBGRA_8888_SkColorType;
+      break;
+    default:
+      qFatal("unsupported swap chain format for the Skia overlay: %d", mWindow->colorFormat());
+  }
+
+  beginSecondary(slot.overlayCB);
+
+  VkRect2D drawBounds{};
+
+  GrVkDrawableInfo drawableInfo;
+  drawableInfo.fSecondaryCommandBuffer = slot.overlayCB;
+  drawableInfo.fColorAttachmentIndex = 0;
+  drawableInfo.fCompatibleRenderPass = mWindow->defaultRenderPass();
+  drawableInfo.fFormat = mWindow->colorFormat();
+  drawableInfo.fDrawBounds = &drawBounds;
+
+  SkImageInfo imageInfo = SkImageInfo::Make(sz.width(), sz.height(), colorType, kPremul_SkAlphaType);
+  SkSurfaceProps props = text_mode_surface_props();
+
+  slot.drawContext = GrVkSecondaryCBDrawContext::Make(mSkiaContext.get(), imageInfo, drawableInfo, &props);
+  if (!slot.drawContext) {
+    qFatal("Failed to create GrVkSecondaryCBDrawContext");
+  }
+
+  drawOverlay(slot.drawContext->getCanvas());
+
+  {
+    AllocStageScope allocStage(RenderStage::Flush);
+
+    slot.drawContext->flush();
+
+    // Skia's own command buffer (texture uploads) has to reach the queue before Qt submits
+    // the frame that executes the overlay.
+    mSkiaContext->submit();
+  }
+
+  mDeviceFunctions->vkEndCommandBuffer(slot.overlayCB);
+}
+
+
+void CombinedVulkanRenderer::drawOverlay(SkCanvas* canvas)
+{
+  const FrameStats& stats = frame_stats();
+
+  canvas->save();
+  canvas->translate(10, 10);
+
+  SkPaint panelPaint;
+  panelPaint.setColor(SkColorSetARGB(0xC0, 0x20, 0x20, 0x20));
+  canvas->drawRoundRect(SkRect::MakeWH(kPanelWidth, kPanelHeight), 6, 6, panelPaint);
+
+  // Frame time graph, 0..33 ms, one column per frame.
+
+  const SkRect graph = SkRect::MakeXYWH(8, kTextHeight + 8, kPanelWidth - 16, kPanelHeight - kTextHeight - 16);
+  const float maxMs = 33.3f;
+
+  SkPaint gridPaint;
+  gridPaint.setColor(SkColorSetARGB(0x80, 0xFF, 0xFF, 0xFF));
+  gridPaint.setStrokeWidth(1);
+  float y60 = graph.bottom() - graph.height() * (16.7f / maxMs);
+  canvas->drawLine(graph.left(), y60, graph.right(), y60, gridPaint);
+
+  int n = std::min(stats.historyLength(), (int) graph.width());
+  if (n > 1) {
+    SkPath path;
+    int first = stats.historyLength() - n;
+    for (int i = 0; i < n; i++) {
+      float ms = std::min(stats.frameTimeMs(first + i), maxMs);
+      SkPoint p{graph.left() + i * graph.width() / (n - 1), graph.bottom() - graph.height() * ms / maxMs};
+      if (i == 0) {
+        path.moveTo(p);
+      }
+      else {
+        path.lineTo(p);
+      }
+    }
+
+    SkPaint graphPaint;
+    graphPaint.setColor(SkColorSetRGB(0x40, 0xFF, 0x40));
+    graphPaint.setStyle(SkPaint::kStroke_Style);
+    graphPaint.setStrokeWidth(1.5f);
+    graphPaint.setAntiAlias(true);
+    canvas->drawPath(path, graphPaint);
+  }
+
+  char line[100];
+  snprintf(line, sizeof(line), "%.1f fps   %.2f ms   vulkan + skia overlay",
+           stats.framesPerSecond(), stats.averageFrameTimeMs());
+
+  SkPaint textPaint;
+  textPaint.setColor(SK_ColorWHITE);
+  textPaint.setAntiAlias(true);
+  canvas->drawString(line, 10, 26, mFont, textPaint);
+
+  canvas->restore();
+}
@@ -0,0 +1,77 @@
+/*
+ * Copyright (C) 2025 by Dirk Farin, Kronenstr. 49b, 70174 Stuttgart, Germany
+ *
+ * 2-Clause BSD
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer
+ *    in the documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef COMBINEDVULKANRENDERER_H
+#define COMBINEDVULKANRENDERER_H
+
+#include "NonSkiaVulkanRenderer.h"
+
+#include <QVulkanWindow>
+
+#include <core/SkFont.h>
+#include <core/SkRefCnt.h>
+
+class GrDirectContext;
+class GrVkSecondaryCBDrawContext;
+class SkCanvas;
+
+
+// Draws the native Vulkan scene of NonSkiaVulkanRenderer and a Skia overlay (frame statistics)
+// into the same render pass of the swap chain image.
+//
+// Both parts are recorded into secondary command buffers that are executed in order inside the
+// window's render pass. Skia records into its secondary command buffer through
+// GrVkSecondaryCBDrawContext, so the overlay needs neither an offscreen image nor a copy.
+// Uploads that Skia needs for the overlay are submitted by Skia on the same queue before Qt
+// submits the frame's command buffer.
+
+class CombinedVulkanRenderer : public NonSkiaVulkanRenderer
+{
+public:
+  explicit CombinedVulkanRenderer(QVulkanWindow* w);
+
+  void initResources() override;
+
+  void releaseResources() override;
+
+  void startNextFrame() override;
+
+private:
+  struct FrameSlot
+  {
+    VkCommandBuffer sceneCB = VK_NULL_HANDLE;
+    VkCommandBuffer overlayCB = VK_NULL_HANDLE;
+
+    // Kept alive until the slot is reused, i.e. until the GPU has executed 'overlayCB'.
+    sk_sp<GrVkSecondaryCBDrawContext> drawContext;
+  };
+
+  sk_sp<GrDirectContext> mSkiaContext;
+
+  VkCommandPool mCommandPool = VK_NULL_HANDLE;
+  FrameSlot mSlots[QVulkanWindow::MAX_CONCURRENT_FRAME_COUNT];
+
+  SkFont mFont;
+
+  void recordOverlay(FrameSlot&);
+
+  void drawOverlay(SkCanvas*);
+};
+
+#endif
@@ -18,53 +18,61 @@
 
 
 #include "Drawing.h"
+#include "Scenes.h"
+#include "ImageCache.h"
+#include "profiling/FrameCapture.h"
 
-#include <iostream>
-#include "main/MainWindow.h"
-#include "SkiaFontManager.h"
-
-#include <core/SkPaint.h>
 #include <core/SkCanvas.h>
-#include <core/SkFont.h>
 
 
 void draw_skia_scene(SkCanvas* canvas)
+{
+  SkISize size = canvas->getBaseLayerSize();
+  draw_skia_scene(canvas, size.width(), size.height());
+}
+
+
+void draw_skia_scene(SkCanvas* canvas, int w, int h)
 {
   static int cnt = 0;
 
-  SkISize size = canvas->getBaseLayerSize();
-  int w = size.width();
-  int h = size.height();
+  draw_scene_frame_with_capture(canvas, w, h, cnt);
+
+  cnt++;
+}
 
-  canvas->clear(SK_ColorBLUE);
 
+void draw_skia_scene_frame(SkCanvas* canvas, int w, int h, int frame)
+{
+  draw_scene_frame(active_scene(), canvas, w, h, frame);
+}
 
-  // --- draw rotating line
 
-  SkPaint paint;
-  paint.setColor(SK_ColorRED);
-  paint.setStrokeWidth((w + h) / 100.0f);
-  paint.setStyle(SkPaint::kStroke_Style);
-  canvas->drawLine(w / 2 + cos(cnt / 100.0) * w * 0.4, h / 2 + sin(cnt / 100.0) * h * 0.4, w / 2, h / 2, paint);
+static thread_local SkCanvas* sForwardingCanvas = nullptr;
+static thread_local SkCanvas* sForwardingTarget = nullptr;
 
 
-  // --- draw text with increasing font size
+GrRecordingContext* canvas_recording_context(SkCanvas* canvas)
+{
+  if (canvas == sForwardingCanvas) {
+    canvas = sForwardingTarget;
+  }
 
-  int font_size = cnt / 3;
+  return canvas->recordingContext();
+}
 
-  auto mgr = get_skia_font_manager();
-  SkFont font;
-  font.setTypeface(mgr->matchFamilyStyle("FreeSans", {}));
-  font.setSize(font_size);
 
-  paint.setColor(SK_ColorWHITE);
-  paint.setStyle(SkPaint::kFill_Style);
+void set_forwarding_canvas(SkCanvas* forwardingCanvas, SkCanvas* target)
+{
+  sForwardingCanvas = forwardingCanvas;
+  sForwardingTarget = forwardingCanvas ? target : nullptr;
+}
 
-  std::string text = std::to_string(font_size);
-  int text_width = font.measureText(text.c_str(), text.length(), SkTextEncoding::kUTF8);
 
-  canvas->drawSimpleText(text.c_str(), text.length(), SkTextEncoding::kUTF8,
-                         (w - text_width) / 2, h * 4 / 5, font, paint);
+void draw_scene_frame(Scene* scene, SkCanvas* canvas, int w, int h, int frame)
+{
+  // Textures of images that were decoded since the last frame.
+  image_cache_for(canvas)->beginFrame();
 
-  cnt++;
+  scene->render(canvas, w, h, frame);
 }
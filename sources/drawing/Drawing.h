@@ -20,6 +20,28 @@
 #ifndef DRAWING_H
 #define DRAWING_H
 
+// Draws the active scene (see Scenes.h, "default" unless selected otherwise).
 void draw_skia_scene(class SkCanvas*);
 
+// Draws the scene into the top-left width x height area of the canvas.
+// The canvas may be larger than the view (see SurfacePool).
+// Frames may be captured to .skp files (see FrameCapture.h).
+void draw_skia_scene(class SkCanvas*, int width, int height);
+
+// Draws a specific frame of the animation. Does not advance the internal frame counter.
+void draw_skia_scene_frame(class SkCanvas*, int width, int height, int frame);
+
+// Draws a frame of the given scene instead of the active one.
+void draw_scene_frame(class Scene*, class SkCanvas*, int width, int height, int frame);
+
+// The GPU context that the canvas draws to, nullptr for raster canvases. Caches use this instead
+// of SkCanvas::recordingContext(): while a frame is captured (see FrameCapture.h), the scene draws
+// to a canvas that forwards to the real canvas and a picture recorder, which reports the context
+// of the real canvas here.
+class GrRecordingContext* canvas_recording_context(class SkCanvas*);
+
+// Makes canvas_recording_context() report the context of 'target' for 'forwardingCanvas' on this
+// thread, until called again with nullptr.
+void set_forwarding_canvas(class SkCanvas* forwardingCanvas, class SkCanvas* target);
+
 #endif
@@ -18,18 +18,36 @@
 
 
 #include "DrawingWidget_Skia_GL.h"
+#include <QOpenGLContext>
 #include <QSurfaceFormat>
 
-#include <iostream>
 #include "Drawing.h"
+#include "Hud.h"
+#include "TextMode.h"
+#include "PresentConfig.h"
+#include "profiling/Tracing.h"
+#include "profiling/FrameStats.h"
+#include "profiling/LatencyProbe.h"
+#include "profiling/StartupProfile.h"
+#include "ShaderCache.h"
+#include "ImageCache.h"
+#include "LayerCache.h"
+#include "TileCache.h"
+#include "util/Log.h"
+
+#ifdef IM_HAVE_FRAME_EXPORT
+#include "FrameExport.h"
+#endif
 
 #ifdef _WIN32 // TODO(skia): how can we test the skia version?
 #include "gpu/GrDirectContext.h"
+#include "gpu/GrContextOptions.h"
 #include <gpu/gl/GrGLInterface.h>
 #include <gpu/ganesh/gl/GrGLDirectContext.h>
 #include <gpu/ganesh/SkSurfaceGanesh.h>
 #else
 #include "gpu/ganesh/GrDirectContext.h"
+#include "gpu/ganesh/GrContextOptions.h"
 #include "gpu/ganesh/gl/GrGLInterface.h"
 #include <gpu/ganesh/GrBackendSurface.h>
 #include <gpu/ganesh/SkSurfaceGanesh.h>
@@ -37,7 +55,11 @@
 
 
 
+static const int kResizeSettleTimeMs = 250;
+
+
 DrawingWidget_Skia_GL::DrawingWidget_Skia_GL()
+    : mSurfacePool([this](int w, int h) { return createSurface(w, h); })
 {
   setFocusPolicy(Qt::StrongFocus);
 
@@ -45,46 +67,104 @@ DrawingWidget_Skia_GL::DrawingWidget_Skia_GL()
 
   QSurfaceFormat format;
   format.setSamples(4); // Example: Enable multisampling
+  format.setSwapInterval(gl_swap_interval());
   setFormat(format);
+
+  connect(this, &QOpenGLWidget::frameSwapped, this, [] {
+    latency_probe().framePresented();
+    startup_frame_presented();
+  });
+
+  mResizeSettleTimer.setSingleShot(true);
+  mResizeSettleTimer.setInterval(kResizeSettleTimeMs);
+  connect(&mResizeSettleTimer, &QTimer::timeout, this, &DrawingWidget_Skia_GL::resizeSettled);
+}
+
+
+DrawingWidget_Skia_GL::~DrawingWidget_Skia_GL()
+{
+  cleanupGL();
 }
 
 
 void DrawingWidget_Skia_GL::initializeGL()
 {
+    STARTUP_PHASE("skia context");
+
     initializeOpenGLFunctions(); // Important!
 
+    GrContextOptions options;
+    apply_text_mode_context_options(options);
+    apply_shader_cache_context_options(options);
+
     auto glinterface = GrGLMakeNativeInterface();
-    m_grContext = GrDirectContexts::MakeGL(glinterface);
+    m_grContext = GrDirectContexts::MakeGL(glinterface, options);
     if (!m_grContext) {
       qFatal("Failed to create GrDirectContext!");
     }
+
+    connect(context(), &QOpenGLContext::aboutToBeDestroyed, this, &DrawingWidget_Skia_GL::cleanupGL, Qt::UniqueConnection);
+
+    mGpuTimer.init();
+}
+
+
+void DrawingWidget_Skia_GL::cleanupGL()
+{
+  if (!m_grContext) {
+    return;
+  }
+
+  makeCurrent();
+
+  mSurfacePool.clear();
+  release_image_cache(m_grContext.get());
+  release_text_mode_cache(m_grContext.get());
+  release_tile_cache(m_grContext.get());
+  release_layer_cache(m_grContext.get());
+
+  m_grContext->releaseResourcesAndAbandonContext();
+  m_grContext = nullptr;
+
+  doneCurrent();
 }
 
 
 void DrawingWidget_Skia_GL::resizeGL(int w, int h)
 {
+  // The surface is not reallocated here. All resize events up to the next paint are coalesced
+  // and paintGL() takes a pooled surface that fits.
+
   mViewWidth = w;
   mViewHeight = h;
 
-  if (m_grContext) {
-    createSurface(mViewWidth, mViewHeight);
-  }
+  mResizeSettleTimer.start();
 }
 
 
-void DrawingWidget_Skia_GL::createSurface(int w, int h)
+void DrawingWidget_Skia_GL::resizeSettled()
+{
+  makeCurrent();
+  mSurfacePool.trim(mViewWidth, mViewHeight);
+  doneCurrent();
+
+  LOG_DEBUG("surface pool: %d surface allocations so far", mSurfacePool.allocationCount());
+}
+
+
+sk_sp<SkSurface> DrawingWidget_Skia_GL::createSurface(int w, int h)
 {
   SkColorType colorType = kRGBA_8888_SkColorType;
+  SkSurfaceProps surfaceProps = text_mode_surface_props();
 
-  m_surface = nullptr;
-  m_surface = SkSurfaces::RenderTarget(
+  sk_sp<SkSurface> surface = SkSurfaces::RenderTarget(
           m_grContext.get(), // GrRecordingContext* context,
           skgpu::Budgeted::kNo, // skgpu::Budgeted budgeted,
           SkImageInfo::Make(w, h, colorType,
                             kOpaque_SkAlphaType), //const SkImageInfo& imageInfo,
           0, // int sampleCount,
           kBottomLeft_GrSurfaceOrigin,
-          nullptr, // &surfaceProps,
+          &surfaceProps,
           false, // bool shouldCreateWithMips = false,
           false); // bool isProtected = false);
 
@@ -93,28 +173,62 @@ void DrawingWidget_Skia_GL::createSurface(int w, int h)
     // Convert error code to string for better debugging
     //const char* errorString = reinterpret_cast<const char*>(gluErrorString(error));
     // qDebug() << "Error string:" << errorString << "\n";
-    std::cerr << "error " << error << "\n";
+    LOG_ERROR("GL error %u while creating the surface", error);
   }
 
-  if (!m_surface) {
+  if (!surface) {
     qFatal("Failed to create SkSurface");
   }
 
-  update();
+  return surface;
 }
 
 
 void DrawingWidget_Skia_GL::paintGL()
 {
-  if (m_surface) {
-    SkCanvas* canvas = m_surface->getCanvas();
+  TRACE_SCOPE("paintGL");
+
+  frame_stats().beginFrame();
+
+  mGpuTimer.poll();
 
-    draw_skia_scene(canvas);
+  SkSurface* surface = nullptr;
+  if (m_grContext) {
+    surface = mSurfacePool.acquire(mViewWidth, mViewHeight);
+  }
+
+  if (surface) {
+    SkCanvas* canvas = surface->getCanvas();
 
+    // Skia records the draws and only issues GL commands on flush.
+    draw_skia_scene(canvas, mViewWidth, mViewHeight);
+    draw_hud(canvas);
+
+    AllocStageScope allocStage(RenderStage::Flush);
+    mGpuTimer.begin();
     m_grContext->flush();
+    mGpuTimer.end();
+
+    latency_probe().frameSubmitted();
+
+#ifdef IM_HAVE_FRAME_EXPORT
+    // Read back straight into the consumer's shared buffer. This waits for the GPU.
+    FrameExporter::Buffer exportBuffer;
+    if (frame_exporter() && frame_exporter()->acquire(mViewWidth, mViewHeight, &exportBuffer)) {
+      TRACE_SCOPE("export readback");
+
+      if (surface->readPixels(exportBuffer.pixmap, 0, 0)) {
+        frame_exporter()->publish(exportBuffer, mFrameNumber);
+      }
+    }
+#endif
+
+    mFrameNumber++;
   }
 
   update();
+
+  frame_stats().endFrame();
 }
 
 
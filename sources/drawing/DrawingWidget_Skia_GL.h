@@ -22,6 +22,7 @@
 #include <QWidget>
 #include <QOpenGLWidget>
 #include <QOpenGLFunctions>
+#include <QTimer>
 
 #include <core/SkSurface.h>
 #include <gpu/ganesh/gl/GrGLDirectContext.h>
@@ -32,6 +33,9 @@
 #include "gpu/ganesh/GrDirectContext.h"
 #endif
 
+#include "SurfacePool.h"
+#include "profiling/GpuTimerGL.h"
+
 
 class DrawingWidget_Skia_GL : public QOpenGLWidget, protected QOpenGLFunctions
 {
@@ -40,6 +44,8 @@ Q_OBJECT
 public:
   DrawingWidget_Skia_GL();
 
+  ~DrawingWidget_Skia_GL() override;
+
 protected:
   void initializeGL() override;
 
@@ -54,9 +60,24 @@ private:
   int mViewWidth = 0, mViewHeight = 0;
 
   sk_sp<GrDirectContext> m_grContext;
-  sk_sp<SkSurface> m_surface;
 
-  void createSurface(int w, int h);
+  SurfacePool mSurfacePool;
+
+  GpuTimerGL mGpuTimer;
+
+  // Counts the rendered frames, for the sequence numbers of exported frames.
+  uint64_t mFrameNumber = 0;
+
+  // Fires when no resize event came in for a while. Only then oversized surfaces are released.
+  QTimer mResizeSettleTimer;
+
+  sk_sp<SkSurface> createSurface(int w, int h);
+
+  void resizeSettled();
+
+  // Frees the Skia resources while the GL context is still current. Called when the context is
+  // destroyed (e.g. the widget is reparented) and from the destructor.
+  void cleanupGL();
 };
 
 #endif
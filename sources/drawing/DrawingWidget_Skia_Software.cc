@@ -19,13 +19,21 @@
 
 #include "DrawingWidget_Skia_Software.h"
 #include "Drawing.h"
+#include "Hud.h"
+#include "profiling/Tracing.h"
+#include "profiling/FrameStats.h"
+#include "profiling/LatencyProbe.h"
+#include "profiling/StartupProfile.h"
+#include "util/Log.h"
+
+#ifdef IM_HAVE_FRAME_EXPORT
+#include "FrameExport.h"
+#endif
 
 #include <QSurfaceFormat>
 #include <QPainter>
 #include <QResizeEvent>
 
-#include <iostream>
-
 #include <core/SkPaint.h>
 #include <core/SkCanvas.h>
 
@@ -38,54 +46,115 @@
 #endif
 
 
+static const int kResizeSettleTimeMs = 250;
+
+
 DrawingWidget_Skia_Software::DrawingWidget_Skia_Software()
+    : mSurfacePool([](int w, int h) {
+        SkImageInfo imageInfo = SkImageInfo::Make(w, h, kRGBA_8888_SkColorType, kPremul_SkAlphaType);
+        return SkSurfaces::Raster(imageInfo);
+      })
 {
+  mResizeSettleTimer.setSingleShot(true);
+  mResizeSettleTimer.setInterval(kResizeSettleTimeMs);
+  connect(&mResizeSettleTimer, &QTimer::timeout, this, &DrawingWidget_Skia_Software::resizeSettled);
 }
 
 
 void DrawingWidget_Skia_Software::resizeEvent(QResizeEvent* e)
 {
+  // The surface is not reallocated here. All resize events up to the next paint are coalesced
+  // and paintEvent() takes a pooled surface that fits.
+
   mViewWidth = e->size().width();
   mViewHeight = e->size().height();
 
-  SkImageInfo imageInfo = SkImageInfo::Make(mViewWidth, mViewHeight,
-                                            kRGBA_8888_SkColorType, kPremul_SkAlphaType);
-  m_surface = SkSurfaces::Raster(imageInfo);
-
-  if (!m_surface) {
-    qFatal("Failed to create SkSurface");
-  }
+  mResizeSettleTimer.start();
 
   update();
 }
 
 
+void DrawingWidget_Skia_Software::resizeSettled()
+{
+  mSurfacePool.trim(mViewWidth, mViewHeight);
+
+  LOG_DEBUG("surface pool: %d surface allocations so far", mSurfacePool.allocationCount());
+}
+
+
 void DrawingWidget_Skia_Software::paintEvent(QPaintEvent* event)
 {
-  if (m_surface) {
-    SkCanvas* canvas = m_surface->getCanvas();
+  TRACE_SCOPE("paintEvent");
+
+  frame_stats().beginFrame();
+
+  SkSurface* surface = nullptr;
+
+#ifdef IM_HAVE_FRAME_EXPORT
+  // When a consumer is connected, render directly into one of its shared buffers.
+  FrameExporter::Buffer exportBuffer;
+  if (frame_exporter() && mViewWidth > 0 && mViewHeight > 0 &&
+      frame_exporter()->acquire(mViewWidth, mViewHeight, &exportBuffer)) {
+    surface = exportBuffer.surface;
+  }
+#endif
+
+  if (!surface) {
+    surface = mSurfacePool.acquire(mViewWidth, mViewHeight);
+  }
+
+  if (!surface && mViewWidth > 0 && mViewHeight > 0) {
+    qFatal("Failed to create SkSurface");
+  }
+
+  if (surface) {
+    SkCanvas* canvas = surface->getCanvas();
 
-    draw_skia_scene(canvas);
+    draw_skia_scene(canvas, mViewWidth, mViewHeight);
+    draw_hud(canvas);
+
+    latency_probe().frameSubmitted();
+
+#ifdef IM_HAVE_FRAME_EXPORT
+    if (exportBuffer.surface) {
+      frame_exporter()->publish(exportBuffer, mFrameNumber);
+    }
+#endif
+
+    mFrameNumber++;
 
     SkPixmap pixmap;
-    if (!m_surface->peekPixels(&pixmap)) {
+    if (!surface->peekPixels(&pixmap)) {
       return; // Handle error
     }
 
-    QImage image(
-        static_cast<const uchar*>(pixmap.addr()),
-        pixmap.width(),
-        pixmap.height(),
-        pixmap.rowBytes(),
-        QImage::Format_RGBA8888);
+    AllocStageScope allocStage(RenderStage::Present);
+
+    // only the top-left view area of the (possibly larger) pooled surface is used
+    if (pixmap.addr() != mImagePixels || mImage.width() != mViewWidth || mImage.height() != mViewHeight) {
+      mImage = QImage(
+          static_cast<const uchar*>(pixmap.addr()),
+          mViewWidth,
+          mViewHeight,
+          pixmap.rowBytes(),
+          QImage::Format_RGBA8888);
+      mImagePixels = pixmap.addr();
+    }
 
     QPainter painter(this);
 
     QRect sourceRect(0, 0, mViewWidth, mViewHeight);
     QRect targetRect(0, 0, QWidget::width(), QWidget::height());
 
-    painter.drawImage(targetRect, image, sourceRect);
+    painter.drawImage(targetRect, mImage, sourceRect);
+
+    // The backing store is flushed right after the paint event.
+    latency_probe().framePresented();
+    startup_frame_presented();
 
     update();
   }
+
+  frame_stats().endFrame();
 }
@@ -21,6 +21,7 @@
 #define DRAWINGWIDGET_SKIA_SOFTWARE_H
 
 #include <QWidget>
+#include <QTimer>
 
 #include <core/SkSurface.h>
 #include <gpu/ganesh/gl/GrGLDirectContext.h>
@@ -31,6 +32,8 @@
 #include "gpu/ganesh/GrDirectContext.h"
 #endif
 
+#include "SurfacePool.h"
+
 
 class DrawingWidget_Skia_Software : public QWidget
 {
@@ -45,11 +48,22 @@ protected:
   void resizeEvent(QResizeEvent* e) override;
 
 private:
-  int mViewWidth, mViewHeight;
+  int mViewWidth = 0, mViewHeight = 0;
+
+  SurfacePool mSurfacePool;
+
+  // QImage wrapping the pixels of the current surface. Only recreated when the surface or the
+  // view size changes, since constructing a QImage allocates.
+  QImage mImage;
+  const void* mImagePixels = nullptr;
+
+  // Counts the rendered frames, for the sequence numbers of exported frames.
+  uint64_t mFrameNumber = 0;
 
-  sk_sp<SkSurface> m_surface;
+  // Fires when no resize event came in for a while. Only then oversized surfaces are released.
+  QTimer mResizeSettleTimer;
 
-  void createSurface(int w, int h);
+  void resizeSettled();
 };
 
 #endif
@@ -19,19 +19,34 @@
 
 #include <third_party/vulkan/vulkan/vulkan_core.h>
 #include "Drawing.h"
+#include "Hud.h"
+#include "TextMode.h"
+#include "PresentConfig.h"
 
 #include "DrawingWindow_Skia_Vulkan.h"
 #include <QVulkanInstance>
 #include <QVulkanDeviceFunctions>
 
-#include <iostream>
 #include "NonSkiaVulkanRenderer.h"
+#include "UploadServiceVulkan.h"
+#include "CombinedVulkanRenderer.h"
+#include "profiling/Tracing.h"
+#include "util/Log.h"
+#include "profiling/FrameStats.h"
+#include "profiling/LatencyProbe.h"
+#include "profiling/GpuTimerVulkan.h"
+#include "profiling/StartupProfile.h"
+#include "ShaderCache.h"
+#include "ImageCache.h"
+#include "LayerCache.h"
+#include "TileCache.h"
 
 #include <core/SkPaint.h>
 #include <core/SkCanvas.h>
 
 #ifdef _WIN32 // TODO(skia): how can we test the skia version?
 #include "gpu/GrDirectContext.h"
+#include "gpu/GrContextOptions.h"
 #include <gpu/gl/GrGLInterface.h>
 #include <gpu/ganesh/gl/GrGLDirectContext.h>
 #include <gpu/ganesh/SkSurfaceGanesh.h>
@@ -39,6 +54,7 @@
 
 #include "gpu/ganesh/vk/GrVkTypes.h"
 #include "gpu/ganesh/GrDirectContext.h"
+#include "gpu/ganesh/GrContextOptions.h"
 #include "gpu/ganesh/vk/GrVkDirectContext.h"
 #include <gpu/ganesh/GrBackendSurface.h>
 #include <gpu/ganesh/SkSurfaceGanesh.h>
@@ -47,16 +63,35 @@
 #endif
 
 
+#ifdef NDEBUG
+static bool sVulkanValidation = false;
+#else
+static bool sVulkanValidation = true;
+#endif
+
+
+void set_vulkan_validation_enabled(bool enable)
+{
+  sVulkanValidation = enable;
+}
+
+
 QVulkanInstance* get_vulkan_instance()
 {
   static QVulkanInstance sInstance;
   static bool initialized = false;
 
   if (!initialized) {
-    sInstance.setLayers({"VK_LAYER_KHRONOS_validation"}); // , "VK_LAYER_LUNARG_api_dump"});
+    STARTUP_PHASE("vulkan instance");
+
+    // Loading the validation layer is a large part of the instance creation time.
+    if (sVulkanValidation) {
+      sInstance.setLayers({"VK_LAYER_KHRONOS_validation"}); // , "VK_LAYER_LUNARG_api_dump"});
+    }
+
     sInstance.setApiVersion(QVersionNumber(1,1,0));
     if (!sInstance.create()) {
-      std::cerr << "Failed to create Vulkan instance: " << sInstance.errorCode() << "\n";
+      LOG_ERROR("Failed to create Vulkan instance: %d", sInstance.errorCode());
       return nullptr;
     }
 
@@ -67,14 +102,25 @@ QVulkanInstance* get_vulkan_instance()
 }
 
 
-DrawingWindow_Skia_Vulkan::DrawingWindow_Skia_Vulkan(bool skia)
-    : mSkia(skia)
+DrawingWindow_Skia_Vulkan::DrawingWindow_Skia_Vulkan(VulkanRendererType type)
+    : mType(type)
 {
   auto* vulkan_instance = get_vulkan_instance();
   if (!vulkan_instance) {
     assert(false);
   }
   setVulkanInstance(vulkan_instance);
+
+  // For the GPU-culled draws of the native renderer. QVulkanWindow skips unsupported extensions.
+  if (type != VulkanRendererType::Skia) {
+    setDeviceExtensions({ QByteArrayLiteral("VK_KHR_draw_indirect_count") });
+    request_transfer_queue(this);
+  }
+
+  if (present_config().presentMode != PresentMode::Fifo) {
+    LOG_WARNING("present mode '%s' is not supported by QVulkanWindow, using 'fifo'",
+                present_mode_name(present_config().presentMode));
+  }
 }
 
 
@@ -91,6 +137,7 @@ public:
   void initResources() override
   {
     initSkia();
+    mGpuTimer.init(mWindow);
   }
 
   //Set up resources - only MVP-matrix for now:
@@ -101,7 +148,7 @@ public:
 
   //Release Vulkan resources when program ends
   //Called by Qt
-  //void releaseResources() override;
+  void releaseResources() override;
 
   //Render the next frame
   void startNextFrame() override;
@@ -113,8 +160,12 @@ protected:
   QVulkanWindow* mWindow{nullptr};
 
   sk_sp<GrDirectContext> m_grContext;
+
+  // Created once per swap chain size instead of per frame.
   sk_sp<SkSurface> m_surface;
 
+  GpuTimerVulkan mGpuTimer;
+
   void paintVK();
 };
 
@@ -125,12 +176,12 @@ SkiaRenderer::SkiaRenderer(QVulkanWindow* w, bool msaa)
   if (msaa) {
     const QVector<int> counts = w->supportedSampleCounts();
     for (int s : counts) {
-      std::cout << "Supported sample counts:" << s << "\n";
+      LOG_DEBUG("Supported sample count: %d", s);
     }
 
     for (int s = 16; s >= 4; s /= 2) {
       if (counts.contains(s)) {
-        qDebug("Requesting sample count %d", s);
+        LOG_DEBUG("Requesting sample count %d", s);
         mWindow->setSampleCount(s);
         break;
       }
@@ -151,12 +202,32 @@ PFN_vkVoidFunction my_get_proc(
 
 void SkiaRenderer::initSkia()
 {
-  QVulkanInstance* qVkInst = mWindow->vulkanInstance();
-  VkInstance vkInstance = qVkInst->vkInstance();
-  VkPhysicalDevice physicalDevice = mWindow->physicalDevice();
-  VkDevice vkDevice = mWindow->device();
-  VkQueue queue = mWindow->graphicsQueue();
-  uint32_t queueFamilyIndex = mWindow->graphicsQueueFamilyIndex();
+  // Store grContext for use during rendering.
+  m_grContext = make_skia_vulkan_context(mWindow);
+
+  m_grContext->flushAndSubmit();
+}
+
+
+sk_sp<GrDirectContext> make_skia_vulkan_context(QVulkanWindow* window)
+{
+  sk_sp<GrDirectContext> grContext = make_skia_vulkan_context(window->vulkanInstance()->vkInstance(),
+                                                              window->physicalDevice(),
+                                                              window->device(),
+                                                              window->graphicsQueue(),
+                                                              window->graphicsQueueFamilyIndex());
+  if (!grContext) {
+    qFatal("Failed to create Skia GrDirectContext with Vulkan");
+  }
+
+  return grContext;
+}
+
+
+sk_sp<GrDirectContext> make_skia_vulkan_context(VkInstance vkInstance, VkPhysicalDevice physicalDevice, VkDevice vkDevice,
+                                                VkQueue queue, uint32_t queueFamilyIndex)
+{
+  STARTUP_PHASE("skia context");
 
   // --- Fill in the Skia backend context
 
@@ -218,38 +289,96 @@ void SkiaRenderer::initSkia()
   // (Optionally, if needed, set fPhysicalDeviceFeatures, fDeviceFeatures, etc.)
 
   // Create Skia’s direct context using Vulkan.
-  sk_sp<GrDirectContext> grContext = GrDirectContexts::MakeVulkan(backendContext);
+  GrContextOptions options;
+  apply_text_mode_context_options(options);
+  apply_shader_cache_context_options(options);
+
+  sk_sp<GrDirectContext> grContext = GrDirectContexts::MakeVulkan(backendContext, options);
   if (!grContext) {
-    qFatal("Failed to create Skia GrDirectContext with Vulkan");
+    LOG_ERROR("Failed to create Skia GrDirectContext with Vulkan");
   }
 
-  // Store grContext for use during rendering.
-  m_grContext = grContext;
-
-  grContext->flushAndSubmit();
+  return grContext;
 }
 
 void SkiaRenderer::initSwapChainResources()
 {
+  STARTUP_PHASE("swapchain surface");
+
   const QSize sz = mWindow->swapChainImageSize();
+
+  SkColorType colorType = kBGRA_8888_SkColorType; // or match your VkFormat
+  SkSurfaceProps surfaceProps = text_mode_surface_props();
+
+  m_surface = SkSurfaces::RenderTarget(
+      m_grContext.get(), // GrRecordingContext* context,
+      skgpu::Budgeted::kNo, // skgpu::Budgeted budgeted,
+      SkImageInfo::Make(sz.width(), sz.height(), colorType,
+                        kOpaque_SkAlphaType), //const SkImageInfo& imageInfo,
+      0, // int sampleCount,
+      kTopLeft_GrSurfaceOrigin,
+      &surfaceProps,
+      false, // bool shouldCreateWithMips = false,
+      false); // bool isProtected = false);
+
+  if (!m_surface) {
+    qFatal("Failed to create SkSurface");
+  }
 }
 
 
 void SkiaRenderer::releaseSwapChainResources()
 {
+  m_surface = nullptr;
+}
+
+
+void SkiaRenderer::releaseResources()
+{
+  mGpuTimer.release();
+
+  // The device is destroyed after this, free everything Skia holds on it now.
+  m_surface = nullptr;
+  release_image_cache(m_grContext.get());
+  release_text_mode_cache(m_grContext.get());
+  release_tile_cache(m_grContext.get());
+  release_layer_cache(m_grContext.get());
+
+  if (m_grContext) {
+    m_grContext->releaseResourcesAndAbandonContext();
+    m_grContext = nullptr;
+  }
 }
 
 
 void SkiaRenderer::startNextFrame()
 {
+  TRACE_SCOPE("SkiaRenderer::startNextFrame");
+
+  frame_stats().beginFrame();
+
+  wait_for_frames_in_flight(mWindow);
+
+  mGpuTimer.poll();
+
   paintVK();
 
-  mWindow->frameReady();
-  mWindow->requestUpdate(); // render continuously, throttled by the presentation rate
+  {
+    AllocStageScope allocStage(RenderStage::Present);
+    mWindow->frameReady();
+    mWindow->requestUpdate(); // render continuously, throttled by the presentation rate
+  }
+
+  latency_probe().framePresented();
+  startup_frame_presented();
+
+  frame_stats().endFrame();
 }
 
 void SkiaRenderer::paintVK()
 {
+  TRACE_SCOPE("paintVK");
+
   // Retrieve the current Vulkan command buffer and framebuffer info from QVulkanWindow.
   VkCommandBuffer cmdBuffer = mWindow->currentCommandBuffer();
   // You can obtain the current VkImage from the framebuffer, etc.
@@ -258,7 +387,7 @@ void SkiaRenderer::paintVK()
   int currentFrame;
   //currentFrame = mWindow->currentFrame();
   currentFrame = mWindow->currentSwapChainImageIndex();
-  printf("currentFrame: %d\n", currentFrame);
+  LOG_TRACE("currentFrame: %d", currentFrame);
 
   // Suppose you have the VkImage and its info:
   VkImage image = mWindow->swapChainImage(currentFrame);
@@ -294,20 +423,7 @@ void SkiaRenderer::paintVK()
 
   int w = mWindow->swapChainImageSize().width();
   int h = mWindow->swapChainImageSize().height();
-  printf("size: %d x %d\n", w, h);
-
-  SkColorType colorType = kBGRA_8888_SkColorType; // or match your VkFormat
-
-  m_surface = SkSurfaces::RenderTarget(
-      m_grContext.get(), // GrRecordingContext* context,
-      skgpu::Budgeted::kNo, // skgpu::Budgeted budgeted,
-      SkImageInfo::Make(w, h, colorType,
-                        kOpaque_SkAlphaType), //const SkImageInfo& imageInfo,
-      0, // int sampleCount,
-      kTopLeft_GrSurfaceOrigin,
-      nullptr, // &surfaceProps,
-      false, // bool shouldCreateWithMips = false,
-      false); // bool isProtected = false);
+  LOG_TRACE("size: %d x %d", w, h);
 
   // Draw with Skia:
   SkCanvas* canvas = m_surface->getCanvas();
@@ -315,20 +431,33 @@ void SkiaRenderer::paintVK()
   // ... perform additional drawing ...
 
   draw_skia_scene(canvas);
+  draw_hud(canvas);
 
   // Flush Skia drawing commands.
 
+  AllocStageScope allocStage(RenderStage::Flush);
+
+  // Skia submits its own command buffers; they are bracketed by the timer's.
+  mGpuTimer.submitBegin();
   //m_grContext->submit();
   m_grContext->flushAndSubmit();
+  mGpuTimer.submitEnd();
+
+  latency_probe().frameSubmitted();
 }
 
 
 QVulkanWindowRenderer* DrawingWindow_Skia_Vulkan::createRenderer()
 {
-  if (mSkia) {
-    return new SkiaRenderer(this, false);
-  }
-  else {
-    return new NonSkiaVulkanRenderer(this, true);
+  switch (mType) {
+    case VulkanRendererType::Skia:
+      return new SkiaRenderer(this, false);
+    case VulkanRendererType::NonSkia:
+      return new NonSkiaVulkanRenderer(this, true);
+    case VulkanRendererType::Combined:
+      // Skia's secondary command buffer has to match the sample count of the render pass.
+      return new CombinedVulkanRenderer(this);
   }
+
+  return nullptr;
 }
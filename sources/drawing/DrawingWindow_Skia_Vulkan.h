@@ -31,17 +31,39 @@
 #endif
 
 
+enum class VulkanRendererType {
+  Skia,     // Skia draws everything
+  NonSkia,  // native Vulkan triangle only
+  Combined  // native Vulkan scene with a Skia overlay in the same render pass
+};
+
+
 class DrawingWindow_Skia_Vulkan : public QVulkanWindow
 {
 Q_OBJECT
 
 public:
-  DrawingWindow_Skia_Vulkan(bool skia);
+  DrawingWindow_Skia_Vulkan(VulkanRendererType);
 
   QVulkanWindowRenderer* createRenderer() override;
 
 private:
-  bool mSkia;
+  VulkanRendererType mType;
 };
 
+
+// Enables VK_LAYER_KHRONOS_validation for the Vulkan instance. Must be called before the
+// first window is created. Default: enabled in debug builds.
+void set_vulkan_validation_enabled(bool enable);
+
+// Creates a Skia context on the device and graphics queue of the window.
+sk_sp<GrDirectContext> make_skia_vulkan_context(QVulkanWindow*);
+
+// Same for a device that was created without a window (e.g. for offscreen rendering).
+// The device must have been created with all features of the physical device except
+// robustBufferAccess enabled, like QVulkanWindow does. Returns nullptr on failure.
+sk_sp<GrDirectContext> make_skia_vulkan_context(VkInstance, VkPhysicalDevice, VkDevice, VkQueue, uint32_t queueFamilyIndex);
+
+QVulkanInstance* get_vulkan_instance();
+
 #endif
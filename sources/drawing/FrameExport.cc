@@ -0,0 +1,321 @@
+/*
+ * Copyright (C) 2025 by Dirk Farin, Kronenstr. 49b, 70174 Stuttgart, Germany
+ *
+ * 2-Clause BSD
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer
+ *    in the documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "FrameExport.h"
+#include "profiling/Tracing.h"
+#include "util/Log.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <memory>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using frame_export::Message;
+using frame_export::MessageType;
+
+
+FrameExporter::FrameExporter(const std::string& socketPath, int nBuffers, SkColorType colorType)
+    : mSocketPath(socketPath),
+      mBufferCount(std::max(2, std::min(nBuffers, frame_export::kMaxBuffers))),
+      mColorType(colorType)
+{
+  sockaddr_un addr{};
+  addr.sun_family = AF_UNIX;
+  if (socketPath.size() >= sizeof(addr.sun_path)) {
+    LOG_ERROR("frame export: socket path too long: %s", socketPath.c_str());
+    return;
+  }
+
+  strcpy(addr.sun_path, socketPath.c_str());
+
+  mListenFd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (mListenFd < 0) {
+    LOG_ERROR("frame export: socket: %s", strerror(errno));
+    return;
+  }
+
+  unlink(socketPath.c_str());
+
+  if (bind(mListenFd, (sockaddr*) &addr, sizeof(addr)) < 0 || listen(mListenFd, 1) < 0) {
+    LOG_ERROR("frame export: bind: %s", strerror(errno));
+    close(mListenFd);
+    mListenFd = -1;
+  }
+}
+
+
+FrameExporter::~FrameExporter()
+{
+  disconnectConsumer();
+  freeRing();
+
+  if (mListenFd >= 0) {
+    close(mListenFd);
+    unlink(mSocketPath.c_str());
+  }
+}
+
+
+void FrameExporter::acceptConsumer()
+{
+  if (mClientFd >= 0 || mListenFd < 0) {
+    return;
+  }
+
+  mClientFd = accept4(mListenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+  if (mClientFd >= 0) {
+    mBufferSetSent = false;
+    for (auto& slot : mSlots) {
+      slot.held = false;
+    }
+  }
+}
+
+
+void FrameExporter::disconnectConsumer()
+{
+  if (mClientFd >= 0) {
+    close(mClientFd);
+    mClientFd = -1;
+  }
+
+  for (auto& slot : mSlots) {
+    slot.held = false;
+  }
+}
+
+
+void FrameExporter::readReleases()
+{
+  while (mClientFd >= 0) {
+    Message msg;
+    ssize_t n = recv(mClientFd, &msg, sizeof(msg), 0);
+    if (n == 0) {
+      disconnectConsumer();
+      return;
+    }
+
+    if (n < 0) {
+      if (errno != EAGAIN && errno != EWOULDBLOCK) {
+        disconnectConsumer();
+      }
+      return;
+    }
+
+    if (n == sizeof(msg) && msg.type == MessageType::Release &&
+        msg.generation == mGeneration && msg.index < mSlots.size()) {
+      mSlots[msg.index].held = false;
+    }
+  }
+}
+
+
+bool FrameExporter::allocateRing(int width, int height)
+{
+  TRACE_SCOPE("FrameExporter::allocateRing");
+
+  freeRing();
+
+  SkImageInfo info = SkImageInfo::Make(width, height, mColorType, kPremul_SkAlphaType);
+  mRowBytes = info.minRowBytes();
+  mBufferSize = info.computeByteSize(mRowBytes);
+
+  mSlots.resize(mBufferCount);
+  for (auto& slot : mSlots) {
+    slot.fd = memfd_create("qtskia-frame", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (slot.fd < 0 || ftruncate(slot.fd, (off_t) mBufferSize) < 0) {
+      LOG_ERROR("frame export: memfd: %s", strerror(errno));
+      freeRing();
+      return false;
+    }
+
+    // The consumer may rely on the size not changing under its mapping.
+    fcntl(slot.fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL);
+
+    slot.pixels = mmap(nullptr, mBufferSize, PROT_READ | PROT_WRITE, MAP_SHARED, slot.fd, 0);
+    if (slot.pixels == MAP_FAILED) {
+      slot.pixels = nullptr;
+      LOG_ERROR("frame export: mmap: %s", strerror(errno));
+      freeRing();
+      return false;
+    }
+
+    slot.surface = SkSurfaces::WrapPixels(info, slot.pixels, mRowBytes);
+  }
+
+  mWidth = width;
+  mHeight = height;
+  mGeneration++;
+  mBufferSetSent = false;
+  mNextSlot = 0;
+  mStats.reallocations++;
+
+  return true;
+}
+
+
+void FrameExporter::freeRing()
+{
+  for (auto& slot : mSlots) {
+    slot.surface = nullptr;
+    if (slot.pixels) {
+      munmap(slot.pixels, mBufferSize);
+    }
+    if (slot.fd >= 0) {
+      close(slot.fd);
+    }
+  }
+
+  mSlots.clear();
+  mWidth = mHeight = 0;
+}
+
+
+bool FrameExporter::sendBufferSet()
+{
+  Message msg{};
+  msg.type = MessageType::BufferSet;
+  msg.generation = mGeneration;
+  msg.index = (uint32_t) mSlots.size();
+  msg.width = mWidth;
+  msg.height = mHeight;
+  msg.rowBytes = (uint32_t) mRowBytes;
+  msg.colorType = mColorType;
+  msg.bufferSize = mBufferSize;
+
+  int fds[frame_export::kMaxBuffers];
+  for (size_t i = 0; i < mSlots.size(); i++) {
+    fds[i] = mSlots[i].fd;
+  }
+
+  iovec iov{&msg, sizeof(msg)};
+
+  alignas(cmsghdr) char control[CMSG_SPACE(sizeof(fds))]{};
+
+  msghdr mh{};
+  mh.msg_iov = &iov;
+  mh.msg_iovlen = 1;
+  mh.msg_control = control;
+  mh.msg_controllen = CMSG_SPACE(sizeof(int) * mSlots.size());
+
+  cmsghdr* cmsg = CMSG_FIRSTHDR(&mh);
+  cmsg->cmsg_level = SOL_SOCKET;
+  cmsg->cmsg_type = SCM_RIGHTS;
+  cmsg->cmsg_len = CMSG_LEN(sizeof(int) * mSlots.size());
+  memcpy(CMSG_DATA(cmsg), fds, sizeof(int) * mSlots.size());
+
+  if (sendmsg(mClientFd, &mh, MSG_NOSIGNAL) != sizeof(msg)) {
+    disconnectConsumer();
+    return false;
+  }
+
+  mBufferSetSent = true;
+  return true;
+}
+
+
+bool FrameExporter::acquire(int width, int height, Buffer* buffer)
+{
+  acceptConsumer();
+  readReleases();
+
+  if (mClientFd < 0) {
+    mStats.skippedNoConsumer++;
+    return false;
+  }
+
+  if (width != mWidth || height != mHeight) {
+    // The consumer keeps its own mappings of the old buffers; it drops them on the next BufferSet.
+    if (!allocateRing(width, height)) {
+      return false;
+    }
+  }
+
+  if (!mBufferSetSent && !sendBufferSet()) {
+    mStats.skippedNoConsumer++;
+    return false;
+  }
+
+  for (int i = 0; i < (int) mSlots.size(); i++) {
+    int idx = (mNextSlot + i) % (int) mSlots.size();
+    Slot& slot = mSlots[idx];
+    if (!slot.held) {
+      buffer->index = idx;
+      buffer->surface = slot.surface.get();
+      buffer->pixmap.reset(slot.surface->imageInfo(), slot.pixels, mRowBytes);
+      mNextSlot = (idx + 1) % (int) mSlots.size();
+      return true;
+    }
+  }
+
+  mStats.skippedNoBuffer++;
+  return false;
+}
+
+
+void FrameExporter::publish(const Buffer& buffer, uint64_t frameNumber)
+{
+  if (mClientFd < 0 || buffer.index < 0 || buffer.index >= (int) mSlots.size()) {
+    return;
+  }
+
+  Message msg{};
+  msg.type = MessageType::Frame;
+  msg.generation = mGeneration;
+  msg.index = buffer.index;
+  msg.width = mWidth;
+  msg.height = mHeight;
+  msg.rowBytes = (uint32_t) mRowBytes;
+  msg.colorType = mColorType;
+  msg.sequence = frameNumber;
+
+  if (send(mClientFd, &msg, sizeof(msg), MSG_NOSIGNAL) != sizeof(msg)) {
+    disconnectConsumer();
+    return;
+  }
+
+  mSlots[buffer.index].held = true;
+  mStats.exported++;
+}
+
+
+static std::unique_ptr<FrameExporter> sFrameExporter;
+
+FrameExporter* frame_exporter()
+{
+  return sFrameExporter.get();
+}
+
+
+bool enable_frame_export(const std::string& socketPath)
+{
+  sFrameExporter = std::make_unique<FrameExporter>(socketPath);
+  if (!sFrameExporter->ok()) {
+    sFrameExporter.reset();
+    return false;
+  }
+
+  return true;
+}
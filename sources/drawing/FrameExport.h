@@ -0,0 +1,158 @@
+/*
+ * Copyright (C) 2025 by Dirk Farin, Kronenstr. 49b, 70174 Stuttgart, Germany
+ *
+ * 2-Clause BSD
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer
+ *    in the documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef FRAMEEXPORT_H
+#define FRAMEEXPORT_H
+
+#include <core/SkPixmap.h>
+#include <core/SkSurface.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+
+// Hands rendered frames to another process (e.g. a video encoder) without copying them.
+// Linux only (memfd, SCM_RIGHTS); compiled when IM_HAVE_FRAME_EXPORT is defined.
+//
+// The exporter owns a ring of memfd-backed shared-memory buffers and listens on a Unix
+// socket. When a consumer connects, it receives the buffer file descriptors (BufferSet) and
+// maps them once. For each exported frame, the producer renders directly into a free buffer
+// and sends its index with a sequence number (Frame). The buffer belongs to the consumer until
+// it sends it back (Release); the producer never writes into a buffer the consumer holds.
+// If the consumer falls behind and no buffer is free, the frame is not exported and the
+// sequence number shows the gap.
+//
+// When the frame size changes, the ring is reallocated and sent again with a new generation.
+// Releases of older generations are ignored.
+
+namespace frame_export {
+
+enum class MessageType : uint32_t
+{
+  BufferSet = 1, // producer -> consumer, carries the buffer fds
+  Frame = 2,     // producer -> consumer
+  Release = 3    // consumer -> producer
+};
+
+// All messages have the same layout. Sent over a SOCK_SEQPACKET socket.
+struct Message
+{
+  MessageType type;
+  uint32_t generation;
+  uint32_t index;       // buffer index, or the number of buffers for BufferSet
+  uint32_t width;
+  uint32_t height;
+  uint32_t rowBytes;
+  uint32_t colorType;   // SkColorType
+  uint32_t reserved;
+  uint64_t sequence;    // Frame: producer frame counter
+  uint64_t bufferSize;  // BufferSet: size of each buffer
+};
+
+const int kMaxBuffers = 8;
+
+}
+
+
+class FrameExporter
+{
+public:
+  struct Buffer
+  {
+    int index = -1;
+    SkSurface* surface = nullptr; // renders directly into the shared memory
+    SkPixmap pixmap;              // for copying GPU readbacks into the buffer
+  };
+
+  struct Stats
+  {
+    uint64_t exported = 0;
+    uint64_t skippedNoConsumer = 0;
+    uint64_t skippedNoBuffer = 0;
+    uint64_t reallocations = 0;
+  };
+
+  // Listens on 'socketPath' (an existing socket file is replaced).
+  FrameExporter(const std::string& socketPath, int nBuffers = 3, SkColorType colorType = kRGBA_8888_SkColorType);
+
+  ~FrameExporter();
+
+  FrameExporter(const FrameExporter&) = delete;
+  FrameExporter& operator=(const FrameExporter&) = delete;
+
+  bool ok() const { return mListenFd >= 0; }
+
+  // Gets a free buffer of width x height for the next frame. Accepts a waiting consumer and
+  // processes its releases first; never blocks. Returns false if there is no consumer or all
+  // buffers are held by it.
+  bool acquire(int width, int height, Buffer* buffer);
+
+  // Passes the buffer to the consumer. 'frameNumber' should count all rendered frames, so that
+  // the consumer can see how many were skipped.
+  void publish(const Buffer& buffer, uint64_t frameNumber);
+
+  const Stats& stats() const { return mStats; }
+
+private:
+  struct Slot
+  {
+    int fd = -1;
+    void* pixels = nullptr;
+    sk_sp<SkSurface> surface;
+    bool held = false; // owned by the consumer
+  };
+
+  std::string mSocketPath;
+  int mListenFd = -1;
+  int mClientFd = -1;
+
+  int mBufferCount;
+  SkColorType mColorType;
+
+  std::vector<Slot> mSlots;
+  int mWidth = 0, mHeight = 0;
+  size_t mRowBytes = 0;
+  size_t mBufferSize = 0;
+  uint32_t mGeneration = 0;
+  bool mBufferSetSent = false;
+  int mNextSlot = 0;
+
+  Stats mStats;
+
+  void acceptConsumer();
+
+  void readReleases();
+
+  void disconnectConsumer();
+
+  bool allocateRing(int width, int height);
+
+  void freeRing();
+
+  bool sendBufferSet();
+};
+
+
+// Exporter of the interactive backends. nullptr unless enable_frame_export() was called.
+FrameExporter* frame_exporter();
+
+bool enable_frame_export(const std::string& socketPath);
+
+#endif
@@ -0,0 +1,503 @@
+/*
+ * Copyright (C) 2025 by Dirk Farin, Kronenstr. 49b, 70174 Stuttgart, Germany
+ *
+ * 2-Clause BSD
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer
+ *    in the documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "GpuCullingVulkan.h"
+#include "VulkanAssets.h"
+#include "util/Log.h"
+
+#include <QVulkanDeviceFunctions>
+#include <QVulkanFunctions>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+
+// std140 layout of FrameData in cull.comp and culled.vert
+struct FrameData
+{
+  float viewProj[16];
+  float planes[6][4];
+  float rotation;
+  uint32_t objectCount;
+  uint32_t pad[2];
+};
+
+// std430 layout of Object
+struct Object
+{
+  float sphere[4];
+  float params[4];
+};
+
+static const uint16_t kIndices[] = { 0, 1, 2 };
+
+// Radius of the bounding sphere of the triangle in vertexData (NonSkiaVulkanRenderer.cc).
+static const float kTriangleRadius = 0.71f;
+
+// Height of the plane z = 0 that is visible with the projection of NonSkiaVulkanRenderer.
+static const float kViewHeight = 1.7f;
+
+// The objects are created before the swapchain size is known.
+static const float kAssumedAspect = 16.0f / 9.0f;
+
+static const int kWorkgroupSize = 64; // local_size_x in cull.comp
+
+
+static inline VkDeviceSize aligned(VkDeviceSize v, VkDeviceSize byteAlign)
+{
+  return (v + byteAlign - 1) & ~(byteAlign - 1);
+}
+
+
+bool GpuCullingVulkan::init(QVulkanWindow* window, VkPipelineCache pipelineCache,
+                            VkGraphicsPipelineCreateInfo drawPipelineInfo, int objectCount)
+{
+  mWindow = window;
+  mObjectCount = std::max(1, objectCount);
+
+  QVulkanInstance* inst = window->vulkanInstance();
+  mDevFuncs = inst->deviceFunctions(window->device());
+
+  // --- check the device
+
+  VkPhysicalDeviceFeatures features;
+  inst->functions()->vkGetPhysicalDeviceFeatures(window->physicalDevice(), &features);
+
+  // QVulkanWindow enables all supported features (except robustBufferAccess).
+  if (!features.drawIndirectFirstInstance) {
+    LOG_WARNING("GPU culling needs drawIndirectFirstInstance, which the device does not support");
+    return false;
+  }
+
+  mMultiDrawIndirect = features.multiDrawIndirect;
+  mMaxDrawCount = features.multiDrawIndirect ? (int) std::min<uint32_t>(window->physicalDeviceProperties()->limits.maxDrawIndirectCount, INT32_MAX) : 1;
+
+  if (mObjectCount <= mMaxDrawCount &&
+      window->supportedDeviceExtensions().contains(QByteArrayLiteral("VK_KHR_draw_indirect_count"))) {
+    auto getDeviceProcAddr = reinterpret_cast<PFN_vkGetDeviceProcAddr>(inst->getInstanceProcAddr("vkGetDeviceProcAddr"));
+    mDrawIndirectCount = reinterpret_cast<PFN_vkCmdDrawIndexedIndirectCountKHR>(
+        getDeviceProcAddr(window->device(), "vkCmdDrawIndexedIndirectCountKHR"));
+  }
+
+  if (!createBuffers()) {
+    release();
+    return false;
+  }
+
+  createObjects();
+
+  if (!createPipelines(pipelineCache, drawPipelineInfo)) {
+    release();
+    return false;
+  }
+
+  LOG_INFO("GPU culling of %d objects, %s", mObjectCount,
+           mDrawIndirectCount ? "indirect draw count" : (mMultiDrawIndirect ? "multi draw indirect" : "one indirect draw per object"));
+
+  return true;
+}
+
+
+bool GpuCullingVulkan::createBuffers()
+{
+  VkDevice dev = mWindow->device();
+  const VkPhysicalDeviceLimits& limits = mWindow->physicalDeviceProperties()->limits;
+  const VkDeviceSize align = std::max(limits.minUniformBufferOffsetAlignment, limits.minStorageBufferOffsetAlignment);
+  const int concurrentFrameCount = mWindow->concurrentFrameCount();
+
+  // --- static buffer: indices, objects, frame data
+
+  mObjectsOffset = aligned(sizeof(kIndices), align);
+  mObjectsSize = mObjectCount * sizeof(Object);
+  mFrameDataOffset = aligned(mObjectsOffset + mObjectsSize, align);
+  mFrameDataStride = aligned(sizeof(FrameData), align);
+
+  VkBufferCreateInfo bufInfo{};
+  bufInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+  bufInfo.size = mFrameDataOffset + concurrentFrameCount * mFrameDataStride;
+  bufInfo.usage = VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT;
+
+  if (mDevFuncs->vkCreateBuffer(dev, &bufInfo, nullptr, &mStaticBuffer) != VK_SUCCESS) {
+    LOG_WARNING("Failed to create the object buffer");
+    return false;
+  }
+
+  VkMemoryRequirements memReq;
+  mDevFuncs->vkGetBufferMemoryRequirements(dev, mStaticBuffer, &memReq);
+
+  VkMemoryAllocateInfo memAllocInfo{};
+  memAllocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+  memAllocInfo.allocationSize = memReq.size;
+  memAllocInfo.memoryTypeIndex = mWindow->hostVisibleMemoryIndex();
+
+  if (mDevFuncs->vkAllocateMemory(dev, &memAllocInfo, nullptr, &mStaticMemory) != VK_SUCCESS) {
+    LOG_WARNING("Failed to allocate %d bytes for the object buffer", (int) memReq.size);
+    return false;
+  }
+
+  mDevFuncs->vkBindBufferMemory(dev, mStaticBuffer, mStaticMemory, 0);
+
+  if (mDevFuncs->vkMapMemory(dev, mStaticMemory, 0, memReq.size, 0, reinterpret_cast<void**>(&mMapped)) != VK_SUCCESS) {
+    LOG_WARNING("Failed to map the object buffer");
+    return false;
+  }
+
+  memcpy(mMapped, kIndices, sizeof(kIndices));
+
+  // --- indirect buffer: draw count and commands, written by the compute shader
+
+  // vkCmdFillBuffer() needs multiples of 4
+  const VkDeviceSize storageAlign = std::max<VkDeviceSize>(4, limits.minStorageBufferOffsetAlignment);
+  mCommandsOffset = aligned(sizeof(uint32_t), storageAlign);
+  mIndirectStride = aligned(mCommandsOffset + mObjectCount * sizeof(VkDrawIndexedIndirectCommand), storageAlign);
+
+  bufInfo.size = concurrentFrameCount * mIndirectStride;
+  bufInfo.usage = VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+
+  if (mDevFuncs->vkCreateBuffer(dev, &bufInfo, nullptr, &mIndirectBuffer) != VK_SUCCESS) {
+    LOG_WARNING("Failed to create the indirect buffer");
+    return false;
+  }
+
+  mDevFuncs->vkGetBufferMemoryRequirements(dev, mIndirectBuffer, &memReq);
+  memAllocInfo.allocationSize = memReq.size;
+  memAllocInfo.memoryTypeIndex = mWindow->deviceLocalMemoryIndex();
+
+  if (mDevFuncs->vkAllocateMemory(dev, &memAllocInfo, nullptr, &mIndirectMemory) != VK_SUCCESS) {
+    LOG_WARNING("Failed to allocate %d bytes for the indirect buffer", (int) memReq.size);
+    return false;
+  }
+
+  mDevFuncs->vkBindBufferMemory(dev, mIndirectBuffer, mIndirectMemory, 0);
+
+  return true;
+}
+
+
+void GpuCullingVulkan::createObjects()
+{
+  // A grid of cells, three views wide and one view high.
+
+  mViewWidth = kViewHeight * kAssumedAspect;
+  mWorldWidth = 3 * mViewWidth;
+
+  float cell = std::sqrt(mWorldWidth * kViewHeight / mObjectCount);
+  int columns = std::max(1, (int) std::ceil(mWorldWidth / cell));
+  int rows = (mObjectCount + columns - 1) / columns;
+  cell = std::min(mWorldWidth / columns, kViewHeight / rows);
+
+  const float scale = cell * 0.9f;
+
+  auto* objects = reinterpret_cast<Object*>(mMapped + mObjectsOffset);
+
+  for (int i = 0; i < mObjectCount; i++) {
+    int col = i % columns;
+    int row = i / columns;
+
+    Object& o = objects[i];
+    o.sphere[0] = (col - (columns - 1) / 2.0f) * cell;
+    o.sphere[1] = ((rows - 1) / 2.0f - row) * cell;
+    o.sphere[2] = 0;
+    o.sphere[3] = kTriangleRadius * scale;
+    o.params[0] = (i % 360) * 13.0f;
+    o.params[1] = scale;
+    o.params[2] = o.params[3] = 0;
+  }
+}
+
+
+float GpuCullingVulkan::panOffset(float rotation) const
+{
+  return std::sin(rotation * 0.005f) * (mWorldWidth - mViewWidth) / 2;
+}
+
+
+bool GpuCullingVulkan::createPipelines(VkPipelineCache pipelineCache, VkGraphicsPipelineCreateInfo drawPipelineInfo)
+{
+  VkDevice dev = mWindow->device();
+  const int concurrentFrameCount = mWindow->concurrentFrameCount();
+
+  VkShaderModule cullShader = load_shader_module(mWindow, QStringLiteral(":/shaders/cull_comp.spv"));
+  VkShaderModule vertShader = load_shader_module(mWindow, QStringLiteral(":/shaders/culled_vert.spv"));
+
+  auto destroyShaders = [&]() {
+    if (cullShader) mDevFuncs->vkDestroyShaderModule(dev, cullShader, nullptr);
+    if (vertShader) mDevFuncs->vkDestroyShaderModule(dev, vertShader, nullptr);
+  };
+
+  if (!cullShader || !vertShader) {
+    LOG_WARNING("GPU culling shaders are missing (glslc was not available at build time?)");
+    destroyShaders();
+    return false;
+  }
+
+  // --- descriptors, shared by both pipelines
+
+  VkDescriptorSetLayoutBinding bindings[] = {
+      { 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT | VK_SHADER_STAGE_VERTEX_BIT, nullptr },
+      { 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT | VK_SHADER_STAGE_VERTEX_BIT, nullptr },
+      { 2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr },
+      { 3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr }
+  };
+
+  VkDescriptorSetLayoutCreateInfo layoutInfo{};
+  layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+  layoutInfo.bindingCount = 4;
+  layoutInfo.pBindings = bindings;
+
+  if (mDevFuncs->vkCreateDescriptorSetLayout(dev, &layoutInfo, nullptr, &mDescriptorSetLayout) != VK_SUCCESS)
+    qFatal("Failed to create descriptor set layout");
+
+  VkDescriptorPoolSize poolSizes[] = {
+      { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, uint32_t(concurrentFrameCount) },
+      { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, uint32_t(3 * concurrentFrameCount) }
+  };
+
+  VkDescriptorPoolCreateInfo poolInfo{};
+  poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+  poolInfo.maxSets = concurrentFrameCount;
+  poolInfo.poolSizeCount = 2;
+  poolInfo.pPoolSizes = poolSizes;
+
+  if (mDevFuncs->vkCreateDescriptorPool(dev, &poolInfo, nullptr, &mDescriptorPool) != VK_SUCCESS)
+    qFatal("Failed to create descriptor pool");
+
+  for (int f = 0; f < concurrentFrameCount; f++) {
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = mDescriptorPool;
+    allocInfo.descriptorSetCount = 1;
+    allocInfo.pSetLayouts = &mDescriptorSetLayout;
+
+    if (mDevFuncs->vkAllocateDescriptorSets(dev, &allocInfo, &mDescriptorSet[f]) != VK_SUCCESS)
+      qFatal("Failed to allocate descriptor set");
+
+    VkDescriptorBufferInfo bufferInfos[] = {
+        { mStaticBuffer, mFrameDataOffset + f * mFrameDataStride, sizeof(FrameData) },
+        { mStaticBuffer, mObjectsOffset, mObjectsSize },
+        { mIndirectBuffer, f * mIndirectStride + mCommandsOffset, mObjectCount * sizeof(VkDrawIndexedIndirectCommand) },
+        { mIndirectBuffer, f * mIndirectStride, sizeof(uint32_t) }
+    };
+
+    VkWriteDescriptorSet writes[4]{};
+    for (int b = 0; b < 4; b++) {
+      writes[b].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+      writes[b].dstSet = mDescriptorSet[f];
+      writes[b].dstBinding = b;
+      writes[b].descriptorCount = 1;
+      writes[b].descriptorType = bindings[b].descriptorType;
+      writes[b].pBufferInfo = &bufferInfos[b];
+    }
+
+    mDevFuncs->vkUpdateDescriptorSets(dev, 4, writes, 0, nullptr);
+  }
+
+  VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+  pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+  pipelineLayoutInfo.setLayoutCount = 1;
+  pipelineLayoutInfo.pSetLayouts = &mDescriptorSetLayout;
+
+  if (mDevFuncs->vkCreatePipelineLayout(dev, &pipelineLayoutInfo, nullptr, &mPipelineLayout) != VK_SUCCESS)
+    qFatal("Failed to create pipeline layout");
+
+  // --- compute pipeline
+
+  VkComputePipelineCreateInfo computeInfo{};
+  computeInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+  computeInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+  computeInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+  computeInfo.stage.module = cullShader;
+  computeInfo.stage.pName = "main";
+  computeInfo.layout = mPipelineLayout;
+
+  VkResult err = mDevFuncs->vkCreateComputePipelines(dev, pipelineCache, 1, &computeInfo, nullptr, &mCullPipeline);
+  if (err != VK_SUCCESS)
+    qFatal("Failed to create compute pipeline: %d", err);
+
+  // --- graphics pipeline: the renderer's, with our vertex shader and layout
+
+  VkPipelineShaderStageCreateInfo stages[2];
+  std::copy(drawPipelineInfo.pStages, drawPipelineInfo.pStages + 2, stages);
+  for (auto& stage : stages) {
+    if (stage.stage == VK_SHADER_STAGE_VERTEX_BIT) {
+      stage.module = vertShader;
+    }
+  }
+
+  drawPipelineInfo.pStages = stages;
+  drawPipelineInfo.layout = mPipelineLayout;
+
+  err = mDevFuncs->vkCreateGraphicsPipelines(dev, pipelineCache, 1, &drawPipelineInfo, nullptr, &mDrawPipeline);
+  if (err != VK_SUCCESS)
+    qFatal("Failed to create graphics pipeline: %d", err);
+
+  destroyShaders();
+
+  return true;
+}
+
+
+void GpuCullingVulkan::recordCulling(VkCommandBuffer cb, const QMatrix4x4& viewProj, float rotation)
+{
+  const int frame = mWindow->currentFrame();
+
+  // --- frame data
+
+  FrameData data{};
+  memcpy(data.viewProj, viewProj.constData(), sizeof(data.viewProj));
+
+  // Frustum planes (Gribb/Hartmann) for Vulkan clip space, where 0 <= z <= w.
+  const QVector4D r0 = viewProj.row(0), r1 = viewProj.row(1), r2 = viewProj.row(2), r3 = viewProj.row(3);
+  const QVector4D planes[6] = { r3 + r0, r3 - r0, r3 + r1, r3 - r1, r2, r3 - r2 };
+
+  for (int p = 0; p < 6; p++) {
+    float len = planes[p].toVector3D().length();
+    for (int k = 0; k < 4; k++) {
+      data.planes[p][k] = planes[p][k] / len;
+    }
+  }
+
+  data.rotation = rotation;
+  data.objectCount = mObjectCount;
+
+  memcpy(mMapped + mFrameDataOffset + frame * mFrameDataStride, &data, sizeof(data));
+
+  // --- clear count and commands. Without the draw count, culled objects draw zero instances.
+
+  const VkDeviceSize regionOffset = frame * mIndirectStride;
+  mDevFuncs->vkCmdFillBuffer(cb, mIndirectBuffer, regionOffset, mIndirectStride, 0);
+
+  VkBufferMemoryBarrier barrier{};
+  barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+  barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+  barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.buffer = mIndirectBuffer;
+  barrier.offset = regionOffset;
+  barrier.size = mIndirectStride;
+
+  mDevFuncs->vkCmdPipelineBarrier(cb, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+                                  0, nullptr, 1, &barrier, 0, nullptr);
+
+  // --- cull
+
+  mDevFuncs->vkCmdBindPipeline(cb, VK_PIPELINE_BIND_POINT_COMPUTE, mCullPipeline);
+  mDevFuncs->vkCmdBindDescriptorSets(cb, VK_PIPELINE_BIND_POINT_COMPUTE, mPipelineLayout, 0, 1,
+                                     &mDescriptorSet[frame], 0, nullptr);
+  mDevFuncs->vkCmdDispatch(cb, (mObjectCount + kWorkgroupSize - 1) / kWorkgroupSize, 1, 1);
+
+  barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+  barrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+
+  mDevFuncs->vkCmdPipelineBarrier(cb, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, 0,
+                                  0, nullptr, 1, &barrier, 0, nullptr);
+}
+
+
+void GpuCullingVulkan::recordDraw(VkCommandBuffer cb, VkBuffer vertexBuffer)
+{
+  const int frame = mWindow->currentFrame();
+  const VkDeviceSize countOffset = frame * mIndirectStride;
+  const VkDeviceSize commandsOffset = countOffset + mCommandsOffset;
+  const uint32_t stride = sizeof(VkDrawIndexedIndirectCommand);
+
+  mDevFuncs->vkCmdBindPipeline(cb, VK_PIPELINE_BIND_POINT_GRAPHICS, mDrawPipeline);
+  mDevFuncs->vkCmdBindDescriptorSets(cb, VK_PIPELINE_BIND_POINT_GRAPHICS, mPipelineLayout, 0, 1,
+                                     &mDescriptorSet[frame], 0, nullptr);
+
+  VkDeviceSize vbOffset = 0;
+  mDevFuncs->vkCmdBindVertexBuffers(cb, 0, 1, &vertexBuffer, &vbOffset);
+  mDevFuncs->vkCmdBindIndexBuffer(cb, mStaticBuffer, 0, VK_INDEX_TYPE_UINT16);
+
+  if (mDrawIndirectCount) {
+    mDrawIndirectCount(cb, mIndirectBuffer, commandsOffset, mIndirectBuffer, countOffset, mObjectCount, stride);
+  }
+  else {
+    // Without multiDrawIndirect, mMaxDrawCount is 1.
+    for (int first = 0; first < mObjectCount; first += mMaxDrawCount) {
+      int count = std::min(mMaxDrawCount, mObjectCount - first);
+      mDevFuncs->vkCmdDrawIndexedIndirect(cb, mIndirectBuffer, commandsOffset + first * stride, count, stride);
+    }
+  }
+}
+
+
+void GpuCullingVulkan::release()
+{
+  if (!mWindow) {
+    return;
+  }
+
+  VkDevice dev = mWindow->device();
+
+  if (mDrawPipeline) {
+    mDevFuncs->vkDestroyPipeline(dev, mDrawPipeline, nullptr);
+    mDrawPipeline = VK_NULL_HANDLE;
+  }
+
+  if (mCullPipeline) {
+    mDevFuncs->vkDestroyPipeline(dev, mCullPipeline, nullptr);
+    mCullPipeline = VK_NULL_HANDLE;
+  }
+
+  if (mPipelineLayout) {
+    mDevFuncs->vkDestroyPipelineLayout(dev, mPipelineLayout, nullptr);
+    mPipelineLayout = VK_NULL_HANDLE;
+  }
+
+  if (mDescriptorPool) {
+    mDevFuncs->vkDestroyDescriptorPool(dev, mDescriptorPool, nullptr); // frees the sets
+    mDescriptorPool = VK_NULL_HANDLE;
+  }
+
+  if (mDescriptorSetLayout) {
+    mDevFuncs->vkDestroyDescriptorSetLayout(dev, mDescriptorSetLayout, nullptr);
+    mDescriptorSetLayout = VK_NULL_HANDLE;
+  }
+
+  if (mIndirectBuffer) {
+    mDevFuncs->vkDestroyBuffer(dev, mIndirectBuffer, nullptr);
+    mIndirectBuffer = VK_NULL_HANDLE;
+  }
+
+  if (mIndirectMemory) {
+    mDevFuncs->vkFreeMemory(dev, mIndirectMemory, nullptr);
+    mIndirectMemory = VK_NULL_HANDLE;
+  }
+
+  if (mStaticBuffer) {
+    mDevFuncs->vkDestroyBuffer(dev, mStaticBuffer, nullptr);
+    mStaticBuffer = VK_NULL_HANDLE;
+  }
+
+  if (mStaticMemory) {
+    if (mMapped) {
+      mDevFuncs->vkUnmapMemory(dev, mStaticMemory);
+      mMapped = nullptr;
+    }
+
+    mDevFuncs->vkFreeMemory(dev, mStaticMemory, nullptr);
+    mStaticMemory = VK_NULL_HANDLE;
+  }
+
+  mWindow = nullptr;
+}
@@ -0,0 +1,101 @@
+/*
+ * Copyright (C) 2025 by Dirk Farin, Kronenstr. 49b, 70174 Stuttgart, Germany
+ *
+ * 2-Clause BSD
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer
+ *    in the documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef GPUCULLINGVULKAN_H
+#define GPUCULLINGVULKAN_H
+
+#include <QVulkanWindow>
+#include <QMatrix4x4>
+
+
+// GPU-driven drawing of many instances of one mesh.
+//
+// The object bounds (spheres) live in a storage buffer. Each frame, a compute shader tests them
+// against the view frustum and appends a VkDrawIndexedIndirectCommand for every visible object.
+// The frame is then drawn with one vkCmdDrawIndexedIndirectCountKHR (VK_KHR_draw_indirect_count),
+// or, without the extension, with vkCmdDrawIndexedIndirect over the whole, zero-filled command
+// array. Without multiDrawIndirect, there is one indirect draw per object.
+//
+// The objects are laid out on a grid three views wide, the camera pans over it.
+// Needs shaders compiled with glslc at build time and drawIndirectFirstInstance (the object
+// index is passed in firstInstance). Everything else is Vulkan 1.0 core, e.g. available on lavapipe.
+
+class GpuCullingVulkan
+{
+public:
+  // 'drawPipelineInfo' is the renderer's graphics pipeline. The culled draw uses a copy with
+  // another vertex shader and pipeline layout.
+  // Returns false if the device or the build does not support the path.
+  bool init(QVulkanWindow*, VkPipelineCache, VkGraphicsPipelineCreateInfo drawPipelineInfo, int objectCount);
+
+  void release();
+
+  bool isReady() const { return mDrawPipeline != VK_NULL_HANDLE; }
+
+  // Culls the objects for the view (outside of a render pass).
+  void recordCulling(VkCommandBuffer, const QMatrix4x4& viewProj, float rotation);
+
+  // Draws the visible objects (inside the render pass). 'vertexBuffer' holds the triangle.
+  void recordDraw(VkCommandBuffer, VkBuffer vertexBuffer);
+
+  // Horizontal camera position for the animation frame 'rotation'.
+  float panOffset(float rotation) const;
+
+private:
+  QVulkanWindow* mWindow = nullptr;
+  QVulkanDeviceFunctions* mDevFuncs = nullptr;
+
+  int mObjectCount = 0;
+  float mWorldWidth = 0;
+  float mViewWidth = 0;
+
+  PFN_vkCmdDrawIndexedIndirectCountKHR mDrawIndirectCount = nullptr;
+  bool mMultiDrawIndirect = false;
+  int mMaxDrawCount = 1; // per vkCmdDrawIndexedIndirect()
+
+  // host-visible: indices, objects, per frame: FrameData
+  VkBuffer mStaticBuffer = VK_NULL_HANDLE;
+  VkDeviceMemory mStaticMemory = VK_NULL_HANDLE;
+  quint8* mMapped = nullptr;
+  VkDeviceSize mObjectsOffset = 0;
+  VkDeviceSize mObjectsSize = 0;
+  VkDeviceSize mFrameDataOffset = 0;
+  VkDeviceSize mFrameDataStride = 0;
+
+  // device-local, per frame: count, commands
+  VkBuffer mIndirectBuffer = VK_NULL_HANDLE;
+  VkDeviceMemory mIndirectMemory = VK_NULL_HANDLE;
+  VkDeviceSize mIndirectStride = 0;
+  VkDeviceSize mCommandsOffset = 0; // relative to the frame's region
+
+  VkDescriptorPool mDescriptorPool = VK_NULL_HANDLE;
+  VkDescriptorSetLayout mDescriptorSetLayout = VK_NULL_HANDLE;
+  VkDescriptorSet mDescriptorSet[QVulkanWindow::MAX_CONCURRENT_FRAME_COUNT]{};
+  VkPipelineLayout mPipelineLayout = VK_NULL_HANDLE;
+  VkPipeline mCullPipeline = VK_NULL_HANDLE;
+  VkPipeline mDrawPipeline = VK_NULL_HANDLE;
+
+  bool createBuffers();
+
+  void createObjects();
+
+  bool createPipelines(VkPipelineCache, VkGraphicsPipelineCreateInfo);
+};
+
+#endif
@@ -0,0 +1,241 @@
+/*
+ * Copyright (C) 2025 by Dirk Farin, Kronenstr. 49b, 70174 Stuttgart, Germany
+ *
+ * 2-Clause BSD
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer
+ *    in the documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "Hud.h"
+#include "SkiaFontManager.h"
+#include "profiling/FrameStats.h"
+#include "profiling/Tracing.h"
+
+#include <core/SkCanvas.h>
+#include <core/SkPaint.h>
+#include <core/SkPictureRecorder.h>
+#include <core/SkTypeface.h>
+
+#ifdef _WIN32 // TODO(skia): how can we test the skia version?
+#include "gpu/GrDirectContext.h"
+#include "gpu/GrRecordingContext.h"
+#else
+#include "gpu/ganesh/GrDirectContext.h"
+#include "gpu/ganesh/GrRecordingContext.h"
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+
+namespace {
+
+const float kPanelWidth = 280;
+const float kPanelHeight = 150;
+const float kMargin = 10;
+const float kLineHeight = 18;
+
+// Frame time graph, one pixel per frame of the FrameStats history.
+const SkRect kGraphRect = SkRect::MakeXYWH(12, 90, FrameStats::kHistorySize, 50);
+const float kGraphMaxMs = 50;
+
+std::atomic<bool> sHudEnabled{false};
+
+}
+
+
+void Hud::CachedText::set(const char* newText, const SkFont& font)
+{
+  if (blob && strcmp(text, newText) == 0) {
+    return;
+  }
+
+  snprintf(text, sizeof(text), "%s", newText);
+  blob = SkTextBlob::MakeFromString(text, font);
+}
+
+
+void Hud::setBackendName(const std::string& name)
+{
+  mBackendName = name;
+  mStaticPart = nullptr;
+}
+
+
+void Hud::recordStaticPart()
+{
+  SkPictureRecorder recorder;
+  SkCanvas* canvas = recorder.beginRecording(SkRect::MakeWH(kPanelWidth, kPanelHeight));
+
+  SkPaint panelPaint;
+  panelPaint.setColor(SkColorSetARGB(0xC0, 0x10, 0x10, 0x10));
+  canvas->drawRoundRect(SkRect::MakeWH(kPanelWidth, kPanelHeight), 6, 6, panelPaint);
+
+  SkPaint textPaint;
+  textPaint.setColor(SkColorSetRGB(0xA0, 0xC0, 0xFF));
+  textPaint.setAntiAlias(true);
+
+  std::string title = "backend: " + (mBackendName.empty() ? std::string("unknown") : mBackendName);
+  canvas->drawString(title.c_str(), 12, kLineHeight, mFont, textPaint);
+
+  // grid lines at 60 Hz and 30 Hz frame times
+  SkPaint gridPaint;
+  gridPaint.setColor(SkColorSetARGB(0x60, 0xFF, 0xFF, 0xFF));
+  for (float ms : {16.7f, 33.3f}) {
+    float y = kGraphRect.bottom() - kGraphRect.height() * ms / kGraphMaxMs;
+    canvas->drawLine(kGraphRect.left(), y, kGraphRect.right(), y, gridPaint);
+  }
+
+  SkPaint framePaint;
+  framePaint.setColor(SkColorSetARGB(0x80, 0xFF, 0xFF, 0xFF));
+  framePaint.setStyle(SkPaint::kStroke_Style);
+  canvas->drawRect(kGraphRect, framePaint);
+
+  mStaticPart = recorder.finishRecordingAsPicture();
+}
+
+
+void Hud::draw(SkCanvas* canvas)
+{
+  TRACE_SCOPE("Hud::draw");
+
+  if (!mFontLoaded) {
+    mFont = SkFont(get_skia_font_manager()->legacyMakeTypeface(nullptr, {}), 13);
+    mFont.setEdging(SkFont::Edging::kAntiAlias);
+    mFontLoaded = true;
+  }
+
+  if (!mStaticPart) {
+    recordStaticPart();
+  }
+
+  const FrameStats& stats = frame_stats();
+  char line[96];
+
+  // --- text lines (blobs are rebuilt only when the text changes)
+
+  if (stats.averageGpuTimeMs() > 0) {
+    snprintf(line, sizeof(line), "%.1f fps   cpu %.2f ms   gpu %.2f ms",
+             stats.framesPerSecond(), stats.averageFrameTimeMs(), stats.averageGpuTimeMs());
+  }
+  else {
+    snprintf(line, sizeof(line), "%.1f fps   cpu %.2f ms", stats.framesPerSecond(), stats.averageFrameTimeMs());
+  }
+  mFrameLine.set(line, mFont);
+
+  GrDirectContext* context = canvas->recordingContext() ? canvas->recordingContext()->asDirectContext() : nullptr;
+  if (context) {
+    int resources = 0;
+    size_t bytes = 0;
+    context->getResourceCacheUsage(&resources, &bytes);
+    snprintf(line, sizeof(line), "gpu cache: %d resources, %.1f / %.0f MB", resources,
+             bytes / (1024.0 * 1024.0), context->getResourceCacheLimit() / (1024.0 * 1024.0));
+  }
+  else {
+    snprintf(line, sizeof(line), "gpu cache: -");
+  }
+  mCacheLine.set(line, mFont);
+
+  snprintf(line, sizeof(line), "hud: %.3f ms/frame", stats.averageHudTimeMs());
+  mOverheadLine.set(line, mFont);
+
+  // --- frame time graph
+
+  mGraphPath.rewind();
+
+  int n = stats.historyLength();
+  for (int i = 0; i < n; i++) {
+    float ms = std::min(stats.frameTimeMs(i), kGraphMaxMs);
+    float x = kGraphRect.right() - (n - 1 - i);
+    float y = kGraphRect.bottom() - kGraphRect.height() * ms / kGraphMaxMs;
+    if (i == 0) {
+      mGraphPath.moveTo(x, y);
+    }
+    else {
+      mGraphPath.lineTo(x, y);
+    }
+  }
+
+  // --- draw
+
+  canvas->save();
+  canvas->translate(kMargin, kMargin);
+
+  canvas->drawPicture(mStaticPart);
+
+  SkPaint textPaint;
+  textPaint.setColor(SK_ColorWHITE);
+  textPaint.setAntiAlias(true);
+
+  canvas->drawTextBlob(mFrameLine.blob, 12, 2 * kLineHeight, textPaint);
+  canvas->drawTextBlob(mCacheLine.blob, 12, 3 * kLineHeight, textPaint);
+  canvas->drawTextBlob(mOverheadLine.blob, 12, 4 * kLineHeight, textPaint);
+
+  SkPaint graphPaint;
+  graphPaint.setColor(SkColorSetRGB(0x40, 0xFF, 0x40));
+  graphPaint.setStyle(SkPaint::kStroke_Style);
+  graphPaint.setStrokeWidth(1);
+  graphPaint.setAntiAlias(true);
+  canvas->drawPath(mGraphPath, graphPaint);
+
+  canvas->restore();
+}
+
+
+static Hud& the_hud()
+{
+  static Hud sHud;
+  return sHud;
+}
+
+
+void set_hud_enabled(bool enable)
+{
+  sHudEnabled = enable;
+}
+
+
+bool hud_enabled()
+{
+  return sHudEnabled;
+}
+
+
+void toggle_hud()
+{
+  sHudEnabled = !sHudEnabled;
+}
+
+
+void set_hud_backend_name(const std::string& name)
+{
+  the_hud().setBackendName(name);
+}
+
+
+void draw_hud(SkCanvas* canvas)
+{
+  if (!hud_enabled()) {
+    return;
+  }
+
+  auto start = std::chrono::steady_clock::now();
+
+  the_hud().draw(canvas);
+
+  frame_stats().addHudTime(std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count());
+}
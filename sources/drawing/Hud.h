@@ -0,0 +1,90 @@
+/*
+ * Copyright (C) 2025 by Dirk Farin, Kronenstr. 49b, 70174 Stuttgart, Germany
+ *
+ * 2-Clause BSD
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer
+ *    in the documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef HUD_H
+#define HUD_H
+
+#include <core/SkFont.h>
+#include <core/SkPath.h>
+#include <core/SkPicture.h>
+#include <core/SkTextBlob.h>
+
+#include <string>
+
+class SkCanvas;
+
+
+// On-screen diagnostics drawn on top of the scene: active backend, frame rate, frame time graph,
+// GPU resource cache usage and the HUD's own cost.
+//
+// Meant to stay enabled, so a frame does as little as possible: the static parts (panel, labels,
+// grid) are an SkPicture recorded once, text lines are text blobs that are only rebuilt when
+// their text changes (the averages change once per report interval), and the frame time graph
+// is one path, rebuilt in place from the FrameStats history.
+//
+// The reported overhead is the CPU time of drawing the HUD. With the GPU backends, the GPU work
+// it causes at flush time is part of the normal frame time.
+
+class Hud
+{
+public:
+  void setBackendName(const std::string& name);
+
+  void draw(SkCanvas*);
+
+private:
+  struct CachedText
+  {
+    char text[96] = "";
+    sk_sp<SkTextBlob> blob;
+
+    void set(const char* newText, const SkFont&);
+  };
+
+  std::string mBackendName;
+
+  SkFont mFont;
+  bool mFontLoaded = false;
+
+  sk_sp<SkPicture> mStaticPart;
+
+  CachedText mFrameLine;
+  CachedText mCacheLine;
+  CachedText mOverheadLine;
+
+  // Reused with rewind(), so that its storage is kept.
+  SkPath mGraphPath;
+
+  void recordStaticPart();
+};
+
+
+void set_hud_enabled(bool enable);
+
+bool hud_enabled();
+
+void toggle_hud();
+
+void set_hud_backend_name(const std::string& name);
+
+// Draws the HUD (if enabled) into the top-left corner and adds its CPU time to frame_stats().
+// Called by the backends after draw_skia_scene().
+void draw_hud(SkCanvas*);
+
+#endif
@@ -0,0 +1,339 @@
+/*
+ * Copyright (C) 2025 by Dirk Farin, Kronenstr. 49b, 70174 Stuttgart, Germany
+ *
+ * 2-Clause BSD
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer
+ *    in the documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "ImageCache.h"
+#include "Drawing.h"
+#include "util/ThreadPool.h"
+#include "profiling/Tracing.h"
+
+#include <codec/SkCodec.h>
+#include <core/SkBitmap.h>
+#include <core/SkCanvas.h>
+#include <core/SkData.h>
+#include <core/SkPaint.h>
+#include <core/SkPixmap.h>
+#include <gpu/ganesh/GrDirectContext.h>
+#include <gpu/ganesh/SkImageGanesh.h>
+
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+
+
+ImageCache::ImageCache(GrDirectContext* context)
+    : mContext(sk_ref_sp(context)),
+      mGuard(std::make_shared<Guard>())
+{
+}
+
+
+ImageCache::~ImageCache()
+{
+  // Decodes that are still running see this and drop their result.
+  std::lock_guard<std::mutex> lock(mGuard->mutex);
+  mGuard->alive = false;
+}
+
+
+sk_sp<SkImage> ImageCache::get(const std::string& source, int width, int height)
+{
+  std::lock_guard<std::mutex> lock(mGuard->mutex);
+
+  Key key{source, width, height};
+
+  auto iter = mEntries.find(key);
+  if (iter != mEntries.end()) {
+    Entry& entry = iter->second;
+    mLRU.splice(mLRU.begin(), mLRU, entry.lruPos);
+
+    if (entry.state == State::Ready) {
+      mStats.hits++;
+      return entry.image;
+    }
+
+    mStats.misses++;
+    return nullptr;
+  }
+
+  // --- not in cache yet: schedule decoding
+
+  mStats.misses++;
+
+  mLRU.push_front(key);
+  Entry& entry = mEntries[key];
+  entry.lruPos = mLRU.begin();
+
+  background_thread_pool().enqueue([this, guard = mGuard, key] {
+    sk_sp<SkImage> image = decode_image_scaled(key.source, key.width, key.height);
+
+    std::lock_guard<std::mutex> lock(guard->mutex);
+    if (guard->alive) {
+      decodeFinished(key, std::move(image));
+    }
+  });
+
+  return nullptr;
+}
+
+
+// Called with the mutex held.
+void ImageCache::decodeFinished(const Key& key, sk_sp<SkImage> image)
+{
+  auto iter = mEntries.find(key);
+  if (iter == mEntries.end()) {
+    return; // evicted while decoding
+  }
+
+  Entry& entry = iter->second;
+
+  if (!image) {
+    entry.state = State::Failed;
+    mStats.decodeFailures++;
+    return;
+  }
+
+  mStats.decoded++;
+  entry.image = std::move(image);
+
+  if (mContext) {
+    entry.state = State::Decoded;
+    mUploadQueue.push_back(key);
+  }
+  else {
+    entry.state = State::Ready;
+    mStats.residentBytes += entry.image->imageInfo().computeMinByteSize();
+  }
+}
+
+
+void ImageCache::beginFrame()
+{
+  std::lock_guard<std::mutex> lock(mGuard->mutex);
+
+  if (!mUploadQueue.empty()) {
+    TRACE_SCOPE("ImageCache::upload");
+
+    // Upload in decoding order, but at least one image per frame, even if it exceeds the budget.
+    size_t uploaded = 0;
+    size_t n = 0;
+    for (; n < mUploadQueue.size(); n++) {
+      auto iter = mEntries.find(mUploadQueue[n]);
+      if (iter == mEntries.end() || iter->second.state != State::Decoded) {
+        continue;
+      }
+
+      Entry& entry = iter->second;
+      size_t bytes = entry.image->imageInfo().computeMinByteSize();
+      if (uploaded > 0 && uploaded + bytes > mUploadBudget) {
+        break;
+      }
+
+      sk_sp<SkImage> texture = SkImages::TextureFromImage(mContext.get(), entry.image, skgpu::Mipmapped::kNo, skgpu::Budgeted::kYes);
+      if (!texture) {
+        entry.state = State::Failed;
+        entry.image.reset();
+        mStats.decodeFailures++;
+        continue;
+      }
+
+      entry.image = std::move(texture);
+      entry.state = State::Ready;
+
+      uploaded += bytes;
+      mStats.uploads++;
+      mStats.uploadedBytes += bytes;
+      mStats.residentBytes += bytes;
+    }
+
+    mUploadQueue.erase(mUploadQueue.begin(), mUploadQueue.begin() + n);
+  }
+
+  evict();
+}
+
+
+// Called with the mutex held.
+void ImageCache::evict()
+{
+  // Remove least recently used images until the budget is met. Entries that are not ready
+  // do not count against the budget and stay, so that their decode result is not lost.
+
+  auto iter = mLRU.end();
+  while (mStats.residentBytes > mCacheBudget && iter != mLRU.begin()) {
+    --iter;
+
+    if (mEntries.find(*iter)->second.state != State::Ready) {
+      continue;
+    }
+
+    auto next = std::next(iter);
+    erase(iter);
+    iter = next;
+  }
+
+  // Bound the number of entries in any state. A decode that is still running drops its result
+  // (see decodeFinished()), and a failed source is decoded again when it is requested again.
+  while (mEntries.size() > mMaxEntries) {
+    erase(std::prev(mLRU.end()));
+  }
+}
+
+
+// Called with the mutex held.
+void ImageCache::erase(std::list<Key>::iterator lruPos)
+{
+  auto entryIter = mEntries.find(*lruPos);
+  Entry& entry = entryIter->second;
+
+  if (entry.state == State::Ready) {
+    mStats.residentBytes -= entry.image->imageInfo().computeMinByteSize();
+  }
+
+  mStats.evictions++;
+
+  mEntries.erase(entryIter);
+  mLRU.erase(lruPos);
+}
+
+
+ImageCache::Stats ImageCache::stats() const
+{
+  std::lock_guard<std::mutex> lock(mGuard->mutex);
+  return mStats;
+}
+
+
+sk_sp<SkImage> decode_image_scaled(const std::string& source, int width, int height)
+{
+  TRACE_SCOPE("decode_image_scaled");
+
+  sk_sp<SkData> data = SkData::MakeFromFileName(source.c_str());
+  if (!data) {
+    return nullptr;
+  }
+
+  std::unique_ptr<SkCodec> codec = SkCodec::MakeFromData(std::move(data));
+  if (!codec) {
+    return nullptr;
+  }
+
+  // Let the codec do as much of the downscaling as it can (e.g. JPEG DCT scaling).
+  // It returns the next supported size, which is at least the requested size.
+  float scale = std::max(width / (float) codec->dimensions().width(),
+                         height / (float) codec->dimensions().height());
+  SkISize decodeSize = codec->getScaledDimensions(std::min(scale, 1.0f));
+
+  SkImageInfo decodeInfo = SkImageInfo::MakeN32Premul(decodeSize);
+  SkBitmap decoded;
+  if (!decoded.tryAllocPixels(decodeInfo)) {
+    return nullptr;
+  }
+
+  SkCodec::Result result = codec->getPixels(decoded.pixmap());
+  if (result != SkCodec::kSuccess && result != SkCodec::kIncompleteInput) {
+    return nullptr;
+  }
+
+  if (decodeSize.width() == width && decodeSize.height() == height) {
+    decoded.setImmutable();
+    return decoded.asImage();
+  }
+
+  // --- scale the rest of the way to the exact target size
+
+  SkBitmap scaled;
+  if (!scaled.tryAllocPixels(SkImageInfo::MakeN32Premul(width, height))) {
+    return nullptr;
+  }
+
+  if (!decoded.pixmap().scalePixels(scaled.pixmap(), SkSamplingOptions(SkFilterMode::kLinear, SkMipmapMode::kLinear))) {
+    return nullptr;
+  }
+
+  scaled.setImmutable();
+  return scaled.asImage();
+}
+
+
+// The caches hold a reference to their context, so a key cannot be the address of another
+// context while its entry exists. Entries are removed by release_image_cache().
+static std::mutex sCachesMutex;
+static std::unordered_map<GrDirectContext*, std::unique_ptr<ImageCache>> sCaches;
+
+
+ImageCache* image_cache_for(SkCanvas* canvas)
+{
+  GrDirectContext* context = nullptr;
+  if (auto* recordingContext = canvas_recording_context(canvas)) {
+    context = recordingContext->asDirectContext();
+  }
+
+  std::lock_guard<std::mutex> lock(sCachesMutex);
+
+  auto& cache = sCaches[context];
+  if (!cache) {
+    cache = std::make_unique<ImageCache>(context);
+  }
+
+  return cache.get();
+}
+
+
+void release_image_cache(GrDirectContext* context)
+{
+  if (!context) {
+    return;
+  }
+
+  std::unique_ptr<ImageCache> cache;
+
+  {
+    std::lock_guard<std::mutex> lock(sCachesMutex);
+
+    auto iter = sCaches.find(context);
+    if (iter == sCaches.end()) {
+      return;
+    }
+
+    cache = std::move(iter->second);
+    sCaches.erase(iter);
+  }
+
+  // Frees the textures, outside of the lock.
+  cache.reset();
+}
+
+
+void draw_cached_image(SkCanvas* canvas, const std::string& source, const SkRect& dst)
+{
+  // Request the image at the device size of the target rectangle, so that it does not have to be scaled when drawing.
+  SkRect deviceRect = canvas->getTotalMatrix().mapRect(dst);
+  int w = std::max(1, (int) std::lround(deviceRect.width()));
+  int h = std::max(1, (int) std::lround(deviceRect.height()));
+
+  sk_sp<SkImage> image = image_cache_for(canvas)->get(source, w, h);
+  if (image) {
+    canvas->drawImageRect(image, dst, SkSamplingOptions(SkFilterMode::kLinear));
+  }
+  else {
+    SkPaint paint;
+    paint.setColor(SkColorSetRGB(0xC0, 0xC0, 0xC0));
+    canvas->drawRect(dst, paint);
+  }
+}
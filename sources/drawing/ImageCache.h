@@ -0,0 +1,161 @@
+/*
+ * Copyright (C) 2025 by Dirk Farin, Kronenstr. 49b, 70174 Stuttgart, Germany
+ *
+ * 2-Clause BSD
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer
+ *    in the documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef IMAGECACHE_H
+#define IMAGECACHE_H
+
+#include <core/SkImage.h>
+#include <core/SkRefCnt.h>
+#include <core/SkRect.h>
+
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class GrDirectContext;
+class SkCanvas;
+
+
+// Decodes images on background threads and keeps them in an LRU cache, keyed by source and
+// target size.
+//
+// Images are decoded with SkCodec directly at (about) the target size. For GPU contexts, the
+// decoded images are uploaded as textures in beginFrame(), at most 'upload budget' bytes per
+// frame, so that a burst of finished decodes does not cause a frame hitch. get() never blocks;
+// it returns nullptr until the image is ready and callers draw a placeholder instead.
+
+class ImageCache
+{
+public:
+  struct Stats
+  {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t decoded = 0;
+    uint64_t decodeFailures = 0;
+    uint64_t uploads = 0;
+    uint64_t uploadedBytes = 0;
+    uint64_t evictions = 0;
+    size_t residentBytes = 0;
+  };
+
+  // 'context' is nullptr for raster rendering.
+  explicit ImageCache(GrDirectContext* context);
+
+  ~ImageCache();
+
+  // Returns the image of the given size if it is ready. Otherwise schedules decoding (once)
+  // and returns nullptr.
+  sk_sp<SkImage> get(const std::string& source, int width, int height);
+
+  // Uploads finished decodes (within the per-frame budget) and evicts old entries.
+  // Must be called on the rendering thread, between frames.
+  void beginFrame();
+
+  void setUploadBudget(size_t bytesPerFrame) { mUploadBudget = bytesPerFrame; }
+
+  void setCacheBudget(size_t bytes) { mCacheBudget = bytes; }
+
+  // Maximum number of entries in any state. Bounds the entries of images that failed to decode
+  // or are still decoding, which do not count against the byte budget.
+  void setMaxEntries(size_t n) { mMaxEntries = n; }
+
+  Stats stats() const;
+
+private:
+  struct Key
+  {
+    std::string source;
+    int width, height;
+
+    bool operator==(const Key& b) const { return width == b.width && height == b.height && source == b.source; }
+  };
+
+  struct KeyHash
+  {
+    size_t operator()(const Key& k) const
+    {
+      return std::hash<std::string>()(k.source) ^ (size_t(k.width) * 31 + size_t(k.height)) * 0x9E3779B9u;
+    }
+  };
+
+  enum class State
+  {
+    Decoding,
+    Decoded,  // raster image waiting for upload
+    Ready,
+    Failed
+  };
+
+  struct Entry
+  {
+    State state = State::Decoding;
+    sk_sp<SkImage> image;
+    std::list<Key>::iterator lruPos;
+  };
+
+  // Referenced, so that its address cannot be reused by another context while the cache exists.
+  sk_sp<GrDirectContext> mContext;
+
+  // The mutex protects all members. It is shared with the decode tasks that are still in flight,
+  // together with a flag that is cleared when the cache is destroyed.
+  struct Guard
+  {
+    std::mutex mutex;
+    bool alive = true;
+  };
+
+  std::shared_ptr<Guard> mGuard;
+
+  std::unordered_map<Key, Entry, KeyHash> mEntries;
+  std::list<Key> mLRU; // most recently used at the front
+  std::vector<Key> mUploadQueue;
+
+  size_t mUploadBudget = 8 * 1024 * 1024;
+  size_t mCacheBudget = 256 * 1024 * 1024;
+  size_t mMaxEntries = 4096;
+
+  Stats mStats;
+
+  void decodeFinished(const Key& key, sk_sp<SkImage> image);
+
+  void evict();
+
+  void erase(std::list<Key>::iterator lruPos);
+};
+
+
+// Decodes 'source' to exactly width x height pixels. Returns nullptr on failure.
+sk_sp<SkImage> decode_image_scaled(const std::string& source, int width, int height);
+
+
+// Cache for the GPU context the canvas renders to. All raster canvases share one cache.
+ImageCache* image_cache_for(SkCanvas*);
+
+// Drops the cache of a GPU context, with its textures. Must be called on the rendering thread
+// before the context is released (while its GL context is current / its VkDevice exists).
+void release_image_cache(GrDirectContext*);
+
+// Draws the image if it is cached, otherwise a placeholder.
+void draw_cached_image(SkCanvas*, const std::string& source, const SkRect& dst);
+
+#endif
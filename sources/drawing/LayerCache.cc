@@ -0,0 +1,232 @@
+/*
+ * Copyright (C) 2025 by Dirk Farin, Kronenstr. 49b, 70174 Stuttgart, Germany
+ *
+ * 2-Clause BSD
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer
+ *    in the documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "LayerCache.h"
+#include "Drawing.h"
+#include "profiling/Tracing.h"
+#include "profiling/FrameStats.h"
+
+#include <core/SkCanvas.h>
+#include <core/SkMatrix.h>
+
+#ifdef _WIN32 // TODO(skia): how can we test the skia version?
+#include "gpu/GrRecordingContext.h"
+#else
+#include "gpu/ganesh/GrRecordingContext.h"
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <mutex>
+#include <vector>
+
+
+// A layer rasterized at scale s is reused for device scales in [s * kMinScaleFactor, s * kMaxScaleFactor].
+static const float kMinScaleFactor = 0.5f;
+static const float kMaxScaleFactor = 1.05f;
+
+// Larger layers are drawn directly.
+static const int kMaxLayerSize = 4096;
+
+
+// Layers with an image, and their memory.
+static std::atomic<int> sLayers{0};
+static std::atomic<size_t> sResidentBytes{0};
+
+static std::atomic<bool> sEnabled{true};
+
+// All layers, for release_layer_cache().
+static std::mutex sLayersMutex;
+static std::vector<CachedLayer*> sAllLayers;
+
+
+static void report_residency()
+{
+  frame_stats().setLayerResidency(sLayers, sResidentBytes);
+}
+
+
+CachedLayer::CachedLayer(const SkRect& bounds) : mBounds(bounds)
+{
+  std::lock_guard<std::mutex> lock(sLayersMutex);
+  sAllLayers.push_back(this);
+}
+
+
+CachedLayer::~CachedLayer()
+{
+  {
+    std::lock_guard<std::mutex> lock(sLayersMutex);
+    sAllLayers.erase(std::find(sAllLayers.begin(), sAllLayers.end(), this));
+  }
+
+  release();
+}
+
+
+void CachedLayer::setBounds(const SkRect& bounds)
+{
+  if (bounds != mBounds) {
+    mBounds = bounds;
+    release();
+  }
+}
+
+
+void CachedLayer::invalidate()
+{
+  release();
+}
+
+
+void CachedLayer::release()
+{
+  if (mImage) {
+    sLayers--;
+    sResidentBytes -= mBytes;
+    report_residency();
+  }
+
+  mImage.reset();
+  mBytes = 0;
+  mScale = 0;
+  mContext.reset();
+}
+
+
+SkCanvas* CachedLayer::beginUpdate(SkCanvas* canvas)
+{
+  if (mBounds.isEmpty()) {
+    return nullptr;
+  }
+
+  const SkMatrix& matrix = canvas->getTotalMatrix();
+  float scale = matrix.getMaxScale();
+  GrRecordingContext* context = canvas_recording_context(canvas);
+
+  if (context && context->abandoned()) {
+    // Nothing is drawn to an abandoned context.
+    release();
+    return nullptr;
+  }
+
+  if (sEnabled && mImage && context == mContext.get() &&
+      scale >= mScale * kMinScaleFactor && scale <= mScale * kMaxScaleFactor) {
+    frame_stats().addLayerDraw(FrameStats::LayerDraw::Hit);
+    return nullptr;
+  }
+
+  int w = (int) std::ceil(mBounds.width() * scale);
+  int h = (int) std::ceil(mBounds.height() * scale);
+
+  if (sEnabled && scale > 0 && w <= kMaxLayerSize && h <= kMaxLayerSize) {
+    SkImageInfo info = SkImageInfo::MakeN32Premul(w, h, canvas->imageInfo().refColorSpace());
+    mSurface = canvas->makeSurface(info);
+  }
+
+  if (!mSurface) {
+    // The canvas records a picture, or the layer is too large to cache.
+    frame_stats().addLayerDraw(FrameStats::LayerDraw::Uncached);
+    release();
+
+    canvas->save();
+    canvas->clipRect(mBounds);
+    return canvas;
+  }
+
+  TRACE_SCOPE("CachedLayer::rasterize");
+
+  frame_stats().addLayerDraw(FrameStats::LayerDraw::Rasterized);
+
+  release();
+
+  mScale = scale;
+  mContext = sk_ref_sp(context);
+  mBytes = mSurface->imageInfo().computeMinByteSize();
+
+  SkCanvas* layerCanvas = mSurface->getCanvas();
+  layerCanvas->clear(SK_ColorTRANSPARENT);
+  layerCanvas->scale(scale, scale);
+  layerCanvas->translate(-mBounds.left(), -mBounds.top());
+
+  return layerCanvas;
+}
+
+
+bool CachedLayer::endUpdate(SkCanvas* canvas)
+{
+  if (!mSurface) {
+    canvas->restore();
+    return true;
+  }
+
+  mImage = mSurface->makeImageSnapshot();
+  mSurface.reset();
+
+  if (mImage) {
+    sLayers++;
+    sResidentBytes += mBytes;
+    report_residency();
+  }
+
+  return false;
+}
+
+
+void CachedLayer::drawImage(SkCanvas* canvas)
+{
+  if (!mImage) {
+    return;
+  }
+
+  canvas->save();
+  canvas->translate(mBounds.left(), mBounds.top());
+  canvas->scale(1 / mScale, 1 / mScale);
+  canvas->drawImage(mImage, 0, 0, SkSamplingOptions(SkFilterMode::kLinear));
+  canvas->restore();
+}
+
+
+void release_layer_cache(GrRecordingContext* context)
+{
+  if (!context) {
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(sLayersMutex);
+
+  for (CachedLayer* layer : sAllLayers) {
+    if (layer->mContext.get() == context) {
+      layer->release();
+    }
+  }
+}
+
+
+void set_layer_caching_enabled(bool enable)
+{
+  sEnabled = enable;
+}
+
+
+bool layer_caching_enabled()
+{
+  return sEnabled;
+}
@@ -0,0 +1,109 @@
+/*
+ * Copyright (C) 2025 by Dirk Farin, Kronenstr. 49b, 70174 Stuttgart, Germany
+ *
+ * 2-Clause BSD
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer
+ *    in the documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef LAYERCACHE_H
+#define LAYERCACHE_H
+
+#include <core/SkImage.h>
+#include <core/SkRect.h>
+#include <core/SkSurface.h>
+
+#include <cstddef>
+
+class GrRecordingContext;
+class SkCanvas;
+
+
+// Caches a subtree of drawing commands that does not change from frame to frame (background,
+// grid, complex vector icons) as an image.
+//
+// The content is rasterized into an offscreen surface made by the target canvas (a GPU texture
+// on the GPU backends) at the current device scale, and composited with a single drawImage()
+// afterwards. It is drawn again when invalidate() was called, when the canvas renders to a
+// different GPU context, or when the device scale differs too much from the scale it was
+// rasterized at: zooming in would make it blurry, zooming out would waste memory.
+//
+// Canvases that cannot make surfaces (e.g. picture recording for frame capture) get the
+// content drawn directly. Hits, rasterizations and resident memory are reported to frame_stats().
+//
+//   mBackground.draw(canvas, [&](SkCanvas* c) { draw_grid(c); });
+
+class CachedLayer
+{
+public:
+  // 'bounds' in local coordinates of the canvas that the layer is drawn to. Content outside
+  // is clipped.
+  explicit CachedLayer(const SkRect& bounds = SkRect::MakeEmpty());
+
+  ~CachedLayer();
+
+  CachedLayer(const CachedLayer&) = delete;
+  CachedLayer& operator=(const CachedLayer&) = delete;
+
+  // Invalidates the layer if the bounds change.
+  void setBounds(const SkRect&);
+
+  void invalidate();
+
+  template <class DrawContent>
+  void draw(SkCanvas* canvas, DrawContent&& drawContent)
+  {
+    if (SkCanvas* layerCanvas = beginUpdate(canvas)) {
+      drawContent(layerCanvas);
+      if (endUpdate(canvas)) {
+        return;
+      }
+    }
+
+    drawImage(canvas);
+  }
+
+private:
+  SkRect mBounds;
+
+  sk_sp<SkImage> mImage;
+  float mScale = 0;
+  sk_sp<GrRecordingContext> mContext; // referenced, so that its address cannot be reused
+  size_t mBytes = 0;
+
+  sk_sp<SkSurface> mSurface; // only while updating
+
+  // Returns the canvas to draw the content to, or nullptr if the cached image can be used.
+  SkCanvas* beginUpdate(SkCanvas*);
+
+  // Returns true if the content was drawn directly to the target canvas.
+  bool endUpdate(SkCanvas*);
+
+  void drawImage(SkCanvas*);
+
+  void release();
+
+  friend void release_layer_cache(GrRecordingContext*);
+};
+
+// Drops the images of all layers rasterized with a GPU context, and their reference to it. Must be
+// called on the rendering thread before the context is released, like release_image_cache().
+void release_layer_cache(GrRecordingContext*);
+
+// When disabled, all layers draw their content directly. For comparisons.
+void set_layer_caching_enabled(bool enable);
+
+bool layer_caching_enabled();
+
+#endif
@@ -0,0 +1,422 @@
+/*
+ * Copyright (C) 2025 by Dirk Farin, Kronenstr. 49b, 70174 Stuttgart, Germany
+ *
+ * 2-Clause BSD
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer
+ *    in the documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "MaterialsVulkan.h"
+#include "VulkanAssets.h"
+#include "util/Log.h"
+
+#include <QVulkanDeviceFunctions>
+#include <QVulkanFunctions>
+
+#include <algorithm>
+#include <cstring>
+
+
+static const uint32_t kDefaultTextureSize = 4;
+
+
+bool MaterialsVulkan::init(QVulkanWindow* window, UploadServiceVulkan* uploads, VkPipelineCache pipelineCache,
+                           VkGraphicsPipelineCreateInfo drawPipelineInfo, VkDescriptorSetLayout instanceSetLayout,
+                           int capacity)
+{
+  mWindow = window;
+  mDevFuncs = window->vulkanInstance()->deviceFunctions(window->device());
+  mUploads = uploads;
+
+  // QVulkanWindow enables all supported 1.0 features
+  VkPhysicalDeviceFeatures features;
+  window->vulkanInstance()->functions()->vkGetPhysicalDeviceFeatures(window->physicalDevice(), &features);
+
+  if (!features.shaderSampledImageArrayDynamicIndexing) {
+    LOG_WARNING("textures: the device does not support indexing image arrays (shaderSampledImageArrayDynamicIndexing)");
+    return false;
+  }
+
+  const VkPhysicalDeviceLimits& limits = window->physicalDeviceProperties()->limits;
+  uint32_t maxImages = std::min(limits.maxPerStageDescriptorSampledImages, limits.maxDescriptorSetSampledImages);
+
+  // +1: default texture
+  if ((uint32_t) capacity + 1 > maxImages) {
+    LOG_WARNING("textures: the device supports only %u images in one stage, using %u textures", maxImages, maxImages - 1);
+    capacity = (int) maxImages - 1;
+  }
+
+  mTextures.resize(capacity + 1);
+
+  if (!createDescriptors(instanceSetLayout) || !createPipeline(pipelineCache, drawPipelineInfo)) {
+    release();
+    return false;
+  }
+
+  // Index 0: white, shown by elements without a texture and until the textures are resident.
+  addTexture(kDefaultTextureSize, kDefaultTextureSize, std::vector<uint8_t>(kDefaultTextureSize * kDefaultTextureSize * 4, 0xFF));
+
+  LOG_INFO("textures: %d in a fixed array, one set per frame slot", capacity);
+
+  return true;
+}
+
+
+bool MaterialsVulkan::createDescriptors(VkDescriptorSetLayout instanceSetLayout)
+{
+  VkDevice dev = mWindow->device();
+  const uint32_t count = (uint32_t) mTextures.size();
+
+  VkSamplerCreateInfo samplerInfo{};
+  samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+  samplerInfo.magFilter = VK_FILTER_LINEAR;
+  samplerInfo.minFilter = VK_FILTER_LINEAR;
+  samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+  samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+  samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+  samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+  samplerInfo.maxLod = 0.25f;
+
+  if (mDevFuncs->vkCreateSampler(dev, &samplerInfo, nullptr, &mSampler) != VK_SUCCESS)
+    qFatal("Failed to create sampler");
+
+  VkDescriptorSetLayoutBinding bindings[] = {
+      { 0, VK_DESCRIPTOR_TYPE_SAMPLER, 1, VK_SHADER_STAGE_FRAGMENT_BIT, &mSampler },
+      { 1, VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, count, VK_SHADER_STAGE_FRAGMENT_BIT, nullptr }
+  };
+
+  VkDescriptorSetLayoutCreateInfo layoutInfo{};
+  layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+  layoutInfo.bindingCount = 2;
+  layoutInfo.pBindings = bindings;
+
+  if (mDevFuncs->vkCreateDescriptorSetLayout(dev, &layoutInfo, nullptr, &mDescriptorSetLayout) != VK_SUCCESS) {
+    LOG_WARNING("textures: failed to create the descriptor set layout for %u images", count);
+    return false;
+  }
+
+  VkDescriptorPoolSize poolSizes[] = {
+      { VK_DESCRIPTOR_TYPE_SAMPLER, uint32_t(setCount()) },
+      { VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, uint32_t(setCount()) * count }
+  };
+
+  VkDescriptorPoolCreateInfo poolInfo{};
+  poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+  poolInfo.maxSets = setCount();
+  poolInfo.poolSizeCount = 2;
+  poolInfo.pPoolSizes = poolSizes;
+
+  if (mDevFuncs->vkCreateDescriptorPool(dev, &poolInfo, nullptr, &mDescriptorPool) != VK_SUCCESS) {
+    LOG_WARNING("textures: failed to create the descriptor pool for %u images", count);
+    return false;
+  }
+
+  for (int s = 0; s < setCount(); s++) {
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = mDescriptorPool;
+    allocInfo.descriptorSetCount = 1;
+    allocInfo.pSetLayouts = &mDescriptorSetLayout;
+
+    if (mDevFuncs->vkAllocateDescriptorSets(dev, &allocInfo, &mDescriptorSet[s]) != VK_SUCCESS) {
+      LOG_WARNING("textures: failed to allocate the descriptor set");
+      return false;
+    }
+  }
+
+  VkDescriptorSetLayout setLayouts[2] = { instanceSetLayout, mDescriptorSetLayout };
+
+  VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+  pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+  pipelineLayoutInfo.setLayoutCount = 2;
+  pipelineLayoutInfo.pSetLayouts = setLayouts;
+
+  if (mDevFuncs->vkCreatePipelineLayout(dev, &pipelineLayoutInfo, nullptr, &mPipelineLayout) != VK_SUCCESS)
+    qFatal("Failed to create pipeline layout");
+
+  return true;
+}
+
+
+bool MaterialsVulkan::createPipeline(VkPipelineCache pipelineCache, VkGraphicsPipelineCreateInfo drawPipelineInfo)
+{
+  VkDevice dev = mWindow->device();
+
+  VkShaderModule vertShader = load_shader_module(mWindow, QStringLiteral(":/shaders/textured_vert.spv"));
+  VkShaderModule fragShader = load_shader_module(mWindow, QStringLiteral(":/shaders/textured_frag.spv"));
+
+  auto destroyShaders = [&]() {
+    if (vertShader) mDevFuncs->vkDestroyShaderModule(dev, vertShader, nullptr);
+    if (fragShader) mDevFuncs->vkDestroyShaderModule(dev, fragShader, nullptr);
+  };
+
+  if (!vertShader || !fragShader) {
+    LOG_WARNING("texture shaders are missing (glslc was not available at build time?)");
+    destroyShaders();
+    return false;
+  }
+
+  // The array size in the fragment shader is a specialization constant.
+  const uint32_t count = (uint32_t) mTextures.size();
+  VkSpecializationMapEntry specEntry = { 0, 0, sizeof(uint32_t) };
+
+  VkSpecializationInfo specInfo{};
+  specInfo.mapEntryCount = 1;
+  specInfo.pMapEntries = &specEntry;
+  specInfo.dataSize = sizeof(count);
+  specInfo.pData = &count;
+
+  VkPipelineShaderStageCreateInfo stages[2];
+  std::copy(drawPipelineInfo.pStages, drawPipelineInfo.pStages + 2, stages);
+  for (auto& stage : stages) {
+    if (stage.stage == VK_SHADER_STAGE_VERTEX_BIT) {
+      stage.module = vertShader;
+    }
+    else if (stage.stage == VK_SHADER_STAGE_FRAGMENT_BIT) {
+      stage.module = fragShader;
+      stage.pSpecializationInfo = &specInfo;
+    }
+  }
+
+  drawPipelineInfo.pStages = stages;
+  drawPipelineInfo.layout = mPipelineLayout;
+
+  VkResult err = mDevFuncs->vkCreateGraphicsPipelines(dev, pipelineCache, 1, &drawPipelineInfo, nullptr, &mPipeline);
+  if (err != VK_SUCCESS)
+    qFatal("Failed to create graphics pipeline: %d", err);
+
+  destroyShaders();
+
+  return true;
+}
+
+
+void MaterialsVulkan::release()
+{
+  if (!mWindow) {
+    return;
+  }
+
+  VkDevice dev = mWindow->device();
+
+  // Qt has waited for the device to become idle.
+  for (Texture& texture : mTextures) {
+    destroyTexture(texture);
+  }
+
+  mTextures.clear();
+  mRetired.clear();
+
+  for (auto& writes : mPendingWrites) {
+    writes.clear();
+  }
+
+  if (mPipeline) {
+    mDevFuncs->vkDestroyPipeline(dev, mPipeline, nullptr);
+    mPipeline = VK_NULL_HANDLE;
+  }
+
+  if (mPipelineLayout) {
+    mDevFuncs->vkDestroyPipelineLayout(dev, mPipelineLayout, nullptr);
+    mPipelineLayout = VK_NULL_HANDLE;
+  }
+
+  if (mDescriptorPool) {
+    mDevFuncs->vkDestroyDescriptorPool(dev, mDescriptorPool, nullptr); // frees the sets
+    mDescriptorPool = VK_NULL_HANDLE;
+  }
+
+  for (VkDescriptorSet& set : mDescriptorSet) {
+    set = VK_NULL_HANDLE;
+  }
+
+  if (mDescriptorSetLayout) {
+    mDevFuncs->vkDestroyDescriptorSetLayout(dev, mDescriptorSetLayout, nullptr);
+    mDescriptorSetLayout = VK_NULL_HANDLE;
+  }
+
+  if (mSampler) {
+    mDevFuncs->vkDestroySampler(dev, mSampler, nullptr);
+    mSampler = VK_NULL_HANDLE;
+  }
+
+  mWindow = nullptr;
+}
+
+
+int MaterialsVulkan::addTexture(uint32_t width, uint32_t height, std::vector<uint8_t> rgba)
+{
+  auto free = std::find_if(mTextures.begin(), mTextures.end(), [](const Texture& t) { return t.image == VK_NULL_HANDLE; });
+  if (free == mTextures.end()) {
+    return -1;
+  }
+
+  Texture& texture = *free;
+
+  if (!mUploads->createImage(width, height, VK_FORMAT_R8G8B8A8_UNORM, &texture.image, &texture.memory)) {
+    LOG_WARNING("textures: cannot allocate a %ux%u image", width, height);
+    return -1;
+  }
+
+  VkImageViewCreateInfo viewInfo{};
+  viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+  viewInfo.image = texture.image;
+  viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+  viewInfo.format = VK_FORMAT_R8G8B8A8_UNORM;
+  viewInfo.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+
+  if (mDevFuncs->vkCreateImageView(mWindow->device(), &viewInfo, nullptr, &texture.view) != VK_SUCCESS)
+    qFatal("Failed to create image view");
+
+  // kept until the upload has completed
+  texture.data = std::move(rgba);
+  texture.ticket = mUploads->enqueueImage(texture.image, width, height, texture.data.data());
+
+  if (!texture.ticket) {
+    LOG_WARNING("textures: %ux%u is larger than a staging buffer", width, height);
+    destroyTexture(texture);
+    return -1;
+  }
+
+  return (int) (free - mTextures.begin());
+}
+
+
+void MaterialsVulkan::removeTexture(int index)
+{
+  Texture& texture = mTextures[index];
+  if (!texture.image || texture.removed) {
+    return;
+  }
+
+  texture.removed = true;
+
+  if (texture.resident) {
+    texture.resident = false;
+
+    // Point the element back to the default texture.
+    for (int s = 0; s < setCount(); s++) {
+      mPendingWrites[s].push_back(index);
+    }
+  }
+
+  // Every set has been rewritten and every frame that used the image has finished.
+  mRetired.push_back({ index, mWindow->concurrentFrameCount() + 1 });
+}
+
+
+void MaterialsVulkan::update()
+{
+  if (!mWindow) {
+    return;
+  }
+
+  for (size_t i = 0; i < mRetired.size();) {
+    Texture& texture = mTextures[mRetired[i].index];
+
+    // also wait for the upload, if the texture was removed before it completed
+    if (mRetired[i].frames > 0) {
+      mRetired[i].frames--;
+    }
+
+    if (mRetired[i].frames == 0 && (!texture.ticket || mUploads->isComplete(texture.ticket))) {
+      destroyTexture(texture);
+      mRetired[i] = mRetired.back();
+      mRetired.pop_back();
+    }
+    else {
+      i++;
+    }
+  }
+
+  for (int i = 0; i < (int) mTextures.size(); i++) {
+    Texture& texture = mTextures[i];
+    if (!texture.ticket || texture.removed || !mUploads->isComplete(texture.ticket)) {
+      continue;
+    }
+
+    texture.ticket = 0;
+    texture.data = std::vector<uint8_t>();
+    texture.resident = true;
+
+    for (int s = 0; s < setCount(); s++) {
+      if (i == 0) {
+        // all elements must be valid, initialize them with the default texture
+        for (int e = 0; e < (int) mTextures.size(); e++) {
+          mPendingWrites[s].push_back(e);
+        }
+      }
+      else {
+        mPendingWrites[s].push_back(i);
+      }
+    }
+  }
+
+  // Qt has waited for the fence of the current frame slot, so its set is not in use.
+  int set = mWindow->currentFrame();
+
+  if (!mPendingWrites[set].empty()) {
+    writeDescriptors(set, mPendingWrites[set]);
+    mPendingWrites[set].clear();
+  }
+}
+
+
+void MaterialsVulkan::writeDescriptors(int set, const std::vector<int>& indices)
+{
+  std::vector<VkDescriptorImageInfo> imageInfos;
+  std::vector<VkWriteDescriptorSet> writes;
+  imageInfos.reserve(indices.size());
+  writes.reserve(indices.size());
+
+  for (int index : indices) {
+    const Texture& texture = mTextures[index];
+
+    VkImageView view = texture.resident ? texture.view : mTextures[0].view;
+
+    imageInfos.push_back({ VK_NULL_HANDLE, view, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL });
+
+    VkWriteDescriptorSet write{};
+    write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    write.dstSet = mDescriptorSet[set];
+    write.dstBinding = 1;
+    write.dstArrayElement = index;
+    write.descriptorCount = 1;
+    write.descriptorType = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+    write.pImageInfo = &imageInfos.back();
+    writes.push_back(write);
+  }
+
+  mDevFuncs->vkUpdateDescriptorSets(mWindow->device(), (uint32_t) writes.size(), writes.data(), 0, nullptr);
+}
+
+
+void MaterialsVulkan::bind(VkCommandBuffer cb) const
+{
+  VkDescriptorSet set = mDescriptorSet[mWindow->currentFrame()];
+
+  mDevFuncs->vkCmdBindDescriptorSets(cb, VK_PIPELINE_BIND_POINT_GRAPHICS, mPipelineLayout, 1, 1, &set, 0, nullptr);
+}
+
+
+void MaterialsVulkan::destroyTexture(Texture& texture)
+{
+  VkDevice dev = mWindow->device();
+
+  if (texture.view) mDevFuncs->vkDestroyImageView(dev, texture.view, nullptr);
+  if (texture.image) mDevFuncs->vkDestroyImage(dev, texture.image, nullptr);
+  if (texture.memory) mDevFuncs->vkFreeMemory(dev, texture.memory, nullptr);
+
+  texture = Texture{};
+}
@@ -0,0 +1,131 @@
+/*
+ * Copyright (C) 2025 by Dirk Farin, Kronenstr. 49b, 70174 Stuttgart, Germany
+ *
+ * 2-Clause BSD
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer
+ *    in the documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef MATERIALSVULKAN_H
+#define MATERIALSVULKAN_H
+
+#include <QVulkanWindow>
+#include "UploadServiceVulkan.h"
+
+#include <cstdint>
+#include <vector>
+
+
+// Textures of the native renderer in one descriptor set: an immutable sampler and an array of
+// sampled images. Instances select their texture with an index (in their uniform data), so the
+// set is bound once per command buffer, independent of the number of textures. Descriptors are
+// only written when a texture is added or removed.
+//
+// Vulkan 1.0 (shaderSampledImageArrayDynamicIndexing): one set per frame slot. Every element must
+// be valid, so unused elements show the default texture (index 0). Writes are applied to each set
+// when its frame slot comes around again. The index is the same for a whole draw (dynamically
+// uniform).
+//
+// Partially bound, update-after-bind descriptors (VK_EXT_descriptor_indexing) would need a single
+// set, but their features have to be enabled at device creation, which QVulkanWindow only allows
+// from Qt 6.7 on (setEnabledFeaturesModifier()).
+
+class MaterialsVulkan
+{
+public:
+  // 'drawPipelineInfo' is the renderer's graphics pipeline, 'instanceSetLayout' its set 0. The
+  // textured draw uses a copy with other shaders and the texture array as set 1.
+  // Returns false if the device or the build does not support the path.
+  bool init(QVulkanWindow*, UploadServiceVulkan*, VkPipelineCache, VkGraphicsPipelineCreateInfo drawPipelineInfo,
+            VkDescriptorSetLayout instanceSetLayout, int capacity);
+
+  void release();
+
+  // Pipeline and default texture are available.
+  bool isReady() const { return mPipeline != VK_NULL_HANDLE && isResident(0); }
+
+  // Number of array elements, including the default texture.
+  int capacity() const { return (int) mTextures.size(); }
+
+  // Streams an RGBA8 texture in. Returns its index, or -1 if the array is full.
+  // The index can be used once isResident() returns true.
+  int addTexture(uint32_t width, uint32_t height, std::vector<uint8_t> rgba);
+
+  // The image is destroyed when the frames in flight are done with it.
+  void removeTexture(int index);
+
+  bool isResident(int index) const { return mTextures[index].resident; }
+
+  // Marks the textures whose uploads have completed as resident and writes their descriptors
+  // (render thread, at the start of a frame, before recording).
+  void update();
+
+  VkPipeline pipeline() const { return mPipeline; }
+
+  VkPipelineLayout pipelineLayout() const { return mPipelineLayout; }
+
+  // Binds the textures as set 1 (once per command buffer).
+  void bind(VkCommandBuffer) const;
+
+private:
+  QVulkanWindow* mWindow = nullptr;
+  QVulkanDeviceFunctions* mDevFuncs = nullptr;
+  UploadServiceVulkan* mUploads = nullptr;
+
+  struct Texture
+  {
+    VkImage image = VK_NULL_HANDLE;
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    VkImageView view = VK_NULL_HANDLE;
+    UploadServiceVulkan::Ticket ticket = 0;
+    std::vector<uint8_t> data;  // until uploaded
+    bool resident = false;
+    bool removed = false;       // waiting in mRetired
+  };
+
+  std::vector<Texture> mTextures;
+
+  // Removed textures and the number of frames until they can be destroyed. The index is only
+  // reused after that, the frames in flight may still access it.
+  struct Retired
+  {
+    int index;
+    int frames;
+  };
+
+  std::vector<Retired> mRetired;
+
+  // Elements to write into the set of each frame slot.
+  std::vector<int> mPendingWrites[QVulkanWindow::MAX_CONCURRENT_FRAME_COUNT];
+
+  VkSampler mSampler = VK_NULL_HANDLE;
+  VkDescriptorPool mDescriptorPool = VK_NULL_HANDLE;
+  VkDescriptorSetLayout mDescriptorSetLayout = VK_NULL_HANDLE;
+  VkDescriptorSet mDescriptorSet[QVulkanWindow::MAX_CONCURRENT_FRAME_COUNT]{};
+  VkPipelineLayout mPipelineLayout = VK_NULL_HANDLE;
+  VkPipeline mPipeline = VK_NULL_HANDLE;
+
+  int setCount() const { return mWindow->concurrentFrameCount(); }
+
+  bool createDescriptors(VkDescriptorSetLayout instanceSetLayout);
+
+  bool createPipeline(VkPipelineCache, VkGraphicsPipelineCreateInfo);
+
+  void destroyTexture(Texture&);
+
+  void writeDescriptors(int set, const std::vector<int>& indices);
+};
+
+
+#endif
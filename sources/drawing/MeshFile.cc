@@ -0,0 +1,161 @@
+/*
+ * Copyright (C) 2025 by Dirk Farin, Kronenstr. 49b, 70174 Stuttgart, Germany
+ *
+ * 2-Clause BSD
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer
+ *    in the documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "MeshFile.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+
+static const char kMagic[4] = { 'Q', 'M', 'S', 'H' };
+
+
+static bool fail(std::string* error, const char* msg)
+{
+  if (error) {
+    *error = msg;
+  }
+
+  return false;
+}
+
+
+template <typename Index>
+static bool indices_in_range(const uint8_t* data, uint32_t indexCount, uint32_t vertexCount)
+{
+  const Index* indices = reinterpret_cast<const Index*>(data);
+  return std::all_of(indices, indices + indexCount, [vertexCount](Index i) { return i < vertexCount; });
+}
+
+
+bool MeshFile::open(const std::string& path, std::string* error)
+{
+  if (!mFile.open(path)) {
+    return fail(error, "cannot open or map the file");
+  }
+
+  if (mFile.size() < sizeof(MeshFileHeader)) {
+    return fail(error, "file too short");
+  }
+
+  const MeshFileHeader& h = header();
+
+  if (memcmp(h.magic, kMagic, 4) != 0) {
+    return fail(error, "not a mesh file");
+  }
+
+  if (h.version != kMeshFileVersion) {
+    return fail(error, "unsupported version");
+  }
+
+  if (h.vertexFormat != (uint32_t) MeshVertexFormat::PositionColor || h.vertexStride != 6 * sizeof(float)) {
+    return fail(error, "unsupported vertex format");
+  }
+
+  if (h.indexSize != 2 && h.indexSize != 4) {
+    return fail(error, "invalid index size");
+  }
+
+  if (h.vertexCount == 0 && h.indexCount == 0) {
+    return fail(error, "empty mesh");
+  }
+
+  auto inFile = [this](uint64_t offset, uint64_t size) {
+    return offset % kMeshBlockAlignment == 0 && offset <= mFile.size() && size <= mFile.size() - offset;
+  };
+
+  if (!inFile(h.vertexOffset, uint64_t(h.vertexCount) * h.vertexStride) ||
+      !inFile(h.indexOffset, uint64_t(h.indexCount) * h.indexSize)) {
+    return fail(error, "blocks outside of the file (truncated?)");
+  }
+
+  // The blocks are aligned, so the indices can be read in place.
+  bool inRange = h.indexSize == 2 ? indices_in_range<uint16_t>(indexData(), h.indexCount, h.vertexCount)
+                                  : indices_in_range<uint32_t>(indexData(), h.indexCount, h.vertexCount);
+  if (!inRange) {
+    return fail(error, "index out of range");
+  }
+
+  return true;
+}
+
+
+bool write_mesh_file(const std::string& path, const float* vertices, uint32_t vertexCount,
+                     const uint32_t* indices, uint32_t indexCount)
+{
+  auto alignUp = [](uint64_t v) { return (v + kMeshBlockAlignment - 1) / kMeshBlockAlignment * kMeshBlockAlignment; };
+
+  MeshFileHeader h{};
+  memcpy(h.magic, kMagic, 4);
+  h.version = kMeshFileVersion;
+  h.vertexFormat = (uint32_t) MeshVertexFormat::PositionColor;
+  h.vertexStride = 6 * sizeof(float);
+  h.vertexCount = vertexCount;
+  h.indexSize = vertexCount <= 65536 ? 2 : 4;
+  h.indexCount = indexCount;
+  h.vertexOffset = alignUp(sizeof(MeshFileHeader));
+  h.indexOffset = alignUp(h.vertexOffset + uint64_t(vertexCount) * h.vertexStride);
+
+  for (int k = 0; k < 3; k++) {
+    h.boundsMin[k] = vertexCount ? vertices[k] : 0;
+    h.boundsMax[k] = vertexCount ? vertices[k] : 0;
+  }
+
+  for (uint32_t v = 0; v < vertexCount; v++) {
+    for (int k = 0; k < 3; k++) {
+      h.boundsMin[k] = std::min(h.boundsMin[k], vertices[6 * v + k]);
+      h.boundsMax[k] = std::max(h.boundsMax[k], vertices[6 * v + k]);
+    }
+  }
+
+  FILE* fh = fopen(path.c_str(), "wb");
+  if (!fh) {
+    return false;
+  }
+
+  static const uint8_t zeros[kMeshBlockAlignment] = {};
+  uint64_t pos = 0;
+
+  auto write = [&](const void* data, uint64_t size) {
+    pos += size;
+    return fwrite(data, 1, size, fh) == size;
+  };
+
+  auto padTo = [&](uint64_t offset) {
+    return write(zeros, offset - pos);
+  };
+
+  bool ok = write(&h, sizeof(h));
+  ok = ok && padTo(h.vertexOffset) && write(vertices, uint64_t(vertexCount) * h.vertexStride);
+  ok = ok && padTo(h.indexOffset);
+
+  if (h.indexSize == 2) {
+    std::vector<uint16_t> indices16(indices, indices + indexCount);
+    ok = ok && write(indices16.data(), indices16.size() * 2);
+  }
+  else {
+    ok = ok && write(indices, uint64_t(indexCount) * 4);
+  }
+
+  ok = fclose(fh) == 0 && ok;
+
+  return ok;
+}
@@ -0,0 +1,94 @@
+/*
+ * Copyright (C) 2025 by Dirk Farin, Kronenstr. 49b, 70174 Stuttgart, Germany
+ *
+ * 2-Clause BSD
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer
+ *    in the documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef MESHFILE_H
+#define MESHFILE_H
+
+#include "util/MappedFile.h"
+
+#include <cstdint>
+#include <string>
+
+
+// Binary mesh file (.qmesh) that is used in place after mapping it into memory.
+//
+// Layout: MeshFileHeader, then the vertex block and the index block, each starting at a multiple
+// of kMeshBlockAlignment. The blocks have exactly the layout of the GPU buffers, so they can be
+// copied into (staging) buffers as they are. All values are little endian.
+
+static const uint32_t kMeshFileVersion = 1;
+static const uint32_t kMeshBlockAlignment = 16;
+
+enum class MeshVertexFormat : uint32_t
+{
+  PositionColor = 1  // float x, y, z, r, g, b (the layout of NonSkiaVulkanRenderer)
+};
+
+struct MeshFileHeader
+{
+  char magic[4];          // "QMSH"
+  uint32_t version;
+  uint32_t vertexFormat;  // MeshVertexFormat
+  uint32_t vertexStride;  // bytes
+  uint32_t vertexCount;
+  uint32_t indexSize;     // 2 or 4 bytes
+  uint32_t indexCount;
+  uint32_t reserved0;
+  uint64_t vertexOffset;  // from the start of the file
+  uint64_t indexOffset;
+  float boundsMin[3];
+  float boundsMax[3];
+  uint32_t reserved1[2];
+};
+
+static_assert(sizeof(MeshFileHeader) == 80, "MeshFileHeader is part of the file format");
+
+
+class MeshFile
+{
+public:
+  // Maps the file and checks the header and the block ranges. Empty meshes are rejected.
+  // The vertex data is not read; the index block is read once to check that all indices
+  // reference existing vertices.
+  bool open(const std::string& path, std::string* error);
+
+  const MeshFileHeader& header() const { return *reinterpret_cast<const MeshFileHeader*>(mFile.data()); }
+
+  const uint8_t* vertexData() const { return mFile.data() + header().vertexOffset; }
+
+  size_t vertexBytes() const { return size_t(header().vertexCount) * header().vertexStride; }
+
+  const uint8_t* indexData() const { return mFile.data() + header().indexOffset; }
+
+  size_t indexBytes() const { return size_t(header().indexCount) * header().indexSize; }
+
+  size_t fileSize() const { return mFile.size(); }
+
+  void prefetch() const { mFile.prefetch(); }
+
+private:
+  MappedFile mFile;
+};
+
+
+// Writes a mesh of the PositionColor format. Indices are stored with 16 bits if possible.
+bool write_mesh_file(const std::string& path, const float* vertices, uint32_t vertexCount,
+                     const uint32_t* indices, uint32_t indexCount);
+
+#endif
@@ -3,9 +3,22 @@
 //
 
 #include "NonSkiaVulkanRenderer.h"
-#include <iostream>
+#include "profiling/Tracing.h"
+#include "util/Log.h"
+#include "PresentConfig.h"
+#include "profiling/FrameStats.h"
+#include "profiling/LatencyProbe.h"
+#include "profiling/StartupProfile.h"
+#include "ShaderCache.h"
+#include "VulkanAssets.h"
+#include "MeshFile.h"
 #include <QVulkanDeviceFunctions>
-#include <QFile>
+
+#include <algorithm>
+#include <cmath>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
 
 
 // Hardcoded mesh for now. Will be put in its own class soon!
@@ -20,28 +33,59 @@ static float vertexData[] = {
     0.5f,  -0.5f,  0.0f,   0.0f, 0.0f, 1.0f     //bottom right vertex - blue
 };
 
+// Entry of the pipeline cache in the ShaderCache.
+static const char* const kPipelineCacheName = "vk-pipeline-cache";
+
+// Edge length of the generated textures (see createTextures()).
+static const uint32_t kTextureSize = 32;
+
 //Utility variable and function for alignment:
 static const int UNIFORM_DATA_SIZE = 16 * sizeof(float); //our MVP matrix contains 16 floats
+static const int TEXTURE_INDEX_SIZE = 4 * sizeof(uint32_t); // after the matrix, padded to std140 size
 static inline VkDeviceSize aligned(VkDeviceSize v, VkDeviceSize byteAlign)
 {
   return (v + byteAlign - 1) & ~(byteAlign - 1);
 }
 
 
+static NativeVulkanConfig sNativeVulkanConfig;
+
+
+void set_native_vulkan_config(const NativeVulkanConfig& config)
+{
+  sNativeVulkanConfig = config;
+}
+
+
+const NativeVulkanConfig& native_vulkan_config()
+{
+  return sNativeVulkanConfig;
+}
+
+
 /*** RenderWindow class ***/
 
 NonSkiaVulkanRenderer::NonSkiaVulkanRenderer(QVulkanWindow *w, bool msaa)
     : mWindow(w)
 {
+  mInstances = std::max(1, sNativeVulkanConfig.instances);
+
+  mGpuCulling = sNativeVulkanConfig.gpuCulling;
+
+  mRecordThreads = sNativeVulkanConfig.recordThreads;
+  if (mRecordThreads <= 0) {
+    mRecordThreads = std::max(1, (int) std::thread::hardware_concurrency());
+  }
+
   if (msaa) {
     const QVector<int> counts = w->supportedSampleCounts();
     for (int s : counts) {
-      std::cout << "Supported sample counts:" << s << "\n";
+      LOG_DEBUG("Supported sample count: %d", s);
     }
 
     for (int s = 16; s >= 4; s /= 2) {
       if (counts.contains(s)) {
-        qDebug("Requesting sample count %d", s);
+        LOG_DEBUG("Requesting sample count %d", s);
         mWindow->setSampleCount(s);
         break;
       }
@@ -51,7 +95,9 @@ NonSkiaVulkanRenderer::NonSkiaVulkanRenderer(QVulkanWindow *w, bool msaa)
 
 void NonSkiaVulkanRenderer::initResources()
 {
-  qDebug("\n ***************************** initResources ******************************************* \n");
+  STARTUP_PHASE("vulkan resources");
+
+  LOG_DEBUG("initResources");
 
   VkDevice logicalDevice = mWindow->device();
   mDeviceFunctions = mWindow->vulkanInstance()->deviceFunctions(logicalDevice);
@@ -75,16 +121,18 @@ void NonSkiaVulkanRenderer::initResources()
   const int concurrentFrameCount = mWindow->concurrentFrameCount(); // 2 on Oles Machine
   const VkPhysicalDeviceLimits *pdevLimits = &mWindow->physicalDeviceProperties()->limits;
   const VkDeviceSize uniAlign = pdevLimits->minUniformBufferOffsetAlignment;
-  qDebug("uniform buffer offset alignment is %u", (uint)uniAlign); //64 on Oles machine
+  LOG_DEBUG("uniform buffer offset alignment is %u", (uint)uniAlign); //64 on Oles machine
 
   VkBufferCreateInfo bufInfo;
   memset(&bufInfo, 0, sizeof(bufInfo)); //Clear out the memory
   bufInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO; // Set the structure type
 
   // Our internal layout is vertex, uniform, uniform, ... with each uniform buffer
-  // start offset aligned to uniAlign.
+  // start offset aligned to uniAlign. A uniform buffer holds the matrices of all instances.
   const VkDeviceSize vertexAllocSize = aligned(sizeof(vertexData), uniAlign);
-  const VkDeviceSize uniformAllocSize = aligned(UNIFORM_DATA_SIZE, uniAlign);
+  mUniformSize = UNIFORM_DATA_SIZE + (sNativeVulkanConfig.textures > 0 ? TEXTURE_INDEX_SIZE : 0);
+  mUniformStride = aligned(mUniformSize, uniAlign);
+  const VkDeviceSize uniformAllocSize = mUniformStride * mInstances;
   bufInfo.size = vertexAllocSize + concurrentFrameCount * uniformAllocSize; //One vertex buffer and two uniform buffers
   bufInfo.usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT; // Set the usage to both vertex buffer and uniform buffer
 
@@ -115,16 +163,41 @@ void NonSkiaVulkanRenderer::initResources()
   if (err != VK_SUCCESS)
     qFatal("Failed to map memory: %d", err);
   memcpy(p, vertexData, sizeof(vertexData));
-  QMatrix4x4 ident;
   memset(mUniformBufferInfo, 0, sizeof(mUniformBufferInfo));
   for (int i = 0; i < concurrentFrameCount; ++i) {
     const VkDeviceSize offset = vertexAllocSize + i * uniformAllocSize;
-    memcpy(p + offset, ident.constData(), 16 * sizeof(float));
     mUniformBufferInfo[i].buffer = mBuffer;
     mUniformBufferInfo[i].offset = offset;
-    mUniformBufferInfo[i].range = uniformAllocSize;
+    mUniformBufferInfo[i].range = mUniformSize; // one instance, the dynamic offset selects it
+  }
+
+  // Stays mapped, the matrices are written every frame (possibly from several threads).
+  mMappedBuffer = p;
+
+  // Optional mesh that replaces the triangle, streamed in while rendering starts.
+  mUploads.init(mWindow);
+
+  const std::string& meshPath = sNativeVulkanConfig.meshFile;
+  if (!meshPath.empty()) {
+    mMeshStart = std::chrono::steady_clock::now();
+    mMeshFrames = 0;
+
+    mMeshFile = std::make_unique<MeshFile>();
+    std::string error;
+    if (!mMeshFile->open(meshPath, &error)) {
+      LOG_WARNING("cannot load mesh %s: %s", meshPath.c_str(), error.c_str());
+      mMeshFile.reset();
+    }
+    else {
+      mMeshFile->prefetch();
+
+      mMeshTicket = stream_mesh(mUploads, *mMeshFile, &mPendingMesh);
+      if (!mMeshTicket) {
+        LOG_WARNING("cannot allocate %.1f MB for mesh %s", mMeshFile->fileSize() / (1024.0 * 1024.0), meshPath.c_str());
+        mMeshFile.reset();
+      }
+    }
   }
-  mDeviceFunctions->vkUnmapMemory(logicalDevice, mBufferMemory);
 
   /********************************* Vertex layout: *********************************/
 
@@ -162,7 +235,7 @@ void NonSkiaVulkanRenderer::initResources()
   vertexInputInfo.pVertexAttributeDescriptions = vertexAttrDesc;
 
   // Set up descriptor set and its layout.
-  VkDescriptorPoolSize descPoolSizes = { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, uint32_t(concurrentFrameCount) };
+  VkDescriptorPoolSize descPoolSizes = { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, uint32_t(concurrentFrameCount) };
   VkDescriptorPoolCreateInfo descPoolInfo;
   memset(&descPoolInfo, 0, sizeof(descPoolInfo));
   descPoolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
@@ -176,7 +249,7 @@ void NonSkiaVulkanRenderer::initResources()
   /********************************* Uniform (projection matrix) bindings: *********************************/
   VkDescriptorSetLayoutBinding layoutBinding = {
       0, // binding
-      VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+      VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
       1,
       VK_SHADER_STAGE_VERTEX_BIT,
       nullptr
@@ -209,15 +282,21 @@ void NonSkiaVulkanRenderer::initResources()
     descWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
     descWrite.dstSet = mDescriptorSet[i];
     descWrite.descriptorCount = 1;
-    descWrite.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    descWrite.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
     descWrite.pBufferInfo = &mUniformBufferInfo[i];
     mDeviceFunctions->vkUpdateDescriptorSets(logicalDevice, 1, &descWrite, 0, nullptr);
   }
 
-  // Pipeline cache
+  // Pipeline cache, initialized from the previous run. The driver ignores data of another device or driver version.
+  sk_sp<SkData> pipelineCacheData = shader_cache().load(kPipelineCacheName);
+
   VkPipelineCacheCreateInfo pipelineCacheInfo;
   memset(&pipelineCacheInfo, 0, sizeof(pipelineCacheInfo));
   pipelineCacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+  if (pipelineCacheData) {
+    pipelineCacheInfo.initialDataSize = pipelineCacheData->size();
+    pipelineCacheInfo.pInitialData = pipelineCacheData->data();
+  }
   err = mDeviceFunctions->vkCreatePipelineCache(logicalDevice, &pipelineCacheInfo, nullptr, &mPipelineCache);
   if (err != VK_SUCCESS)
     qFatal("Failed to create pipeline cache: %d", err);
@@ -234,8 +313,8 @@ void NonSkiaVulkanRenderer::initResources()
 
   /********************************* Create shaders *********************************/
   //Creates our actuall shader modules
-  VkShaderModule vertShaderModule = createShader(QStringLiteral(":/color_vert.spv"));
-  VkShaderModule fragShaderModule = createShader(QStringLiteral(":/color_frag.spv"));
+  VkShaderModule vertShaderModule = load_shader_module(mWindow, QStringLiteral(":/color_vert.spv"));
+  VkShaderModule fragShaderModule = load_shader_module(mWindow, QStringLiteral(":/color_frag.spv"));
 
   // Graphics pipeline
   VkGraphicsPipelineCreateInfo pipelineInfo;
@@ -332,19 +411,145 @@ void NonSkiaVulkanRenderer::initResources()
   if (err != VK_SUCCESS)
     qFatal("Failed to create graphics pipeline: %d", err);
 
+  // The GPU-driven path adds a compute pipeline and a variant of this graphics pipeline.
+  if (mGpuCulling && !mCulling.init(mWindow, mPipelineCache, pipelineInfo, mInstances)) {
+    LOG_WARNING("GPU culling is not available, drawing the instances directly");
+    mGpuCulling = false;
+  }
+
+  // The textured draw is another variant, with the textures as second descriptor set.
+  if (mUniformSize > UNIFORM_DATA_SIZE && !mGpuCulling) {
+    if (mMaterials.init(mWindow, &mUploads, mPipelineCache, pipelineInfo, mDescriptorSetLayout, sNativeVulkanConfig.textures)) {
+      createTextures();
+    }
+    else {
+      LOG_WARNING("textures are not available, drawing untextured");
+    }
+  }
+
   if (vertShaderModule)
     mDeviceFunctions->vkDestroyShaderModule(logicalDevice, vertShaderModule, nullptr);
   if (fragShaderModule)
     mDeviceFunctions->vkDestroyShaderModule(logicalDevice, fragShaderModule, nullptr);
 
-  qDebug("\n ***************************** initResources finished ******************************************* \n");
+  LOG_DEBUG("initResources finished");
 
   getVulkanHWInfo();
+
+  mGpuTimer.init(mWindow);
+
+  if (mRecordThreads > 1 && !mGpuCulling) {
+    createRecordBatches();
+  }
+}
+
+
+void NonSkiaVulkanRenderer::createTextures()
+{
+  // Checkerboards in different colors and sizes, streamed in by the upload service.
+  const int count = mMaterials.capacity() - 1; // without the default texture
+
+  auto channel = [](float v) { return (uint8_t) (255 * std::max(0.0f, std::min(1.0f, v))); };
+
+  for (int t = 0; t < count; t++) {
+    const float hue = std::fmod(t * 0.618034f, 1.0f) * 6;
+    const uint8_t color[3] = { channel(std::fabs(hue - 3) - 1), channel(2 - std::fabs(hue - 2)), channel(2 - std::fabs(hue - 4)) };
+    const uint32_t squares = 2 + t % 7;
+
+    std::vector<uint8_t> rgba(kTextureSize * kTextureSize * 4);
+
+    for (uint32_t y = 0; y < kTextureSize; y++) {
+      for (uint32_t x = 0; x < kTextureSize; x++) {
+        uint8_t* p = &rgba[(y * kTextureSize + x) * 4];
+        bool dark = (x * squares / kTextureSize + y * squares / kTextureSize) & 1;
+        for (int c = 0; c < 3; c++) {
+          p[c] = dark ? color[c] / 3 : color[c];
+        }
+        p[3] = 255;
+      }
+    }
+
+    int index = mMaterials.addTexture(kTextureSize, kTextureSize, std::move(rgba));
+    if (index < 0) {
+      break;
+    }
+
+    mTextureIndices.push_back(index);
+  }
+}
+
+
+void NonSkiaVulkanRenderer::createRecordBatches()
+{
+  VkDevice dev = mWindow->device();
+
+  mBatches.resize(mRecordThreads);
+  mBatchCBs.resize(mRecordThreads);
+
+  for (RecordBatch& batch : mBatches) {
+    for (int f = 0; f < mWindow->concurrentFrameCount(); f++) {
+      VkCommandPoolCreateInfo poolInfo{};
+      poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+      poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+      poolInfo.queueFamilyIndex = mWindow->graphicsQueueFamilyIndex();
+
+      VkResult err = mDeviceFunctions->vkCreateCommandPool(dev, &poolInfo, nullptr, &batch.pool[f]);
+      if (err != VK_SUCCESS)
+        qFatal("Failed to create command pool: %d", err);
+
+      VkCommandBufferAllocateInfo allocInfo{};
+      allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+      allocInfo.commandPool = batch.pool[f];
+      allocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+      allocInfo.commandBufferCount = 1;
+
+      err = mDeviceFunctions->vkAllocateCommandBuffers(dev, &allocInfo, &batch.cb[f]);
+      if (err != VK_SUCCESS)
+        qFatal("Failed to allocate secondary command buffer: %d", err);
+    }
+  }
+
+  // The render thread records the first batch itself.
+  mRecordPool = std::make_unique<ThreadPool>(mRecordThreads - 1, "vk-record");
+
+  for (int b = 1; b < mRecordThreads; b++) {
+    mBatchTasks.push_back([this, b] {
+      recordBatch(b);
+
+      std::lock_guard<std::mutex> lock(mBatchMutex);
+      if (--mBatchesRemaining == 0) {
+        mBatchesDone.notify_one();
+      }
+    });
+  }
+
+  LOG_INFO("recording %d instances in %d batches in parallel", mInstances, mRecordThreads);
+}
+
+
+void NonSkiaVulkanRenderer::releaseRecordBatches()
+{
+  mRecordPool.reset();
+
+  VkDevice dev = mWindow->device();
+
+  for (RecordBatch& batch : mBatches) {
+    for (VkCommandPool& pool : batch.pool) {
+      if (pool) {
+        mDeviceFunctions->vkDestroyCommandPool(dev, pool, nullptr); // frees the command buffer
+        pool = VK_NULL_HANDLE;
+      }
+    }
+  }
+
+  mBatches.clear();
+  mBatchCBs.clear();
+  mBatchTasks.clear();
 }
 
 void NonSkiaVulkanRenderer::initSwapChainResources()
 {
-  qDebug("\n ***************************** initSwapChainResources ******************************************* \n");
+  LOG_DEBUG("initSwapChainResources");
 
   // Projection matrix - how the scene will be projected into the render window
 
@@ -366,8 +571,111 @@ void NonSkiaVulkanRenderer::initSwapChainResources()
 
 void NonSkiaVulkanRenderer::startNextFrame()
 {
-  VkDevice dev = mWindow->device();
-  VkCommandBuffer cb = mWindow->currentCommandBuffer();
+  TRACE_SCOPE("NonSkiaVulkanRenderer::startNextFrame");
+
+  frame_stats().beginFrame();
+
+  wait_for_frames_in_flight(mWindow);
+
+  mGpuTimer.poll();
+
+  VkCommandBuffer cmdBuf = mWindow->currentCommandBuffer();
+
+  updateUploads(cmdBuf);
+
+  if (mGpuCulling) {
+    mGpuTimer.begin(cmdBuf);
+    recordCulledDraw(cmdBuf);
+  }
+  else if (mBatches.empty()) {
+    mGpuTimer.begin(cmdBuf);
+    beginRenderPass(cmdBuf, VK_SUBPASS_CONTENTS_INLINE);
+
+    recordDraw(cmdBuf);
+  }
+  else {
+    recordBatches();
+
+    mGpuTimer.begin(cmdBuf);
+    beginRenderPass(cmdBuf, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+
+    mDeviceFunctions->vkCmdExecuteCommands(cmdBuf, (uint32_t) mBatchCBs.size(), mBatchCBs.data());
+  }
+
+  mDeviceFunctions->vkCmdEndRenderPass(cmdBuf);
+  mGpuTimer.end(cmdBuf);
+
+  /*QVulkanWindow subclasses queue their draw calls in their reimplementation of
+  QVulkanWindowRenderer::startNextFrame(). Once done, they are required to call back
+  QVulkanWindow::frameReady(). The example has no asynchronous command generation, so the
+  frameReady() call is made directly from startNextFrame().
+  To get continuous updates, the example simply invokes QWindow::requestUpdate() in order to schedule a repaint.
+  This means that it requests the Qt window system to call the update() method,
+  which will eventually lead to the paintEvent() being called.
+  */
+  present();
+
+  frame_stats().endFrame();
+}
+
+
+void NonSkiaVulkanRenderer::updateUploads(VkCommandBuffer cb)
+{
+  mUploads.pump();
+
+  if (mUploads.takeCompletions()) {
+    // The copies have finished (fence). Make them visible to the draws of this frame.
+    VkMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+
+    mDeviceFunctions->vkCmdPipelineBarrier(cb, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                                           VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
+                                           1, &barrier, 0, nullptr, 0, nullptr);
+  }
+
+  // Textures that have become resident get their descriptors.
+  mMaterials.update();
+
+  if (!mMeshTicket) {
+    return;
+  }
+
+  mMeshFrames++;
+
+  if (mUploads.isComplete(mMeshTicket)) {
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - mMeshStart).count();
+    double mb = mMeshFile->fileSize() / (1024.0 * 1024.0);
+    LOG_INFO("mesh: %u vertices, %u indices, %.1f MB streamed in %.1f ms (%.2f ms/MB) during %d frames",
+             mMeshFile->header().vertexCount, mMeshFile->header().indexCount, mb, ms, ms / mb, mMeshFrames);
+
+    mMesh = mPendingMesh;
+    mPendingMesh = MeshBufferVulkan{};
+    mMeshTicket = 0;
+    mMeshFile.reset();
+  }
+}
+
+
+void NonSkiaVulkanRenderer::present()
+{
+  // Submission and presentation both happen in frameReady().
+  latency_probe().frameSubmitted();
+
+  {
+    AllocStageScope allocStage(RenderStage::Present);
+    mWindow->frameReady();
+    mWindow->requestUpdate(); // render continuously, throttled by the presentation rate
+  }
+
+  latency_probe().framePresented();
+  startup_frame_presented();
+}
+
+
+void NonSkiaVulkanRenderer::beginRenderPass(VkCommandBuffer cmdBuf, VkSubpassContents contents)
+{
   const QSize sz = mWindow->swapChainImageSize();
 
   //Backtgound color of the render window - dark grey -
@@ -389,39 +697,156 @@ void NonSkiaVulkanRenderer::startNextFrame()
   rpBeginInfo.renderArea.extent.height = sz.height();
   rpBeginInfo.clearValueCount = mWindow->sampleCountFlagBits() > VK_SAMPLE_COUNT_1_BIT ? 3 : 2;
   rpBeginInfo.pClearValues = clearValues;
-  VkCommandBuffer cmdBuf = mWindow->currentCommandBuffer();
-  mDeviceFunctions->vkCmdBeginRenderPass(cmdBuf, &rpBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
-
-  quint8* GPUmemPointer;
-  VkResult err = mDeviceFunctions->vkMapMemory(dev, mBufferMemory, mUniformBufferInfo[mWindow->currentFrame()].offset,
-                                               UNIFORM_DATA_SIZE, 0, reinterpret_cast<void **>(&GPUmemPointer));
-  if (err != VK_SUCCESS)
-    qFatal("Failed to map memory: %d", err);
+  mDeviceFunctions->vkCmdBeginRenderPass(cmdBuf, &rpBeginInfo, contents);
+}
 
-  /********************************* Set the rotation in our matrix *********************************/
-  //We make a temp of this to now mess up the original matrix
-  QMatrix4x4 tempMatrix = mProjectionMatrix;
-  //Rotates the object
-  //                  speed,   X, Y, Z axis
-  /**PLAY WITH THIS**/
-  tempMatrix.rotate(mRotation, 0, 1, 0);
 
-  memcpy(GPUmemPointer, tempMatrix.constData(), 16 * sizeof(float));
-  mDeviceFunctions->vkUnmapMemory(dev, mBufferMemory);
+void NonSkiaVulkanRenderer::recordDraw(VkCommandBuffer cb)
+{
+  writeInstanceUniforms(0, mInstances);
+  recordInstances(cb, 0, mInstances);
 
   //rotate the triangle 1 degree per frame
   /**PLAY WITH THIS**/
   mRotation += 1.0f;
+}
+
+
+void NonSkiaVulkanRenderer::recordCulledDraw(VkCommandBuffer cb)
+{
+  QMatrix4x4 viewProj = mProjectionMatrix;
+  viewProj.translate(-mCulling.panOffset(mRotation), 0, 0);
+
+  mCulling.recordCulling(cb, viewProj, mRotation);
+
+  beginRenderPass(cb, VK_SUBPASS_CONTENTS_INLINE);
+
+  const QSize sz = mWindow->swapChainImageSize();
+
+  VkViewport viewport;
+  viewport.x = viewport.y = 0;
+  viewport.width = sz.width();
+  viewport.height = sz.height();
+  viewport.minDepth = 0;
+  viewport.maxDepth = 1;
+  mDeviceFunctions->vkCmdSetViewport(cb, 0, 1, &viewport);
+
+  VkRect2D scissor;
+  scissor.offset.x = scissor.offset.y = 0;
+  scissor.extent.width = viewport.width;
+  scissor.extent.height = viewport.height;
+  mDeviceFunctions->vkCmdSetScissor(cb, 0, 1, &scissor);
+
+  mCulling.recordDraw(cb, mBuffer);
+
+  mRotation += 1.0f;
+}
+
+
+void NonSkiaVulkanRenderer::beginSecondary(VkCommandBuffer cb)
+{
+  VkCommandBufferInheritanceInfo inheritance{};
+  inheritance.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+  inheritance.renderPass = mWindow->defaultRenderPass();
+  inheritance.subpass = 0;
+  inheritance.framebuffer = mWindow->currentFramebuffer();
+
+  VkCommandBufferBeginInfo beginInfo{};
+  beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+  beginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT | VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+  beginInfo.pInheritanceInfo = &inheritance;
+
+  VkResult err = mDeviceFunctions->vkBeginCommandBuffer(cb, &beginInfo);
+  if (err != VK_SUCCESS)
+    qFatal("Failed to begin secondary command buffer: %d", err);
+}
+
+
+void NonSkiaVulkanRenderer::writeInstanceUniforms(int first, int end)
+{
+  quint8* uniforms = mMappedBuffer + mUniformBufferInfo[mWindow->currentFrame()].offset;
+
+  if (mInstances == 1) {
+    /********************************* Set the rotation in our matrix *********************************/
+    //We make a temp of this to now mess up the original matrix
+    QMatrix4x4 tempMatrix = mProjectionMatrix;
+    //Rotates the object
+    //                  speed,   X, Y, Z axis
+    /**PLAY WITH THIS**/
+    tempMatrix.rotate(mRotation, 0, 1, 0);
+
+    memcpy(uniforms, tempMatrix.constData(), 16 * sizeof(float));
+    writeTextureIndex(uniforms, 0);
+    return;
+  }
+
+  // Stress test: a grid of small triangles that covers the view (the plane z = 0 is visible
+  // up to about +-0.89 vertically), each rotating with its own phase.
+
+  const QSize sz = mWindow->swapChainImageSize();
+  const float aspect = sz.width() / (float) std::max(1, sz.height());
+  const float halfHeight = 0.85f;
+
+  int columns = std::max(1, (int) std::ceil(std::sqrt(mInstances * aspect)));
+  int rows = (mInstances + columns - 1) / columns;
+  float cell = std::min(2 * halfHeight * aspect / columns, 2 * halfHeight / rows);
+
+  for (int i = first; i < end; i++) {
+    int col = i % columns;
+    int row = i / columns;
+
+    QMatrix4x4 matrix = mProjectionMatrix;
+    matrix.translate((col - (columns - 1) / 2.0f) * cell, ((rows - 1) / 2.0f - row) * cell, 0);
+    matrix.scale(cell * 0.9f);
+    matrix.rotate(mRotation + (i % 360) * 13.0f, 0, 1, 0);
+
+    memcpy(uniforms + i * mUniformStride, matrix.constData(), 16 * sizeof(float));
+    writeTextureIndex(uniforms + i * mUniformStride, i);
+  }
+}
+
+
+void NonSkiaVulkanRenderer::writeTextureIndex(quint8* uniforms, int instance) const
+{
+  if (mTextureIndices.empty()) {
+    return;
+  }
+
+  // the default texture until the texture is resident
+  int index = mTextureIndices[instance % mTextureIndices.size()];
+  uint32_t textureIndex = mMaterials.isResident(index) ? index : 0;
+
+  memcpy(uniforms + UNIFORM_DATA_SIZE, &textureIndex, sizeof(textureIndex));
+}
+
+
+void NonSkiaVulkanRenderer::recordInstances(VkCommandBuffer cb, int first, int end)
+{
+  const QSize sz = mWindow->swapChainImageSize();
+  const int frame = mWindow->currentFrame();
+
+  // One pipeline and texture set for all instances, however many textures there are.
+  const bool textured = mMaterials.isReady();
+  const VkPipelineLayout layout = textured ? mMaterials.pipelineLayout() : mPipelineLayout;
+
+  mDeviceFunctions->vkCmdBindPipeline(cb, VK_PIPELINE_BIND_POINT_GRAPHICS, textured ? mMaterials.pipeline() : mPipeline);
+  if (textured) {
+    mMaterials.bind(cb);
+  }
 
-  mDeviceFunctions->vkCmdBindPipeline(cb, VK_PIPELINE_BIND_POINT_GRAPHICS, mPipeline);
-  mDeviceFunctions->vkCmdBindDescriptorSets(cb, VK_PIPELINE_BIND_POINT_GRAPHICS, mPipelineLayout, 0, 1,
-                                            &mDescriptorSet[mWindow->currentFrame()], 0, nullptr);
   VkDeviceSize vbOffset = 0;
 
   //The second parameter here is the binding to the VertexInputBindingDescription,
   //so it has to be the same number used there
-  mDeviceFunctions->vkCmdBindVertexBuffers(cb, 0, 1, &mBuffer, &vbOffset);
+  if (mMesh.buffer) {
+    mDeviceFunctions->vkCmdBindVertexBuffers(cb, 0, 1, &mMesh.buffer, &vbOffset);
+    mDeviceFunctions->vkCmdBindIndexBuffer(cb, mMesh.buffer, mMesh.indexOffset, mMesh.indexType);
+  }
+  else {
+    mDeviceFunctions->vkCmdBindVertexBuffers(cb, 0, 1, &mBuffer, &vbOffset);
+  }
 
+  // Dynamic state is not inherited by secondary command buffers, so every batch sets it.
   VkViewport viewport;
   viewport.x = viewport.y = 0;
   viewport.width = sz.width();
@@ -436,54 +861,78 @@ void NonSkiaVulkanRenderer::startNextFrame()
   scissor.extent.height = viewport.height;
   mDeviceFunctions->vkCmdSetScissor(cb, 0, 1, &scissor);
 
-  /********************************* Our draw call!: *********************************/
-  // the number 3 is the number of vertices, so you have to change that if you add more!
-  mDeviceFunctions->vkCmdDraw(cb, 3, 1, 0, 0);
+  for (int i = first; i < end; i++) {
+    uint32_t dynamicOffset = (uint32_t) (i * mUniformStride);
+    mDeviceFunctions->vkCmdBindDescriptorSets(cb, VK_PIPELINE_BIND_POINT_GRAPHICS, layout, 0, 1,
+                                              &mDescriptorSet[frame], 1, &dynamicOffset);
 
-  mDeviceFunctions->vkCmdEndRenderPass(cmdBuf);
+    /********************************* Our draw call!: *********************************/
+    // the number 3 is the number of vertices, so you have to change that if you add more!
+    if (mMesh.buffer) {
+      mDeviceFunctions->vkCmdDrawIndexed(cb, mMesh.indexCount, 1, 0, 0, 0);
+    }
+    else {
+      mDeviceFunctions->vkCmdDraw(cb, 3, 1, 0, 0);
+    }
+  }
+}
 
-  /*QVulkanWindow subclasses queue their draw calls in their reimplementation of
-  QVulkanWindowRenderer::startNextFrame(). Once done, they are required to call back
-  QVulkanWindow::frameReady(). The example has no asynchronous command generation, so the
-  frameReady() call is made directly from startNextFrame().
-  To get continuous updates, the example simply invokes QWindow::requestUpdate() in order to schedule a repaint.
-  This means that it requests the Qt window system to call the update() method,
-  which will eventually lead to the paintEvent() being called.
-  */
-  mWindow->frameReady();
-  mWindow->requestUpdate(); // render continuously, throttled by the presentation rate
+
+void NonSkiaVulkanRenderer::recordBatches()
+{
+  TRACE_SCOPE("record batches");
+
+  // A single instance is shared by all batches: written once, before the workers start.
+  if (mInstances == 1) {
+    writeInstanceUniforms(0, 1);
+  }
+
+  mBatchesRemaining = (int) mBatchTasks.size();
+
+  for (const std::function<void()>& task : mBatchTasks) {
+    mRecordPool->enqueue(task);
+  }
+
+  recordBatch(0);
+
+  {
+    std::unique_lock<std::mutex> lock(mBatchMutex);
+    mBatchesDone.wait(lock, [this] { return mBatchesRemaining == 0; });
+  }
+
+  //rotate the triangle 1 degree per frame
+  mRotation += 1.0f;
 }
 
-VkShaderModule NonSkiaVulkanRenderer::createShader(const QString &name)
+
+void NonSkiaVulkanRenderer::recordBatch(int b)
 {
-  //This uses Qt's own file opening and resource system
-  //We probably will replace it with pure C++ when expanding the program
-  QFile file(name);
-  if (!file.open(QIODevice::ReadOnly)) {
-    qWarning("Failed to read shader %s", qPrintable(name));
-    return VK_NULL_HANDLE;
-  }
-  QByteArray blob = file.readAll();
-  file.close();
-
-  VkShaderModuleCreateInfo shaderInfo;
-  memset(&shaderInfo, 0, sizeof(shaderInfo));
-  shaderInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-  shaderInfo.codeSize = blob.size();
-  shaderInfo.pCode = reinterpret_cast<const uint32_t *>(blob.constData());
-  VkShaderModule shaderModule;
-  VkResult err = mDeviceFunctions->vkCreateShaderModule(mWindow->device(), &shaderInfo, nullptr, &shaderModule);
-  if (err != VK_SUCCESS) {
-    qWarning("Failed to create shader module: %d", err);
-    return VK_NULL_HANDLE;
-  }
-
-  return shaderModule;
+  TRACE_SCOPE("record batch");
+
+  const int frame = mWindow->currentFrame();
+  const int nBatches = (int) mBatches.size();
+
+  int first = (int) ((int64_t) mInstances * b / nBatches);
+  int end = (int) ((int64_t) mInstances * (b + 1) / nBatches);
+
+  if (mInstances > 1) {
+    writeInstanceUniforms(first, end);
+  }
+
+  // Qt has waited for the fence of this frame slot, so the GPU is done with the pool's command buffer.
+  VkCommandBuffer cb = mBatches[b].cb[frame];
+  mDeviceFunctions->vkResetCommandPool(mWindow->device(), mBatches[b].pool[frame], 0);
+
+  beginSecondary(cb);
+  recordInstances(cb, first, end);
+  mDeviceFunctions->vkEndCommandBuffer(cb);
+
+  mBatchCBs[b] = cb;
 }
 
 void NonSkiaVulkanRenderer::getVulkanHWInfo()
 {
-  qDebug("\n ***************************** Vulkan Hardware Info ******************************************* \n");
+  LOG_DEBUG("Vulkan Hardware Info");
   QVulkanInstance *inst = mWindow->vulkanInstance();
   mDeviceFunctions = inst->deviceFunctions(mWindow->device());
 
@@ -523,21 +972,40 @@ void NonSkiaVulkanRenderer::getVulkanHWInfo()
     info += QLatin1Char(' ') + QString::number(count);
   info += QLatin1Char('\n');
 
-  qDebug(info.toUtf8().constData());
-  qDebug("\n ***************************** Vulkan Hardware Info finished ******************************************* \n");
+  // one message per line, log records are limited in length
+  for (const QString& line : info.split(QLatin1Char('\n')))
+    if (!line.isEmpty())
+      LOG_DEBUG("%s", qPrintable(line));
+  LOG_DEBUG("Vulkan Hardware Info finished");
 }
 
 void NonSkiaVulkanRenderer::releaseSwapChainResources()
 {
-  qDebug("\n ***************************** releaseSwapChainResources ******************************************* \n");
+  LOG_DEBUG("releaseSwapChainResources");
 }
 
 void NonSkiaVulkanRenderer::releaseResources()
 {
-  qDebug("\n ***************************** releaseResources ******************************************* \n");
+  LOG_DEBUG("releaseResources");
 
   VkDevice dev = mWindow->device();
 
+  mGpuTimer.release();
+
+  releaseRecordBatches();
+
+  mCulling.release();
+
+  mUploads.release(); // waits for the copies into the pending mesh and textures
+
+  mMaterials.release();
+  mTextureIndices.clear();
+
+  mMeshTicket = 0;
+  mMeshFile.reset();
+  mPendingMesh.release(mWindow);
+  mMesh.release(mWindow);
+
   if (mPipeline) {
     mDeviceFunctions->vkDestroyPipeline(dev, mPipeline, nullptr);
     mPipeline = VK_NULL_HANDLE;
@@ -549,6 +1017,14 @@ void NonSkiaVulkanRenderer::releaseResources()
   }
 
   if (mPipelineCache) {
+    size_t size = 0;
+    if (mDeviceFunctions->vkGetPipelineCacheData(dev, mPipelineCache, &size, nullptr) == VK_SUCCESS && size > 0) {
+      sk_sp<SkData> data = SkData::MakeUninitialized(size);
+      if (mDeviceFunctions->vkGetPipelineCacheData(dev, mPipelineCache, &size, data->writable_data()) == VK_SUCCESS) {
+        shader_cache().store(kPipelineCacheName, *SkData::MakeSubset(data.get(), 0, size));
+      }
+    }
+
     mDeviceFunctions->vkDestroyPipelineCache(dev, mPipelineCache, nullptr);
     mPipelineCache = VK_NULL_HANDLE;
   }
@@ -569,6 +1045,9 @@ void NonSkiaVulkanRenderer::releaseResources()
   }
 
   if (mBufferMemory) {
+    mDeviceFunctions->vkUnmapMemory(dev, mBufferMemory);
+    mMappedBuffer = nullptr;
+
     mDeviceFunctions->vkFreeMemory(dev, mBufferMemory, nullptr);
     mBufferMemory = VK_NULL_HANDLE;
   }
@@ -6,6 +6,46 @@
 #define NONSKIAVULKANRENDERER_H
 
 #include <QVulkanWindowRenderer>
+#include "profiling/GpuTimerVulkan.h"
+#include "GpuCullingVulkan.h"
+#include "VulkanAssets.h"
+#include "UploadServiceVulkan.h"
+#include "MaterialsVulkan.h"
+#include "MeshFile.h"
+#include "util/ThreadPool.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+
+// Workload of the native renderer.
+struct NativeVulkanConfig
+{
+  int instances = 1;     // triangles per frame, each with its own transform (stress test)
+
+  // Number of threads recording the draws. With more than one, the instances are split into
+  // batches that are recorded in parallel into secondary command buffers. 0: one per core.
+  int recordThreads = 1;
+
+  // Cull the instances with a compute shader and draw them with indirect draws (see GpuCullingVulkan).
+  bool gpuCulling = false;
+
+  // .qmesh file (see MeshFile.h) drawn instead of the triangle once it has been streamed in, not used by the GPU culling.
+  std::string meshFile;
+
+  // Number of textures, instance i samples texture i % textures (see MaterialsVulkan). 0: untextured.
+  // Not used by the GPU culling.
+  int textures = 0;
+};
+
+void set_native_vulkan_config(const NativeVulkanConfig&);
+
+const NativeVulkanConfig& native_vulkan_config();
 
 
 class NonSkiaVulkanRenderer : public QVulkanWindowRenderer
@@ -37,8 +77,32 @@ public:
 
 protected:
 
-  //Creates the Vulkan shader module from the precompiled shader files in .spv format
-  VkShaderModule createShader(const QString &name);
+  // Begins the default render pass on the current framebuffer, with the clear values.
+  void beginRenderPass(VkCommandBuffer, VkSubpassContents);
+
+  // Records the scene (inside the render pass) on the calling thread. 'cb' may also be a
+  // secondary command buffer.
+  void recordDraw(VkCommandBuffer cb);
+
+  // Culls and draws the instances on the GPU. Begins the render pass after the culling.
+  void recordCulledDraw(VkCommandBuffer cb);
+
+  // Advances the uploads and switches to the streamed mesh once it is complete. Records a barrier
+  // for finished uploads, so it must be called before the render pass (and before recording).
+  void updateUploads(VkCommandBuffer cb);
+
+  // Begins a secondary command buffer that continues the default render pass on the current framebuffer.
+  void beginSecondary(VkCommandBuffer);
+
+  // Threads used by recordBatches(). Subclasses that record the scene themselves set it to 1
+  // in their constructor.
+  int mRecordThreads = 1;
+
+  // Same for the GPU-driven path.
+  bool mGpuCulling = false;
+
+  // frameReady() and request of the next frame.
+  void present();
 
   //The ModelViewProjection MVP matrix
   QMatrix4x4 mProjectionMatrix;
@@ -63,6 +127,76 @@ protected:
   VkPipelineCache mPipelineCache{ VK_NULL_HANDLE };
   VkPipelineLayout mPipelineLayout{ VK_NULL_HANDLE };
   VkPipeline mPipeline{ VK_NULL_HANDLE };
+
+  GpuTimerVulkan mGpuTimer;
+
+  GpuCullingVulkan mCulling;
+
+  MeshBufferVulkan mMesh;
+
+  // --- streaming
+
+  UploadServiceVulkan mUploads;
+
+  // The mesh while it streams in. The triangle is drawn until it is complete.
+  std::unique_ptr<MeshFile> mMeshFile;
+  MeshBufferVulkan mPendingMesh;
+  UploadServiceVulkan::Ticket mMeshTicket = 0;
+  std::chrono::steady_clock::time_point mMeshStart;
+  int mMeshFrames = 0;
+
+  // --- textures
+  //     Streamed in like the mesh. Until the default texture is resident, the untextured pipeline is used.
+
+  MaterialsVulkan mMaterials;
+  std::vector<int> mTextureIndices;     // of the generated textures in mMaterials
+
+  void createTextures();
+
+  // --- instances
+  //     Each instance has its own matrix (and texture index) in the uniform buffer of the frame,
+  //     selected with a dynamic offset.
+
+  int mInstances = 1;
+  VkDeviceSize mUniformSize = 0;        // matrix, texture index with textures
+  VkDeviceSize mUniformStride = 0;      // aligned to minUniformBufferOffsetAlignment
+  quint8* mMappedBuffer = nullptr;      // host-visible buffer memory, mapped while the resources exist
+
+  void writeInstanceUniforms(int first, int end);
+
+  void writeTextureIndex(quint8* uniforms, int instance) const;
+
+  void recordInstances(VkCommandBuffer cb, int first, int end);
+
+  // --- parallel recording
+  //     One command pool per batch and frame slot. Pools are reset when their slot is reused, so
+  //     the command buffers are allocated only once.
+
+  struct RecordBatch
+  {
+    VkCommandPool pool[QVulkanWindow::MAX_CONCURRENT_FRAME_COUNT]{};
+    VkCommandBuffer cb[QVulkanWindow::MAX_CONCURRENT_FRAME_COUNT]{};
+  };
+
+  std::vector<RecordBatch> mBatches;
+  std::vector<VkCommandBuffer> mBatchCBs; // of the current frame, for vkCmdExecuteCommands()
+  std::unique_ptr<ThreadPool> mRecordPool;
+
+  // Tasks of the worker batches, built once. They only capture the renderer and the batch index,
+  // so enqueueing a copy does not allocate.
+  std::vector<std::function<void()>> mBatchTasks;
+  std::mutex mBatchMutex;
+  std::condition_variable mBatchesDone;
+  int mBatchesRemaining = 0;
+
+  void createRecordBatches();
+
+  void releaseRecordBatches();
+
+  // Records all instances into the batch command buffers of the current frame.
+  void recordBatches();
+
+  void recordBatch(int b);
 };
 
 #endif // NONSKIAVULKANRENDERER_H
@@ -0,0 +1,108 @@
+/*
+ * Copyright (C) 2025 by Dirk Farin, Kronenstr. 49b, 70174 Stuttgart, Germany
+ *
+ * 2-Clause BSD
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer
+ *    in the documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "PresentConfig.h"
+#include "profiling/Tracing.h"
+
+#include <QVulkanWindow>
+#include <QVulkanDeviceFunctions>
+
+#include <cstdio>
+
+
+static PresentConfig sPresentConfig;
+
+static const struct
+{
+  PresentMode mode;
+  const char* name;
+} sPresentModeNames[] = {
+    {PresentMode::Fifo, "fifo"},
+    {PresentMode::Mailbox, "mailbox"},
+    {PresentMode::Immediate, "immediate"},
+};
+
+
+void set_present_config(const PresentConfig& config)
+{
+  sPresentConfig = config;
+}
+
+
+const PresentConfig& present_config()
+{
+  return sPresentConfig;
+}
+
+
+const char* present_mode_name(PresentMode mode)
+{
+  for (const auto& m : sPresentModeNames) {
+    if (m.mode == mode) {
+      return m.name;
+    }
+  }
+
+  return "?";
+}
+
+
+bool parse_present_mode(const std::string& name, PresentMode* mode)
+{
+  for (const auto& m : sPresentModeNames) {
+    if (name == m.name) {
+      *mode = m.mode;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+
+std::string present_config_description()
+{
+  char buf[100];
+  snprintf(buf, sizeof(buf), "present-mode=%s frames-in-flight=%d swap-interval=%d",
+           present_mode_name(sPresentConfig.presentMode), sPresentConfig.framesInFlight, sPresentConfig.swapInterval);
+  return buf;
+}
+
+
+int gl_swap_interval()
+{
+  if (sPresentConfig.presentMode == PresentMode::Immediate) {
+    return 0;
+  }
+
+  return sPresentConfig.swapInterval;
+}
+
+
+void wait_for_frames_in_flight(QVulkanWindow* window)
+{
+  if (sPresentConfig.framesInFlight > 1) {
+    return; // QVulkanWindow itself keeps at most two frames in flight
+  }
+
+  TRACE_SCOPE("wait_for_frames_in_flight");
+
+  QVulkanDeviceFunctions* devFuncs = window->vulkanInstance()->deviceFunctions(window->device());
+  devFuncs->vkQueueWaitIdle(window->graphicsQueue());
+}
@@ -0,0 +1,70 @@
+/*
+ * Copyright (C) 2025 by Dirk Farin, Kronenstr. 49b, 70174 Stuttgart, Germany
+ *
+ * 2-Clause BSD
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer
+ *    in the documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef PRESENTCONFIG_H
+#define PRESENTCONFIG_H
+
+#include <string>
+
+class QVulkanWindow;
+
+
+// Trade-off between latency and throughput of the presentation.
+//
+// Support per backend:
+//   OpenGL:   swapInterval (0 = no vsync, the equivalent of 'immediate').
+//   Vulkan:   framesInFlight 1 or 2. QVulkanWindow always creates a FIFO swap chain, other
+//             present modes are reported as unsupported.
+//   Software: presented by the Qt backing store; nothing to configure.
+
+enum class PresentMode
+{
+  Fifo,
+  Mailbox,
+  Immediate
+};
+
+struct PresentConfig
+{
+  PresentMode presentMode = PresentMode::Fifo;
+  int framesInFlight = 2;
+  int swapInterval = 1;
+};
+
+void set_present_config(const PresentConfig&);
+
+const PresentConfig& present_config();
+
+const char* present_mode_name(PresentMode);
+
+bool parse_present_mode(const std::string& name, PresentMode* mode);
+
+// Description of the configuration, for reports.
+std::string present_config_description();
+
+
+// Swap interval for OpenGL. Present mode 'immediate' implies 0.
+int gl_swap_interval();
+
+
+// For Vulkan renderers: to be called at the start of startNextFrame(). With one frame in flight,
+// waits until the GPU has finished all previous frames before the new one is recorded.
+void wait_for_frames_in_flight(QVulkanWindow*);
+
+#endif
@@ -0,0 +1,128 @@
+/*
+ * Copyright (C) 2025 by Dirk Farin, Kronenstr. 49b, 70174 Stuttgart, Germany
+ *
+ * 2-Clause BSD
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer
+ *    in the documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "RenderToBuffer.h"
+#include "Drawing.h"
+#include "Scenes.h"
+#include "SurfacePool.h"
+#include "profiling/Tracing.h"
+
+#include <core/SkCanvas.h>
+#include <core/SkImageInfo.h>
+#include <core/SkSurface.h>
+
+#include <memory>
+#include <unordered_map>
+
+
+// Upper limit for the number of scene instances per thread. Scenes keep their generated content,
+// so a thread that renders many different specs should not keep all of them.
+static const size_t kMaxScenesPerThread = 16;
+
+
+struct RenderThreadState
+{
+  SurfacePool surfacePool{[](int w, int h) { return SkSurfaces::Raster(SkImageInfo::MakeN32Premul(w, h)); }};
+
+  std::unordered_map<std::string, std::unique_ptr<Scene>> scenes;
+};
+
+static thread_local std::unique_ptr<RenderThreadState> tRenderState;
+
+
+static SkImageInfo pixel_format_info(PixelFormat format, int width, int height)
+{
+  switch (format) {
+    case PixelFormat::RGBA_8888:
+      return SkImageInfo::Make(width, height, kRGBA_8888_SkColorType, kPremul_SkAlphaType);
+    case PixelFormat::BGRA_8888:
+      return SkImageInfo::Make(width, height, kBGRA_8888_SkColorType, kPremul_SkAlphaType);
+    case PixelFormat::RGB_565:
+      return SkImageInfo::Make(width, height, kRGB_565_SkColorType, kOpaque_SkAlphaType);
+    case PixelFormat::Gray_8:
+      return SkImageInfo::Make(width, height, kGray_8_SkColorType, kOpaque_SkAlphaType);
+  }
+
+  return SkImageInfo::MakeUnknown(width, height);
+}
+
+
+RenderedImage render_scene(const std::string& sceneSpec, int width, int height, PixelFormat format, int frame)
+{
+  TRACE_SCOPE("render_scene");
+
+  RenderedImage result;
+  if (width <= 0 || height <= 0) {
+    return result;
+  }
+
+  if (!tRenderState) {
+    tRenderState = std::make_unique<RenderThreadState>();
+  }
+
+  // --- get the scene instance of this thread
+
+  auto& scenes = tRenderState->scenes;
+
+  auto iter = scenes.find(sceneSpec);
+  if (iter == scenes.end()) {
+    std::unique_ptr<Scene> scene = create_scene(sceneSpec);
+    if (!scene) {
+      return result;
+    }
+
+    if (scenes.size() >= kMaxScenesPerThread) {
+      scenes.clear();
+    }
+
+    iter = scenes.emplace(sceneSpec, std::move(scene)).first;
+  }
+
+  // --- render
+
+  SkSurface* surface = tRenderState->surfacePool.acquire(width, height);
+  if (!surface) {
+    return result;
+  }
+
+  draw_scene_frame(iter->second.get(), surface->getCanvas(), width, height, frame);
+
+  // Only the top-left area of the pooled surface is used. readPixels() also converts to the
+  // requested pixel format.
+
+  SkImageInfo info = pixel_format_info(format, width, height);
+
+  result.width = width;
+  result.height = height;
+  result.format = format;
+  result.rowBytes = info.minRowBytes();
+  result.pixels.resize(info.computeByteSize(result.rowBytes));
+
+  if (!surface->readPixels(info, result.pixels.data(), result.rowBytes, 0, 0)) {
+    result.pixels.clear();
+  }
+
+  return result;
+}
+
+
+void release_render_thread_resources()
+{
+  tRenderState.reset();
+}
@@ -0,0 +1,62 @@
+/*
+ * Copyright (C) 2025 by Dirk Farin, Kronenstr. 49b, 70174 Stuttgart, Germany
+ *
+ * 2-Clause BSD
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer
+ *    in the documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef RENDERTOBUFFER_H
+#define RENDERTOBUFFER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+
+// Rendering of scenes into memory, without Qt, e.g. for server-side thumbnails and exports.
+// The fonts have to be set up first (set_global_skia_font_manager_from_fonts_directory()).
+
+enum class PixelFormat
+{
+  RGBA_8888,
+  BGRA_8888,
+  RGB_565,
+  Gray_8
+};
+
+struct RenderedImage
+{
+  int width = 0;
+  int height = 0;
+  PixelFormat format = PixelFormat::RGBA_8888;
+  size_t rowBytes = 0;
+  std::vector<uint8_t> pixels; // empty if rendering failed
+
+  bool ok() const { return !pixels.empty(); }
+};
+
+
+// Renders a frame of a scene (spec as for create_scene(), e.g. "paths:500:7") on a raster surface.
+//
+// Thread-safe: any number of threads may render concurrently. Each thread keeps its own surfaces
+// and scene instances and reuses them for subsequent calls; image and paragraph caches are shared
+// (painting the same cached paragraph is serialized, see paint_paragraph()).
+RenderedImage render_scene(const std::string& sceneSpec, int width, int height, PixelFormat format, int frame = 0);
+
+// Releases the surfaces and scenes kept for the calling thread.
+void release_render_thread_resources();
+
+#endif
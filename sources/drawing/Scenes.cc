@@ -0,0 +1,1208 @@
+/*
+ * Copyright (C) 2025 by Dirk Farin, Kronenstr. 49b, 70174 Stuttgart, Germany
+ *
+ * 2-Clause BSD
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer
+ *    in the documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "Scenes.h"
+#include "Drawing.h"
+#include "ImageCache.h"
+#include "TileCache.h"
+#include "LayerCache.h"
+#include "TextLayout.h"
+#include "TextMode.h"
+#include "SkiaFontManager.h"
+#include "profiling/Tracing.h"
+#include "profiling/AllocTracker.h"
+
+#include <core/SkCanvas.h>
+#include <core/SkFont.h>
+#include <core/SkImage.h>
+#include <core/SkMaskFilter.h>
+#include <core/SkMatrix.h>
+#include <core/SkBlurTypes.h>
+#include <core/SkPaint.h>
+#include <core/SkPath.h>
+#include <core/SkPicture.h>
+#include <core/SkPictureRecorder.h>
+#include <core/SkPathBuilder.h>
+#include <core/SkRRect.h>
+#include <core/SkSurface.h>
+#include <core/SkTextBlob.h>
+#include <effects/SkGradientShader.h>
+#include <gpu/ganesh/GrDirectContext.h>
+#include <effects/SkImageFilters.h>
+#include <modules/skparagraph/include/Paragraph.h>
+#include <encode/SkPngEncoder.h>
+#include <core/SkStream.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <thread>
+#include <unordered_map>
+
+
+static const float kPi = 3.14159265358979f;
+
+
+void Scene::render(SkCanvas* canvas, int width, int height, int frame)
+{
+  TRACE_SCOPE("draw_skia_scene");
+  AllocStageScope allocStage(RenderStage::Scene);
+
+  if (width != mPreparedWidth || height != mPreparedHeight) {
+    prepare(width, height);
+    mPreparedWidth = width;
+    mPreparedHeight = height;
+  }
+
+  canvas->save();
+  canvas->clipRect(SkRect::MakeIWH(width, height));
+
+  draw(canvas, width, height, frame);
+
+  canvas->restore();
+}
+
+
+uint32_t SceneRandom::next()
+{
+  uint64_t z = (mState += 0x9E3779B97F4A7C15ull);
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+  return (uint32_t) ((z ^ (z >> 31)) >> 32);
+}
+
+
+float SceneRandom::uniform(float a, float b)
+{
+  return a + (b - a) * (next() >> 8) * (1.0f / 16777216.0f);
+}
+
+
+int SceneRandom::uniform_int(int a, int b)
+{
+  return a + (int) (next() % (uint32_t) (b - a));
+}
+
+
+uint32_t SceneRandom::color(uint8_t alpha)
+{
+  return (uint32_t(alpha) << 24) | (next() & 0xFFFFFF);
+}
+
+
+static sk_sp<SkTypeface> scene_typeface(const char* family)
+{
+  auto mgr = get_skia_font_manager();
+  sk_sp<SkTypeface> typeface = mgr->matchFamilyStyle(family, {});
+  if (!typeface) {
+    typeface = mgr->legacyMakeTypeface(nullptr, {});
+  }
+
+  return typeface;
+}
+
+
+// --- The original test scene: a rotating line and a number with increasing font size.
+
+class Scene_Default : public Scene
+{
+public:
+  explicit Scene_Default(const SceneParams& params) : Scene(params) {}
+
+  const char* name() const override { return "default"; }
+
+protected:
+  void draw(SkCanvas* canvas, int w, int h, int cnt) override
+  {
+    // Looked up once. Matching the family allocates and is not needed per frame.
+    if (!mTypeface) {
+      mTypeface = scene_typeface("FreeSans");
+    }
+
+    canvas->clear(SK_ColorBLUE);
+
+
+    // --- draw rotating line
+
+    SkPaint paint;
+    paint.setColor(SK_ColorRED);
+    paint.setStrokeWidth((w + h) / 100.0f);
+    paint.setStyle(SkPaint::kStroke_Style);
+    canvas->drawLine(w / 2 + cos(cnt / 100.0) * w * 0.4, h / 2 + sin(cnt / 100.0) * h * 0.4, w / 2, h / 2, paint);
+
+
+    // --- draw text with increasing font size
+
+    int font_size = cnt / 3;
+
+    SkFont font;
+    font.setTypeface(mTypeface);
+    font.setSize(font_size);
+
+    paint.setColor(SK_ColorWHITE);
+    paint.setStyle(SkPaint::kFill_Style);
+
+    char text[16];
+    int text_length = snprintf(text, sizeof(text), "%d", font_size);
+    int text_width = font.measureText(text, text_length, SkTextEncoding::kUTF8);
+
+    draw_text_at_size(canvas, text, text_length, (w - text_width) / 2, h * 4 / 5, font, font_size, paint);
+  }
+
+private:
+  sk_sp<SkTypeface> mTypeface;
+};
+
+
+// --- A few lines of text, continuously zooming in and out (pinch zoom). Each frame has a new font size.
+
+class Scene_Zoom : public Scene
+{
+public:
+  explicit Scene_Zoom(const SceneParams& params) : Scene(params) {}
+
+  const char* name() const override { return "zoom"; }
+
+protected:
+  void draw(SkCanvas* canvas, int w, int h, int frame) override
+  {
+    static const char* const lines[] = {"The quick brown fox jumps over the lazy dog.",
+                                        "Pack my box with five dozen liquor jugs.",
+                                        "0123456789 !?%&()[]{}<>+-*/=",
+                                        "Sphinx of black quartz, judge my vow."};
+
+    if (!mTypeface) {
+      mTypeface = scene_typeface("FreeSans");
+    }
+
+    canvas->clear(SK_ColorWHITE);
+
+    // font size between 8 and 160, with a period of 'count' frames
+    float phase = (1 - std::cos(frame * 2 * kPi / count(600))) / 2;
+    float size = 8 * std::pow(20.0f, phase);
+
+    SkFont font(mTypeface);
+    SkPaint paint;
+    paint.setAntiAlias(true);
+    paint.setColor(SK_ColorBLACK);
+
+    float y = size * 1.5f;
+    for (const char* line : lines) {
+      draw_text_at_size(canvas, line, strlen(line), 10, y, font, size, paint);
+      y += size * 1.3f;
+    }
+  }
+
+private:
+  sk_sp<SkTypeface> mTypeface;
+};
+
+
+// --- Random cubic paths, alternately stroked and filled.
+
+class Scene_Paths : public Scene
+{
+public:
+  explicit Scene_Paths(const SceneParams& params) : Scene(params) {}
+
+  const char* name() const override { return "paths"; }
+
+protected:
+  void prepare(int w, int h) override
+  {
+    SceneRandom rnd(mParams.seed);
+    mItems.clear();
+
+    for (int i = 0; i < count(200); i++) {
+      SkPathBuilder builder;
+      builder.moveTo(rnd.uniform(0, w), rnd.uniform(0, h));
+      int nSegments = rnd.uniform_int(2, 6);
+      for (int s = 0; s < nSegments; s++) {
+        builder.cubicTo(rnd.uniform(0, w), rnd.uniform(0, h),
+                        rnd.uniform(0, w), rnd.uniform(0, h),
+                        rnd.uniform(0, w), rnd.uniform(0, h));
+      }
+
+      Item item;
+      item.stroke = (i % 2) == 0;
+      if (!item.stroke) {
+        builder.close();
+      }
+      item.path = builder.detach();
+      item.color = rnd.color(item.stroke ? 0xFF : 0x80);
+      item.strokeWidth = rnd.uniform(1, 8);
+      mItems.push_back(std::move(item));
+    }
+  }
+
+  void draw(SkCanvas* canvas, int w, int h, int frame) override
+  {
+    canvas->clear(SK_ColorWHITE);
+
+    // slow rotation so that the paths have to be re-rasterized every frame
+    canvas->rotate(std::sin(frame / 50.0f) * 5.0f, w / 2.0f, h / 2.0f);
+
+    SkPaint paint;
+    paint.setAntiAlias(true);
+
+    for (const auto& item : mItems) {
+      paint.setColor(item.color);
+      paint.setStyle(item.stroke ? SkPaint::kStroke_Style : SkPaint::kFill_Style);
+      paint.setStrokeWidth(item.strokeWidth);
+      canvas->drawPath(item.path, paint);
+    }
+  }
+
+private:
+  struct Item
+  {
+    SkPath path;
+    SkColor color;
+    float strokeWidth;
+    bool stroke;
+  };
+
+  std::vector<Item> mItems;
+};
+
+
+// --- Text runs at varied sizes and typefaces, scrolling vertically.
+
+class Scene_Text : public Scene
+{
+public:
+  explicit Scene_Text(const SceneParams& params) : Scene(params) {}
+
+  const char* name() const override { return "text"; }
+
+protected:
+  void prepare(int w, int h) override
+  {
+    static const char* const families[] = {"FreeSans", "FreeSerif", "FreeMono"};
+    static const char* const words[] = {"Skia", "backend", "glyph", "atlas", "Vulkan", "OpenGL", "raster",
+                                        "benchmark", "quick", "brown", "fox", "jumps", "over", "lazy", "dog"};
+
+    SceneRandom rnd(mParams.seed);
+    mRuns.clear();
+
+    sk_sp<SkTypeface> typefaces[3];
+    for (int i = 0; i < 3; i++) {
+      typefaces[i] = scene_typeface(families[i]);
+    }
+
+    float y = 0;
+    for (int i = 0; i < count(100); i++) {
+      SkFont font(typefaces[rnd.uniform_int(0, 3)], rnd.uniform(8, 48));
+      font.setSubpixel(true);
+
+      std::string text;
+      int nWords = rnd.uniform_int(3, 10);
+      for (int k = 0; k < nWords; k++) {
+        text += words[rnd.uniform_int(0, sizeof(words) / sizeof(words[0]))];
+        text += ' ';
+      }
+
+      y += font.getSize() * 1.2f;
+
+      Run run;
+      run.blob = SkTextBlob::MakeFromString(text.c_str(), font);
+      run.x = rnd.uniform(0, w * 0.3f);
+      run.y = y;
+      run.color = rnd.color() | 0xFF000000;
+      mRuns.push_back(std::move(run));
+    }
+
+    mTotalHeight = y + 50;
+  }
+
+  void draw(SkCanvas* canvas, int w, int h, int frame) override
+  {
+    canvas->clear(SK_ColorWHITE);
+
+    float scroll = std::fmod(frame * 2.0f, mTotalHeight);
+
+    SkPaint paint;
+    paint.setAntiAlias(true);
+
+    for (const auto& run : mRuns) {
+      float y = run.y - scroll;
+      if (y < 0) {
+        y += mTotalHeight;
+      }
+
+      paint.setColor(run.color);
+      canvas->drawTextBlob(run.blob, run.x, y, paint);
+    }
+  }
+
+private:
+  struct Run
+  {
+    sk_sp<SkTextBlob> blob;
+    float x, y;
+    SkColor color;
+  };
+
+  std::vector<Run> mRuns;
+  float mTotalHeight = 1;
+};
+
+
+// --- Linear and radial gradients, with blur mask filters and a blurred layer.
+
+class Scene_Gradients : public Scene
+{
+public:
+  explicit Scene_Gradients(const SceneParams& params) : Scene(params) {}
+
+  const char* name() const override { return "gradients"; }
+
+protected:
+  void prepare(int w, int h) override
+  {
+    SceneRandom rnd(mParams.seed);
+    mItems.clear();
+
+    for (int i = 0; i < count(50); i++) {
+      Item item;
+      item.rect = SkRect::MakeXYWH(rnd.uniform(0, w * 0.8f), rnd.uniform(0, h * 0.8f),
+                                   rnd.uniform(20, w * 0.3f), rnd.uniform(20, h * 0.3f));
+
+      SkColor colors[3] = {rnd.color(), rnd.color(), rnd.color(0x80)};
+      if (i % 2) {
+        SkPoint pts[2] = {{item.rect.left(), item.rect.top()}, {item.rect.right(), item.rect.bottom()}};
+        item.paint.setShader(SkGradientShader::MakeLinear(pts, colors, nullptr, 3, SkTileMode::kClamp));
+      }
+      else {
+        item.paint.setShader(SkGradientShader::MakeRadial(item.rect.center(), item.rect.width() / 2,
+                                                          colors, nullptr, 3, SkTileMode::kMirror));
+      }
+
+      if (i % 3 == 0) {
+        item.paint.setMaskFilter(SkMaskFilter::MakeBlur(kNormal_SkBlurStyle, rnd.uniform(2, 10)));
+      }
+
+      item.paint.setAntiAlias(true);
+      item.oval = (i % 4) == 1;
+      mItems.push_back(std::move(item));
+    }
+
+    mLayerPaint.setImageFilter(SkImageFilters::Blur(8, 8, nullptr));
+  }
+
+  void draw(SkCanvas* canvas, int w, int h, int frame) override
+  {
+    canvas->clear(SK_ColorBLACK);
+
+    float dx = std::sin(frame / 40.0f) * 20;
+
+    for (const auto& item : mItems) {
+      SkRect r = item.rect.makeOffset(dx, 0);
+      if (item.oval) {
+        canvas->drawOval(r, item.paint);
+      }
+      else {
+        canvas->drawRect(r, item.paint);
+      }
+    }
+
+    // a moving blurred layer on top
+    float x = (frame * 3) % (w + 200) - 200.0f;
+    SkRect layerBounds = SkRect::MakeXYWH(x, h / 3.0f, 200, h / 3.0f);
+    canvas->saveLayer(&layerBounds, &mLayerPaint);
+    SkPaint paint;
+    paint.setColor(0xC0FFFFFF);
+    canvas->drawRect(layerBounds.makeInset(30, 30), paint);
+    canvas->restore();
+  }
+
+private:
+  struct Item
+  {
+    SkRect rect;
+    SkPaint paint;
+    bool oval;
+  };
+
+  std::vector<Item> mItems;
+  SkPaint mLayerPaint;
+};
+
+
+// --- Many small image draws from a set of generated images.
+
+class Scene_Images : public Scene
+{
+public:
+  explicit Scene_Images(const SceneParams& params) : Scene(params) {}
+
+  const char* name() const override { return "images"; }
+
+protected:
+  void prepare(int w, int h) override
+  {
+    SceneRandom rnd(mParams.seed);
+
+    if (mImages.empty()) {
+      for (int i = 0; i < kNumImages; i++) {
+        sk_sp<SkSurface> surface = SkSurfaces::Raster(SkImageInfo::MakeN32Premul(kImageSize, kImageSize));
+        SkCanvas* canvas = surface->getCanvas();
+        canvas->clear(rnd.color());
+
+        SkColor colors[2] = {rnd.color(), rnd.color()};
+        SkPaint paint;
+        paint.setAntiAlias(true);
+        paint.setShader(SkGradientShader::MakeRadial({kImageSize / 2.0f, kImageSize / 2.0f}, kImageSize / 2.0f,
+                                                     colors, nullptr, 2, SkTileMode::kClamp));
+        canvas->drawCircle(kImageSize / 2.0f, kImageSize / 2.0f, kImageSize * 0.4f, paint);
+
+        mImages.push_back(surface->makeImageSnapshot());
+      }
+    }
+
+    mDraws.clear();
+    for (int i = 0; i < count(500); i++) {
+      float size = rnd.uniform(16, 96);
+      mDraws.push_back({rnd.uniform_int(0, kNumImages),
+                        SkRect::MakeXYWH(rnd.uniform(0, w - size), rnd.uniform(0, h - size), size, size)});
+    }
+  }
+
+  void draw(SkCanvas* canvas, int w, int h, int frame) override
+  {
+    canvas->clear(SK_ColorDKGRAY);
+
+    SkSamplingOptions sampling(SkFilterMode::kLinear);
+    float dy = std::sin(frame / 30.0f) * 10;
+
+    for (const auto& d : mDraws) {
+      canvas->drawImageRect(mImages[d.image], d.rect.makeOffset(0, dy), sampling);
+    }
+  }
+
+private:
+  static const int kNumImages = 16;
+  static const int kImageSize = 128;
+
+  struct Draw
+  {
+    int image;
+    SkRect rect;
+  };
+
+  std::vector<sk_sp<SkImage>> mImages;
+  std::vector<Draw> mDraws;
+};
+
+
+// --- Deeply nested save/clip stacks with rect, rrect and path clips.
+
+class Scene_Clips : public Scene
+{
+public:
+  explicit Scene_Clips(const SceneParams& params) : Scene(params) {}
+
+  const char* name() const override { return "clips"; }
+
+protected:
+  void prepare(int w, int h) override
+  {
+    SceneRandom rnd(mParams.seed);
+
+    SkPathBuilder star;
+    for (int i = 0; i < 10; i++) {
+      float r = (i % 2) ? 0.5f : 1.0f;
+      float a = i * kPi / 5;
+      if (i == 0) {
+        star.moveTo(r * std::cos(a), r * std::sin(a));
+      }
+      else {
+        star.lineTo(r * std::cos(a), r * std::sin(a));
+      }
+    }
+    star.close();
+    mStar = star.detach();
+
+    mColors.clear();
+    for (int i = 0; i < count(64); i++) {
+      mColors.push_back(rnd.color());
+    }
+  }
+
+  void draw(SkCanvas* canvas, int w, int h, int frame) override
+  {
+    canvas->clear(SK_ColorWHITE);
+
+    const int depth = (int) mColors.size();
+
+    SkPaint paint;
+    paint.setAntiAlias(true);
+
+    SkRect r = SkRect::MakeIWH(w, h);
+    for (int i = 0; i < depth; i++) {
+      canvas->save();
+
+      float inset = std::min(w, h) * 0.4f / depth;
+      r.inset(inset, inset);
+      canvas->rotate(std::sin((frame + i * 7) / 60.0f), w / 2.0f, h / 2.0f);
+
+      switch (i % 3) {
+        case 0:
+          canvas->clipRect(r, true);
+          break;
+        case 1:
+          canvas->clipRRect(SkRRect::MakeRectXY(r, 20, 20), true);
+          break;
+        case 2: {
+          SkPath path = mStar.makeTransform(SkMatrix::Scale(r.width() * 0.7f, r.height() * 0.7f)
+                                                .postTranslate(r.centerX(), r.centerY()));
+          canvas->clipPath(path, true);
+          break;
+        }
+      }
+
+      paint.setColor(mColors[i]);
+      canvas->drawPaint(paint);
+    }
+
+    for (int i = 0; i < depth; i++) {
+      canvas->restore();
+    }
+  }
+
+private:
+  SkPath mStar;
+  std::vector<SkColor> mColors;
+};
+
+
+// --- Large antialiased polygons with many vertices.
+
+class Scene_Polygons : public Scene
+{
+public:
+  explicit Scene_Polygons(const SceneParams& params) : Scene(params) {}
+
+  const char* name() const override { return "polygons"; }
+
+protected:
+  void prepare(int w, int h) override
+  {
+    SceneRandom rnd(mParams.seed);
+    mItems.clear();
+
+    for (int i = 0; i < count(20); i++) {
+      int nVertices = rnd.uniform_int(100, 1000);
+      float cx = rnd.uniform(0, w), cy = rnd.uniform(0, h);
+      float radius = rnd.uniform(0.2f, 0.6f) * std::max(w, h);
+
+      SkPathBuilder builder;
+      for (int v = 0; v < nVertices; v++) {
+        float a = v * 2 * kPi / nVertices;
+        float r = radius * rnd.uniform(0.7f, 1.0f);
+        SkPoint p = {cx + r * std::cos(a), cy + r * std::sin(a)};
+        if (v == 0) {
+          builder.moveTo(p);
+        }
+        else {
+          builder.lineTo(p);
+        }
+      }
+      builder.close();
+
+      mItems.push_back({builder.detach(), rnd.color(0x60), {cx, cy}});
+    }
+  }
+
+  void draw(SkCanvas* canvas, int w, int h, int frame) override
+  {
+    canvas->clear(SK_ColorWHITE);
+
+    SkPaint paint;
+    paint.setAntiAlias(true);
+
+    for (const auto& item : mItems) {
+      canvas->save();
+      canvas->rotate(frame * 0.2f, item.center.x(), item.center.y());
+      paint.setColor(item.color);
+      canvas->drawPath(item.path, paint);
+      canvas->restore();
+    }
+  }
+
+private:
+  struct Item
+  {
+    SkPath path;
+    SkColor color;
+    SkPoint center;
+  };
+
+  std::vector<Item> mItems;
+};
+
+
+// --- Scrolling grid of thumbnails, decoded and uploaded in the background by the ImageCache.
+//     Uses the images in the thumbnail directory, or generates PNG files if none is set.
+
+static std::string sThumbnailDirectory;
+
+
+void set_thumbnail_directory(const std::string& dir)
+{
+  sThumbnailDirectory = dir;
+}
+
+
+class Scene_Thumbnails : public Scene
+{
+public:
+  explicit Scene_Thumbnails(const SceneParams& params) : Scene(params) {}
+
+  const char* name() const override { return "thumbnails"; }
+
+protected:
+  void prepare(int w, int h) override
+  {
+    if (mFiles.empty()) {
+      if (!sThumbnailDirectory.empty()) {
+        collect_image_files(sThumbnailDirectory);
+      }
+
+      if (mFiles.empty()) {
+        generate_image_files();
+      }
+    }
+  }
+
+  void draw(SkCanvas* canvas, int w, int h, int frame) override
+  {
+    canvas->clear(SK_ColorWHITE);
+
+    if (mFiles.empty()) {
+      return;
+    }
+
+    const float cellSize = kThumbnailSize + kSpacing;
+    int columns = std::max(1, (int) (w / cellSize));
+    int rows = (count(500) + columns - 1) / columns;
+    float scrollRange = std::max(1.0f, rows * cellSize - h);
+    float scroll = std::fmod(frame * 4.0f, scrollRange);
+
+    int firstRow = (int) (scroll / cellSize);
+    int lastRow = std::min(rows - 1, (int) ((scroll + h) / cellSize));
+
+    for (int row = firstRow; row <= lastRow; row++) {
+      for (int col = 0; col < columns; col++) {
+        int idx = row * columns + col;
+        if (idx >= count(500)) {
+          break;
+        }
+
+        SkRect rect = SkRect::MakeXYWH(kSpacing + col * cellSize, kSpacing + row * cellSize - scroll,
+                                       kThumbnailSize, kThumbnailSize);
+        draw_cached_image(canvas, mFiles[idx % mFiles.size()], rect);
+      }
+    }
+  }
+
+private:
+  static constexpr float kThumbnailSize = 96;
+  static constexpr float kSpacing = 8;
+
+  std::vector<std::string> mFiles;
+
+  void collect_image_files(const std::string& dir)
+  {
+    std::error_code err;
+    for (const auto& entry : std::filesystem::directory_iterator(dir, err)) {
+      std::string ext = entry.path().extension().string();
+      std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+      if (ext == ".jpg" || ext == ".jpeg" || ext == ".png" || ext == ".webp" || ext == ".gif" || ext == ".bmp") {
+        mFiles.push_back(entry.path().string());
+      }
+    }
+
+    std::sort(mFiles.begin(), mFiles.end());
+  }
+
+  void generate_image_files()
+  {
+    std::filesystem::path dir = std::filesystem::temp_directory_path() / "qtskia-thumbnails";
+    std::error_code err;
+    std::filesystem::create_directories(dir, err);
+
+    SceneRandom rnd(mParams.seed);
+
+    for (int i = 0; i < 64; i++) {
+      std::filesystem::path file = dir / ("image" + std::to_string(mParams.seed) + "-" + std::to_string(i) + ".png");
+
+      // Drawn for every image, so that the colors do not depend on which files exist already.
+      SkColor colors[2] = {rnd.color(), rnd.color()};
+
+      if (!std::filesystem::exists(file)) {
+        const int size = 512;
+        sk_sp<SkSurface> surface = SkSurfaces::Raster(SkImageInfo::MakeN32Premul(size, size));
+        SkCanvas* canvas = surface->getCanvas();
+
+        SkPoint points[2] = {{0, 0}, {size, size}};
+        SkPaint paint;
+        paint.setShader(SkGradientShader::MakeLinear(points, colors, nullptr, 2, SkTileMode::kClamp));
+        canvas->drawPaint(paint);
+
+        // Written to a temporary file first. Other threads may create the same file concurrently.
+        std::filesystem::path tmpFile = file;
+        tmpFile += "." + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id())) + ".tmp";
+
+        SkPixmap pixmap;
+        bool encoded;
+        {
+          SkFILEWStream stream(tmpFile.string().c_str());
+          encoded = surface->peekPixels(&pixmap) && stream.isValid() && SkPngEncoder::Encode(&stream, pixmap, {});
+        }
+
+        if (encoded) {
+          std::filesystem::rename(tmpFile, file, err);
+        }
+
+        if (!encoded || err) {
+          std::error_code removeErr;
+          std::filesystem::remove(tmpFile, removeErr);
+          continue;
+        }
+      }
+
+      mFiles.push_back(file.string());
+    }
+  }
+};
+
+
+// --- Long document of shaped, multilingual paragraphs, scrolling vertically.
+//     Paragraphs are laid out in the background by the ParagraphCache; a resize relayouts all of them.
+
+class Scene_Paragraphs : public Scene
+{
+public:
+  explicit Scene_Paragraphs(const SceneParams& params) : Scene(params) {}
+
+  const char* name() const override { return "paragraphs"; }
+
+protected:
+  void prepare(int w, int h) override
+  {
+    static const char* const words[] = {"Skia", "paragraph", "shaping", "glyph", "ligature", "office", "fluffy",
+                                        "Ελληνικά", "κείμενο", "Русский", "текст", "עברית", "טקסט",
+                                        "العربية", "نص", "日本語", "テキスト", "中文", "文本", "한국어"};
+
+    if (mTexts.empty()) {
+      SceneRandom rnd(mParams.seed);
+
+      for (int i = 0; i < count(300); i++) {
+        std::string text;
+        int nWords = rnd.uniform_int(20, 120);
+        for (int k = 0; k < nWords; k++) {
+          text += words[rnd.uniform_int(0, sizeof(words) / sizeof(words[0]))];
+          text += (k % 13 == 12) ? ". " : " ";
+        }
+
+        mTexts.push_back(std::move(text));
+      }
+    }
+
+    mStyle.family = "FreeSerif";
+    mStyle.size = 16;
+    mStyle.lineHeight = 1.3f;
+
+    // Prefetch the layouts of the whole document for the new width.
+    mWidth = std::max(50.0f, w - 2 * kMargin);
+    for (const auto& text : mTexts) {
+      paragraph_cache().request(text, mStyle, mWidth);
+    }
+  }
+
+  void draw(SkCanvas* canvas, int w, int h, int frame) override
+  {
+    canvas->clear(SK_ColorWHITE);
+
+    SkPaint placeholder;
+    placeholder.setColor(SkColorSetRGB(0xE8, 0xE8, 0xE8));
+
+    // Paragraphs that are not laid out yet are drawn as placeholders of estimated height.
+    // Their actual height is only known when they are ready, so the document height changes
+    // while the background layouts progress.
+
+    float scroll = std::fmod(frame * 3.0f, mDocumentHeight);
+    float y = kMargin - scroll;
+    float estimatedHeight = mStyle.size * mStyle.lineHeight * 4;
+
+    for (const auto& text : mTexts) {
+      if (y > h) {
+        y += estimatedHeight + kParagraphSpacing; // approximation is fine below the visible area
+        continue;
+      }
+
+      auto paragraph = paragraph_cache().request(text, mStyle, mWidth);
+      float height = paragraph ? paragraph->getHeight() : estimatedHeight;
+
+      if (y + height >= 0) {
+        if (paragraph) {
+          paint_paragraph(paragraph, canvas, kMargin, y);
+        }
+        else {
+          canvas->drawRect(SkRect::MakeXYWH(kMargin, y, mWidth, height), placeholder);
+        }
+      }
+
+      y += height + kParagraphSpacing;
+    }
+
+    mDocumentHeight = std::max(1.0f, y + scroll);
+  }
+
+private:
+  static constexpr float kMargin = 20;
+  static constexpr float kParagraphSpacing = 12;
+
+  std::vector<std::string> mTexts;
+  TextLayoutStyle mStyle;
+  float mWidth = 0;
+  float mDocumentHeight = 1;
+};
+
+
+// --- Static background (grid and detailed vector icons) with a few animated objects on top.
+//     The background is a CachedLayer, so it is only rasterized again when the zoom changes enough.
+
+class Scene_Layers : public Scene
+{
+public:
+  explicit Scene_Layers(const SceneParams& params) : Scene(params) {}
+
+  const char* name() const override { return "layers"; }
+
+protected:
+  void prepare(int w, int h) override
+  {
+    SceneRandom rnd(mParams.seed);
+    mIcons.clear();
+
+    const float cellSize = 64;
+    int columns = std::max(1, (int) (w / cellSize));
+
+    for (int i = 0; i < count(300); i++) {
+      SkPoint center{(i % columns + 0.5f) * cellSize, (i / columns + 0.5f) * cellSize};
+
+      // gear with many teeth
+      int nTeeth = rnd.uniform_int(8, 24);
+      SkPathBuilder builder;
+      for (int v = 0; v < nTeeth * 4; v++) {
+        float a = v * 2 * kPi / (nTeeth * 4);
+        float r = ((v / 2) % 2) ? cellSize * 0.3f : cellSize * 0.4f;
+        SkPoint p = {center.x() + r * std::cos(a), center.y() + r * std::sin(a)};
+        if (v == 0) {
+          builder.moveTo(p);
+        }
+        else {
+          builder.lineTo(p);
+        }
+      }
+      builder.close();
+      builder.addCircle(center.x(), center.y(), cellSize * 0.12f, SkPathDirection::kCCW);
+
+      mIcons.push_back({builder.detach(), rnd.color(), rnd.color(), center});
+    }
+
+    mBackground.setBounds(SkRect::MakeIWH(w, h));
+  }
+
+  void draw(SkCanvas* canvas, int w, int h, int frame) override
+  {
+    canvas->clear(SK_ColorWHITE);
+
+    canvas->save();
+    float zoom = 1.0f + 0.25f * std::sin(frame / 200.0f);
+    canvas->scale(zoom, zoom);
+
+    mBackground.draw(canvas, [&](SkCanvas* c) { drawBackground(c, w, h); });
+
+    canvas->restore();
+
+    // --- animated foreground
+
+    SkPaint paint;
+    paint.setAntiAlias(true);
+    paint.setColor(SkColorSetARGB(0xC0, 0xE0, 0x20, 0x20));
+
+    for (int i = 0; i < 20; i++) {
+      float t = frame / 60.0f + i * 0.7f;
+      canvas->drawCircle(w / 2.0f + std::cos(t * 1.3f) * w * 0.4f, h / 2.0f + std::sin(t) * h * 0.4f, 12, paint);
+    }
+  }
+
+private:
+  struct Icon
+  {
+    SkPath path;
+    SkColor color0, color1;
+    SkPoint center;
+  };
+
+  std::vector<Icon> mIcons;
+  CachedLayer mBackground;
+
+  void drawBackground(SkCanvas* canvas, int w, int h)
+  {
+    SkPaint gridPaint;
+    gridPaint.setColor(SkColorSetRGB(0xD0, 0xD8, 0xE0));
+    gridPaint.setStyle(SkPaint::kStroke_Style);
+    for (int x = 0; x <= w; x += 16) {
+      canvas->drawLine(x, 0, x, h, gridPaint);
+    }
+    for (int y = 0; y <= h; y += 16) {
+      canvas->drawLine(0, y, w, y, gridPaint);
+    }
+
+    SkPaint fillPaint;
+    fillPaint.setAntiAlias(true);
+
+    SkPaint strokePaint;
+    strokePaint.setAntiAlias(true);
+    strokePaint.setStyle(SkPaint::kStroke_Style);
+    strokePaint.setStrokeWidth(1.5f);
+    strokePaint.setColor(SK_ColorBLACK);
+
+    for (const auto& icon : mIcons) {
+      SkColor colors[2] = {icon.color0, icon.color1};
+      fillPaint.setShader(SkGradientShader::MakeRadial(icon.center, 32, colors, nullptr, 2, SkTileMode::kClamp));
+      canvas->drawPath(icon.path, fillPaint);
+      canvas->drawPath(icon.path, strokePaint);
+    }
+  }
+};
+
+
+// --- Large document (a map of shapes and labels) that is panned and zoomed through the TileCache.
+//     The document is recorded once; frames only composite cached tiles.
+
+class Scene_Tiles : public Scene
+{
+public:
+  explicit Scene_Tiles(const SceneParams& params) : Scene(params) {}
+
+  const char* name() const override { return "tiles"; }
+
+protected:
+  void prepare(int w, int h) override
+  {
+    if (mDocument) {
+      return;
+    }
+
+    SceneRandom rnd(mParams.seed);
+    sk_sp<SkTypeface> typeface = scene_typeface("FreeSans");
+
+    SkPictureRecorder recorder;
+    SkCanvas* canvas = recorder.beginRecording(SkRect::MakeWH(kDocumentSize, kDocumentSize));
+
+    canvas->clear(SK_ColorWHITE);
+
+    SkPaint gridPaint;
+    gridPaint.setColor(SkColorSetRGB(0xD0, 0xD8, 0xE0));
+    gridPaint.setStyle(SkPaint::kStroke_Style);
+    for (float p = 0; p <= kDocumentSize; p += 128) {
+      canvas->drawLine(p, 0, p, kDocumentSize, gridPaint);
+      canvas->drawLine(0, p, kDocumentSize, p, gridPaint);
+    }
+
+    SkFont font;
+    font.setTypeface(typeface);
+    font.setSize(10);
+
+    SkPaint paint;
+    paint.setAntiAlias(true);
+
+    for (int i = 0; i < count(20000); i++) {
+      float x = rnd.uniform(0, kDocumentSize);
+      float y = rnd.uniform(0, kDocumentSize);
+      float size = rnd.uniform(4, 40);
+
+      paint.setColor(rnd.color(0xC0));
+      paint.setStyle(rnd.uniform_int(0, 3) ? SkPaint::kFill_Style : SkPaint::kStroke_Style);
+
+      if (rnd.uniform_int(0, 2)) {
+        canvas->drawCircle(x, y, size / 2, paint);
+      }
+      else {
+        canvas->drawRoundRect(SkRect::MakeXYWH(x, y, size, size * 0.6f), 3, 3, paint);
+      }
+
+      if (i % 4 == 0) {
+        char label[16];
+        int len = snprintf(label, sizeof(label), "#%d", i);
+        paint.setColor(SK_ColorBLACK);
+        paint.setStyle(SkPaint::kFill_Style);
+        canvas->drawSimpleText(label, len, SkTextEncoding::kUTF8, x, y + size + 10, font, paint);
+      }
+    }
+
+    mDocument = recorder.finishRecordingAsPicture();
+  }
+
+  void draw(SkCanvas* canvas, int w, int h, int frame) override
+  {
+    // Slow zoom between 1/4 and 4, panning along a Lissajous curve.
+    float t = frame / 60.0f;
+    float scale = std::exp2(2.0f * std::sin(t * 0.3f));
+    float viewW = w / scale;
+    float viewH = h / scale;
+
+    float cx = kDocumentSize / 2 + std::sin(t * 0.21f) * (kDocumentSize / 2 - viewW / 2);
+    float cy = kDocumentSize / 2 + std::sin(t * 0.13f) * (kDocumentSize / 2 - viewH / 2);
+
+    tile_cache_for(canvas)->draw(canvas, SkPoint{cx - viewW / 2, cy - viewH / 2}, scale, w, h);
+  }
+
+private:
+  static constexpr float kDocumentSize = 8192;
+
+  sk_sp<SkPicture> mDocument;
+
+  // The caches reference their context, so a key is never the address of a newer context.
+  // Caches whose context was released (release_tile_cache()) or abandoned are dropped here.
+  std::unordered_map<GrDirectContext*, std::unique_ptr<TileCache>> mCaches;
+
+  TileCache* tile_cache_for(SkCanvas* canvas)
+  {
+    GrDirectContext* context = nullptr;
+    if (auto* recordingContext = canvas_recording_context(canvas)) {
+      context = recordingContext->asDirectContext();
+    }
+
+    for (auto iter = mCaches.begin(); iter != mCaches.end();) {
+      if (iter->second->contextReleased()) {
+        iter = mCaches.erase(iter);
+      }
+      else {
+        ++iter;
+      }
+    }
+
+    auto& cache = mCaches[context];
+    if (!cache) {
+      cache = std::make_unique<TileCache>(context, mDocument);
+    }
+
+    return cache.get();
+  }
+};
+
+
+// --- registry
+
+using SceneFactory = std::unique_ptr<Scene> (*)(const SceneParams&);
+
+template <class T>
+static std::unique_ptr<Scene> make_scene(const SceneParams& params) { return std::make_unique<T>(params); }
+
+static const struct
+{
+  const char* name;
+  SceneFactory factory;
+} sScenes[] = {
+    {"default", make_scene<Scene_Default>},
+    {"paths", make_scene<Scene_Paths>},
+    {"text", make_scene<Scene_Text>},
+    {"zoom", make_scene<Scene_Zoom>},
+    {"gradients", make_scene<Scene_Gradients>},
+    {"images", make_scene<Scene_Images>},
+    {"clips", make_scene<Scene_Clips>},
+    {"polygons", make_scene<Scene_Polygons>},
+    {"thumbnails", make_scene<Scene_Thumbnails>},
+    {"paragraphs", make_scene<Scene_Paragraphs>},
+    {"layers", make_scene<Scene_Layers>},
+    {"tiles", make_scene<Scene_Tiles>},
+};
+
+
+std::vector<std::string> scene_names()
+{
+  std::vector<std::string> names;
+  for (const auto& s : sScenes) {
+    names.push_back(s.name);
+  }
+
+  return names;
+}
+
+
+std::unique_ptr<Scene> create_scene(const std::string& spec)
+{
+  // --- split "name[:count[:seed]]"
+
+  std::string name = spec;
+  SceneParams params;
+
+  size_t colon = spec.find(':');
+  if (colon != std::string::npos) {
+    name = spec.substr(0, colon);
+    params.count = atoi(spec.c_str() + colon + 1);
+
+    size_t colon2 = spec.find(':', colon + 1);
+    if (colon2 != std::string::npos) {
+      params.seed = (uint32_t) strtoul(spec.c_str() + colon2 + 1, nullptr, 10);
+    }
+  }
+
+  for (const auto& s : sScenes) {
+    if (name == s.name) {
+      return s.factory(params);
+    }
+  }
+
+  return nullptr;
+}
+
+
+static std::unique_ptr<Scene> sActiveScene;
+
+
+bool set_active_scene(const std::string& spec)
+{
+  auto scene = create_scene(spec);
+  if (!scene) {
+    return false;
+  }
+
+  sActiveScene = std::move(scene);
+  return true;
+}
+
+
+Scene* active_scene()
+{
+  if (!sActiveScene) {
+    sActiveScene = create_scene("default");
+  }
+
+  return sActiveScene.get();
+}
@@ -0,0 +1,106 @@
+/*
+ * Copyright (C) 2025 by Dirk Farin, Kronenstr. 49b, 70174 Stuttgart, Germany
+ *
+ * 2-Clause BSD
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer
+ *    in the documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef SCENES_H
+#define SCENES_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+class SkCanvas;
+
+
+// Parameters of a synthetic workload scene. Scenes with the same name, parameters, size and
+// frame number draw exactly the same content, independent of the backend.
+struct SceneParams
+{
+  int count = 0;      // number of objects (paths, text runs, ...), 0 = scene default
+  uint32_t seed = 1;  // seed for the pseudo-random scene content
+};
+
+
+class Scene
+{
+public:
+  virtual ~Scene() = default;
+
+  virtual const char* name() const = 0;
+
+  // Draws the given animation frame into the top-left width x height area of the canvas.
+  // Scene content is (re)generated when the size changes.
+  void render(SkCanvas*, int width, int height, int frame);
+
+protected:
+  explicit Scene(const SceneParams& params) : mParams(params) {}
+
+  SceneParams mParams;
+
+  int count(int defaultCount) const { return mParams.count > 0 ? mParams.count : defaultCount; }
+
+  // Generates everything that does not change from frame to frame.
+  virtual void prepare(int width, int height) {}
+
+  virtual void draw(SkCanvas*, int width, int height, int frame) = 0;
+
+private:
+  int mPreparedWidth = -1;
+  int mPreparedHeight = -1;
+};
+
+
+// Small deterministic PRNG (SplitMix64). Unlike the <random> distributions, its output is
+// identical on all platforms and standard libraries.
+class SceneRandom
+{
+public:
+  explicit SceneRandom(uint64_t seed) : mState(seed) {}
+
+  uint32_t next();
+
+  // uniform in [a, b)
+  float uniform(float a, float b);
+
+  int uniform_int(int a, int b);
+
+  uint32_t color(uint8_t alpha = 0xFF);
+
+private:
+  uint64_t mState;
+};
+
+
+// Names of all available scenes.
+std::vector<std::string> scene_names();
+
+// Creates a scene from a spec "name[:count[:seed]]", e.g. "paths:500:7". Returns nullptr for unknown scenes.
+std::unique_ptr<Scene> create_scene(const std::string& spec);
+
+
+// The scene that draw_skia_scene() draws. Only to be used from the GUI thread.
+bool set_active_scene(const std::string& spec);
+
+Scene* active_scene();
+
+
+// Directory with the images shown by the "thumbnails" scene.
+void set_thumbnail_directory(const std::string& dir);
+
+#endif
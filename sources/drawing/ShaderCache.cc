@@ -0,0 +1,244 @@
+/*
+ * Copyright (C) 2025 by Dirk Farin, Kronenstr. 49b, 70174 Stuttgart, Germany
+ *
+ * 2-Clause BSD
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer
+ *    in the documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "ShaderCache.h"
+#include "util/ThreadPool.h"
+#include "util/Log.h"
+#include "profiling/StartupProfile.h"
+
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <vector>
+
+
+// File layout: magic, key size (uint32), key, data.
+static const char kMagic[4] = {'Q', 'S', 'S', 'C'};
+
+
+// Stable across runs and platforms, unlike std::hash.
+static uint64_t fnv1a(const std::string& bytes)
+{
+  uint64_t h = 0xcbf29ce484222325ull;
+  for (unsigned char c : bytes) {
+    h = (h ^ c) * 0x100000001b3ull;
+  }
+
+  return h;
+}
+
+
+static std::string entry_file_name(const std::string& key)
+{
+  char name[32];
+  snprintf(name, sizeof(name), "%016llx.bin", (unsigned long long) fnv1a(key));
+  return name;
+}
+
+
+static std::string key_bytes(const SkData& key)
+{
+  return std::string((const char*) key.data(), key.size());
+}
+
+
+static std::string named_key(const char* name)
+{
+  // Cannot collide with Skia's keys, which are binary and start with a shader type.
+  return std::string("name:") + name;
+}
+
+
+void ShaderCache::setDirectory(const std::string& dir)
+{
+  waitForLoading();
+
+  std::lock_guard<std::mutex> lock(mMutex);
+  mDirectory = dir;
+  mEntries.clear();
+
+  if (dir.empty()) {
+    return;
+  }
+
+  auto task = std::make_shared<std::packaged_task<void()>>([this, dir] { loadDirectory(dir); });
+  mLoading = task->get_future().share();
+  background_thread_pool().enqueue([task] { (*task)(); });
+}
+
+
+void ShaderCache::loadDirectory(const std::string& dir)
+{
+  STARTUP_PHASE("shader cache loading");
+
+  std::unordered_map<std::string, sk_sp<SkData>> entries;
+
+  std::error_code err;
+  for (const auto& file : std::filesystem::directory_iterator(dir, err)) {
+    if (file.path().extension() != ".bin") {
+      continue;
+    }
+
+    sk_sp<SkData> content = SkData::MakeFromFileName(file.path().string().c_str());
+    if (!content || content->size() < 8 || memcmp(content->data(), kMagic, 4) != 0) {
+      continue;
+    }
+
+    uint32_t keySize;
+    memcpy(&keySize, content->bytes() + 4, 4);
+    if (content->size() < 8 + (size_t) keySize) {
+      continue;
+    }
+
+    std::string key((const char*) content->bytes() + 8, keySize);
+    entries[key] = SkData::MakeSubset(content.get(), 8 + keySize, content->size() - 8 - keySize);
+  }
+
+  LOG_DEBUG("shader cache: %d entries loaded from %s", (int) entries.size(), dir.c_str());
+
+  std::lock_guard<std::mutex> lock(mMutex);
+  mEntries = std::move(entries);
+}
+
+
+void ShaderCache::waitForLoading()
+{
+  std::shared_future<void> loading;
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    loading = mLoading;
+  }
+
+  if (loading.valid()) {
+    loading.wait();
+  }
+}
+
+
+sk_sp<SkData> ShaderCache::loadEntry(const std::string& key)
+{
+  waitForLoading();
+
+  std::lock_guard<std::mutex> lock(mMutex);
+
+  auto iter = mEntries.find(key);
+  return iter != mEntries.end() ? iter->second : nullptr;
+}
+
+
+void ShaderCache::storeEntry(const std::string& key, sk_sp<SkData> data)
+{
+  waitForLoading();
+
+  std::string dir;
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (mDirectory.empty()) {
+      return;
+    }
+
+    mEntries[key] = data;
+    dir = mDirectory;
+    mPendingWrites++;
+  }
+
+  background_thread_pool().enqueue([this, dir, key, data] {
+    writeEntryFile(dir, key, data);
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (--mPendingWrites == 0) {
+      mWritesDone.notify_all();
+    }
+  });
+}
+
+
+void ShaderCache::flush()
+{
+  std::unique_lock<std::mutex> lock(mMutex);
+  mWritesDone.wait(lock, [this] { return mPendingWrites == 0; });
+}
+
+
+void ShaderCache::writeEntryFile(const std::string& dir, const std::string& key, const sk_sp<SkData>& data)
+{
+  std::error_code err;
+  std::filesystem::create_directories(dir, err);
+
+  std::filesystem::path file = std::filesystem::path(dir) / entry_file_name(key);
+  std::filesystem::path tmpFile = file;
+  tmpFile += ".tmp";
+
+  FILE* fp = fopen(tmpFile.string().c_str(), "wb");
+  if (!fp) {
+    LOG_WARNING("cannot write shader cache entry %s", file.string().c_str());
+    return;
+  }
+
+  uint32_t keySize = (uint32_t) key.size();
+  bool ok = fwrite(kMagic, 4, 1, fp) == 1 &&
+            fwrite(&keySize, 4, 1, fp) == 1 &&
+            fwrite(key.data(), key.size(), 1, fp) == 1 &&
+            (data->size() == 0 || fwrite(data->data(), data->size(), 1, fp) == 1);
+  ok = (fclose(fp) == 0) && ok;
+
+  if (ok) {
+    std::filesystem::rename(tmpFile, file, err);
+  }
+  else {
+    std::filesystem::remove(tmpFile, err);
+  }
+}
+
+
+sk_sp<SkData> ShaderCache::load(const SkData& key)
+{
+  return loadEntry(key_bytes(key));
+}
+
+
+void ShaderCache::store(const SkData& key, const SkData& data, const SkString& description)
+{
+  storeEntry(key_bytes(key), SkData::MakeWithCopy(data.data(), data.size()));
+}
+
+
+sk_sp<SkData> ShaderCache::load(const char* name)
+{
+  return loadEntry(named_key(name));
+}
+
+
+void ShaderCache::store(const char* name, const SkData& data)
+{
+  storeEntry(named_key(name), SkData::MakeWithCopy(data.data(), data.size()));
+}
+
+
+ShaderCache& shader_cache()
+{
+  static ShaderCache sCache;
+  return sCache;
+}
+
+
+void apply_shader_cache_context_options(GrContextOptions& options)
+{
+  options.fPersistentCache = &shader_cache();
+}
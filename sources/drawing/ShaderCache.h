@@ -0,0 +1,89 @@
+/*
+ * Copyright (C) 2025 by Dirk Farin, Kronenstr. 49b, 70174 Stuttgart, Germany
+ *
+ * 2-Clause BSD
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer
+ *    in the documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef SHADERCACHE_H
+#define SHADERCACHE_H
+
+#ifdef _WIN32 // TODO(skia): how can we test the skia version?
+#include <gpu/GrContextOptions.h>
+#else
+#include <gpu/ganesh/GrContextOptions.h>
+#endif
+
+#include <core/SkData.h>
+
+#include <condition_variable>
+#include <future>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+
+// Persistent cache for the shaders that Skia compiles (GrContextOptions::fPersistentCache)
+// and for other blobs such as the Vulkan pipeline cache. One file per entry in a directory.
+//
+// The directory is read on a background thread as soon as it is set, so that loading overlaps
+// with window, device and swapchain creation. load() only waits if the first shader is
+// compiled before that has finished. New entries are written on a background thread.
+
+class ShaderCache : public GrContextOptions::PersistentCache
+{
+public:
+  // Starts reading all entries. An empty directory disables the cache.
+  void setDirectory(const std::string& dir);
+
+  sk_sp<SkData> load(const SkData& key) override;
+
+  void store(const SkData& key, const SkData& data, const SkString& description) override;
+
+  // Blobs stored under a name instead of a Skia key.
+  sk_sp<SkData> load(const char* name);
+
+  void store(const char* name, const SkData& data);
+
+  // Waits until all entries stored so far have been written. Call it before the application
+  // exits, the background threads may not get to the writes otherwise.
+  void flush();
+
+private:
+  std::mutex mMutex;
+  std::condition_variable mWritesDone;
+  int mPendingWrites = 0;
+  std::string mDirectory;
+  std::shared_future<void> mLoading;
+  std::unordered_map<std::string, sk_sp<SkData>> mEntries; // by key bytes
+
+  void waitForLoading();
+
+  void loadDirectory(const std::string& dir);
+
+  sk_sp<SkData> loadEntry(const std::string& key);
+
+  void storeEntry(const std::string& key, sk_sp<SkData> data);
+
+  static void writeEntryFile(const std::string& dir, const std::string& key, const sk_sp<SkData>& data);
+};
+
+
+ShaderCache& shader_cache();
+
+// Uses the shader cache for the context.
+void apply_shader_cache_context_options(GrContextOptions&);
+
+#endif
@@ -0,0 +1,107 @@
+/*
+ * Copyright (C) 2025 by Dirk Farin, Kronenstr. 49b, 70174 Stuttgart, Germany
+ *
+ * 2-Clause BSD
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer
+ *    in the documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "SurfacePool.h"
+
+#include <algorithm>
+
+
+// Number of surfaces kept at most. Two are enough to bounce between a shrunken and the
+// previous size without reallocating.
+static const size_t kMaxPooledSurfaces = 2;
+
+// Surface sizes are rounded up to multiples of this.
+static const int kBucketGranularity = 128;
+
+
+SurfacePool::SurfacePool(Factory factory)
+    : mFactory(std::move(factory))
+{
+}
+
+
+int SurfacePool::bucket_size(int v)
+{
+  // 1/8 headroom so that slowly growing a window does not hit a new bucket on every step
+  v += v / 8;
+  return (v + kBucketGranularity - 1) / kBucketGranularity * kBucketGranularity;
+}
+
+
+SkSurface* SurfacePool::acquire(int w, int h)
+{
+  if (w <= 0 || h <= 0) {
+    return nullptr;
+  }
+
+  // --- take the smallest pooled surface that fits
+
+  Entry* best = nullptr;
+  for (auto& entry : mEntries) {
+    if (entry.surface->width() >= w && entry.surface->height() >= h) {
+      if (!best || entry.surface->width() * (int64_t) entry.surface->height() <
+                   best->surface->width() * (int64_t) best->surface->height()) {
+        best = &entry;
+      }
+    }
+  }
+
+  if (best) {
+    best->lastUse = ++mUseCounter;
+    return best->surface.get();
+  }
+
+  // --- nothing fits, allocate a new bucket-sized surface
+
+  sk_sp<SkSurface> surface = mFactory(bucket_size(w), bucket_size(h));
+  if (!surface) {
+    return nullptr;
+  }
+
+  mAllocationCount++;
+
+  if (mEntries.size() >= kMaxPooledSurfaces) {
+    auto lru = std::min_element(mEntries.begin(), mEntries.end(),
+                                [](const Entry& a, const Entry& b) { return a.lastUse < b.lastUse; });
+    mEntries.erase(lru);
+  }
+
+  mEntries.push_back({std::move(surface), ++mUseCounter});
+  return mEntries.back().surface.get();
+}
+
+
+void SurfacePool::trim(int w, int h)
+{
+  // A surface is kept if it is not more than twice the area of the bucket the view would get.
+  int64_t maxArea = 2 * (int64_t) bucket_size(w) * bucket_size(h);
+
+  mEntries.erase(std::remove_if(mEntries.begin(), mEntries.end(),
+                                [=](const Entry& e) {
+                                  return e.surface->width() * (int64_t) e.surface->height() > maxArea ||
+                                         e.surface->width() < w || e.surface->height() < h;
+                                }),
+                 mEntries.end());
+}
+
+
+void SurfacePool::clear()
+{
+  mEntries.clear();
+}
@@ -0,0 +1,71 @@
+/*
+ * Copyright (C) 2025 by Dirk Farin, Kronenstr. 49b, 70174 Stuttgart, Germany
+ *
+ * 2-Clause BSD
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer
+ *    in the documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef SURFACEPOOL_H
+#define SURFACEPOOL_H
+
+#include <core/SkSurface.h>
+
+#include <functional>
+#include <vector>
+
+
+// Keeps a few over-allocated surfaces around so that interactive window resizing does not
+// allocate a new full-size surface for every resize event.
+//
+// Surfaces are allocated in size buckets (rounded up, with some headroom). As long as the
+// requested view size fits into a pooled surface, that surface is reused and the caller only
+// draws into its top-left w x h area. Oversized surfaces are only given back in trim(), which
+// should be called once resizing has settled.
+
+class SurfacePool
+{
+public:
+  using Factory = std::function<sk_sp<SkSurface>(int w, int h)>;
+
+  explicit SurfacePool(Factory factory);
+
+  // Returns a surface of at least w x h pixels, or nullptr if the factory failed.
+  SkSurface* acquire(int w, int h);
+
+  // Releases surfaces that are much larger than a view of w x h needs.
+  void trim(int w, int h);
+
+  void clear();
+
+  // Total number of surfaces that have been allocated through the factory.
+  int allocationCount() const { return mAllocationCount; }
+
+private:
+  Factory mFactory;
+
+  struct Entry
+  {
+    sk_sp<SkSurface> surface;
+    uint64_t lastUse = 0;
+  };
+
+  std::vector<Entry> mEntries;
+  uint64_t mUseCounter = 0;
+  int mAllocationCount = 0;
+
+  static int bucket_size(int v);
+};
+
+#endif
@@ -0,0 +1,266 @@
+/*
+ * Copyright (C) 2025 by Dirk Farin, Kronenstr. 49b, 70174 Stuttgart, Germany
+ *
+ * 2-Clause BSD
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer
+ *    in the documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "TextLayout.h"
+#include "SkiaFontManager.h"
+#include "util/ThreadPool.h"
+#include "profiling/Tracing.h"
+
+#include <modules/skparagraph/include/FontCollection.h>
+#include <modules/skparagraph/include/Paragraph.h>
+#include <modules/skparagraph/include/ParagraphBuilder.h>
+#include <modules/skparagraph/include/ParagraphStyle.h>
+#include <modules/skparagraph/include/TextStyle.h>
+#include <modules/skunicode/include/SkUnicode_icu.h>
+
+#include <cstdint>
+
+using namespace skia::textlayout;
+
+
+bool TextLayoutStyle::operator==(const TextLayoutStyle& b) const
+{
+  return size == b.size && color == b.color && weight == b.weight && italic == b.italic &&
+         lineHeight == b.lineHeight && family == b.family;
+}
+
+
+size_t ParagraphCache::KeyHash::operator()(const KeyRef& k) const
+{
+  size_t h = std::hash<std::string_view>()(k.text);
+
+  auto combine = [&h](size_t v) { h ^= v + 0x9E3779B9u + (h << 6) + (h >> 2); };
+  combine(std::hash<std::string>()(k.style.family));
+  combine(std::hash<float>()(k.style.size));
+  combine(k.style.color);
+  combine(size_t(k.style.weight) * 2 + k.style.italic);
+  combine(std::hash<float>()(k.style.lineHeight));
+  combine(std::hash<float>()(k.width));
+
+  return h;
+}
+
+
+sk_sp<FontCollection> thread_font_collection()
+{
+  thread_local sk_sp<FontCollection> tCollection;
+
+  if (!tCollection) {
+    tCollection = sk_make_sp<FontCollection>();
+    tCollection->setDefaultFontManager(get_skia_font_manager());
+    tCollection->enableFontFallback();
+  }
+
+  return tCollection;
+}
+
+
+static sk_sp<SkUnicode> thread_unicode()
+{
+  thread_local sk_sp<SkUnicode> tUnicode = SkUnicodes::ICU::Make();
+  return tUnicode;
+}
+
+
+std::unique_ptr<Paragraph> layout_paragraph(const std::string& text, const TextLayoutStyle& style, float width)
+{
+  TRACE_SCOPE("layout_paragraph");
+
+  TextStyle textStyle;
+  textStyle.setFontFamilies({SkString(style.family.c_str())});
+  textStyle.setFontSize(style.size);
+  textStyle.setColor(style.color);
+  textStyle.setFontStyle(SkFontStyle(style.weight, SkFontStyle::kNormal_Width,
+                                     style.italic ? SkFontStyle::kItalic_Slant : SkFontStyle::kUpright_Slant));
+  if (style.lineHeight > 0) {
+    textStyle.setHeightOverride(true);
+    textStyle.setHeight(style.lineHeight);
+  }
+
+  ParagraphStyle paragraphStyle;
+  paragraphStyle.setTextStyle(textStyle);
+
+  auto builder = ParagraphBuilder::make(paragraphStyle, thread_font_collection(), thread_unicode());
+  builder->addText(text.data(), text.size());
+
+  std::unique_ptr<Paragraph> paragraph = builder->Build();
+  paragraph->layout(width);
+
+  return paragraph;
+}
+
+
+ParagraphCache::ParagraphCache()
+{
+  // Make sure that the thread pool is created first, so that it is destroyed (and its
+  // background layouts are finished) before this cache.
+  background_thread_pool();
+}
+
+
+ParagraphCache::Entry* ParagraphCache::lookup(const KeyRef& key)
+{
+  auto iter = mEntries.find(key);
+  if (iter == mEntries.end()) {
+    return nullptr;
+  }
+
+  mLRU.splice(mLRU.begin(), mLRU, iter->second.lruPos);
+  return &iter->second;
+}
+
+
+void ParagraphCache::insert(const Key& key, ParagraphPtr paragraph)
+{
+  mLRU.push_front(key);
+
+  Entry& entry = mEntries[key];
+  entry.paragraph = std::move(paragraph);
+  entry.lruPos = mLRU.begin();
+
+  evict();
+}
+
+
+ParagraphCache::ParagraphPtr ParagraphCache::get(const std::string& text, const TextLayoutStyle& style, float width)
+{
+  KeyRef key{text, style, width};
+
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    Entry* entry = lookup(key);
+    if (entry && entry->paragraph) {
+      mStats.hits++;
+      return entry->paragraph;
+    }
+
+    mStats.misses++;
+  }
+
+  // Lay out without holding the lock. If a background layout of the same paragraph is still
+  // running, we do not wait for it; its result will be dropped.
+
+  ParagraphPtr paragraph = layout_paragraph(text, style, width);
+
+  std::lock_guard<std::mutex> lock(mMutex);
+  mStats.layouts++;
+
+  if (Entry* entry = lookup(key)) {
+    entry->paragraph = paragraph;
+  }
+  else {
+    insert(Key{text, style, width}, paragraph);
+  }
+
+  return paragraph;
+}
+
+
+ParagraphCache::ParagraphPtr ParagraphCache::request(const std::string& text, const TextLayoutStyle& style, float width)
+{
+  std::lock_guard<std::mutex> lock(mMutex);
+
+  if (Entry* entry = lookup(KeyRef{text, style, width})) {
+    if (entry->paragraph) {
+      mStats.hits++;
+    }
+    else {
+      mStats.misses++;
+    }
+
+    return entry->paragraph;
+  }
+
+  mStats.misses++;
+
+  Key key{text, style, width};
+  insert(key, nullptr);
+
+  background_thread_pool().enqueue([this, key] {
+    ParagraphPtr paragraph = layout_paragraph(key.text, key.style, key.width);
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    mStats.layouts++;
+    mStats.backgroundLayouts++;
+
+    auto iter = mEntries.find(key);
+    if (iter != mEntries.end() && !iter->second.paragraph) {
+      iter->second.paragraph = std::move(paragraph);
+    }
+  });
+
+  return nullptr;
+}
+
+
+// Called with mMutex held.
+void ParagraphCache::evict()
+{
+  // Entries whose layout is still running in the background are kept.
+
+  auto iter = mLRU.end();
+  while (mEntries.size() > mCapacity && iter != mLRU.begin()) {
+    --iter;
+
+    auto entryIter = mEntries.find(*iter);
+    if (!entryIter->second.paragraph) {
+      continue;
+    }
+
+    mEntries.erase(entryIter);
+    iter = mLRU.erase(iter);
+    mStats.evictions++;
+  }
+}
+
+
+void ParagraphCache::setCapacity(size_t n)
+{
+  std::lock_guard<std::mutex> lock(mMutex);
+  mCapacity = n;
+  evict();
+}
+
+
+ParagraphCache::Stats ParagraphCache::stats() const
+{
+  std::lock_guard<std::mutex> lock(mMutex);
+  return mStats;
+}
+
+
+ParagraphCache& paragraph_cache()
+{
+  static ParagraphCache sCache;
+  return sCache;
+}
+
+
+void paint_paragraph(const ParagraphCache::ParagraphPtr& paragraph, SkCanvas* canvas, float x, float y)
+{
+  // Paragraph::paint() updates state of the paragraph. A lock per paragraph, striped by address,
+  // so that threads painting different paragraphs rarely wait for each other.
+  static std::mutex sPaintMutexes[16];
+
+  std::mutex& mutex = sPaintMutexes[(reinterpret_cast<uintptr_t>(paragraph.get()) >> 4) % 16];
+  std::lock_guard<std::mutex> lock(mutex);
+
+  paragraph->paint(canvas, x, y);
+}
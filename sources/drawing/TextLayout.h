@@ -0,0 +1,162 @@
+/*
+ * Copyright (C) 2025 by Dirk Farin, Kronenstr. 49b, 70174 Stuttgart, Germany
+ *
+ * 2-Clause BSD
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer
+ *    in the documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef TEXTLAYOUT_H
+#define TEXTLAYOUT_H
+
+#include <core/SkColor.h>
+#include <core/SkRefCnt.h>
+
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+class SkCanvas;
+
+namespace skia::textlayout {
+class FontCollection;
+class Paragraph;
+}
+
+
+// Style of a whole paragraph. Only what we need so far; extend together with operator== and the hash.
+struct TextLayoutStyle
+{
+  std::string family = "FreeSans";
+  float size = 14;
+  SkColor color = SK_ColorBLACK;
+  int weight = 400;
+  bool italic = false;
+  float lineHeight = 0; // multiple of the font size, 0 = font default
+
+  bool operator==(const TextLayoutStyle& b) const;
+};
+
+
+// Font collection on the global font manager (see SkiaFontManager.h).
+// FontCollection is not thread-safe, hence there is one per thread. It is reused for all
+// paragraphs of that thread, so its typeface lookups and shaping results are shared.
+sk_sp<skia::textlayout::FontCollection> thread_font_collection();
+
+// Shapes and lays out a paragraph (uncached).
+std::unique_ptr<skia::textlayout::Paragraph> layout_paragraph(const std::string& text, const TextLayoutStyle&, float width);
+
+
+// Laid-out paragraphs, keyed by text, style and width.
+//
+// A cached layout stays valid until its inputs change; a different width (relayout) is a new
+// entry. Paragraphs are handed out as shared pointers, so evicting an entry does not affect a
+// paragraph that is currently being drawn. Paragraph::paint() is not thread-safe, and the cache
+// is shared between threads, so cached paragraphs must be painted with paint_paragraph().
+
+class ParagraphCache
+{
+public:
+  using ParagraphPtr = std::shared_ptr<skia::textlayout::Paragraph>;
+
+  struct Stats
+  {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t layouts = 0;
+    uint64_t backgroundLayouts = 0;
+    uint64_t evictions = 0;
+  };
+
+  ParagraphCache();
+
+  // Returns the paragraph, laying it out on the calling thread if it is not cached.
+  ParagraphPtr get(const std::string& text, const TextLayoutStyle&, float width);
+
+  // Returns the paragraph if it is cached. Otherwise schedules the layout on a background
+  // thread (once) and returns nullptr. Use this for large documents and for prefetching.
+  ParagraphPtr request(const std::string& text, const TextLayoutStyle&, float width);
+
+  // Maximum number of cached paragraphs.
+  void setCapacity(size_t n);
+
+  Stats stats() const;
+
+private:
+  // Lookups use a non-owning key; the strings are only copied into a Key when an entry is inserted.
+  struct KeyRef
+  {
+    std::string_view text;
+    const TextLayoutStyle& style;
+    float width;
+  };
+
+  struct Key
+  {
+    std::string text;
+    TextLayoutStyle style;
+    float width;
+
+    KeyRef ref() const { return {text, style, width}; }
+  };
+
+  struct KeyHash
+  {
+    using is_transparent = void;
+
+    size_t operator()(const KeyRef& k) const;
+    size_t operator()(const Key& k) const { return (*this)(k.ref()); }
+  };
+
+  struct KeyEqual
+  {
+    using is_transparent = void;
+
+    static bool equal(const KeyRef& a, const KeyRef& b) { return a.width == b.width && a.style == b.style && a.text == b.text; }
+
+    bool operator()(const Key& a, const Key& b) const { return equal(a.ref(), b.ref()); }
+    bool operator()(const KeyRef& a, const Key& b) const { return equal(a, b.ref()); }
+    bool operator()(const Key& a, const KeyRef& b) const { return equal(a.ref(), b); }
+  };
+
+  struct Entry
+  {
+    ParagraphPtr paragraph; // nullptr while the layout is running in the background
+    std::list<Key>::iterator lruPos;
+  };
+
+  mutable std::mutex mMutex;
+  std::unordered_map<Key, Entry, KeyHash, KeyEqual> mEntries;
+  std::list<Key> mLRU; // most recently used at the front
+  size_t mCapacity = 2000;
+
+  Stats mStats;
+
+  Entry* lookup(const KeyRef& key);
+
+  void insert(const Key& key, ParagraphPtr paragraph);
+
+  void evict();
+};
+
+
+ParagraphCache& paragraph_cache();
+
+// Paints a (cached) paragraph. Serializes painting of the same paragraph on several threads.
+void paint_paragraph(const ParagraphCache::ParagraphPtr&, SkCanvas*, float x, float y);
+
+#endif
@@ -0,0 +1,239 @@
+/*
+ * Copyright (C) 2025 by Dirk Farin, Kronenstr. 49b, 70174 Stuttgart, Germany
+ *
+ * 2-Clause BSD
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer
+ *    in the documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "TextMode.h"
+#include "Drawing.h"
+
+#include <core/SkCanvas.h>
+#include <core/SkFont.h>
+#include <core/SkImage.h>
+#include <core/SkPaint.h>
+#include <core/SkSurface.h>
+#include <core/SkTypeface.h>
+
+#ifdef _WIN32 // TODO(skia): how can we test the skia version?
+#include <gpu/GrContextOptions.h>
+#else
+#include <gpu/ganesh/GrContextOptions.h>
+#endif
+
+#ifdef _WIN32 // TODO(skia): how can we test the skia version?
+#include "gpu/GrRecordingContext.h"
+#else
+#include "gpu/ganesh/GrRecordingContext.h"
+#endif
+
+#include <cmath>
+#include <list>
+#include <string_view>
+
+
+static TextMode sTextMode = TextMode::Default;
+
+static const struct
+{
+  TextMode mode;
+  const char* name;
+} sTextModeNames[] = {
+    {TextMode::Default, "default"},
+    {TextMode::DistanceField, "distance-field"},
+    {TextMode::QuantizedSize, "quantized"},
+};
+
+
+void set_text_mode(TextMode mode)
+{
+  sTextMode = mode;
+}
+
+
+TextMode text_mode()
+{
+  return sTextMode;
+}
+
+
+const char* text_mode_name(TextMode mode)
+{
+  for (const auto& m : sTextModeNames) {
+    if (m.mode == mode) {
+      return m.name;
+    }
+  }
+
+  return "?";
+}
+
+
+bool parse_text_mode(const std::string& name, TextMode* mode)
+{
+  for (const auto& m : sTextModeNames) {
+    if (name == m.name) {
+      *mode = m.mode;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+
+SkSurfaceProps text_mode_surface_props()
+{
+  uint32_t flags = 0;
+  if (sTextMode == TextMode::DistanceField) {
+    flags |= SkSurfaceProps::kUseDeviceIndependentFonts_Flag;
+  }
+
+  return SkSurfaceProps(flags, kUnknown_SkPixelGeometry);
+}
+
+
+void apply_text_mode_context_options(GrContextOptions& options)
+{
+  if (sTextMode == TextMode::DistanceField) {
+    // Use distance fields down to small sizes; the default (18) would still rasterize the
+    // small end of a zoom at every size.
+    options.fMinDistanceFieldFontSize = 8;
+    options.fGlyphsAsPathsFontSize = 512;
+  }
+}
+
+
+static float quantize_font_size(float size)
+{
+  const float kStepsPerOctave = 4;
+
+  if (size <= 1) {
+    return size;
+  }
+
+  // Round up, so that glyphs are only ever scaled down.
+  return std::exp2(std::ceil(std::log2(size) * kStepsPerOctave) / kStepsPerOctave);
+}
+
+
+// Images of text runs rendered at a quantized size, most recently used at the front.
+// Drawing the text itself with a scale transform would not help: Skia rasterizes glyph masks
+// at the device size, i.e. with the transform applied.
+// One cache per thread, as scenes may be rendered concurrently (see RenderToBuffer.h).
+// The entries reference their context, so that its address cannot be reused by a new context.
+
+struct QuantizedText
+{
+  sk_sp<GrRecordingContext> context; // null for raster canvases
+  std::string text;
+  SkTypefaceID typeface;
+  float size;
+  SkColor color;
+
+  SkPoint origin; // baseline origin in the image
+  sk_sp<SkImage> image;
+};
+
+static thread_local std::list<QuantizedText> sQuantizedTexts;
+static const size_t kMaxQuantizedTexts = 64;
+
+
+static const QuantizedText* quantized_text_image(SkCanvas* canvas, const char* text, size_t length,
+                                                 SkFont font, float size, const SkPaint& paint)
+{
+  GrRecordingContext* context = canvas_recording_context(canvas);
+  std::string_view str(text, length); // copied only for a new entry, hits must not allocate
+  SkTypefaceID typeface = font.getTypeface() ? font.getTypeface()->uniqueID() : 0;
+
+  for (auto iter = sQuantizedTexts.begin(); iter != sQuantizedTexts.end();) {
+    if (iter->context && iter->context->abandoned()) {
+      iter = sQuantizedTexts.erase(iter);
+      continue;
+    }
+
+    if (iter->context.get() == context && iter->typeface == typeface && iter->size == size &&
+        iter->color == paint.getColor() && iter->text == str) {
+      sQuantizedTexts.splice(sQuantizedTexts.begin(), sQuantizedTexts, iter);
+      return &sQuantizedTexts.front();
+    }
+
+    ++iter;
+  }
+
+  // --- render text into a new image
+
+  font.setSize(size);
+
+  SkRect bounds;
+  font.measureText(text, length, SkTextEncoding::kUTF8, &bounds, &paint);
+  SkIRect ibounds = bounds.roundOut().makeOutset(1, 1);
+  if (ibounds.isEmpty()) {
+    return nullptr;
+  }
+
+  SkImageInfo info = SkImageInfo::MakeN32Premul(ibounds.width(), ibounds.height());
+  sk_sp<SkSurface> surface = canvas->makeSurface(info);
+  if (!surface) {
+    surface = SkSurfaces::Raster(info);
+  }
+
+  SkCanvas* textCanvas = surface->getCanvas();
+  textCanvas->clear(SK_ColorTRANSPARENT);
+  textCanvas->drawSimpleText(text, length, SkTextEncoding::kUTF8, -ibounds.left(), -ibounds.top(), font, paint);
+
+  QuantizedText entry{sk_ref_sp(context), std::string(str), typeface, size, paint.getColor(),
+                      SkPoint::Make(-ibounds.left(), -ibounds.top()), surface->makeImageSnapshot()};
+
+  sQuantizedTexts.push_front(std::move(entry));
+  if (sQuantizedTexts.size() > kMaxQuantizedTexts) {
+    sQuantizedTexts.pop_back();
+  }
+
+  return &sQuantizedTexts.front();
+}
+
+
+void release_text_mode_cache(GrRecordingContext* context)
+{
+  if (!context) {
+    return;
+  }
+
+  sQuantizedTexts.remove_if([context](const QuantizedText& entry) { return entry.context.get() == context; });
+}
+
+
+void draw_text_at_size(SkCanvas* canvas, const char* text, size_t length, float x, float y,
+                       SkFont font, float size, const SkPaint& paint)
+{
+  if (sTextMode == TextMode::QuantizedSize) {
+    float quantized = quantize_font_size(size);
+    if (const QuantizedText* q = quantized_text_image(canvas, text, length, font, quantized, paint)) {
+      float scale = size / quantized;
+
+      canvas->save();
+      canvas->translate(x, y);
+      canvas->scale(scale, scale);
+      canvas->drawImage(q->image, -q->origin.x(), -q->origin.y(), SkSamplingOptions(SkFilterMode::kLinear));
+      canvas->restore();
+    }
+
+    return;
+  }
+
+  font.setSize(size);
+  canvas->drawSimpleText(text, length, SkTextEncoding::kUTF8, x, y, font, paint);
+}
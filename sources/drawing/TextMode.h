@@ -0,0 +1,75 @@
+/*
+ * Copyright (C) 2025 by Dirk Farin, Kronenstr. 49b, 70174 Stuttgart, Germany
+ *
+ * 2-Clause BSD
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer
+ *    in the documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef TEXTMODE_H
+#define TEXTMODE_H
+
+#include <core/SkSurfaceProps.h>
+
+#include <string>
+
+class SkCanvas;
+class SkFont;
+class SkPaint;
+class GrRecordingContext;
+struct GrContextOptions;
+
+
+// How text with continuously changing size (zooming) is rendered.
+//
+// Default: Skia rasterizes the glyphs at each size into the atlas. Every new size causes new
+//   glyph rasterizations and atlas uploads.
+// DistanceField: GPU backends render glyphs from signed distance fields, which are generated
+//   once for a few base sizes and scaled in the shader.
+// QuantizedSize: text is rendered into an image at the next quantized size (four steps per
+//   octave), which is drawn scaled down. Works on all backends, at the price of slightly softer
+//   text. Only for short, frequently drawn runs (labels), as each run is cached separately.
+
+enum class TextMode
+{
+  Default,
+  DistanceField,
+  QuantizedSize
+};
+
+void set_text_mode(TextMode);
+
+TextMode text_mode();
+
+const char* text_mode_name(TextMode);
+
+bool parse_text_mode(const std::string& name, TextMode* mode);
+
+
+// Surface properties that have to be used for all surfaces of the GPU backends.
+SkSurfaceProps text_mode_surface_props();
+
+// Sets the distance field thresholds. Must be applied when creating the GrDirectContext.
+void apply_text_mode_context_options(GrContextOptions&);
+
+// Draws UTF-8 text in 'font' at 'size'. In QuantizedSize mode, the text is drawn from an image
+// rendered at the quantized size.
+void draw_text_at_size(SkCanvas*, const char* text, size_t length, float x, float y,
+                       SkFont font, float size, const SkPaint&);
+
+// Drops the QuantizedSize images of the calling thread that were rendered with 'context'. Call it
+// before the context is destroyed. Images of abandoned contexts are also dropped on the next draw.
+void release_text_mode_cache(GrRecordingContext*);
+
+#endif
@@ -0,0 +1,448 @@
+/*
+ * Copyright (C) 2025 by Dirk Farin, Kronenstr. 49b, 70174 Stuttgart, Germany
+ *
+ * 2-Clause BSD
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer
+ *    in the documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "TileCache.h"
+#include "util/ThreadPool.h"
+#include "profiling/Tracing.h"
+
+#include <core/SkCanvas.h>
+#include <core/SkPaint.h>
+#include <core/SkSurface.h>
+#include <gpu/ganesh/GrDirectContext.h>
+#include <gpu/ganesh/SkImageGanesh.h>
+
+#include <algorithm>
+#include <cmath>
+
+
+static int floor_div(int a, int b)
+{
+  return a >= 0 ? a / b : -((-a + b - 1) / b);
+}
+
+
+// All live caches, for release_tile_cache(). Locked before the mutex of a cache.
+static std::mutex sCachesMutex;
+static std::vector<TileCache*> sCaches;
+
+
+TileCache::TileCache(GrDirectContext* context, sk_sp<SkPicture> document)
+    : mContext(sk_ref_sp(context)),
+      mDocument(std::move(document)),
+      mGuard(std::make_shared<Guard>())
+{
+  mBounds = mDocument->cullRect();
+  mMaxInFlight = background_thread_pool().threadCount();
+
+  std::lock_guard<std::mutex> lock(sCachesMutex);
+  sCaches.push_back(this);
+}
+
+
+TileCache::~TileCache()
+{
+  {
+    std::lock_guard<std::mutex> lock(sCachesMutex);
+    sCaches.erase(std::find(sCaches.begin(), sCaches.end(), this));
+  }
+
+  // Tiles that are still rendering see this and drop their result.
+  std::lock_guard<std::mutex> lock(mGuard->mutex);
+  mGuard->alive = false;
+}
+
+
+float TileCache::tile_extent(int level)
+{
+  return std::ldexp((float) kTileSize, -level);
+}
+
+
+void TileCache::draw(SkCanvas* canvas, SkPoint origin, float scale, int viewWidth, int viewHeight)
+{
+  TRACE_SCOPE("TileCache::draw");
+
+  // Tiles are rendered at the next finer level, so they are only ever scaled down.
+  int level = std::clamp((int) std::ceil(std::log2(scale) - 0.01f), kMinLevel, kMaxLevel);
+  float extent = tile_extent(level);
+
+  SkRect view = SkRect::MakeXYWH(origin.x(), origin.y(), viewWidth / scale, viewHeight / scale);
+
+  auto to_view = [&](const SkRect& r) {
+    return SkRect::MakeLTRB((r.left() - origin.x()) * scale, (r.top() - origin.y()) * scale,
+                            (r.right() - origin.x()) * scale, (r.bottom() - origin.y()) * scale);
+  };
+
+  mDraws.clear();
+
+  {
+    std::lock_guard<std::mutex> lock(mGuard->mutex);
+
+    upload();
+
+    // The queue is rebuilt from what is visible now.
+    dropQueuedRequests();
+
+    SkRect visible = view;
+    if (visible.intersect(mBounds)) {
+      int x0 = (int) std::floor(visible.left() / extent);
+      int y0 = (int) std::floor(visible.top() / extent);
+      int x1 = (int) std::ceil(visible.right() / extent) - 1;
+      int y1 = (int) std::ceil(visible.bottom() / extent) - 1;
+
+      for (int y = y0; y <= y1; y++) {
+        for (int x = x0; x <= x1; x++) {
+          Key key{level, x, y};
+
+          TileDraw tile;
+          tile.dst = to_view(SkRect::MakeXYWH(x * extent, y * extent, extent, extent));
+          tile.src = SkRect::MakeIWH(kTileSize, kTileSize);
+
+          auto iter = mEntries.find(key);
+          if (iter != mEntries.end() && iter->second.state == State::Ready) {
+            mStats.hits++;
+            mLRU.splice(mLRU.begin(), mLRU, iter->second.lruPos);
+            tile.image = iter->second.image;
+            mDraws.push_back(std::move(tile));
+            continue;
+          }
+
+          mStats.misses++;
+          request(key, false);
+
+          if (findFallback(key, &tile)) {
+            mStats.fallbacks++;
+            mDraws.push_back(std::move(tile));
+          }
+        }
+      }
+
+      // --- prefetch the next row/column in the direction of the pan
+
+      SkPoint center{view.centerX(), view.centerY()};
+      if (mHaveLastCenter) {
+        SkPoint delta = center - mLastCenter;
+        int dx = delta.x() > 0 ? 1 : delta.x() < 0 ? -1 : 0;
+        int dy = delta.y() > 0 ? 1 : delta.y() < 0 ? -1 : 0;
+
+        int maxX = (int) std::ceil(mBounds.right() / extent) - 1;
+        int maxY = (int) std::ceil(mBounds.bottom() / extent) - 1;
+        int minX = (int) std::floor(mBounds.left() / extent);
+        int minY = (int) std::floor(mBounds.top() / extent);
+
+        auto prefetch = [&](int x, int y) {
+          if (x >= minX && x <= maxX && y >= minY && y <= maxY) {
+            request(Key{level, x, y}, true);
+          }
+        };
+
+        if (dx) {
+          int x = dx > 0 ? x1 + 1 : x0 - 1;
+          for (int y = y0 - (dy < 0); y <= y1 + (dy > 0); y++) {
+            prefetch(x, y);
+          }
+        }
+
+        if (dy) {
+          int y = dy > 0 ? y1 + 1 : y0 - 1;
+          for (int x = x0; x <= x1; x++) {
+            prefetch(x, y);
+          }
+        }
+      }
+
+      mLastCenter = center;
+      mHaveLastCenter = true;
+    }
+
+    startRendering();
+    evict();
+  }
+
+  // --- composite (outside of the lock, the tile images are referenced by mDraws)
+
+  canvas->save();
+  canvas->clipRect(SkRect::MakeIWH(viewWidth, viewHeight));
+  canvas->clear(SK_ColorWHITE);
+
+  SkPaint placeholderPaint;
+  placeholderPaint.setColor(SkColorSetRGB(0xE8, 0xE8, 0xE8));
+  canvas->drawRect(to_view(mBounds), placeholderPaint);
+
+  SkSamplingOptions sampling(SkFilterMode::kLinear);
+  for (const TileDraw& tile : mDraws) {
+    canvas->drawImageRect(tile.image, tile.src, tile.dst, sampling, nullptr, SkCanvas::kFast_SrcRectConstraint);
+  }
+
+  canvas->restore();
+
+  mDraws.clear();
+}
+
+
+// Called with the mutex held.
+void TileCache::dropQueuedRequests()
+{
+  for (const Key& key : mQueue) {
+    auto iter = mEntries.find(key);
+    if (iter != mEntries.end() && iter->second.state == State::Queued) {
+      mLRU.erase(iter->second.lruPos);
+      mEntries.erase(iter);
+    }
+  }
+
+  mQueue.clear();
+}
+
+
+// Called with the mutex held.
+void TileCache::request(const Key& key, bool prefetch)
+{
+  if (mEntries.find(key) != mEntries.end()) {
+    return;
+  }
+
+  if (prefetch) {
+    mStats.prefetchRequests++;
+  }
+
+  mLRU.push_front(key);
+  Entry& entry = mEntries[key];
+  entry.lruPos = mLRU.begin();
+
+  // Visible tiles are requested before the prefetched ones, so FIFO order is priority order.
+  mQueue.push_back(key);
+}
+
+
+// Called with the mutex held.
+void TileCache::startRendering()
+{
+  while (mInFlight < mMaxInFlight && !mQueue.empty()) {
+    Key key = mQueue.front();
+    mQueue.pop_front();
+
+    mEntries[key].state = State::Rendering;
+    mInFlight++;
+
+    background_thread_pool().enqueue([this, guard = mGuard, document = mDocument, key] {
+      sk_sp<SkImage> image = render_tile(document.get(), key);
+
+      std::lock_guard<std::mutex> lock(guard->mutex);
+      if (guard->alive) {
+        renderFinished(key, std::move(image));
+      }
+    });
+  }
+}
+
+
+// Called with the mutex held.
+void TileCache::renderFinished(const Key& key, sk_sp<SkImage> image)
+{
+  mInFlight--;
+
+  auto iter = mEntries.find(key);
+  if (iter != mEntries.end()) {
+    Entry& entry = iter->second;
+
+    if (!image) {
+      mLRU.erase(entry.lruPos);
+      mEntries.erase(iter);
+    }
+    else {
+      mStats.rendered++;
+      entry.image = std::move(image);
+
+      if (mContext) {
+        entry.state = State::Rendered;
+        mUploadQueue.push_back(key);
+      }
+      else {
+        entry.state = State::Ready;
+        mStats.residentBytes += entry.image->imageInfo().computeMinByteSize();
+      }
+    }
+  }
+
+  // Keep the workers busy between frames.
+  startRendering();
+}
+
+
+bool TileCache::contextReleased() const
+{
+  std::lock_guard<std::mutex> lock(mGuard->mutex);
+  return mReleased || (mContext && mContext->abandoned());
+}
+
+
+// Called with the mutex held.
+void TileCache::releaseContext()
+{
+  // Tiles that are still rendering find no entry and drop their result.
+  mEntries.clear();
+  mLRU.clear();
+  mQueue.clear();
+  mUploadQueue.clear();
+  mDraws.clear();
+  mStats.residentBytes = 0;
+
+  mContext.reset();
+  mReleased = true;
+}
+
+
+void release_tile_cache(GrDirectContext* context)
+{
+  if (!context) {
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(sCachesMutex);
+
+  for (TileCache* cache : sCaches) {
+    std::lock_guard<std::mutex> cacheLock(cache->mGuard->mutex);
+    if (cache->mContext.get() == context) {
+      cache->releaseContext();
+    }
+  }
+}
+
+
+// Called with the mutex held.
+void TileCache::upload()
+{
+  if (mUploadQueue.empty() || !mContext || mContext->abandoned()) {
+    return;
+  }
+
+  TRACE_SCOPE("TileCache::upload");
+
+  // At least one tile per frame, even if it exceeds the budget.
+  size_t uploaded = 0;
+  size_t n = 0;
+  for (; n < mUploadQueue.size(); n++) {
+    auto iter = mEntries.find(mUploadQueue[n]);
+    if (iter == mEntries.end() || iter->second.state != State::Rendered) {
+      continue;
+    }
+
+    Entry& entry = iter->second;
+    size_t bytes = entry.image->imageInfo().computeMinByteSize();
+    if (uploaded > 0 && uploaded + bytes > mUploadBudget) {
+      break;
+    }
+
+    sk_sp<SkImage> texture = SkImages::TextureFromImage(mContext.get(), entry.image, skgpu::Mipmapped::kNo, skgpu::Budgeted::kYes);
+    if (!texture) {
+      mLRU.erase(entry.lruPos);
+      mEntries.erase(iter);
+      continue;
+    }
+
+    entry.image = std::move(texture);
+    entry.state = State::Ready;
+
+    uploaded += bytes;
+    mStats.uploads++;
+    mStats.residentBytes += bytes;
+  }
+
+  mUploadQueue.erase(mUploadQueue.begin(), mUploadQueue.begin() + n);
+}
+
+
+// Called with the mutex held.
+void TileCache::evict()
+{
+  // Least recently used tiles go first. Tiles drawn in this frame were moved to the front of the
+  // LRU list, so they are only evicted if the budget is smaller than the view.
+
+  auto iter = mLRU.end();
+  while (mStats.residentBytes > mCacheBudget && iter != mLRU.begin()) {
+    --iter;
+
+    auto entryIter = mEntries.find(*iter);
+    Entry& entry = entryIter->second;
+    if (entry.state != State::Ready) {
+      continue;
+    }
+
+    mStats.residentBytes -= entry.image->imageInfo().computeMinByteSize();
+    mStats.evictions++;
+
+    mEntries.erase(entryIter);
+    iter = mLRU.erase(iter);
+  }
+}
+
+
+// Called with the mutex held.
+bool TileCache::findFallback(const Key& key, TileDraw* tile)
+{
+  for (int level = key.level - 1; level >= kMinLevel; level--) {
+    int factor = 1 << (key.level - level);
+    Key parent{level, floor_div(key.x, factor), floor_div(key.y, factor)};
+
+    auto iter = mEntries.find(parent);
+    if (iter == mEntries.end() || iter->second.state != State::Ready) {
+      continue;
+    }
+
+    // the part of the coarser tile that covers this tile
+    float size = (float) kTileSize / factor;
+    tile->src = SkRect::MakeXYWH((key.x - parent.x * factor) * size, (key.y - parent.y * factor) * size, size, size);
+    tile->image = iter->second.image;
+
+    mLRU.splice(mLRU.begin(), mLRU, iter->second.lruPos);
+    return true;
+  }
+
+  return false;
+}
+
+
+sk_sp<SkImage> TileCache::render_tile(const SkPicture* document, const Key& key)
+{
+  TRACE_SCOPE("TileCache::render_tile");
+
+  sk_sp<SkSurface> surface = SkSurfaces::Raster(SkImageInfo::MakeN32Premul(kTileSize, kTileSize));
+  if (!surface) {
+    return nullptr;
+  }
+
+  float extent = tile_extent(key.level);
+  float scale = std::ldexp(1.0f, key.level);
+
+  SkCanvas* canvas = surface->getCanvas();
+  canvas->clear(SK_ColorWHITE);
+  canvas->scale(scale, scale);
+  canvas->translate(-key.x * extent, -key.y * extent);
+  canvas->drawPicture(document);
+
+  return surface->makeImageSnapshot();
+}
+
+
+TileCache::Stats TileCache::stats() const
+{
+  std::lock_guard<std::mutex> lock(mGuard->mutex);
+  return mStats;
+}
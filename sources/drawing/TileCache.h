@@ -0,0 +1,190 @@
+/*
+ * Copyright (C) 2025 by Dirk Farin, Kronenstr. 49b, 70174 Stuttgart, Germany
+ *
+ * 2-Clause BSD
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer
+ *    in the documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef TILECACHE_H
+#define TILECACHE_H
+
+#include <core/SkImage.h>
+#include <core/SkPicture.h>
+#include <core/SkPoint.h>
+#include <core/SkRefCnt.h>
+#include <core/SkRect.h>
+
+#include <deque>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+class GrDirectContext;
+class SkCanvas;
+
+
+// Tiled rendering of a large document (an SkPicture) for panning and zooming.
+//
+// The document is split into kTileSize x kTileSize pixel tiles per zoom level (powers of two).
+// Each tile is rasterized once on a worker thread and, for GPU contexts, uploaded as a texture
+// (at most 'upload budget' bytes per frame). Tiles are kept in an LRU cache with a memory
+// budget, so panning only recomposites cached tiles.
+//
+// Visible tiles that are missing are requested first; until they are ready, a tile of a
+// coarser level is drawn scaled up in their place. Tiles next to the view in the direction of
+// the last pan are prefetched with lower priority. Requests that are not visible or prefetched
+// any more are dropped in the next frame.
+
+class TileCache
+{
+public:
+  static const int kTileSize = 256;
+  static const int kMinLevel = -4; // 1/16
+  static const int kMaxLevel = 4;  // 16x
+
+  struct Stats
+  {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t fallbacks = 0;   // missing tiles drawn from a coarser level
+    uint64_t rendered = 0;
+    uint64_t prefetchRequests = 0;
+    uint64_t uploads = 0;
+    uint64_t evictions = 0;
+    size_t residentBytes = 0;
+  };
+
+  // 'context' is nullptr for raster rendering. The picture is played back on worker threads.
+  TileCache(GrDirectContext* context, sk_sp<SkPicture> document);
+
+  ~TileCache();
+
+  // Draws the document so that document point 'origin' is at the top-left of the
+  // viewWidth x viewHeight view, scaled by 'scale'. Never blocks on tile rendering.
+  void draw(SkCanvas*, SkPoint origin, float scale, int viewWidth, int viewHeight);
+
+  void setCacheBudget(size_t bytes) { mCacheBudget = bytes; }
+
+  void setUploadBudget(size_t bytesPerFrame) { mUploadBudget = bytesPerFrame; }
+
+  Stats stats() const;
+
+  // The GPU context has been released by release_tile_cache() or abandoned. The cache has no
+  // textures any more and cannot be used, drop it.
+  bool contextReleased() const;
+
+private:
+  struct Key
+  {
+    int level, x, y;
+
+    bool operator==(const Key& b) const { return level == b.level && x == b.x && y == b.y; }
+  };
+
+  struct KeyHash
+  {
+    size_t operator()(const Key& k) const
+    {
+      return (size_t(k.level + 16) * 0x9E3779B9u) ^ (size_t(uint32_t(k.x)) * 0x85EBCA6Bu) ^ (size_t(uint32_t(k.y)) * 0xC2B2AE35u);
+    }
+  };
+
+  enum class State
+  {
+    Queued,
+    Rendering,
+    Rendered, // raster image waiting for upload
+    Ready
+  };
+
+  struct Entry
+  {
+    State state = State::Queued;
+    sk_sp<SkImage> image;
+    std::list<Key>::iterator lruPos;
+  };
+
+  struct TileDraw
+  {
+    sk_sp<SkImage> image;
+    SkRect src;
+    SkRect dst;
+  };
+
+  // Referenced, so that its address cannot be reused by another context while the cache exists.
+  sk_sp<GrDirectContext> mContext;
+  sk_sp<SkPicture> mDocument;
+  SkRect mBounds;
+
+  // The mutex protects all members below. It is shared with the render tasks that are still
+  // in flight, together with a flag that is cleared when the cache is destroyed.
+  struct Guard
+  {
+    std::mutex mutex;
+    bool alive = true;
+  };
+
+  std::shared_ptr<Guard> mGuard;
+
+  std::unordered_map<Key, Entry, KeyHash> mEntries;
+  std::list<Key> mLRU; // most recently used at the front
+  std::deque<Key> mQueue; // requested tiles, visible ones first
+  std::vector<Key> mUploadQueue;
+  int mInFlight = 0;
+  int mMaxInFlight;
+
+  SkPoint mLastCenter{0, 0};
+  bool mHaveLastCenter = false;
+
+  std::vector<TileDraw> mDraws; // reused from frame to frame
+
+  size_t mUploadBudget = 4 * 1024 * 1024;
+  size_t mCacheBudget = 128 * 1024 * 1024;
+
+  Stats mStats;
+
+  bool mReleased = false;
+
+  static float tile_extent(int level); // in document units
+
+  void dropQueuedRequests();
+
+  void request(const Key&, bool prefetch);
+
+  void startRendering();
+
+  void renderFinished(const Key&, sk_sp<SkImage>);
+
+  void upload();
+
+  void evict();
+
+  bool findFallback(const Key&, TileDraw*);
+
+  void releaseContext();
+
+  friend void release_tile_cache(GrDirectContext*);
+
+  static sk_sp<SkImage> render_tile(const SkPicture*, const Key&);
+};
+
+// Drops the textures of all tile caches of a GPU context and their reference to it. Must be
+// called on the rendering thread before the context is released, like release_image_cache().
+// The owners of the caches drop them the next time they check contextReleased().
+void release_tile_cache(GrDirectContext*);
+
+#endif
@@ -0,0 +1,455 @@
+/*
+ * Copyright (C) 2025 by Dirk Farin, Kronenstr. 49b, 70174 Stuttgart, Germany
+ *
+ * 2-Clause BSD
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer
+ *    in the documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "UploadServiceVulkan.h"
+#include "profiling/FrameStats.h"
+#include "profiling/Tracing.h"
+#include "util/Log.h"
+
+#include <QVulkanDeviceFunctions>
+#include <QVulkanFunctions>
+#include <QVariant>
+
+#include <algorithm>
+#include <cstring>
+
+
+// Set on the window by request_transfer_queue(), once the device has been created with the queue.
+static const char* const kTransferFamilyProperty = "transferQueueFamily";
+
+
+static int find_transfer_only_family(const VkQueueFamilyProperties* families, uint32_t count)
+{
+  for (uint32_t i = 0; i < count; i++) {
+    VkQueueFlags flags = families[i].queueFlags;
+    if ((flags & VK_QUEUE_TRANSFER_BIT) && !(flags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT)) &&
+        families[i].queueCount > 0) {
+      return (int) i;
+    }
+  }
+
+  return -1;
+}
+
+
+void request_transfer_queue(QVulkanWindow* window)
+{
+#if QT_VERSION >= QT_VERSION_CHECK(5, 15, 0)
+  window->setQueueCreateInfoModifier([window](const VkQueueFamilyProperties* families, uint32_t count,
+                                              QVector<VkDeviceQueueCreateInfo>& infos) {
+    static const float priority = 0.5f;
+
+    int family = find_transfer_only_family(families, count);
+    if (family < 0) {
+      return;
+    }
+
+    VkDeviceQueueCreateInfo info{};
+    info.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+    info.queueFamilyIndex = family;
+    info.queueCount = 1;
+    info.pQueuePriorities = &priority;
+    infos.append(info);
+
+    window->setProperty(kTransferFamilyProperty, family);
+  });
+#else
+  Q_UNUSED(window);
+#endif
+}
+
+
+bool UploadServiceVulkan::init(QVulkanWindow* window)
+{
+  mWindow = window;
+  mDevFuncs = window->vulkanInstance()->deviceFunctions(window->device());
+  VkDevice dev = window->device();
+
+  QVariant transferFamily = window->property(kTransferFamilyProperty);
+  if (transferFamily.isValid()) {
+    mQueueFamily = transferFamily.toUInt();
+    mDevFuncs->vkGetDeviceQueue(dev, mQueueFamily, 0, &mQueue);
+  }
+  else {
+    mQueueFamily = window->graphicsQueueFamilyIndex();
+    mQueue = window->graphicsQueue();
+  }
+
+  VkCommandPoolCreateInfo poolInfo{};
+  poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+  poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT | VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+  poolInfo.queueFamilyIndex = mQueueFamily;
+
+  if (mDevFuncs->vkCreateCommandPool(dev, &poolInfo, nullptr, &mCommandPool) != VK_SUCCESS)
+    qFatal("Failed to create command pool");
+
+  for (StagingBuffer& s : mStaging) {
+    VkBufferCreateInfo bufInfo{};
+    bufInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufInfo.size = kStagingBufferSize;
+    bufInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+
+    if (mDevFuncs->vkCreateBuffer(dev, &bufInfo, nullptr, &s.buffer) != VK_SUCCESS)
+      qFatal("Failed to create staging buffer");
+
+    VkMemoryRequirements memReq;
+    mDevFuncs->vkGetBufferMemoryRequirements(dev, s.buffer, &memReq);
+
+    VkMemoryAllocateInfo memAllocInfo{};
+    memAllocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    memAllocInfo.allocationSize = memReq.size;
+    memAllocInfo.memoryTypeIndex = window->hostVisibleMemoryIndex(); // coherent, no flushes needed
+
+    if (mDevFuncs->vkAllocateMemory(dev, &memAllocInfo, nullptr, &s.memory) != VK_SUCCESS) {
+      LOG_WARNING("Failed to allocate staging memory");
+      release();
+      return false;
+    }
+
+    mDevFuncs->vkBindBufferMemory(dev, s.buffer, s.memory, 0);
+    mDevFuncs->vkMapMemory(dev, s.memory, 0, kStagingBufferSize, 0, reinterpret_cast<void**>(&s.mapped));
+
+    VkCommandBufferAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.commandPool = mCommandPool;
+    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocInfo.commandBufferCount = 1;
+
+    if (mDevFuncs->vkAllocateCommandBuffers(dev, &allocInfo, &s.cb) != VK_SUCCESS)
+      qFatal("Failed to allocate command buffer");
+
+    VkFenceCreateInfo fenceInfo{};
+    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+    mDevFuncs->vkCreateFence(dev, &fenceInfo, nullptr, &s.fence);
+  }
+
+  LOG_INFO("uploads on the %s queue (family %u), %d x %d MB staging", hasDedicatedQueue() ? "transfer" : "graphics",
+           mQueueFamily, kStagingBuffers, (int) (kStagingBufferSize >> 20));
+
+  return true;
+}
+
+
+void UploadServiceVulkan::release()
+{
+  if (!mWindow) {
+    return;
+  }
+
+  VkDevice dev = mWindow->device();
+
+  for (StagingBuffer& s : mStaging) {
+    if (s.inFlight) {
+      mDevFuncs->vkWaitForFences(dev, 1, &s.fence, VK_TRUE, UINT64_MAX);
+    }
+
+    if (s.fence) mDevFuncs->vkDestroyFence(dev, s.fence, nullptr);
+    if (s.buffer) mDevFuncs->vkDestroyBuffer(dev, s.buffer, nullptr);
+    if (s.memory) mDevFuncs->vkFreeMemory(dev, s.memory, nullptr); // also unmaps
+
+    s = StagingBuffer{};
+  }
+
+  if (mCommandPool) {
+    mDevFuncs->vkDestroyCommandPool(dev, mCommandPool, nullptr);
+    mCommandPool = VK_NULL_HANDLE;
+  }
+
+  mQueued.clear();
+  mNextSubmit = mNextRetire = 0;
+  mWindow = nullptr;
+}
+
+
+bool UploadServiceVulkan::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkBuffer* buffer, VkDeviceMemory* memory)
+{
+  VkDevice dev = mWindow->device();
+
+  const uint32_t families[2] = { mWindow->graphicsQueueFamilyIndex(), mQueueFamily };
+
+  VkBufferCreateInfo bufInfo{};
+  bufInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+  bufInfo.size = size;
+  bufInfo.usage = usage | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+
+  if (hasDedicatedQueue()) {
+    bufInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+    bufInfo.queueFamilyIndexCount = 2;
+    bufInfo.pQueueFamilyIndices = families;
+  }
+
+  if (mDevFuncs->vkCreateBuffer(dev, &bufInfo, nullptr, buffer) != VK_SUCCESS) {
+    return false;
+  }
+
+  VkMemoryRequirements memReq;
+  mDevFuncs->vkGetBufferMemoryRequirements(dev, *buffer, &memReq);
+
+  VkMemoryAllocateInfo memAllocInfo{};
+  memAllocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+  memAllocInfo.allocationSize = memReq.size;
+  memAllocInfo.memoryTypeIndex = mWindow->deviceLocalMemoryIndex();
+
+  if (mDevFuncs->vkAllocateMemory(dev, &memAllocInfo, nullptr, memory) != VK_SUCCESS) {
+    mDevFuncs->vkDestroyBuffer(dev, *buffer, nullptr);
+    *buffer = VK_NULL_HANDLE;
+    return false;
+  }
+
+  mDevFuncs->vkBindBufferMemory(dev, *buffer, *memory, 0);
+  return true;
+}
+
+
+bool UploadServiceVulkan::createImage(uint32_t width, uint32_t height, VkFormat format, VkImage* image, VkDeviceMemory* memory)
+{
+  VkDevice dev = mWindow->device();
+
+  const uint32_t families[2] = { mWindow->graphicsQueueFamilyIndex(), mQueueFamily };
+
+  VkImageCreateInfo imageInfo{};
+  imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+  imageInfo.imageType = VK_IMAGE_TYPE_2D;
+  imageInfo.format = format;
+  imageInfo.extent = { width, height, 1 };
+  imageInfo.mipLevels = 1;
+  imageInfo.arrayLayers = 1;
+  imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+  imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+  imageInfo.usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+  imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+  if (hasDedicatedQueue()) {
+    imageInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+    imageInfo.queueFamilyIndexCount = 2;
+    imageInfo.pQueueFamilyIndices = families;
+  }
+
+  if (mDevFuncs->vkCreateImage(dev, &imageInfo, nullptr, image) != VK_SUCCESS) {
+    return false;
+  }
+
+  VkMemoryRequirements memReq;
+  mDevFuncs->vkGetImageMemoryRequirements(dev, *image, &memReq);
+
+  VkMemoryAllocateInfo memAllocInfo{};
+  memAllocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+  memAllocInfo.allocationSize = memReq.size;
+  memAllocInfo.memoryTypeIndex = mWindow->deviceLocalMemoryIndex();
+
+  if (mDevFuncs->vkAllocateMemory(dev, &memAllocInfo, nullptr, memory) != VK_SUCCESS) {
+    mDevFuncs->vkDestroyImage(dev, *image, nullptr);
+    *image = VK_NULL_HANDLE;
+    return false;
+  }
+
+  mDevFuncs->vkBindImageMemory(dev, *image, *memory, 0);
+  return true;
+}
+
+
+UploadServiceVulkan::Ticket UploadServiceVulkan::enqueue(VkBuffer dst, VkDeviceSize dstOffset, const void* data, size_t size)
+{
+  Copy copy;
+  copy.dst = dst;
+  copy.dstOffset = dstOffset;
+  copy.data = static_cast<const uint8_t*>(data);
+  copy.size = size;
+  copy.ticket = mNextTicket++;
+
+  mQueued.push_back(copy);
+
+  return copy.ticket;
+}
+
+
+UploadServiceVulkan::Ticket UploadServiceVulkan::enqueueImage(VkImage dst, uint32_t width, uint32_t height, const void* data)
+{
+  size_t size = size_t(width) * height * 4;
+  if (size > kStagingBufferSize) {
+    return 0;
+  }
+
+  Copy copy;
+  copy.dst = VK_NULL_HANDLE;
+  copy.dstOffset = 0;
+  copy.image = dst;
+  copy.width = width;
+  copy.height = height;
+  copy.data = static_cast<const uint8_t*>(data);
+  copy.size = size;
+  copy.ticket = mNextTicket++;
+
+  mQueued.push_back(copy);
+
+  return copy.ticket;
+}
+
+
+void UploadServiceVulkan::pump()
+{
+  TRACE_SCOPE("UploadServiceVulkan::pump");
+
+  if (!mWindow) {
+    return; // init() failed
+  }
+
+  retire();
+
+  // One staging buffer per frame keeps the memcpy on the render thread short.
+  if (!mQueued.empty() && !mStaging[mNextSubmit].inFlight) {
+    submitNext();
+  }
+}
+
+
+void UploadServiceVulkan::retire()
+{
+  VkDevice dev = mWindow->device();
+
+  while (mStaging[mNextRetire].inFlight) {
+    StagingBuffer& s = mStaging[mNextRetire];
+
+    if (mDevFuncs->vkGetFenceStatus(dev, s.fence) != VK_SUCCESS) {
+      break;
+    }
+
+    mDevFuncs->vkResetFences(dev, 1, &s.fence);
+    s.inFlight = false;
+
+    frame_stats().addUpload(s.bytes);
+
+    if (s.completes) {
+      mCompleted = s.completes;
+      mNewCompletions = true;
+    }
+
+    mNextRetire = (mNextRetire + 1) % kStagingBuffers;
+  }
+}
+
+
+void UploadServiceVulkan::submitNext()
+{
+  StagingBuffer& s = mStaging[mNextSubmit];
+
+  mDevFuncs->vkResetCommandBuffer(s.cb, 0);
+
+  VkCommandBufferBeginInfo beginInfo{};
+  beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+  beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+  mDevFuncs->vkBeginCommandBuffer(s.cb, &beginInfo);
+
+  s.bytes = 0;
+  s.completes = 0;
+
+  while (!mQueued.empty() && s.bytes < kStagingBufferSize) {
+    Copy& copy = mQueued.front();
+
+    if (copy.image) {
+      // copy offsets must be multiples of the texel size
+      VkDeviceSize offset = (s.bytes + 15) & ~VkDeviceSize(15);
+      if (offset + copy.size > kStagingBufferSize) {
+        break; // next staging buffer
+      }
+
+      s.bytes = offset;
+      memcpy(s.mapped + s.bytes, copy.data, copy.size);
+      recordImageCopy(s, copy);
+
+      s.bytes += copy.size;
+      s.completes = copy.ticket;
+      mQueued.pop_front();
+      continue;
+    }
+
+    size_t n = std::min<size_t>(copy.size - copy.done, kStagingBufferSize - s.bytes);
+    memcpy(s.mapped + s.bytes, copy.data + copy.done, n);
+
+    if (n > 0) {
+      VkBufferCopy region{ s.bytes, copy.dstOffset + copy.done, n };
+      mDevFuncs->vkCmdCopyBuffer(s.cb, s.buffer, copy.dst, 1, &region);
+    }
+
+    s.bytes += n;
+    copy.done += n;
+
+    if (copy.done == copy.size) {
+      s.completes = copy.ticket;
+      mQueued.pop_front();
+    }
+  }
+
+  mDevFuncs->vkEndCommandBuffer(s.cb);
+
+  VkSubmitInfo submitInfo{};
+  submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+  submitInfo.commandBufferCount = 1;
+  submitInfo.pCommandBuffers = &s.cb;
+
+  VkResult err = mDevFuncs->vkQueueSubmit(mQueue, 1, &submitInfo, s.fence);
+  if (err != VK_SUCCESS)
+    qFatal("Failed to submit upload: %d", err);
+
+  s.inFlight = true;
+  mNextSubmit = (mNextSubmit + 1) % kStagingBuffers;
+}
+
+
+void UploadServiceVulkan::recordImageCopy(StagingBuffer& s, const Copy& copy)
+{
+  VkImageMemoryBarrier barrier{};
+  barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+  barrier.srcAccessMask = 0;
+  barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+  barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+  barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.image = copy.image;
+  barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+
+  mDevFuncs->vkCmdPipelineBarrier(s.cb, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+                                  0, nullptr, 0, nullptr, 1, &barrier);
+
+  VkBufferImageCopy region{};
+  region.bufferOffset = s.bytes;
+  region.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+  region.imageExtent = { copy.width, copy.height, 1 };
+
+  mDevFuncs->vkCmdCopyBufferToImage(s.cb, s.buffer, copy.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+
+  // The shader stages may not be supported by the transfer queue. The renderer's barrier after
+  // the fence makes the data visible to them.
+  barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  barrier.dstAccessMask = 0;
+  barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+  barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+  mDevFuncs->vkCmdPipelineBarrier(s.cb, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0,
+                                  0, nullptr, 0, nullptr, 1, &barrier);
+}
+
+
+bool UploadServiceVulkan::takeCompletions()
+{
+  bool result = mNewCompletions;
+  mNewCompletions = false;
+  return result;
+}
@@ -0,0 +1,137 @@
+/*
+ * Copyright (C) 2025 by Dirk Farin, Kronenstr. 49b, 70174 Stuttgart, Germany
+ *
+ * 2-Clause BSD
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer
+ *    in the documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef UPLOADSERVICEVULKAN_H
+#define UPLOADSERVICEVULKAN_H
+
+#include <QVulkanWindow>
+
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+
+// Streams data into device-local buffers and images while rendering continues.
+//
+// Copies are queued with enqueue() and processed by pump(), once per frame on the render thread:
+// queued data is copied into the next free buffer of a ring of persistently mapped staging
+// buffers (at most one staging buffer per frame), and the buffer is submitted with its copy
+// commands. Finished submissions are detected with their fences, without waiting.
+//
+// The copies run on a dedicated transfer queue if the device has a transfer-only queue family
+// and request_transfer_queue() was called before the device was created (needs Qt 5.15).
+// Otherwise they are submitted to the graphics queue. Destination buffers are created with
+// concurrent sharing between both queue families, so no ownership transfer is needed.
+// Images are left in SHADER_READ_ONLY_OPTIMAL layout by the upload.
+//
+// QVulkanWindow submits the frames itself, so the graphics work cannot wait on a semaphore of
+// the transfer queue. A buffer is only used after pump() has seen the fence of its last copy;
+// the renderer then adds a memory barrier to its next frame (see takeCompletions()).
+
+class UploadServiceVulkan
+{
+public:
+  using Ticket = uint64_t;
+
+  static constexpr VkDeviceSize kStagingBufferSize = 8 * 1024 * 1024;
+  static constexpr int kStagingBuffers = 3;
+
+  bool init(QVulkanWindow*);
+
+  // Waits for the submitted copies. Queued copies are dropped.
+  void release();
+
+  bool hasDedicatedQueue() const { return mQueueFamily != mWindow->graphicsQueueFamilyIndex(); }
+
+  // Device-local buffer that can be written by the service and used by the graphics queue.
+  bool createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkBuffer*, VkDeviceMemory*);
+
+  // Device-local 2D image (one mip level) that can be written by the service and sampled by the graphics queue.
+  bool createImage(uint32_t width, uint32_t height, VkFormat, VkImage*, VkDeviceMemory*);
+
+  // Queues a copy. 'data' must stay valid until the ticket is complete.
+  Ticket enqueue(VkBuffer dst, VkDeviceSize dstOffset, const void* data, size_t size);
+
+  // Same for the whole image, with tightly packed rows of 4-byte texels. Images are not split
+  // between staging buffers, so they are limited to kStagingBufferSize. Returns 0 if larger.
+  Ticket enqueueImage(VkImage dst, uint32_t width, uint32_t height, const void* data);
+
+  void pump();
+
+  bool isComplete(Ticket ticket) const { return ticket <= mCompleted; }
+
+  // Returns true (once) if copies have finished since the last call.
+  bool takeCompletions();
+
+private:
+  QVulkanWindow* mWindow = nullptr;
+  QVulkanDeviceFunctions* mDevFuncs = nullptr;
+
+  uint32_t mQueueFamily = 0;
+  VkQueue mQueue = VK_NULL_HANDLE;
+  VkCommandPool mCommandPool = VK_NULL_HANDLE;
+
+  struct StagingBuffer
+  {
+    VkBuffer buffer = VK_NULL_HANDLE;
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    uint8_t* mapped = nullptr;
+    VkCommandBuffer cb = VK_NULL_HANDLE;
+    VkFence fence = VK_NULL_HANDLE;
+
+    bool inFlight = false;
+    size_t bytes = 0;
+    Ticket completes = 0; // highest ticket whose last copy is in this submission
+  };
+
+  StagingBuffer mStaging[kStagingBuffers];
+  int mNextSubmit = 0;  // ring position of the next staging buffer to fill
+  int mNextRetire = 0;  // oldest submission (completed in submission order)
+
+  struct Copy
+  {
+    VkBuffer dst;
+    VkDeviceSize dstOffset;
+    VkImage image = VK_NULL_HANDLE; // instead of 'dst'
+    uint32_t width = 0;
+    uint32_t height = 0;
+    const uint8_t* data;
+    size_t size;
+    size_t done = 0; // bytes copied to staging
+    Ticket ticket;
+  };
+
+  std::deque<Copy> mQueued;
+  Ticket mNextTicket = 1;
+  Ticket mCompleted = 0;
+  bool mNewCompletions = false;
+
+  void retire();
+
+  void submitNext();
+
+  void recordImageCopy(StagingBuffer&, const Copy&);
+};
+
+
+// Adds a queue of a transfer-only family (if there is one) to the device of the window.
+// Must be called before the window is shown.
+void request_transfer_queue(QVulkanWindow*);
+
+#endif
@@ -0,0 +1,155 @@
+/*
+ * Copyright (C) 2025 by Dirk Farin, Kronenstr. 49b, 70174 Stuttgart, Germany
+ *
+ * 2-Clause BSD
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer
+ *    in the documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "VulkanAssets.h"
+#include "MeshFile.h"
+#include "util/Log.h"
+#include "util/MappedFile.h"
+
+#include <QVulkanDeviceFunctions>
+#include <QResource>
+#include <QFile>
+
+#include <chrono>
+#include <cstring>
+#include <vector>
+
+
+static double ms_since(std::chrono::steady_clock::time_point start)
+{
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+
+static void log_load_time(const char* what, const QString& name, size_t bytes, double ms)
+{
+  double mb = bytes / (1024.0 * 1024.0);
+  LOG_DEBUG("%s %s: %.3f MB in %.2f ms (%.2f ms/MB)", what, qPrintable(name), mb, ms, mb > 0 ? ms / mb : 0.0);
+}
+
+
+VkShaderModule load_shader_module(QVulkanWindow* window, const QString& name)
+{
+  auto start = std::chrono::steady_clock::now();
+
+  const uint8_t* code = nullptr;
+  size_t size = 0;
+
+  MappedFile file;
+  QResource resource;
+  std::vector<uint32_t> copy; // only if the data cannot be used in place
+
+  if (name.startsWith(QLatin1Char(':'))) {
+    resource.setFileName(name);
+
+#if QT_VERSION >= QT_VERSION_CHECK(5, 13, 0)
+    bool compressed = resource.compressionAlgorithm() != QResource::NoCompression;
+#else
+    bool compressed = resource.isCompressed();
+#endif
+
+    if (resource.isValid() && !compressed) {
+      code = resource.data();
+      size = (size_t) resource.size();
+    }
+    else if (resource.isValid()) {
+      // rcc is run with --no-compress, but the resource might come from elsewhere
+      QFile qfile(name);
+      if (qfile.open(QIODevice::ReadOnly)) {
+        QByteArray blob = qfile.readAll();
+        copy.resize((blob.size() + 3) / 4);
+        memcpy(copy.data(), blob.constData(), blob.size());
+        code = reinterpret_cast<const uint8_t*>(copy.data());
+        size = blob.size();
+      }
+    }
+  }
+  else if (file.open(name.toStdString())) {
+    code = file.data();
+    size = file.size();
+  }
+
+  if (!code) {
+    LOG_WARNING("Failed to read shader %s", qPrintable(name));
+    return VK_NULL_HANDLE;
+  }
+
+  // pCode has to be 4-byte aligned. Mapped files are, resource data usually is.
+  if (reinterpret_cast<uintptr_t>(code) % 4 != 0) {
+    copy.resize((size + 3) / 4);
+    memcpy(copy.data(), code, size);
+    code = reinterpret_cast<const uint8_t*>(copy.data());
+  }
+
+  VkShaderModuleCreateInfo shaderInfo{};
+  shaderInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+  shaderInfo.codeSize = size;
+  shaderInfo.pCode = reinterpret_cast<const uint32_t*>(code);
+
+  QVulkanDeviceFunctions* devFuncs = window->vulkanInstance()->deviceFunctions(window->device());
+
+  VkShaderModule shaderModule;
+  VkResult err = devFuncs->vkCreateShaderModule(window->device(), &shaderInfo, nullptr, &shaderModule);
+  if (err != VK_SUCCESS) {
+    LOG_WARNING("Failed to create shader module: %d", err);
+    return VK_NULL_HANDLE;
+  }
+
+  log_load_time("shader", name, size, ms_since(start));
+
+  return shaderModule;
+}
+
+
+void MeshBufferVulkan::release(QVulkanWindow* window)
+{
+  QVulkanDeviceFunctions* devFuncs = window->vulkanInstance()->deviceFunctions(window->device());
+
+  if (buffer) {
+    devFuncs->vkDestroyBuffer(window->device(), buffer, nullptr);
+    buffer = VK_NULL_HANDLE;
+  }
+
+  if (memory) {
+    devFuncs->vkFreeMemory(window->device(), memory, nullptr);
+    memory = VK_NULL_HANDLE;
+  }
+
+  indexCount = 0;
+}
+
+
+UploadServiceVulkan::Ticket stream_mesh(UploadServiceVulkan& uploads, const MeshFile& mesh, MeshBufferVulkan* out)
+{
+  const MeshFileHeader& h = mesh.header();
+
+  out->indexOffset = (mesh.vertexBytes() + 15) & ~VkDeviceSize(15); // multiple of the index size
+  out->indexType = h.indexSize == 2 ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+  out->indexCount = h.indexCount;
+
+  if (!uploads.createBuffer(out->indexOffset + mesh.indexBytes(),
+                            VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+                            &out->buffer, &out->memory)) {
+    return 0;
+  }
+
+  // The blocks go from the mapping straight into the staging buffers.
+  uploads.enqueue(out->buffer, 0, mesh.vertexData(), mesh.vertexBytes());
+  return uploads.enqueue(out->buffer, out->indexOffset, mesh.indexData(), mesh.indexBytes());
+}
@@ -0,0 +1,53 @@
+/*
+ * Copyright (C) 2025 by Dirk Farin, Kronenstr. 49b, 70174 Stuttgart, Germany
+ *
+ * 2-Clause BSD
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer
+ *    in the documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef VULKANASSETS_H
+#define VULKANASSETS_H
+
+#include "UploadServiceVulkan.h"
+
+#include <QVulkanWindow>
+#include <QString>
+
+class MeshFile;
+
+
+// Creates a shader module from SPIR-V in a Qt resource (":/name") or in a file, without reading
+// it into an intermediate buffer: uncompressed resources are used in place, files are mapped.
+// Returns VK_NULL_HANDLE on failure.
+VkShaderModule load_shader_module(QVulkanWindow*, const QString& name);
+
+
+// Vertex and index data of a mesh in one device-local buffer.
+struct MeshBufferVulkan
+{
+  VkBuffer buffer = VK_NULL_HANDLE;
+  VkDeviceMemory memory = VK_NULL_HANDLE;
+  VkDeviceSize indexOffset = 0;
+  VkIndexType indexType = VK_INDEX_TYPE_UINT16;
+  uint32_t indexCount = 0;
+
+  void release(QVulkanWindow*);
+};
+
+// Creates the mesh buffer and queues the upload of the blocks of the mapped mesh file. The file
+// must stay open until the returned ticket is complete. Returns 0 on failure.
+UploadServiceVulkan::Ticket stream_mesh(UploadServiceVulkan&, const MeshFile&, MeshBufferVulkan*);
+
+#endif
@@ -18,31 +18,396 @@
 
 
 #include "main/MainWindow.h"
+#include "main/BackendProbe.h"
+#include "main/RendererComparison.h"
 #include "core-config.h"
 #include "SkiaFontManager.h"
+#include "drawing/Drawing.h"
+#include "drawing/Scenes.h"
+#include "drawing/TextMode.h"
+#include "drawing/PresentConfig.h"
+#include "drawing/Hud.h"
+#include "drawing/LayerCache.h"
+#include "drawing/ShaderCache.h"
+#include "drawing/DrawingWindow_Skia_Vulkan.h"
+#include "drawing/NonSkiaVulkanRenderer.h"
+#ifdef IM_HAVE_FRAME_EXPORT
+#include "drawing/FrameExport.h"
+#endif
+#include "profiling/Tracing.h"
+#include "profiling/AllocTracker.h"
+#include "profiling/TextBenchmark.h"
+#include "profiling/FrameCapture.h"
+#include "profiling/StartupProfile.h"
+#include "util/Log.h"
 
 #include <QCoreApplication>
 #include <QApplication>
+#include <QCommandLineParser>
+#include <QStandardPaths>
+#include <QSurfaceFormat>
+
+#include <core/SkCanvas.h>
+#include <core/SkSurface.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+
+
+// Renders the active scene (--scene, the stock "default" scene unless given) into a raster
+// surface twice over the same range of frames.
+// In the second pass, all surfaces, typefaces and glyphs exist already, so a frame must not
+// perform any heap allocation.
+static int check_zero_alloc_steady_state()
+{
+  if (!alloc_tracking_available()) {
+    fprintf(stderr, "allocation tracking is not available, configure with -DIM_ENABLE_ALLOC_TRACKING=ON\n");
+    return 1;
+  }
+
+  const int w = 640, h = 480;
+  const int nFrames = 90;
+
+  sk_sp<SkSurface> surface = SkSurfaces::Raster(SkImageInfo::MakeN32Premul(w, h));
+  SkCanvas* canvas = surface->getCanvas();
+
+  for (int frame = 0; frame < nFrames; frame++) {
+    draw_skia_scene_frame(canvas, w, h, frame);
+  }
+
+  // Only this thread is measured: threads of the background pool (e.g. shader cache writes)
+  // may allocate at any time.
+  int slot = alloc_thread_slot();
+
+  int nFailed = 0;
+  for (int frame = 0; frame < nFrames; frame++) {
+    AllocCounts before = alloc_counts_thread(slot);
+    draw_skia_scene_frame(canvas, w, h, frame);
+    AllocCounts delta = alloc_counts_thread(slot) - before;
+
+    if (delta.allocations) {
+      printf("frame %d: %llu allocations, %llu bytes\n", frame,
+             (unsigned long long) delta.allocations, (unsigned long long) delta.bytes);
+      nFailed++;
+    }
+  }
+
+  if (nFailed) {
+    printf("FAILED: %d of %d steady-state frames allocated\n", nFailed, nFrames);
+    return 1;
+  }
+
+  printf("PASSED: %d steady-state frames without heap allocation\n", nFrames);
+  return 0;
+}
 
 
 int main(int argc, char** argv)
 {
+  // The tracer has to be in place before Skia creates any objects.
+  install_skia_event_tracer();
+  set_trace_thread_name("main");
+  set_alloc_thread_name("main");
+  set_log_thread_name("main");
+
+  // --- initialize FontProvider
+  //     The font directory is indexed in the background while Qt, the window and the GPU context are set up.
+
+  start_loading_fonts_from_directory(config_fonts_dir());
+
+  StartupPhase appPhase("qt application");
   QApplication app(argc, argv);
+  appPhase.end();
 
+  QCommandLineParser parser;
+  parser.addHelpOption();
 
-  // --- initialize FontProvider
+  QCommandLineOption traceOption("trace",
+                                 "Record a Chrome/Perfetto trace from startup on and write it to <file>. "
+                                 "Tracing can also be toggled at runtime with F12.",
+                                 "file");
+  parser.addOption(traceOption);
+
+  QCommandLineOption checkZeroAllocOption("check-zero-alloc",
+                                          "Check that steady-state frames of the scene selected with --scene do not allocate, then exit.");
+  parser.addOption(checkZeroAllocOption);
+
+  QStringList sceneNames;
+  for (const auto& name : scene_names()) {
+    sceneNames << QString::fromStdString(name);
+  }
+
+  QCommandLineOption sceneOption("scene",
+                                 "Scene to draw, as name[:count[:seed]]. Available scenes: " + sceneNames.join(", "),
+                                 "spec", "default");
+  parser.addOption(sceneOption);
+
+  QCommandLineOption imageDirOption("image-dir",
+                                    "Directory with the images for the 'thumbnails' scene. Without it, generated images are used.",
+                                    "dir");
+  parser.addOption(imageDirOption);
+
+  QCommandLineOption textModeOption("text-mode",
+                                    "Rendering of text with animated sizes: default, distance-field or quantized.",
+                                    "mode", "default");
+  parser.addOption(textModeOption);
+
+  QCommandLineOption textBenchmarkOption("text-benchmark",
+                                         "Measure glyph uploads during a zoom animation in all text modes (OpenGL, offscreen), then exit.");
+  parser.addOption(textBenchmarkOption);
+
+  QCommandLineOption compareVulkanOption("compare-vulkan-renderers",
+                                         "Run the native, Skia and combined Vulkan renderers for <s> seconds each and "
+                                         "print their CPU and GPU frame times, then exit.",
+                                         "s");
+  parser.addOption(compareVulkanOption);
+
+  QCommandLineOption backendOption("backend", "Rendering backend: opengl, software, vulkan, vulkan-noskia, vulkan-combined or auto "
+                                   "(the fastest of software, opengl and vulkan on this machine, measured once).",
+                                   "backend", "opengl");
+  parser.addOption(backendOption);
+
+  QCommandLineOption reprobeBackendOption("reprobe-backend", "With --backend auto: measure again instead of using the stored decision.");
+  parser.addOption(reprobeBackendOption);
+
+  QCommandLineOption presentModeOption("present-mode", "Presentation mode: fifo, mailbox or immediate.",
+                                       "mode", "fifo");
+  parser.addOption(presentModeOption);
+
+  QCommandLineOption framesInFlightOption("frames-in-flight", "Number of frames the GPU may lag behind (Vulkan, 1 or 2).",
+                                          "n", "2");
+  parser.addOption(framesInFlightOption);
+
+  QCommandLineOption swapIntervalOption("swap-interval", "Swap interval (OpenGL).", "n", "1");
+  parser.addOption(swapIntervalOption);
+
+  QCommandLineOption latencyTestOption("latency-test",
+                                       "Measure input-to-present latency with synthetic input events, then exit.");
+  parser.addOption(latencyTestOption);
+
+  QCommandLineOption hudOption("hud", "Show frame statistics on top of the scene. Can also be toggled at runtime with F11.");
+  parser.addOption(hudOption);
+
+  QCommandLineOption noLayerCacheOption("no-layer-cache",
+                                        "Draw cached layers (e.g. the background of the 'layers' scene) directly in every frame.");
+  parser.addOption(noLayerCacheOption);
+
+  QCommandLineOption captureFramesOption("capture-frames",
+                                         "Write these frames (comma-separated frame numbers) as .skp files for "
+                                         "qtskia-skp-replay. F10 captures the next frame.",
+                                         "frames");
+  parser.addOption(captureFramesOption);
+
+  QCommandLineOption captureSlowOption("capture-slow",
+                                       "Record every frame and write those that take longer than <ms> to draw (at most 10). "
+                                       "Recording slows down every frame until then.",
+                                       "ms");
+  parser.addOption(captureSlowOption);
+
+  QCommandLineOption captureDirOption("capture-dir", "Directory for captured frames.", "dir", ".");
+  parser.addOption(captureDirOption);
+
+  QCommandLineOption shaderCacheDirOption("shader-cache-dir",
+                                          "Directory for compiled shaders and pipeline caches. Empty to disable.",
+                                          "dir", QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/shaders");
+  parser.addOption(shaderCacheDirOption);
+
+  QCommandLineOption vulkanValidationOption("vulkan-validation",
+                                            "Enable the Vulkan validation layer (always enabled in debug builds). "
+                                            "Loading it takes a large part of the startup time.");
+  parser.addOption(vulkanValidationOption);
 
-  set_global_skia_font_manager_from_fonts_directory(config_fonts_dir());
+  QCommandLineOption vulkanInstancesOption("vulkan-instances",
+                                           "Number of triangles drawn by the native Vulkan renderers (stress test).",
+                                           "n", "1");
+  parser.addOption(vulkanInstancesOption);
+
+  QCommandLineOption vulkanRecordThreadsOption("vulkan-record-threads",
+                                               "Record the draw calls of the native Vulkan renderer into secondary command "
+                                               "buffers on <n> threads (0: one per core, 1: record inline).",
+                                               "n", "1");
+  parser.addOption(vulkanRecordThreadsOption);
+
+  QCommandLineOption vulkanGpuCullingOption("vulkan-gpu-culling",
+                                            "Cull the instances of the native Vulkan renderer in a compute shader and draw "
+                                            "them with indirect draws. The instances are spread over three view widths.");
+  parser.addOption(vulkanGpuCullingOption);
+
+  QCommandLineOption meshOption("mesh",
+                                "Draw this .qmesh file (see qtskia-meshgen) instead of the triangle in the native Vulkan renderers.",
+                                "file");
+  parser.addOption(meshOption);
+
+  QCommandLineOption vulkanTexturesOption("vulkan-textures",
+                                          "Draw the instances of the native Vulkan renderer with <n> different textures, "
+                                          "indexed from one descriptor set.",
+                                          "n", "0");
+  parser.addOption(vulkanTexturesOption);
+
+  QCommandLineOption quitAfterFirstFrameOption("quit-after-first-frame",
+                                               "Quit when the first frame has been presented (for measuring the startup time).");
+  parser.addOption(quitAfterFirstFrameOption);
+
+  QCommandLineOption logLevelOption("log-level",
+                                    "Lowest level of log messages shown: trace, debug, info, warning or error. "
+                                    "Levels below IM_LOG_LEVEL are not compiled in.",
+                                    "level", "info");
+  parser.addOption(logLevelOption);
+
+#ifdef IM_HAVE_FRAME_EXPORT
+  QCommandLineOption exportSocketOption("export-socket",
+                                        "Export the rendered frames through shared memory to a consumer connecting to the Unix socket <path> "
+                                        "(software and opengl backends, see qtskia-frame-consumer).",
+                                        "path");
+  parser.addOption(exportSocketOption);
+#endif
+
+  parser.process(app);
+
+  if (parser.isSet(traceOption)) {
+    set_trace_file(parser.value(traceOption).toStdString());
+    set_tracing_enabled(true);
+  }
+
+
+  LogLevel logLevel;
+  if (!parse_log_level(parser.value(logLevelOption).toStdString(), &logLevel)) {
+    fprintf(stderr, "unknown log level: %s\n", qPrintable(parser.value(logLevelOption)));
+    return 1;
+  }
+
+  set_log_level(logLevel);
+
+  // Read in the background, overlapping with window, device and swapchain creation.
+  shader_cache().setDirectory(parser.value(shaderCacheDirOption).toStdString());
+
+  if (parser.isSet(vulkanValidationOption)) {
+    set_vulkan_validation_enabled(true);
+  }
+
+  NativeVulkanConfig nativeVulkanConfig;
+  nativeVulkanConfig.instances = std::max(1, parser.value(vulkanInstancesOption).toInt());
+  nativeVulkanConfig.recordThreads = std::max(0, parser.value(vulkanRecordThreadsOption).toInt());
+  nativeVulkanConfig.gpuCulling = parser.isSet(vulkanGpuCullingOption);
+  nativeVulkanConfig.meshFile = parser.value(meshOption).toStdString();
+  nativeVulkanConfig.textures = std::max(0, parser.value(vulkanTexturesOption).toInt());
+  set_native_vulkan_config(nativeVulkanConfig);
+
+  if (parser.isSet(quitAfterFirstFrameOption)) {
+    add_first_frame_callback([] { QMetaObject::invokeMethod(qApp, &QCoreApplication::quit, Qt::QueuedConnection); });
+  }
+
+  set_hud_enabled(parser.isSet(hudOption));
+
+  set_layer_caching_enabled(!parser.isSet(noLayerCacheOption));
+
+  set_capture_directory(parser.value(captureDirOption).toStdString());
+
+  if (parser.isSet(captureFramesOption)) {
+    std::vector<int> frames;
+    for (const QString& f : parser.value(captureFramesOption).split(',')) {
+      frames.push_back(f.toInt());
+    }
+    set_captured_frames(frames);
+  }
+
+  if (parser.isSet(captureSlowOption)) {
+    set_slow_frame_capture(parser.value(captureSlowOption).toFloat());
+  }
+
+
+  TextMode textMode;
+  if (!parse_text_mode(parser.value(textModeOption).toStdString(), &textMode)) {
+    fprintf(stderr, "unknown text mode: %s\n", qPrintable(parser.value(textModeOption)));
+    return 1;
+  }
+
+  set_text_mode(textMode);
+
+  Backend backend;
+  if (!parse_backend(parser.value(backendOption).toStdString(), &backend)) {
+    fprintf(stderr, "unknown backend: %s\n", qPrintable(parser.value(backendOption)));
+    return 1;
+  }
+
+  PresentConfig presentConfig;
+  if (!parse_present_mode(parser.value(presentModeOption).toStdString(), &presentConfig.presentMode)) {
+    fprintf(stderr, "unknown present mode: %s\n", qPrintable(parser.value(presentModeOption)));
+    return 1;
+  }
+
+  presentConfig.framesInFlight = std::max(1, parser.value(framesInFlightOption).toInt());
+  presentConfig.swapInterval = std::max(0, parser.value(swapIntervalOption).toInt());
+  set_present_config(presentConfig);
+
+  // The swap interval of the window that QOpenGLWidget composes into is taken from the default format.
+  QSurfaceFormat defaultFormat = QSurfaceFormat::defaultFormat();
+  defaultFormat.setSwapInterval(gl_swap_interval());
+  QSurfaceFormat::setDefaultFormat(defaultFormat);
+
+#ifdef IM_HAVE_FRAME_EXPORT
+  if (parser.isSet(exportSocketOption) && !enable_frame_export(parser.value(exportSocketOption).toStdString())) {
+    fprintf(stderr, "cannot listen on %s\n", qPrintable(parser.value(exportSocketOption)));
+    return 1;
+  }
+#endif
+
+  if (parser.isSet(imageDirOption)) {
+    set_thumbnail_directory(parser.value(imageDirOption).toStdString());
+  }
+
+  if (!set_active_scene(parser.value(sceneOption).toStdString())) {
+    fprintf(stderr, "unknown scene: %s\n", qPrintable(parser.value(sceneOption)));
+    return 1;
+  }
+
+  if (parser.isSet(checkZeroAllocOption)) {
+    return check_zero_alloc_steady_state();
+  }
+
+  if (parser.isSet(textBenchmarkOption)) {
+    return run_text_zoom_benchmark(600);
+  }
+
+  if (parser.isSet(compareVulkanOption)) {
+    return run_vulkan_renderer_comparison(std::max(1.0, parser.value(compareVulkanOption).toDouble()));
+  }
 
   // --- run main window with selected backend
 
-  Backend backend = Backend::OpenGL; // <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<< Choose backend here <<<<<<<<<<<<
+  if (backend == Backend::Auto) {
+    backend = select_backend_automatically(parser.isSet(reprobeBackendOption));
+  }
+
+  {
+    StartupPhase windowPhase("main window");
+    MainWindow window(backend);
+    window.setMinimumSize(QSize(1000,700));
+    window.show();
+    windowPhase.end();
+
+    if (parser.isSet(latencyTestOption)) {
+      window.startLatencyTest();
+    }
+
+    if (parser.value(backendOption) == "auto") {
+      // The GPU identity is cheap to get from the running backend.
+      add_first_frame_callback([&window] {
+        QMetaObject::invokeMethod(&window, [&window] { window.verifyBackendDecision(); }, Qt::QueuedConnection);
+      });
+    }
+
+    QApplication::exec();
+
+    // The window is destroyed here. The renderers store their caches when they release their resources.
+  }
 
-  MainWindow window(backend);
-  window.setMinimumSize(QSize(1000,700));
-  window.show();
+  if (tracing_enabled()) {
+    toggle_tracing(); // writes the trace file
+  }
 
-  QApplication::exec();
+  shader_cache().flush();
 
   return 0;
 }
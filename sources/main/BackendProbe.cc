@@ -0,0 +1,399 @@
+/*
+ * Copyright (C) 2025 by Dirk Farin, Kronenstr. 49b, 70174 Stuttgart, Germany
+ *
+ * 2-Clause BSD
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer
+ *    in the documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "BackendProbe.h"
+#include "drawing/DrawingWindow_Skia_Vulkan.h"
+#include "drawing/Scenes.h"
+#include "drawing/ShaderCache.h"
+#include "drawing/TextMode.h"
+#include "profiling/StartupProfile.h"
+#include "util/Log.h"
+
+#include <QCryptographicHash>
+#include <QOffscreenSurface>
+#include <QOpenGLContext>
+#include <QOpenGLFunctions>
+#include <QSettings>
+#include <QSysInfo>
+#include <QVulkanFunctions>
+#include <QVulkanInstance>
+
+#include <core/SkCanvas.h>
+#include <core/SkSurface.h>
+
+#ifdef _WIN32 // TODO(skia): how can we test the skia version?
+#include "gpu/GrDirectContext.h"
+#include "gpu/GrContextOptions.h"
+#include <gpu/gl/GrGLInterface.h>
+#include <gpu/ganesh/gl/GrGLDirectContext.h>
+#include <gpu/ganesh/SkSurfaceGanesh.h>
+#else
+#include "gpu/ganesh/GrDirectContext.h"
+#include "gpu/ganesh/GrContextOptions.h"
+#include "gpu/ganesh/gl/GrGLInterface.h"
+#include <gpu/ganesh/gl/GrGLDirectContext.h>
+#include <gpu/ganesh/SkSurfaceGanesh.h>
+#endif
+
+#include <chrono>
+#include <functional>
+#include <iterator>
+#include <thread>
+#include <vector>
+
+
+static const int kWidth = 1000, kHeight = 700;
+static const int kWarmupFrames = 5;
+static const int kMaxFrames = 30;
+static const double kMaxSecondsPerScene = 0.5;
+
+// Paths (tessellation/rasterization) and text (glyph atlas) are the dominant workloads.
+static const char* const kProbeScenes[] = {"paths", "text"};
+
+
+// Average time of a frame over the probe scenes, in ms. 'flush' waits for the GPU.
+static double measure_frames(SkSurface* surface, const std::function<void()>& flush)
+{
+  using Clock = std::chrono::steady_clock;
+
+  double totalMs = 0;
+
+  for (const char* sceneName : kProbeScenes) {
+    std::unique_ptr<Scene> scene = create_scene(sceneName);
+
+    for (int frame = 0; frame < kWarmupFrames; frame++) {
+      scene->render(surface->getCanvas(), kWidth, kHeight, frame);
+      flush();
+    }
+
+    // Slow backends (e.g. software GL) are stopped early, their result is clear anyway.
+    Clock::time_point start = Clock::now();
+    int nFrames = 0;
+    double seconds = 0;
+
+    while (nFrames < kMaxFrames && seconds < kMaxSecondsPerScene) {
+      scene->render(surface->getCanvas(), kWidth, kHeight, kWarmupFrames + nFrames);
+      flush();
+
+      nFrames++;
+      seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    }
+
+    totalMs += seconds * 1000 / nFrames;
+  }
+
+  return totalMs / std::size(kProbeScenes);
+}
+
+
+static double probe_software()
+{
+  sk_sp<SkSurface> surface = SkSurfaces::Raster(SkImageInfo::MakeN32Premul(kWidth, kHeight));
+
+  return measure_frames(surface.get(), [] {});
+}
+
+
+// --- OpenGL
+
+struct GLProbeContext
+{
+  QOffscreenSurface surface;
+  QOpenGLContext context;
+
+  bool create()
+  {
+    surface.create();
+    return context.create() && context.makeCurrent(&surface);
+  }
+};
+
+
+QString gl_identity(QOpenGLContext* context)
+{
+  QOpenGLFunctions* f = context->functions();
+  return QString("gl: %1 / %2 / %3").arg((const char*) f->glGetString(GL_VENDOR),
+                                         (const char*) f->glGetString(GL_RENDERER),
+                                         (const char*) f->glGetString(GL_VERSION));
+}
+
+
+static double probe_opengl(GLProbeContext& gl)
+{
+  GrContextOptions options;
+  apply_text_mode_context_options(options);
+  apply_shader_cache_context_options(options);
+
+  sk_sp<GrDirectContext> context = GrDirectContexts::MakeGL(GrGLMakeNativeInterface(), options);
+  if (!context) {
+    return -1;
+  }
+
+  SkSurfaceProps surfaceProps = text_mode_surface_props();
+  sk_sp<SkSurface> surface = SkSurfaces::RenderTarget(context.get(), skgpu::Budgeted::kNo,
+                                                      SkImageInfo::Make(kWidth, kHeight, kRGBA_8888_SkColorType, kOpaque_SkAlphaType),
+                                                      0, kBottomLeft_GrSurfaceOrigin, &surfaceProps);
+  if (!surface) {
+    return -1;
+  }
+
+  return measure_frames(surface.get(), [&] { context->flushAndSubmit(GrSyncCpu::kYes); });
+}
+
+
+// --- Vulkan (the device that QVulkanWindow would pick: the first one)
+
+static VkPhysicalDevice vulkan_physical_device(QVulkanInstance* instance)
+{
+  QVulkanFunctions* f = instance->functions();
+
+  uint32_t count = 0;
+  if (f->vkEnumeratePhysicalDevices(instance->vkInstance(), &count, nullptr) != VK_SUCCESS || count == 0) {
+    return VK_NULL_HANDLE;
+  }
+
+  std::vector<VkPhysicalDevice> devices(count);
+  f->vkEnumeratePhysicalDevices(instance->vkInstance(), &count, devices.data());
+  return devices[0];
+}
+
+
+QString vulkan_identity(const VkPhysicalDeviceProperties& props)
+{
+  return QString("vulkan: %1 %2:%3 driver %4").arg(props.deviceName)
+                                               .arg(props.vendorID, 4, 16, QChar('0'))
+                                               .arg(props.deviceID, 4, 16, QChar('0'))
+                                               .arg(props.driverVersion);
+}
+
+
+static double probe_vulkan(QVulkanInstance* instance, VkPhysicalDevice physicalDevice)
+{
+  QVulkanFunctions* f = instance->functions();
+
+  uint32_t familyCount = 0;
+  f->vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &familyCount, nullptr);
+  std::vector<VkQueueFamilyProperties> families(familyCount);
+  f->vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &familyCount, families.data());
+
+  uint32_t family = 0;
+  while (family < familyCount && !(families[family].queueFlags & VK_QUEUE_GRAPHICS_BIT)) {
+    family++;
+  }
+
+  if (family == familyCount) {
+    return -1;
+  }
+
+  float priority = 1.0f;
+  VkDeviceQueueCreateInfo queueInfo = {};
+  queueInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+  queueInfo.queueFamilyIndex = family;
+  queueInfo.queueCount = 1;
+  queueInfo.pQueuePriorities = &priority;
+
+  // Same features as QVulkanWindow enables, see make_skia_vulkan_context().
+  VkPhysicalDeviceFeatures features;
+  f->vkGetPhysicalDeviceFeatures(physicalDevice, &features);
+  features.robustBufferAccess = VK_FALSE;
+
+  VkDeviceCreateInfo deviceInfo = {};
+  deviceInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+  deviceInfo.queueCreateInfoCount = 1;
+  deviceInfo.pQueueCreateInfos = &queueInfo;
+  deviceInfo.pEnabledFeatures = &features;
+
+  VkDevice device;
+  if (f->vkCreateDevice(physicalDevice, &deviceInfo, nullptr, &device) != VK_SUCCESS) {
+    return -1;
+  }
+
+  QVulkanDeviceFunctions* df = instance->deviceFunctions(device);
+
+  VkQueue queue;
+  df->vkGetDeviceQueue(device, family, 0, &queue);
+
+  double ms = -1;
+
+  {
+    sk_sp<GrDirectContext> context = make_skia_vulkan_context(instance->vkInstance(), physicalDevice, device, queue, family);
+    if (context) {
+      SkSurfaceProps surfaceProps = text_mode_surface_props();
+      sk_sp<SkSurface> surface = SkSurfaces::RenderTarget(context.get(), skgpu::Budgeted::kNo,
+                                                          SkImageInfo::Make(kWidth, kHeight, kBGRA_8888_SkColorType, kOpaque_SkAlphaType),
+                                                          0, kTopLeft_GrSurfaceOrigin, &surfaceProps);
+      if (surface) {
+        ms = measure_frames(surface.get(), [&] { context->flushAndSubmit(GrSyncCpu::kYes); });
+      }
+    }
+  }
+
+  df->vkDeviceWaitIdle(device);
+  instance->resetDeviceFunctions(device);
+  f->vkDestroyDevice(device, nullptr);
+
+  return ms;
+}
+
+
+// The last decision, trusted at startup (see verify_backend_decision()).
+static const char* const kLastDecisionGroup = "backend-probe/last";
+
+
+static QString cpu_identity()
+{
+  // Software rendering depends on the CPU.
+  return QString("cpu: %1 x%2").arg(QSysInfo::currentCpuArchitecture()).arg(std::thread::hardware_concurrency());
+}
+
+
+Backend select_backend_automatically(bool reprobe)
+{
+  STARTUP_PHASE("backend probe");
+
+  QSettings settings("qt-skia-backend-test", "qtskia");
+
+  QString cpuIdentity = cpu_identity();
+
+  Backend backend;
+  if (!reprobe && settings.value(QString(kLastDecisionGroup) + "/cpu").toString() == cpuIdentity &&
+      parse_backend(settings.value(QString(kLastDecisionGroup) + "/backend").toString().toStdString(), &backend)) {
+    LOG_INFO("backend: %s (last decision, verified when it runs)", backend_name(backend));
+    return backend;
+  }
+
+  // --- identify GPU and drivers
+
+  GLProbeContext gl;
+  bool haveGL = gl.create();
+
+  QVulkanInstance* vulkanInstance = get_vulkan_instance();
+  VkPhysicalDevice vulkanDevice = vulkanInstance ? vulkan_physical_device(vulkanInstance) : VK_NULL_HANDLE;
+
+  QString glIdentity, vulkanIdentity;
+  if (haveGL) {
+    glIdentity = gl_identity(&gl.context);
+  }
+  if (vulkanDevice) {
+    VkPhysicalDeviceProperties props;
+    vulkanInstance->functions()->vkGetPhysicalDeviceProperties(vulkanDevice, &props);
+    vulkanIdentity = vulkan_identity(props);
+  }
+
+  QString identity = cpuIdentity;
+  if (haveGL) {
+    identity += "; " + glIdentity;
+  }
+  if (vulkanDevice) {
+    identity += "; " + vulkanIdentity;
+  }
+
+  QString key = "backend-probe/" + QCryptographicHash::hash(identity.toUtf8(), QCryptographicHash::Sha1).toHex().left(16);
+
+  auto storeLastDecision = [&](Backend decision) {
+    settings.beginGroup(kLastDecisionGroup);
+    settings.setValue("cpu", cpuIdentity);
+    settings.setValue("gl", glIdentity);
+    settings.setValue("vulkan", vulkanIdentity);
+    settings.setValue("backend", backend_name(decision));
+    settings.endGroup();
+  };
+
+  if (!reprobe && parse_backend(settings.value(key + "/backend").toString().toStdString(), &backend)) {
+    LOG_INFO("backend: %s (probed before on %s)", backend_name(backend), qPrintable(identity));
+    storeLastDecision(backend);
+    return backend;
+  }
+
+  // --- measure
+
+  struct Result
+  {
+    Backend backend;
+    double ms;
+  };
+
+  std::vector<Result> results;
+
+  results.push_back({Backend::Software, probe_software()});
+
+  if (haveGL) {
+    results.push_back({Backend::OpenGL, probe_opengl(gl)});
+    gl.context.doneCurrent();
+  }
+
+  if (vulkanDevice) {
+    results.push_back({Backend::Vulkan_Skia, probe_vulkan(vulkanInstance, vulkanDevice)});
+  }
+
+  backend = Backend::Software;
+  double bestMs = -1;
+
+  for (const Result& result : results) {
+    if (result.ms < 0) {
+      LOG_INFO("backend probe: %-10s not available", backend_name(result.backend));
+      continue;
+    }
+
+    LOG_INFO("backend probe: %-10s %7.2f ms/frame", backend_name(result.backend), result.ms);
+
+    if (bestMs < 0 || result.ms < bestMs) {
+      bestMs = result.ms;
+      backend = result.backend;
+    }
+  }
+
+  LOG_INFO("backend: %s (on %s)", backend_name(backend), qPrintable(identity));
+
+  settings.setValue(key + "/identity", identity);
+  settings.setValue(key + "/backend", backend_name(backend));
+  storeLastDecision(backend);
+
+  return backend;
+}
+
+
+void verify_backend_decision(Backend backend, const QString& apiIdentity)
+{
+  const char* api;
+  switch (backend) {
+    case Backend::OpenGL:
+      api = "gl";
+      break;
+    case Backend::Vulkan_Skia:
+    case Backend::Vulkan_NoSkia:
+    case Backend::Vulkan_Combined:
+      api = "vulkan";
+      break;
+    default:
+      return; // software: the CPU has been checked at startup
+  }
+
+  QSettings settings("qt-skia-backend-test", "qtskia");
+  settings.beginGroup(kLastDecisionGroup);
+
+  QString stored = settings.value(api).toString();
+  if (stored.isEmpty() || stored == apiIdentity) {
+    return;
+  }
+
+  LOG_INFO("backend: %s changed since the last probe (was %s), probing again at the next launch",
+           qPrintable(apiIdentity), qPrintable(stored));
+  settings.remove("");
+}
@@ -0,0 +1,57 @@
+/*
+ * Copyright (C) 2025 by Dirk Farin, Kronenstr. 49b, 70174 Stuttgart, Germany
+ *
+ * 2-Clause BSD
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer
+ *    in the documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef BACKENDPROBE_H
+#define BACKENDPROBE_H
+
+#include "MainWindow.h"
+
+#include <QString>
+#include <QVulkanInstance>
+
+class QOpenGLContext;
+
+
+// Chooses the backend for Backend::Auto.
+//
+// Renders a few frames of representative scenes offscreen with each available backend
+// (software, opengl, vulkan) and picks the one with the lowest frame time. The decision is
+// stored in the user settings, keyed by the OpenGL renderer and Vulkan device and driver
+// versions. 'reprobe' ignores a stored decision.
+//
+// Later launches trust the last decision without creating any GL or Vulkan context, as long as
+// the CPU is the same. Once the chosen backend runs, verify_backend_decision() compares the
+// identity of its GPU and driver with the stored one; if they changed, the backend is probed
+// again at the next launch.
+//
+// The probe measures Skia's rendering only. Presentation (window composition, swap chain)
+// is not part of it.
+
+Backend select_backend_automatically(bool reprobe = false);
+
+// Identities of the GPU and driver, as stored with the decision. The context must be current.
+QString gl_identity(QOpenGLContext*);
+
+QString vulkan_identity(const VkPhysicalDeviceProperties&);
+
+// 'apiIdentity' is the identity of the GPU that the running 'backend' uses (empty for software).
+// Drops the last decision if it does not match.
+void verify_backend_decision(Backend backend, const QString& apiIdentity);
+
+#endif
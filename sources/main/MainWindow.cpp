@@ -17,33 +17,132 @@
  */
 
 #include "MainWindow.h"
+#include "BackendProbe.h"
 #include "drawing/DrawingWidget_Skia_GL.h"
 #include "drawing/DrawingWidget_Skia_Software.h"
 #include "drawing/DrawingWindow_Skia_Vulkan.h"
+#include "drawing/PresentConfig.h"
+#include "drawing/Hud.h"
+#include "profiling/Tracing.h"
+#include "profiling/LatencyProbe.h"
+#include "profiling/FrameCapture.h"
 
 #include <QApplication>
+#include <QShortcut>
+
+
+static const struct
+{
+  Backend backend;
+  const char* name;
+} sBackendNames[] = {
+    {Backend::OpenGL, "opengl"},
+    {Backend::Software, "software"},
+    {Backend::Vulkan_NoSkia, "vulkan-noskia"},
+    {Backend::Vulkan_Skia, "vulkan"},
+    {Backend::Vulkan_Combined, "vulkan-combined"},
+    {Backend::Auto, "auto"},
+};
+
+
+const char* backend_name(Backend backend)
+{
+  for (const auto& b : sBackendNames) {
+    if (b.backend == backend) {
+      return b.name;
+    }
+  }
+
+  return "?";
+}
+
+
+bool parse_backend(const std::string& name, Backend* backend)
+{
+  for (const auto& b : sBackendNames) {
+    if (name == b.name) {
+      *backend = b.backend;
+      return true;
+    }
+  }
+
+  return false;
+}
 
 
 MainWindow::MainWindow(Backend backend)
+    : mBackend(backend)
 {
   setWindowTitle("skia-qt-backend-test");
 
+  auto traceShortcut = new QShortcut(QKeySequence(Qt::Key_F12), this);
+  traceShortcut->setContext(Qt::ApplicationShortcut);
+  connect(traceShortcut, &QShortcut::activated, this, [] { toggle_tracing(); });
+
+  auto hudShortcut = new QShortcut(QKeySequence(Qt::Key_F11), this);
+  hudShortcut->setContext(Qt::ApplicationShortcut);
+  connect(hudShortcut, &QShortcut::activated, this, [] { toggle_hud(); });
+
+  auto captureShortcut = new QShortcut(QKeySequence(Qt::Key_F10), this);
+  captureShortcut->setContext(Qt::ApplicationShortcut);
+  connect(captureShortcut, &QShortcut::activated, this, [] { request_frame_capture(); });
+
+  set_hud_backend_name(backend_name(backend));
+
   if (backend == Backend::OpenGL) {
     auto widget = new DrawingWidget_Skia_GL();
     setCentralWidget(widget);
+    mDrawingTarget = widget;
   }
   else if (backend == Backend::Software) {
     auto widget = new DrawingWidget_Skia_Software();
     setCentralWidget(widget);
+    mDrawingTarget = widget;
   }
   else if (backend == Backend::Vulkan_Skia) {
-    auto vulkan_window = new DrawingWindow_Skia_Vulkan(true);
+    auto vulkan_window = new DrawingWindow_Skia_Vulkan(VulkanRendererType::Skia);
     auto containerWidget = QWidget::createWindowContainer(vulkan_window, this);
     setCentralWidget(containerWidget);
+    mDrawingTarget = vulkan_window;
   }
   else if (backend == Backend::Vulkan_NoSkia) {
-    auto vulkan_window = new DrawingWindow_Skia_Vulkan(false);
+    auto vulkan_window = new DrawingWindow_Skia_Vulkan(VulkanRendererType::NonSkia);
     auto containerWidget = QWidget::createWindowContainer(vulkan_window, this);
     setCentralWidget(containerWidget);
+    mDrawingTarget = vulkan_window;
   }
+  else if (backend == Backend::Vulkan_Combined) {
+    auto vulkan_window = new DrawingWindow_Skia_Vulkan(VulkanRendererType::Combined);
+    auto containerWidget = QWidget::createWindowContainer(vulkan_window, this);
+    setCentralWidget(containerWidget);
+    mDrawingTarget = vulkan_window;
+  }
+}
+
+
+void MainWindow::verifyBackendDecision()
+{
+  QString apiIdentity;
+
+  if (auto* widget = qobject_cast<DrawingWidget_Skia_GL*>(mDrawingTarget)) {
+    widget->makeCurrent();
+    apiIdentity = gl_identity(widget->context());
+    widget->doneCurrent();
+  }
+  else if (auto* window = qobject_cast<DrawingWindow_Skia_Vulkan*>(mDrawingTarget)) {
+    if (!window->isValid()) {
+      return;
+    }
+
+    apiIdentity = vulkan_identity(*window->physicalDeviceProperties());
+  }
+
+  verify_backend_decision(mBackend, apiIdentity);
+}
+
+
+void MainWindow::startLatencyTest()
+{
+  std::string configuration = std::string("backend=") + backend_name(mBackend) + " " + present_config_description();
+  latency_probe().start(mDrawingTarget, configuration);
 }
@@ -22,14 +22,22 @@
 
 #include <QMainWindow>
 
+#include <string>
+
 
 enum class Backend {
   OpenGL,
   Software,
   Vulkan_NoSkia,
-  Vulkan_Skia
+  Vulkan_Skia,
+  Vulkan_Combined,
+  Auto // resolved with select_backend_automatically() before the window is created
 };
 
+const char* backend_name(Backend);
+
+bool parse_backend(const std::string& name, Backend* backend);
+
 
 class MainWindow : public QMainWindow
 {
@@ -37,6 +45,17 @@ Q_OBJECT
 
 public:
   MainWindow(Backend);
+
+  // Measures input latency on the drawing widget, then quits (see LatencyProbe).
+  void startLatencyTest();
+
+  // For a backend chosen by select_backend_automatically(): checks the stored decision against
+  // the GPU that the backend runs on (see verify_backend_decision()). Call it after the first frame.
+  void verifyBackendDecision();
+
+private:
+  Backend mBackend;
+  QObject* mDrawingTarget = nullptr;
 };
 
 
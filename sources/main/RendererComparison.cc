@@ -0,0 +1,81 @@
+/*
+ * Copyright (C) 2025 by Dirk Farin, Kronenstr. 49b, 70174 Stuttgart, Germany
+ *
+ * 2-Clause BSD
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer
+ *    in the documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "RendererComparison.h"
+#include "drawing/DrawingWindow_Skia_Vulkan.h"
+#include "profiling/FrameStats.h"
+
+#include <QEventLoop>
+#include <QTimer>
+
+#include <cstdio>
+#include <iterator>
+
+
+static const int kWarmupMs = 1000;
+
+
+int run_vulkan_renderer_comparison(double seconds)
+{
+  if (!get_vulkan_instance()) {
+    fprintf(stderr, "Vulkan is not available\n");
+    return 1;
+  }
+
+  static const struct
+  {
+    VulkanRendererType type;
+    const char* name;
+  } kRenderers[] = {
+      {VulkanRendererType::NonSkia, "native"},
+      {VulkanRendererType::Skia, "skia"},
+      {VulkanRendererType::Combined, "combined"},
+  };
+
+  FrameStats::Totals totals[std::size(kRenderers)];
+
+  for (size_t i = 0; i < std::size(kRenderers); i++) {
+    DrawingWindow_Skia_Vulkan window(kRenderers[i].type);
+    window.resize(1000, 700);
+    window.show();
+
+    // Shader compilation and the first uploads are not part of the measurement.
+    QEventLoop loop;
+    QTimer::singleShot(kWarmupMs, &loop, [] { frame_stats().resetTotals(); });
+    QTimer::singleShot(kWarmupMs + int(seconds * 1000), &loop, &QEventLoop::quit);
+    loop.exec();
+
+    totals[i] = frame_stats().totals();
+  }
+
+  printf("%-10s %8s %10s %12s %12s\n", "renderer", "frames", "frames/s", "cpu ms/frame", "gpu ms/frame");
+
+  for (size_t i = 0; i < std::size(kRenderers); i++) {
+    const FrameStats::Totals& t = totals[i];
+    printf("%-10s %8d %10.1f %12.2f ", kRenderers[i].name, t.frames, t.frames / t.seconds, t.cpuFrameTimeMs);
+    if (t.gpuFrames) {
+      printf("%12.2f\n", t.gpuFrameTimeMs);
+    }
+    else {
+      printf("%12s\n", "-");
+    }
+  }
+
+  return 0;
+}
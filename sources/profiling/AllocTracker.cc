@@ -0,0 +1,169 @@
+/*
+ * Copyright (C) 2025 by Dirk Farin, Kronenstr. 49b, 70174 Stuttgart, Germany
+ *
+ * 2-Clause BSD
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer
+ *    in the documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "AllocTracker.h"
+
+#include <atomic>
+
+
+// Everything here is reached from inside malloc(), so nothing in this file may allocate.
+
+namespace {
+
+struct ThreadAllocStats
+{
+  std::atomic<uint64_t> allocations[(int) RenderStage::NumStages];
+  std::atomic<uint64_t> bytes[(int) RenderStage::NumStages];
+  std::atomic<const char*> name;
+};
+
+ThreadAllocStats sThreadStats[kMaxAllocTrackedThreads];
+std::atomic<int> sNumThreads{0};
+
+thread_local ThreadAllocStats* tStats = nullptr;
+thread_local RenderStage tStage = RenderStage::Other;
+
+
+ThreadAllocStats* thread_stats()
+{
+  if (!tStats) {
+    int slot = sNumThreads.fetch_add(1, std::memory_order_relaxed);
+    if (slot >= kMaxAllocTrackedThreads) {
+      slot = kMaxAllocTrackedThreads - 1;
+    }
+
+    tStats = &sThreadStats[slot];
+  }
+
+  return tStats;
+}
+
+}
+
+
+const char* render_stage_name(RenderStage stage)
+{
+  switch (stage) {
+    case RenderStage::Other:
+      return "other";
+    case RenderStage::Scene:
+      return "scene";
+    case RenderStage::Flush:
+      return "flush";
+    case RenderStage::Present:
+      return "present";
+    default:
+      return "?";
+  }
+}
+
+
+bool alloc_tracking_available()
+{
+#ifdef IM_ENABLE_ALLOC_TRACKING
+  return true;
+#else
+  return false;
+#endif
+}
+
+
+void alloc_tracker_record(size_t size)
+{
+  ThreadAllocStats* stats = thread_stats();
+  int stage = (int) tStage;
+
+  // only the owning thread writes, so load + store is sufficient
+  stats->allocations[stage].store(stats->allocations[stage].load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+  stats->bytes[stage].store(stats->bytes[stage].load(std::memory_order_relaxed) + size, std::memory_order_relaxed);
+}
+
+
+int alloc_thread_count()
+{
+  int n = sNumThreads.load(std::memory_order_relaxed);
+  return n < kMaxAllocTrackedThreads ? n : kMaxAllocTrackedThreads;
+}
+
+
+int alloc_thread_slot()
+{
+  return (int) (thread_stats() - sThreadStats);
+}
+
+
+AllocCounts alloc_counts_thread(int slot)
+{
+  AllocCounts counts;
+  for (int s = 0; s < (int) RenderStage::NumStages; s++) {
+    counts.allocations += sThreadStats[slot].allocations[s].load(std::memory_order_relaxed);
+    counts.bytes += sThreadStats[slot].bytes[s].load(std::memory_order_relaxed);
+  }
+
+  return counts;
+}
+
+
+AllocCounts alloc_counts_stage(RenderStage stage)
+{
+  AllocCounts counts;
+  for (int t = 0; t < alloc_thread_count(); t++) {
+    counts.allocations += sThreadStats[t].allocations[(int) stage].load(std::memory_order_relaxed);
+    counts.bytes += sThreadStats[t].bytes[(int) stage].load(std::memory_order_relaxed);
+  }
+
+  return counts;
+}
+
+
+AllocCounts alloc_counts_total()
+{
+  AllocCounts counts;
+  for (int t = 0; t < alloc_thread_count(); t++) {
+    counts += alloc_counts_thread(t);
+  }
+
+  return counts;
+}
+
+
+const char* alloc_thread_name(int slot)
+{
+  const char* name = sThreadStats[slot].name.load(std::memory_order_relaxed);
+  return name ? name : "unnamed";
+}
+
+
+void set_alloc_thread_name(const char* name)
+{
+  thread_stats()->name.store(name, std::memory_order_relaxed);
+}
+
+
+AllocStageScope::AllocStageScope(RenderStage stage)
+    : mPrevious(tStage)
+{
+  tStage = stage;
+}
+
+
+AllocStageScope::~AllocStageScope()
+{
+  tStage = mPrevious;
+}
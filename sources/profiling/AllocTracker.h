@@ -0,0 +1,98 @@
+/*
+ * Copyright (C) 2025 by Dirk Farin, Kronenstr. 49b, 70174 Stuttgart, Germany
+ *
+ * 2-Clause BSD
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer
+ *    in the documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef ALLOCTRACKER_H
+#define ALLOCTRACKER_H
+
+#include <cstddef>
+#include <cstdint>
+
+
+// Heap allocation accounting per render stage and per thread.
+//
+// Counting is only active when built with IM_ENABLE_ALLOC_TRACKING (CMake option), which
+// replaces the global operator new/delete and, on glibc, malloc and friends. Without it, all
+// counters stay zero and the stage scopes cost a thread-local store.
+
+enum class RenderStage : int
+{
+  Other = 0,
+  Scene,    // drawing the scene into the canvas
+  Flush,    // flushing/submitting GPU work
+  Present,  // handing the frame to Qt / the window system
+  NumStages
+};
+
+const char* render_stage_name(RenderStage);
+
+
+struct AllocCounts
+{
+  uint64_t allocations = 0;
+  uint64_t bytes = 0;
+
+  AllocCounts operator-(const AllocCounts& b) const { return {allocations - b.allocations, bytes - b.bytes}; }
+  AllocCounts& operator+=(const AllocCounts& b) { allocations += b.allocations; bytes += b.bytes; return *this; }
+};
+
+
+bool alloc_tracking_available();
+
+// Counters are monotonically increasing. Take differences to get per-frame values.
+
+AllocCounts alloc_counts_total();
+
+AllocCounts alloc_counts_stage(RenderStage);
+
+// Threads get a slot when they allocate for the first time.
+// Threads beyond the maximum share the last slot.
+const int kMaxAllocTrackedThreads = 64;
+
+int alloc_thread_count();
+
+// Slot of the calling thread (assigned now if the thread has not allocated yet).
+int alloc_thread_slot();
+
+AllocCounts alloc_counts_thread(int slot);
+
+const char* alloc_thread_name(int slot);
+
+// 'name' must be a string literal.
+void set_alloc_thread_name(const char* name);
+
+
+// Called by the allocation hooks.
+void alloc_tracker_record(size_t size);
+
+
+class AllocStageScope
+{
+public:
+  explicit AllocStageScope(RenderStage stage);
+
+  ~AllocStageScope();
+
+  AllocStageScope(const AllocStageScope&) = delete;
+  AllocStageScope& operator=(const AllocStageScope&) = delete;
+
+private:
+  RenderStage mPrevious;
+};
+
+#endif
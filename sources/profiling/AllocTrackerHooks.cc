@@ -0,0 +1,185 @@
+/*
+ * Copyright (C) 2025 by Dirk Farin, Kronenstr. 49b, 70174 Stuttgart, Germany
+ *
+ * 2-Clause BSD
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer
+ *    in the documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+// Only compiled with IM_ENABLE_ALLOC_TRACKING.
+//
+// Replaces the global operator new/delete with counting versions. On glibc, malloc() and its
+// relatives are replaced as well (forwarding to the __libc_* implementations), so that
+// allocations made by C code and by libraries (Skia, Qt, drivers) are counted too.
+// operator new goes directly to __libc_malloc() in that case to avoid counting twice.
+
+#include "AllocTracker.h"
+
+#include <cerrno>
+#include <cstdlib>
+#include <new>
+
+#if defined(__GLIBC__)
+#include <unistd.h>
+
+extern "C" {
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t n, size_t size);
+void* __libc_realloc(void* ptr, size_t size);
+void* __libc_memalign(size_t alignment, size_t size);
+void __libc_free(void* ptr);
+}
+
+#define RAW_MALLOC(size) __libc_malloc(size)
+#define RAW_MEMALIGN(alignment, size) __libc_memalign(alignment, size)
+#define RAW_FREE(ptr) __libc_free(ptr)
+
+#else
+
+#define RAW_MALLOC(size) std::malloc(size)
+#define RAW_FREE(ptr) std::free(ptr)
+
+static void* raw_memalign(size_t alignment, size_t size)
+{
+  void* ptr = nullptr;
+  if (posix_memalign(&ptr, alignment < sizeof(void*) ? sizeof(void*) : alignment, size) != 0) {
+    return nullptr;
+  }
+  return ptr;
+}
+
+#define RAW_MEMALIGN(alignment, size) raw_memalign(alignment, size)
+
+#endif
+
+
+// --- malloc family (glibc only)
+
+#if defined(__GLIBC__)
+
+extern "C" {
+
+void* malloc(size_t size)
+{
+  alloc_tracker_record(size);
+  return __libc_malloc(size);
+}
+
+void* calloc(size_t n, size_t size)
+{
+  alloc_tracker_record(n * size);
+  return __libc_calloc(n, size);
+}
+
+void* realloc(void* ptr, size_t size)
+{
+  alloc_tracker_record(size);
+  return __libc_realloc(ptr, size);
+}
+
+void free(void* ptr)
+{
+  __libc_free(ptr);
+}
+
+void* memalign(size_t alignment, size_t size)
+{
+  alloc_tracker_record(size);
+  return __libc_memalign(alignment, size);
+}
+
+void* aligned_alloc(size_t alignment, size_t size)
+{
+  alloc_tracker_record(size);
+  return __libc_memalign(alignment, size);
+}
+
+int posix_memalign(void** ptr, size_t alignment, size_t size)
+{
+  alloc_tracker_record(size);
+  *ptr = __libc_memalign(alignment, size);
+  return *ptr ? 0 : ENOMEM;
+}
+
+void* valloc(size_t size)
+{
+  alloc_tracker_record(size);
+  return __libc_memalign(sysconf(_SC_PAGESIZE), size);
+}
+
+void* pvalloc(size_t size)
+{
+  size_t page = sysconf(_SC_PAGESIZE);
+  size = (size + page - 1) / page * page;
+  alloc_tracker_record(size);
+  return __libc_memalign(page, size);
+}
+
+}
+
+#endif
+
+
+// --- operator new / delete
+
+static void* counted_new(size_t size)
+{
+  alloc_tracker_record(size);
+
+  void* ptr = RAW_MALLOC(size ? size : 1);
+  if (!ptr) {
+    throw std::bad_alloc();
+  }
+  return ptr;
+}
+
+static void* counted_new_aligned(size_t size, std::align_val_t alignment)
+{
+  alloc_tracker_record(size);
+
+  void* ptr = RAW_MEMALIGN(static_cast<size_t>(alignment), size ? size : 1);
+  if (!ptr) {
+    throw std::bad_alloc();
+  }
+  return ptr;
+}
+
+
+void* operator new(size_t size) { return counted_new(size); }
+void* operator new[](size_t size) { return counted_new(size); }
+void* operator new(size_t size, std::align_val_t al) { return counted_new_aligned(size, al); }
+void* operator new[](size_t size, std::align_val_t al) { return counted_new_aligned(size, al); }
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+  alloc_tracker_record(size);
+  return RAW_MALLOC(size ? size : 1);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept
+{
+  alloc_tracker_record(size);
+  return RAW_MALLOC(size ? size : 1);
+}
+
+void operator delete(void* ptr) noexcept { RAW_FREE(ptr); }
+void operator delete[](void* ptr) noexcept { RAW_FREE(ptr); }
+void operator delete(void* ptr, size_t) noexcept { RAW_FREE(ptr); }
+void operator delete[](void* ptr, size_t) noexcept { RAW_FREE(ptr); }
+void operator delete(void* ptr, std::align_val_t) noexcept { RAW_FREE(ptr); }
+void operator delete[](void* ptr, std::align_val_t) noexcept { RAW_FREE(ptr); }
+void operator delete(void* ptr, size_t, std::align_val_t) noexcept { RAW_FREE(ptr); }
+void operator delete[](void* ptr, size_t, std::align_val_t) noexcept { RAW_FREE(ptr); }
+void operator delete(void* ptr, const std::nothrow_t&) noexcept { RAW_FREE(ptr); }
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept { RAW_FREE(ptr); }
@@ -0,0 +1,312 @@
+/*
+ * Copyright (C) 2025 by Dirk Farin, Kronenstr. 49b, 70174 Stuttgart, Germany
+ *
+ * 2-Clause BSD
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer
+ *    in the documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "FrameCapture.h"
+#include "SkiaFontManager.h"
+#include "drawing/Drawing.h"
+#include "drawing/Scenes.h"
+#include "profiling/Tracing.h"
+#include "util/Log.h"
+#include "util/ThreadPool.h"
+
+#include <core/SkCanvas.h>
+#include <core/SkData.h>
+#include <core/SkImage.h>
+#include <core/SkPictureRecorder.h>
+#include <core/SkSerialProcs.h>
+#include <core/SkStream.h>
+#include <core/SkTypeface.h>
+#include <encode/SkPngEncoder.h>
+#include <utils/SkNWayCanvas.h>
+
+#ifdef _WIN32 // TODO(skia): how can we test the skia version?
+#include "gpu/GrDirectContext.h"
+#else
+#include "gpu/ganesh/GrDirectContext.h"
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <mutex>
+
+
+namespace {
+
+std::mutex sMutex;
+int sPendingCaptures = 0;
+std::vector<int> sCapturedFrames;
+float sSlowFrameMs = 0;
+int sMaxSlowCaptures = 0;
+int sSlowCaptures = 0;
+std::string sCaptureDirectory = ".";
+
+// Set while any capture is configured, so that draw_scene_frame_with_capture() costs a single
+// relaxed load otherwise.
+std::atomic<bool> sCaptureActive{false};
+
+
+void update_capture_active()
+{
+  sCaptureActive = sPendingCaptures > 0 || !sCapturedFrames.empty() ||
+                   (sSlowFrameMs > 0 && sSlowCaptures < sMaxSlowCaptures);
+}
+
+
+// Forwards the scene to the real canvas and a picture recorder. Offscreen surfaces (cached
+// layers, text images) are made by the real canvas, so they live on its GPU context.
+class CaptureCanvas : public SkNWayCanvas
+{
+public:
+  CaptureCanvas(SkCanvas* target, SkCanvas* recorder, int width, int height)
+      : SkNWayCanvas(width, height), mTarget(target)
+  {
+    addCanvas(target);
+    addCanvas(recorder);
+  }
+
+protected:
+  sk_sp<SkSurface> onNewSurface(const SkImageInfo& info, const SkSurfaceProps& props) override
+  {
+    return mTarget->makeSurface(info, &props);
+  }
+
+private:
+  SkCanvas* mTarget;
+};
+
+
+// 'context' is the GPU context that texture images of the picture belong to, or nullptr.
+void write_capture(sk_sp<SkPicture> picture, GrDirectContext* context, const std::string& sceneName, int frame,
+                   const char* suffix)
+{
+  char filename[64];
+  snprintf(filename, sizeof(filename), "-frame%06d%s.skp", frame, suffix);
+
+  std::filesystem::path path;
+  {
+    std::lock_guard<std::mutex> lock(sMutex);
+    path = std::filesystem::path(sCaptureDirectory) / ("qtskia-" + sceneName + filename);
+  }
+
+  // Textures can only be read back on the thread of their context, so GPU frames are serialized here.
+  sk_sp<SkData> data;
+  if (context) {
+    TRACE_SCOPE("serialize capture");
+    data = serialize_picture(picture.get(), context);
+    picture.reset();
+  }
+
+  background_thread_pool().enqueue([picture, data, path]() mutable {
+    TRACE_SCOPE("write capture");
+
+    if (picture) {
+      data = serialize_picture(picture.get());
+    }
+
+    std::filesystem::path tmpPath = path;
+    tmpPath += ".tmp";
+
+    SkFILEWStream stream(tmpPath.string().c_str());
+    if (!data || !stream.isValid() || !stream.write(data->data(), data->size())) {
+      LOG_ERROR("cannot write capture %s", path.string().c_str());
+      return;
+    }
+
+    stream.fsync();
+
+    std::error_code err;
+    std::filesystem::rename(tmpPath, path, err);
+    if (err) {
+      LOG_ERROR("cannot write capture %s", path.string().c_str());
+      return;
+    }
+
+    LOG_INFO("captured frame to %s (%zu KB)", path.string().c_str(), data->size() / 1024);
+  });
+}
+
+}
+
+
+void request_frame_capture(int nFrames)
+{
+  std::lock_guard<std::mutex> lock(sMutex);
+  sPendingCaptures += nFrames;
+  update_capture_active();
+}
+
+
+void set_captured_frames(const std::vector<int>& frames)
+{
+  std::lock_guard<std::mutex> lock(sMutex);
+  sCapturedFrames = frames;
+  update_capture_active();
+}
+
+
+void set_slow_frame_capture(float ms, int maxCaptures)
+{
+  std::lock_guard<std::mutex> lock(sMutex);
+  sSlowFrameMs = ms;
+  sMaxSlowCaptures = maxCaptures;
+  sSlowCaptures = 0;
+  update_capture_active();
+
+  if (ms > 0) {
+    LOG_INFO("recording every frame to capture those slower than %.1f ms, frame times include the recording", ms);
+  }
+}
+
+
+void set_capture_directory(const std::string& dir)
+{
+  std::lock_guard<std::mutex> lock(sMutex);
+  sCaptureDirectory = dir;
+}
+
+
+sk_sp<SkPicture> record_scene_frame(Scene* scene, int width, int height, int frame)
+{
+  TRACE_SCOPE("record_scene_frame");
+
+  SkPictureRecorder recorder;
+  SkCanvas* canvas = recorder.beginRecording(SkRect::MakeIWH(width, height));
+
+  draw_scene_frame(scene, canvas, width, height, frame);
+
+  return recorder.finishRecordingAsPicture();
+}
+
+
+void draw_scene_frame_with_capture(SkCanvas* canvas, int width, int height, int frame)
+{
+  if (!sCaptureActive.load(std::memory_order_relaxed)) {
+    draw_skia_scene_frame(canvas, width, height, frame);
+    return;
+  }
+
+  bool requested = false;
+  bool captureSlow = false;
+  {
+    std::lock_guard<std::mutex> lock(sMutex);
+
+    auto it = std::find(sCapturedFrames.begin(), sCapturedFrames.end(), frame);
+    if (it != sCapturedFrames.end()) {
+      sCapturedFrames.erase(it);
+      requested = true;
+    }
+    else if (sPendingCaptures > 0) {
+      sPendingCaptures--;
+      requested = true;
+    }
+
+    captureSlow = sSlowFrameMs > 0 && sSlowCaptures < sMaxSlowCaptures;
+    update_capture_active();
+  }
+
+  if (!requested && !captureSlow) {
+    draw_skia_scene_frame(canvas, width, height, frame);
+    return;
+  }
+
+  auto start = std::chrono::steady_clock::now();
+
+  // The scene draws to the real canvas and the recorder at once, so that the caches use their
+  // GPU entries (textures, GPU layer surfaces) as in frames that are not captured.
+  Scene* scene = active_scene();
+  GrRecordingContext* recordingContext = canvas->recordingContext();
+  GrDirectContext* context = recordingContext ? recordingContext->asDirectContext() : nullptr;
+
+  sk_sp<SkPicture> picture;
+  {
+    TRACE_SCOPE("record_scene_frame");
+
+    SkPictureRecorder recorder;
+    SkCanvas* recordingCanvas = recorder.beginRecording(SkRect::MakeIWH(width, height));
+    CaptureCanvas captureCanvas(canvas, recordingCanvas, width, height);
+
+    set_forwarding_canvas(&captureCanvas, canvas);
+    draw_scene_frame(scene, &captureCanvas, width, height, frame);
+    set_forwarding_canvas(nullptr, nullptr);
+
+    picture = recorder.finishRecordingAsPicture();
+  }
+
+  float ms = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+  if (requested) {
+    write_capture(picture, context, scene->name(), frame, "");
+  }
+  else {
+    bool slow = false;
+    {
+      std::lock_guard<std::mutex> lock(sMutex);
+      if (ms > sSlowFrameMs && sSlowCaptures < sMaxSlowCaptures) {
+        sSlowCaptures++;
+        slow = true;
+        update_capture_active();
+      }
+    }
+
+    if (slow) {
+      LOG_INFO("frame %d took %.2f ms to draw, capturing it", frame, ms);
+      write_capture(picture, context, scene->name(), frame, "-slow");
+    }
+  }
+}
+
+
+sk_sp<SkData> serialize_picture(const SkPicture* picture, GrDirectContext* context)
+{
+  SkSerialProcs procs;
+
+  procs.fTypefaceProc = [](SkTypeface* typeface, void*) -> sk_sp<SkData> {
+    SkDynamicMemoryWStream stream;
+    typeface->serialize(&stream, SkTypeface::SerializeBehavior::kDoIncludeData);
+    return stream.detachAsData();
+  };
+
+  // Texture images (see FrameCapture.h) are read back with the context.
+  procs.fImageProc = [](SkImage* image, void* context) -> sk_sp<SkData> {
+    return SkPngEncoder::Encode(static_cast<GrDirectContext*>(context), image, {});
+  };
+  procs.fImageCtx = context;
+
+  return picture->serialize(&procs);
+}
+
+
+sk_sp<SkPicture> deserialize_picture(const void* data, size_t size)
+{
+  SkDeserialProcs procs;
+
+  procs.fTypefaceProc = [](const void* data, size_t length, void*) -> sk_sp<SkTypeface> {
+    SkMemoryStream stream(data, length, false);
+    return SkTypeface::MakeDeserialize(&stream, get_skia_font_manager());
+  };
+
+  procs.fImageProc = [](const void* data, size_t length, void*) -> sk_sp<SkImage> {
+    return SkImages::DeferredFromEncodedData(SkData::MakeWithCopy(data, length));
+  };
+
+  return SkPicture::MakeFromData(data, size, &procs);
+}
@@ -0,0 +1,70 @@
+/*
+ * Copyright (C) 2025 by Dirk Farin, Kronenstr. 49b, 70174 Stuttgart, Germany
+ *
+ * 2-Clause BSD
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer
+ *    in the documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef FRAMECAPTURE_H
+#define FRAMECAPTURE_H
+
+#include <core/SkPicture.h>
+
+#include <string>
+#include <vector>
+
+class GrDirectContext;
+class Scene;
+class SkCanvas;
+class SkData;
+
+
+// Records frames of draw_skia_scene() as pictures and writes them as .skp files, with the
+// typefaces embedded, so that they can be replayed and profiled elsewhere (qtskia-skp-replay).
+//
+// A captured frame is drawn to the real canvas and recorded into an SkPicture at the same time
+// (SkNWayCanvas), so the caches use their GPU entries as in any other frame. Images are recorded
+// as the scene draws them: textures of the GPU caches are read back when the picture is
+// serialized, on the rendering thread; raster frames are serialized on a background thread.
+// Images that are not decoded yet appear as placeholders.
+
+// Captures the next 'nFrames' frames.
+void request_frame_capture(int nFrames = 1);
+
+// Captures these frame numbers of the draw_skia_scene() animation.
+void set_captured_frames(const std::vector<int>& frames);
+
+// Records every frame and writes those that take longer than 'ms' to draw (including the
+// recording). 0 disables it. Until 'maxCaptures' frames were written, every frame pays for
+// recording all of its draw calls, so frame times measured meanwhile are too high.
+void set_slow_frame_capture(float ms, int maxCaptures = 10);
+
+// Default: the current directory
+void set_capture_directory(const std::string& dir);
+
+// Used by draw_skia_scene(): draws frame 'frame' of the active scene, capturing it if requested.
+void draw_scene_frame_with_capture(SkCanvas*, int width, int height, int frame);
+
+// Records a frame of any scene into a picture. The caches take their raster paths for it.
+sk_sp<SkPicture> record_scene_frame(Scene*, int width, int height, int frame);
+
+// Serializes with the typefaces (font data) embedded and images encoded as PNG. Texture images
+// are read back with 'context', on its thread.
+sk_sp<SkData> serialize_picture(const SkPicture*, GrDirectContext* context = nullptr);
+
+// Counterpart of serialize_picture(). Uses the global font manager for the embedded typefaces.
+sk_sp<SkPicture> deserialize_picture(const void* data, size_t size);
+
+#endif
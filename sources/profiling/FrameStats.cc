@@ -0,0 +1,234 @@
+/*
+ * Copyright (C) 2025 by Dirk Farin, Kronenstr. 49b, 70174 Stuttgart, Germany
+ *
+ * 2-Clause BSD
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer
+ *    in the documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "FrameStats.h"
+#include "util/Log.h"
+
+#include <algorithm>
+#include <iterator>
+
+
+FrameStats::FrameStats()
+{
+  mIntervalStart = Clock::now();
+  mTotalsStart = mIntervalStart;
+}
+
+
+FrameStats& frame_stats()
+{
+  static FrameStats sStats;
+  return sStats;
+}
+
+
+void FrameStats::beginFrame()
+{
+  mFrameStart = Clock::now();
+
+  if (alloc_tracking_available()) {
+    mFrameStartAllocs = alloc_counts_total();
+  }
+}
+
+
+void FrameStats::endFrame()
+{
+  auto now = Clock::now();
+  double frameTimeMs = std::chrono::duration<double, std::milli>(now - mFrameStart).count();
+
+  mHistory[mHistoryPos] = (float) frameTimeMs;
+  mHistoryPos = (mHistoryPos + 1) % kHistorySize;
+  mHistoryLength = std::min(mHistoryLength + 1, kHistorySize);
+
+  mTotalFrames++;
+  mTotalFrameTimeSum += frameTimeMs;
+
+  mIntervalFrames++;
+  mIntervalFrameTimeSum += frameTimeMs;
+  mIntervalFrameTimeMax = std::max(mIntervalFrameTimeMax, frameTimeMs);
+
+  if (mFrameUploaded) {
+    mIntervalUploadFrames++;
+    mIntervalUploadFrameTimeMax = std::max(mIntervalUploadFrameTimeMax, frameTimeMs);
+    mFrameUploaded = false;
+  }
+
+  if (alloc_tracking_available()) {
+    mLastFrameAllocs = alloc_counts_total() - mFrameStartAllocs;
+    mIntervalAllocs += mLastFrameAllocs;
+  }
+
+  double intervalSeconds = std::chrono::duration<double>(now - mIntervalStart).count();
+  if (intervalSeconds >= mReportInterval) {
+    report(intervalSeconds);
+
+    mIntervalStart = Clock::now();
+    mIntervalFrames = 0;
+    mIntervalFrameTimeSum = 0;
+    mIntervalFrameTimeMax = 0;
+    mIntervalGpuFrames = 0;
+    mIntervalGpuTimeSum = 0;
+    mIntervalGpuTimeMax = 0;
+    mIntervalHudFrames = 0;
+    mIntervalHudTimeSum = 0;
+    mIntervalUploadBytes = 0;
+    mIntervalUploadFrames = 0;
+    mIntervalUploadFrameTimeMax = 0;
+    mIntervalAllocs = {};
+    std::fill(std::begin(mIntervalLayerDraws), std::end(mIntervalLayerDraws), 0);
+
+    for (int s = 0; s < (int) RenderStage::NumStages; s++) {
+      mIntervalStageStart[s] = alloc_counts_stage((RenderStage) s);
+    }
+
+    for (int t = 0; t < alloc_thread_count(); t++) {
+      mIntervalThreadStart[t] = alloc_counts_thread(t);
+    }
+  }
+}
+
+
+void FrameStats::addGpuTime(float ms)
+{
+  mTotalGpuFrames++;
+  mTotalGpuTimeSum += ms;
+
+  mIntervalGpuFrames++;
+  mIntervalGpuTimeSum += ms;
+  mIntervalGpuTimeMax = std::max(mIntervalGpuTimeMax, (double) ms);
+}
+
+
+void FrameStats::addHudTime(float ms)
+{
+  mIntervalHudFrames++;
+  mIntervalHudTimeSum += ms;
+}
+
+
+void FrameStats::addUpload(size_t bytes)
+{
+  mIntervalUploadBytes += bytes;
+  mFrameUploaded = true;
+}
+
+
+void FrameStats::addLayerDraw(LayerDraw draw)
+{
+  mIntervalLayerDraws[(int) draw]++;
+}
+
+
+void FrameStats::setLayerResidency(int layers, size_t bytes)
+{
+  mLayers = layers;
+  mLayerBytes = bytes;
+}
+
+
+void FrameStats::resetTotals()
+{
+  mTotalsStart = Clock::now();
+  mTotalFrames = 0;
+  mTotalFrameTimeSum = 0;
+  mTotalGpuFrames = 0;
+  mTotalGpuTimeSum = 0;
+}
+
+
+FrameStats::Totals FrameStats::totals() const
+{
+  Totals totals;
+  totals.frames = mTotalFrames;
+  totals.seconds = std::chrono::duration<double>(Clock::now() - mTotalsStart).count();
+  totals.cpuFrameTimeMs = mTotalFrames ? mTotalFrameTimeSum / mTotalFrames : 0;
+  totals.gpuFrameTimeMs = mTotalGpuFrames ? mTotalGpuTimeSum / mTotalGpuFrames : 0;
+  totals.gpuFrames = mTotalGpuFrames;
+  return totals;
+}
+
+
+float FrameStats::frameTimeMs(int idx) const
+{
+  int pos = (mHistoryPos - mHistoryLength + idx + kHistorySize) % kHistorySize;
+  return mHistory[pos];
+}
+
+
+void FrameStats::report(double intervalSeconds)
+{
+  mAverageFrameTimeMs = (float) (mIntervalFrameTimeSum / mIntervalFrames);
+  mFramesPerSecond = (float) (mIntervalFrames / intervalSeconds);
+
+  LOG_INFO("frames: %.1f fps, cpu frame time avg %.2f ms, max %.2f ms",
+           mFramesPerSecond, mAverageFrameTimeMs, mIntervalFrameTimeMax);
+
+  mAverageGpuTimeMs = mIntervalGpuFrames ? (float) (mIntervalGpuTimeSum / mIntervalGpuFrames) : 0;
+  mAverageHudTimeMs = mIntervalHudFrames ? (float) (mIntervalHudTimeSum / mIntervalHudFrames) : 0;
+
+  if (mIntervalGpuFrames) {
+    LOG_INFO("  gpu frame time avg %.2f ms, max %.2f ms (%d frames measured)",
+             mIntervalGpuTimeSum / mIntervalGpuFrames, mIntervalGpuTimeMax, mIntervalGpuFrames);
+  }
+
+  if (mIntervalHudFrames) {
+    LOG_INFO("  hud avg %.3f ms (%.1f%% of the cpu frame time)",
+             mAverageHudTimeMs, 100.0 * mAverageHudTimeMs / mAverageFrameTimeMs);
+  }
+
+  if (mIntervalUploadFrames) {
+    LOG_INFO("  uploads: %.1f MB/s, cpu frame time max %.2f ms in the %d frames with uploads",
+             mIntervalUploadBytes / (1024.0 * 1024.0) / intervalSeconds, mIntervalUploadFrameTimeMax, mIntervalUploadFrames);
+  }
+
+  uint64_t layerHits = mIntervalLayerDraws[(int) LayerDraw::Hit];
+  uint64_t layerDraws = mIntervalLayerDraws[(int) LayerDraw::Rasterized];
+  uint64_t layerUncached = mIntervalLayerDraws[(int) LayerDraw::Uncached];
+
+  if (layerHits || layerDraws || layerUncached) {
+    LOG_INFO("  layers: %llu hits, %llu rasterized, %llu uncached, %d resident (%.1f MB)",
+             (unsigned long long) layerHits, (unsigned long long) layerDraws, (unsigned long long) layerUncached,
+             mLayers, mLayerBytes / (1024.0 * 1024.0));
+  }
+
+  if (!alloc_tracking_available()) {
+    return;
+  }
+
+  LOG_INFO("  allocations per frame: %.1f (%.0f bytes)",
+           mIntervalAllocs.allocations / (double) mIntervalFrames,
+           mIntervalAllocs.bytes / (double) mIntervalFrames);
+
+  // Stage and thread counters also include allocations between frames.
+
+  for (int s = 0; s < (int) RenderStage::NumStages; s++) {
+    AllocCounts delta = alloc_counts_stage((RenderStage) s) - mIntervalStageStart[s];
+    LOG_INFO("    stage %-8s %8.1f allocs/frame %10.0f bytes/frame", render_stage_name((RenderStage) s),
+             delta.allocations / (double) mIntervalFrames, delta.bytes / (double) mIntervalFrames);
+  }
+
+  for (int t = 0; t < alloc_thread_count(); t++) {
+    AllocCounts delta = alloc_counts_thread(t) - mIntervalThreadStart[t];
+    if (delta.allocations) {
+      LOG_INFO("    thread %2d (%s) %8.1f allocs/frame %10.0f bytes/frame", t, alloc_thread_name(t),
+               delta.allocations / (double) mIntervalFrames, delta.bytes / (double) mIntervalFrames);
+    }
+  }
+}
@@ -0,0 +1,158 @@
+/*
+ * Copyright (C) 2025 by Dirk Farin, Kronenstr. 49b, 70174 Stuttgart, Germany
+ *
+ * 2-Clause BSD
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer
+ *    in the documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef FRAMESTATS_H
+#define FRAMESTATS_H
+
+#include "AllocTracker.h"
+
+#include <chrono>
+
+
+// Collects CPU frame times (and heap allocations, if tracking is available) and prints a
+// summary once per report interval.
+
+class FrameStats
+{
+public:
+  static const int kHistorySize = 256;
+
+  FrameStats();
+
+  void beginFrame();
+
+  void endFrame();
+
+  // Number of frames in the history (up to kHistorySize).
+  int historyLength() const { return mHistoryLength; }
+
+  // CPU time of a recent frame in milliseconds. Index 0 is the oldest frame in the history.
+  float frameTimeMs(int idx) const;
+
+  float averageFrameTimeMs() const { return mAverageFrameTimeMs; }
+
+  float framesPerSecond() const { return mFramesPerSecond; }
+
+  // Averages of the last report interval, 0 if nothing was measured.
+  float averageGpuTimeMs() const { return mAverageGpuTimeMs; }
+
+  float averageHudTimeMs() const { return mAverageHudTimeMs; }
+
+  AllocCounts lastFrameAllocations() const { return mLastFrameAllocs; }
+
+  // GPU time of a frame, measured with timer queries. Results arrive a few frames late, so they
+  // are not associated with a specific frame, only averaged over the report interval.
+  void addGpuTime(float ms);
+
+  // CPU time spent drawing the HUD in a frame (see Hud.h), reported as overhead.
+  void addHudTime(float ms);
+
+  // Bytes that finished streaming to the GPU in this frame (see UploadServiceVulkan). The report
+  // shows the upload rate and the frame times while uploads were running.
+  void addUpload(size_t bytes);
+
+  // Layer cache activity (see drawing/LayerCache.h): reports how often cached layers were drawn
+  // from their image, rasterized (again) or drawn directly, and the memory they hold.
+  enum class LayerDraw
+  {
+    Hit,
+    Rasterized,
+    Uncached
+  };
+
+  void addLayerDraw(LayerDraw);
+
+  void setLayerResidency(int layers, size_t bytes);
+
+  void setReportInterval(double seconds) { mReportInterval = seconds; }
+
+  // Averages over all frames since resetTotals(), for comparing whole runs (see RendererComparison.h).
+  struct Totals
+  {
+    int frames = 0;
+    double seconds = 0;
+    double cpuFrameTimeMs = 0;
+    double gpuFrameTimeMs = 0; // 0 if nothing was measured
+    int gpuFrames = 0;
+  };
+
+  void resetTotals();
+
+  Totals totals() const;
+
+private:
+  using Clock = std::chrono::steady_clock;
+
+  Clock::time_point mFrameStart;
+  Clock::time_point mIntervalStart;
+  double mReportInterval = 1.0;
+
+  float mHistory[kHistorySize]{};
+  int mHistoryPos = 0;
+  int mHistoryLength = 0;
+
+  float mAverageFrameTimeMs = 0;
+  float mFramesPerSecond = 0;
+  float mAverageGpuTimeMs = 0;
+  float mAverageHudTimeMs = 0;
+
+  // --- accumulated over the current report interval
+
+  int mIntervalFrames = 0;
+  double mIntervalFrameTimeSum = 0;
+  double mIntervalFrameTimeMax = 0;
+
+  int mIntervalGpuFrames = 0;
+  double mIntervalGpuTimeSum = 0;
+  double mIntervalGpuTimeMax = 0;
+
+  int mIntervalHudFrames = 0;
+  double mIntervalHudTimeSum = 0;
+
+  bool mFrameUploaded = false;
+  uint64_t mIntervalUploadBytes = 0;
+  int mIntervalUploadFrames = 0;
+  double mIntervalUploadFrameTimeMax = 0;
+
+  uint64_t mIntervalLayerDraws[3]{};
+  int mLayers = 0;
+  size_t mLayerBytes = 0;
+
+  // --- accumulated since resetTotals()
+
+  Clock::time_point mTotalsStart;
+  int mTotalFrames = 0;
+  double mTotalFrameTimeSum = 0;
+  int mTotalGpuFrames = 0;
+  double mTotalGpuTimeSum = 0;
+
+  AllocCounts mFrameStartAllocs;
+  AllocCounts mLastFrameAllocs;
+  AllocCounts mIntervalAllocs;
+  AllocCounts mIntervalStageStart[(int) RenderStage::NumStages];
+  AllocCounts mIntervalThreadStart[kMaxAllocTrackedThreads];
+
+  void report(double intervalSeconds);
+};
+
+
+// Statistics of the render loop of the active backend.
+FrameStats& frame_stats();
+
+#endif
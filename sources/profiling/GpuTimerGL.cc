@@ -0,0 +1,85 @@
+/*
+ * Copyright (C) 2025 by Dirk Farin, Kronenstr. 49b, 70174 Stuttgart, Germany
+ *
+ * 2-Clause BSD
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer
+ *    in the documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "GpuTimerGL.h"
+#include "FrameStats.h"
+#include "util/Log.h"
+
+
+bool GpuTimerGL::init()
+{
+  for (auto& q : mQueries) {
+    q.query = std::make_unique<QOpenGLTimerQuery>();
+    if (!q.query->create()) {
+      LOG_WARNING("GPU timer queries are not available");
+      for (auto& q2 : mQueries) {
+        q2.query.reset();
+      }
+      return false;
+    }
+  }
+
+  return true;
+}
+
+
+void GpuTimerGL::begin()
+{
+  Query& q = mQueries[mNext];
+  if (!q.query || q.pending) {
+    return; // results are late, skip this frame
+  }
+
+  q.query->begin();
+  mCurrent = mNext;
+}
+
+
+void GpuTimerGL::end()
+{
+  if (mCurrent < 0) {
+    return;
+  }
+
+  mQueries[mCurrent].query->end();
+  mQueries[mCurrent].pending = true;
+  mCurrent = -1;
+
+  mNext = (mNext + 1) % kNumQueries;
+}
+
+
+void GpuTimerGL::poll()
+{
+  // Results become available in order, so we can stop at the first one that is not ready.
+
+  for (int i = 0; i < kNumQueries; i++) {
+    Query& q = mQueries[(mNext + i) % kNumQueries];
+    if (!q.pending) {
+      continue;
+    }
+
+    if (!q.query->isResultAvailable()) {
+      break;
+    }
+
+    frame_stats().addGpuTime(q.query->waitForResult() / 1e6f); // available, does not block
+    q.pending = false;
+  }
+}
@@ -0,0 +1,59 @@
+/*
+ * Copyright (C) 2025 by Dirk Farin, Kronenstr. 49b, 70174 Stuttgart, Germany
+ *
+ * 2-Clause BSD
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer
+ *    in the documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef GPUTIMERGL_H
+#define GPUTIMERGL_H
+
+#include <QOpenGLTimerQuery>
+
+#include <memory>
+
+
+// Measures the GPU time of a section of each frame with GL_TIME_ELAPSED queries.
+// Results are collected without blocking, a few frames later, and passed to frame_stats().
+// All functions must be called with the OpenGL context current.
+
+class GpuTimerGL
+{
+public:
+  // Returns false if timer queries are not supported (e.g. OpenGL ES without the extension).
+  bool init();
+
+  void begin();
+
+  void end();
+
+  // Collects the results of finished queries.
+  void poll();
+
+private:
+  static const int kNumQueries = 4;
+
+  struct Query
+  {
+    std::unique_ptr<QOpenGLTimerQuery> query;
+    bool pending = false;
+  };
+
+  Query mQueries[kNumQueries];
+  int mNext = 0;      // query for the next frame
+  int mCurrent = -1;  // query between begin() and end(), -1 = none
+};
+
+#endif
@@ -0,0 +1,240 @@
+/*
+ * Copyright (C) 2025 by Dirk Farin, Kronenstr. 49b, 70174 Stuttgart, Germany
+ *
+ * 2-Clause BSD
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer
+ *    in the documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "GpuTimerVulkan.h"
+#include "FrameStats.h"
+#include "util/Log.h"
+
+#include <QVulkanDeviceFunctions>
+#include <QVulkanFunctions>
+
+#include <vector>
+
+
+bool GpuTimerVulkan::init(QVulkanWindow* window)
+{
+  mWindow = window;
+
+  QVulkanInstance* inst = window->vulkanInstance();
+  mDevFuncs = inst->deviceFunctions(window->device());
+  VkDevice dev = window->device();
+
+  // --- check timestamp support of the graphics queue
+
+  uint32_t nFamilies = 0;
+  inst->functions()->vkGetPhysicalDeviceQueueFamilyProperties(window->physicalDevice(), &nFamilies, nullptr);
+  std::vector<VkQueueFamilyProperties> families(nFamilies);
+  inst->functions()->vkGetPhysicalDeviceQueueFamilyProperties(window->physicalDevice(), &nFamilies, families.data());
+
+  uint32_t validBits = families[window->graphicsQueueFamilyIndex()].timestampValidBits;
+  if (validBits == 0) {
+    LOG_WARNING("GPU timestamps are not supported by the graphics queue");
+    return false;
+  }
+
+  mTimestampMask = validBits >= 64 ? ~uint64_t(0) : (uint64_t(1) << validBits) - 1;
+  mTimestampPeriod = window->physicalDeviceProperties()->limits.timestampPeriod;
+
+  // --- query pool, two timestamps per slot
+
+  VkQueryPoolCreateInfo poolInfo{};
+  poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+  poolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+  poolInfo.queryCount = 2 * kNumSlots;
+
+  if (mDevFuncs->vkCreateQueryPool(dev, &poolInfo, nullptr, &mQueryPool) != VK_SUCCESS) {
+    LOG_WARNING("Failed to create timestamp query pool");
+    return false;
+  }
+
+  // --- command buffers for submitBegin()/submitEnd()
+
+  VkCommandPoolCreateInfo cmdPoolInfo{};
+  cmdPoolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+  cmdPoolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+  cmdPoolInfo.queueFamilyIndex = window->graphicsQueueFamilyIndex();
+  if (mDevFuncs->vkCreateCommandPool(dev, &cmdPoolInfo, nullptr, &mCommandPool) != VK_SUCCESS) {
+    qFatal("Failed to create command pool");
+  }
+
+  for (auto& slot : mSlots) {
+    VkCommandBufferAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.commandPool = mCommandPool;
+    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocInfo.commandBufferCount = 2;
+
+    VkCommandBuffer cbs[2];
+    if (mDevFuncs->vkAllocateCommandBuffers(dev, &allocInfo, cbs) != VK_SUCCESS) {
+      qFatal("Failed to allocate command buffers");
+    }
+
+    slot.beginCB = cbs[0];
+    slot.endCB = cbs[1];
+
+    VkFenceCreateInfo fenceInfo{};
+    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+    fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+    mDevFuncs->vkCreateFence(dev, &fenceInfo, nullptr, &slot.fence);
+  }
+
+  return true;
+}
+
+
+void GpuTimerVulkan::release()
+{
+  if (!mQueryPool) {
+    return;
+  }
+
+  VkDevice dev = mWindow->device();
+  mDevFuncs->vkDeviceWaitIdle(dev);
+
+  for (auto& slot : mSlots) {
+    mDevFuncs->vkDestroyFence(dev, slot.fence, nullptr);
+    slot = Slot{};
+  }
+
+  mDevFuncs->vkDestroyCommandPool(dev, mCommandPool, nullptr);
+  mDevFuncs->vkDestroyQueryPool(dev, mQueryPool, nullptr);
+  mCommandPool = VK_NULL_HANDLE;
+  mQueryPool = VK_NULL_HANDLE;
+}
+
+
+bool GpuTimerVulkan::slotAvailable(const Slot& slot) const
+{
+  if (!mQueryPool || slot.pending) {
+    return false;
+  }
+
+  // our own command buffers of this slot may still be executing
+  return mDevFuncs->vkGetFenceStatus(mWindow->device(), slot.fence) == VK_SUCCESS;
+}
+
+
+void GpuTimerVulkan::begin(VkCommandBuffer cb)
+{
+  if (!slotAvailable(mSlots[mNext])) {
+    return; // results are late, skip this frame
+  }
+
+  // BOTTOM_OF_PIPE: written when all previously submitted work has finished, so the time of
+  // earlier frames that are still executing is not counted.
+  mDevFuncs->vkCmdResetQueryPool(cb, mQueryPool, 2 * mNext, 2);
+  mDevFuncs->vkCmdWriteTimestamp(cb, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, mQueryPool, 2 * mNext);
+  mCurrent = mNext;
+}
+
+
+void GpuTimerVulkan::end(VkCommandBuffer cb)
+{
+  if (mCurrent < 0) {
+    return;
+  }
+
+  mDevFuncs->vkCmdWriteTimestamp(cb, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, mQueryPool, 2 * mCurrent + 1);
+  mSlots[mCurrent].pending = true;
+  mCurrent = -1;
+
+  mNext = (mNext + 1) % kNumSlots;
+}
+
+
+void GpuTimerVulkan::submit(VkCommandBuffer cb, VkFence fence)
+{
+  VkSubmitInfo submitInfo{};
+  submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+  submitInfo.commandBufferCount = 1;
+  submitInfo.pCommandBuffers = &cb;
+
+  mDevFuncs->vkQueueSubmit(mWindow->graphicsQueue(), 1, &submitInfo, fence);
+}
+
+
+static void begin_one_time_commands(QVulkanDeviceFunctions* devFuncs, VkCommandBuffer cb)
+{
+  VkCommandBufferBeginInfo beginInfo{};
+  beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+  beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+  devFuncs->vkBeginCommandBuffer(cb, &beginInfo);
+}
+
+
+void GpuTimerVulkan::submitBegin()
+{
+  Slot& slot = mSlots[mNext];
+  if (!slotAvailable(slot)) {
+    return;
+  }
+
+  begin_one_time_commands(mDevFuncs, slot.beginCB);
+  begin(slot.beginCB);
+  mDevFuncs->vkEndCommandBuffer(slot.beginCB);
+
+  submit(slot.beginCB, VK_NULL_HANDLE);
+}
+
+
+void GpuTimerVulkan::submitEnd()
+{
+  if (mCurrent < 0) {
+    return;
+  }
+
+  Slot& slot = mSlots[mCurrent];
+
+  begin_one_time_commands(mDevFuncs, slot.endCB);
+  end(slot.endCB);
+  mDevFuncs->vkEndCommandBuffer(slot.endCB);
+
+  // The end buffer is submitted last, so its fence also covers the begin buffer.
+  mDevFuncs->vkResetFences(mWindow->device(), 1, &slot.fence);
+  submit(slot.endCB, slot.fence);
+}
+
+
+void GpuTimerVulkan::poll()
+{
+  if (!mQueryPool) {
+    return;
+  }
+
+  for (int i = 0; i < kNumSlots; i++) {
+    int idx = (mNext + i) % kNumSlots;
+    Slot& slot = mSlots[idx];
+    if (!slot.pending) {
+      continue;
+    }
+
+    // Without VK_QUERY_RESULT_WAIT_BIT, this returns VK_NOT_READY instead of blocking.
+    uint64_t timestamps[2];
+    VkResult result = mDevFuncs->vkGetQueryPoolResults(mWindow->device(), mQueryPool, 2 * idx, 2,
+                                                       sizeof(timestamps), timestamps, sizeof(uint64_t),
+                                                       VK_QUERY_RESULT_64_BIT);
+    if (result != VK_SUCCESS) {
+      break;
+    }
+
+    uint64_t ticks = ((timestamps[1] & mTimestampMask) - (timestamps[0] & mTimestampMask)) & mTimestampMask;
+    frame_stats().addGpuTime(ticks * mTimestampPeriod / 1e6f);
+    slot.pending = false;
+  }
+}
@@ -0,0 +1,84 @@
+/*
+ * Copyright (C) 2025 by Dirk Farin, Kronenstr. 49b, 70174 Stuttgart, Germany
+ *
+ * 2-Clause BSD
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer
+ *    in the documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef GPUTIMERVULKAN_H
+#define GPUTIMERVULKAN_H
+
+#include <QVulkanWindow>
+
+
+// Measures the GPU time of a section of each frame with Vulkan timestamp queries.
+// Results are read back without waiting (no VK_QUERY_RESULT_WAIT_BIT), a few frames later, and
+// passed to frame_stats().
+//
+// The section is either recorded into a command buffer (begin(cb)/end(cb), outside of a render
+// pass), or, for work that is submitted by someone else (Skia), bracketed by small command
+// buffers of our own that are submitted before and after it (submitBegin()/submitEnd()).
+
+class GpuTimerVulkan
+{
+public:
+  // Returns false if the graphics queue does not support timestamps.
+  bool init(QVulkanWindow*);
+
+  void release();
+
+  void begin(VkCommandBuffer);
+
+  void end(VkCommandBuffer);
+
+  void submitBegin();
+
+  void submitEnd();
+
+  // Collects the results of finished queries.
+  void poll();
+
+private:
+  static const int kNumSlots = 4;
+
+  QVulkanWindow* mWindow = nullptr;
+  QVulkanDeviceFunctions* mDevFuncs = nullptr;
+
+  VkQueryPool mQueryPool = VK_NULL_HANDLE;
+  float mTimestampPeriod = 1; // ns per tick
+  uint64_t mTimestampMask = ~uint64_t(0);
+
+  // only for submitBegin()/submitEnd()
+  VkCommandPool mCommandPool = VK_NULL_HANDLE;
+
+  struct Slot
+  {
+    bool pending = false;
+
+    VkCommandBuffer beginCB = VK_NULL_HANDLE;
+    VkCommandBuffer endCB = VK_NULL_HANDLE;
+    VkFence fence = VK_NULL_HANDLE;
+  };
+
+  Slot mSlots[kNumSlots];
+  int mNext = 0;
+  int mCurrent = -1;
+
+  bool slotAvailable(const Slot&) const;
+
+  void submit(VkCommandBuffer cb, VkFence fence);
+};
+
+#endif
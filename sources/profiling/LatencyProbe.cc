@@ -0,0 +1,137 @@
+/*
+ * Copyright (C) 2025 by Dirk Farin, Kronenstr. 49b, 70174 Stuttgart, Germany
+ *
+ * 2-Clause BSD
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer
+ *    in the documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "LatencyProbe.h"
+
+#include <QCoreApplication>
+#include <QEvent>
+
+#include <algorithm>
+#include <cstdio>
+
+
+static const int kInputIntervalMs = 50;
+
+// Registered at runtime, so it cannot collide with other custom event types.
+static const QEvent::Type kProbeEventType = (QEvent::Type) QEvent::registerEventType();
+
+
+LatencyProbe::LatencyProbe()
+{
+  mTimer.setInterval(kInputIntervalMs);
+  connect(&mTimer, &QTimer::timeout, this, &LatencyProbe::postInput);
+}
+
+
+void LatencyProbe::start(QObject* target, const std::string& configuration, int nSamples)
+{
+  mTarget = target;
+  mConfiguration = configuration;
+  mNumSamples = nSamples;
+
+  mTarget->installEventFilter(this);
+  mTimer.start();
+}
+
+
+void LatencyProbe::postInput()
+{
+  if (mState != State::Idle) {
+    return; // previous measurement still running
+  }
+
+  mInputTime = Clock::now();
+  mState = State::InputPosted;
+
+  QCoreApplication::postEvent(mTarget, new QEvent(kProbeEventType));
+}
+
+
+bool LatencyProbe::eventFilter(QObject* obj, QEvent* event)
+{
+  if (event->type() != kProbeEventType) {
+    return QObject::eventFilter(obj, event);
+  }
+
+  if (mState == State::InputPosted) {
+    mHandledTime = Clock::now();
+    mState = State::InputHandled;
+  }
+
+  return true;
+}
+
+
+void LatencyProbe::frameSubmitted()
+{
+  if (mState == State::InputHandled) {
+    mSubmitTime = Clock::now();
+    mState = State::FrameSubmitted;
+  }
+}
+
+
+void LatencyProbe::framePresented()
+{
+  if (mState != State::FrameSubmitted) {
+    return;
+  }
+
+  Clock::time_point now = Clock::now();
+
+  auto ms = [this](Clock::time_point t) { return std::chrono::duration<float, std::milli>(t - mInputTime).count(); };
+  mHandledMs.push_back(ms(mHandledTime));
+  mSubmitMs.push_back(ms(mSubmitTime));
+  mPresentMs.push_back(ms(now));
+
+  mState = State::Idle;
+
+  if ((int) mPresentMs.size() == mNumSamples) {
+    mTimer.stop();
+    report();
+    QCoreApplication::quit();
+  }
+}
+
+
+static void print_distribution(const char* name, std::vector<float> values)
+{
+  std::sort(values.begin(), values.end());
+
+  auto p = [&values](float q) { return values[std::min(values.size() - 1, size_t(q * values.size()))]; };
+
+  printf("  %-18s min %6.2f  p50 %6.2f  p90 %6.2f  p99 %6.2f  max %6.2f ms\n",
+         name, values.front(), p(0.5f), p(0.9f), p(0.99f), values.back());
+}
+
+
+void LatencyProbe::report()
+{
+  printf("latency, %s, %d samples:\n", mConfiguration.c_str(), (int) mPresentMs.size());
+  print_distribution("input->handled", mHandledMs);
+  print_distribution("input->submit", mSubmitMs);
+  print_distribution("input->present", mPresentMs);
+}
+
+
+LatencyProbe& latency_probe()
+{
+  static LatencyProbe sProbe;
+  return sProbe;
+}
@@ -0,0 +1,96 @@
+/*
+ * Copyright (C) 2025 by Dirk Farin, Kronenstr. 49b, 70174 Stuttgart, Germany
+ *
+ * 2-Clause BSD
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer
+ *    in the documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef LATENCYPROBE_H
+#define LATENCYPROBE_H
+
+#include <QObject>
+#include <QTimer>
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+
+// Measures the latency from an input event to the submission and presentation of the frame
+// that first reflects it.
+//
+// A synthetic event is posted to the event queue of the drawing widget/window, like real input.
+// When it is delivered, the next frame carries it; the backends report when this frame was
+// submitted to the GPU and when it was handed to presentation (frameSubmitted()/framePresented()).
+// The time until the photons appear on the display is not visible to the application, so
+// 'present' is the return of the present call (swap/queue present/backing store flush).
+
+class LatencyProbe : public QObject
+{
+Q_OBJECT
+
+public:
+  LatencyProbe();
+
+  // Starts sending events to 'target'. After nSamples measurements, prints the distributions
+  // (labeled with 'configuration') and quits the application.
+  void start(QObject* target, const std::string& configuration, int nSamples = 300);
+
+  bool isRunning() const { return mTarget != nullptr; }
+
+  // --- to be called by the backends
+
+  void frameSubmitted();
+
+  void framePresented();
+
+protected:
+  bool eventFilter(QObject* obj, QEvent* event) override;
+
+private:
+  using Clock = std::chrono::steady_clock;
+
+  enum class State
+  {
+    Idle,
+    InputPosted,
+    InputHandled,
+    FrameSubmitted
+  };
+
+  QObject* mTarget = nullptr;
+  std::string mConfiguration;
+  int mNumSamples = 0;
+
+  QTimer mTimer;
+  State mState = State::Idle;
+
+  Clock::time_point mInputTime;
+  Clock::time_point mHandledTime;
+  Clock::time_point mSubmitTime;
+
+  std::vector<float> mHandledMs;
+  std::vector<float> mSubmitMs;
+  std::vector<float> mPresentMs;
+
+  void postInput();
+
+  void report();
+};
+
+
+LatencyProbe& latency_probe();
+
+#endif
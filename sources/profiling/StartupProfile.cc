@@ -0,0 +1,138 @@
+/*
+ * Copyright (C) 2025 by Dirk Farin, Kronenstr. 49b, 70174 Stuttgart, Germany
+ *
+ * 2-Clause BSD
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer
+ *    in the documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "StartupProfile.h"
+#include "util/Log.h"
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+using Clock = std::chrono::steady_clock;
+
+static const Clock::time_point sProcessStart = Clock::now();
+
+// Static initialization runs on the main thread.
+static const std::thread::id sMainThread = std::this_thread::get_id();
+
+
+namespace {
+
+struct Phase
+{
+  const char* name;
+  double startMs;
+  double endMs = -1; // still running
+  std::thread::id thread;
+};
+
+}
+
+static std::mutex sMutex;
+static std::vector<Phase> sPhases;
+static std::vector<std::function<void()>> sFirstFrameCallbacks;
+static std::atomic<bool> sFirstFramePresented{false};
+
+
+double startup_time_ms()
+{
+  return std::chrono::duration<double, std::milli>(Clock::now() - sProcessStart).count();
+}
+
+
+StartupPhase::StartupPhase(const char* name)
+{
+  // Phases that run again later (e.g. swapchain creation on resize) are only recorded at startup.
+  if (sFirstFramePresented.load(std::memory_order_relaxed)) {
+    mIndex = -1;
+    return;
+  }
+
+  double now = startup_time_ms();
+
+  std::lock_guard<std::mutex> lock(sMutex);
+  mIndex = (int) sPhases.size();
+  sPhases.push_back(Phase{name, now, -1, std::this_thread::get_id()});
+}
+
+
+StartupPhase::~StartupPhase()
+{
+  end();
+}
+
+
+void StartupPhase::end()
+{
+  if (mIndex < 0) {
+    return;
+  }
+
+  double now = startup_time_ms();
+
+  std::lock_guard<std::mutex> lock(sMutex);
+  sPhases[mIndex].endMs = now;
+  mIndex = -1;
+}
+
+
+void add_first_frame_callback(std::function<void()> callback)
+{
+  std::lock_guard<std::mutex> lock(sMutex);
+  sFirstFrameCallbacks.push_back(std::move(callback));
+}
+
+
+void startup_frame_presented()
+{
+  if (sFirstFramePresented.load(std::memory_order_relaxed) || sFirstFramePresented.exchange(true)) {
+    return;
+  }
+
+  double now = startup_time_ms();
+  std::vector<std::function<void()>> callbacks;
+
+  {
+    std::lock_guard<std::mutex> lock(sMutex);
+
+    LOG_INFO("startup: first frame presented after %.1f ms", now);
+    LOG_INFO("  %-24s %9s %9s %9s  %s", "phase", "start", "end", "duration", "thread");
+
+    for (const Phase& phase : sPhases) {
+      const char* thread = phase.thread == sMainThread ? "main" : "worker";
+
+      if (phase.endMs < 0) {
+        LOG_INFO("  %-24s %9.1f %9s %9s  %s", phase.name, phase.startMs, "-", "running", thread);
+      }
+      else {
+        LOG_INFO("  %-24s %9.1f %9.1f %9.1f  %s", phase.name, phase.startMs, phase.endMs,
+                 phase.endMs - phase.startMs, thread);
+      }
+    }
+
+    callbacks = std::move(sFirstFrameCallbacks);
+  }
+
+  for (const auto& callback : callbacks) {
+    callback();
+  }
+}
@@ -0,0 +1,67 @@
+/*
+ * Copyright (C) 2025 by Dirk Farin, Kronenstr. 49b, 70174 Stuttgart, Germany
+ *
+ * 2-Clause BSD
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer
+ *    in the documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef STARTUPPROFILE_H
+#define STARTUPPROFILE_H
+
+#include <functional>
+
+
+// Breakdown of the time from process start to the first presented frame.
+//
+// Startup phases are measured with STARTUP_PHASE() scopes, on any thread. Phases that run
+// concurrently (font indexing, shader cache loading) overlap in the report. When the first
+// frame has been presented, the phases are logged (info level) in the order they started.
+//
+// "Process start" is the static initialization of the program; the time spent by the dynamic
+// loader before it is not included.
+
+class StartupPhase
+{
+public:
+  // 'name' must be a string literal.
+  explicit StartupPhase(const char* name);
+
+  ~StartupPhase();
+
+  // Ends the phase before the end of the scope.
+  void end();
+
+  StartupPhase(const StartupPhase&) = delete;
+  StartupPhase& operator=(const StartupPhase&) = delete;
+
+private:
+  int mIndex;
+};
+
+#define STARTUP_PHASE_CONCAT2(a, b) a##b
+#define STARTUP_PHASE_CONCAT(a, b) STARTUP_PHASE_CONCAT2(a, b)
+#define STARTUP_PHASE(name) StartupPhase STARTUP_PHASE_CONCAT(startup_phase_, __LINE__)(name)
+
+
+// To be called by the backends after each presented frame. Only the first call does anything.
+void startup_frame_presented();
+
+// Milliseconds since process start.
+double startup_time_ms();
+
+// Called (on the presenting thread) after the report has been written, in the order they were added.
+void add_first_frame_callback(std::function<void()>);
+
+#endif
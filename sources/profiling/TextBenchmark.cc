@@ -0,0 +1,157 @@
+/*
+ * Copyright (C) 2025 by Dirk Farin, Kronenstr. 49b, 70174 Stuttgart, Germany
+ *
+ * 2-Clause BSD
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer
+ *    in the documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "TextBenchmark.h"
+#include "drawing/Scenes.h"
+#include "drawing/TextMode.h"
+
+#include <QOffscreenSurface>
+#include <QOpenGLContext>
+
+#include <core/SkCanvas.h>
+#include <core/SkGraphics.h>
+#include <core/SkSurface.h>
+
+#ifdef _WIN32 // TODO(skia): how can we test the skia version?
+#include "gpu/GrDirectContext.h"
+#include "gpu/GrContextOptions.h"
+#include <gpu/gl/GrGLInterface.h>
+#include <gpu/ganesh/gl/GrGLDirectContext.h>
+#include <gpu/ganesh/SkSurfaceGanesh.h>
+#else
+#include "gpu/ganesh/GrDirectContext.h"
+#include "gpu/ganesh/GrContextOptions.h"
+#include "gpu/ganesh/gl/GrGLInterface.h"
+#include <gpu/ganesh/gl/GrGLDirectContext.h>
+#include <gpu/ganesh/SkSurfaceGanesh.h>
+#endif
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+
+// Skia does not expose atlas upload counters. Every glyph that is rasterized for the GPU is
+// uploaded to the atlas, and rasterized glyphs are kept in the strike cache. Hence the growth of
+// the strike cache (new strikes = new sizes, bytes = glyph images) is used as the measure.
+
+struct TextBenchmarkResult
+{
+  double seconds = 0;
+  int newStrikes = 0;
+  size_t newGlyphBytes = 0;
+  std::vector<float> frameTimesMs;
+};
+
+
+static TextBenchmarkResult run_mode(TextMode mode, int nFrames)
+{
+  const int w = 1280, h = 720;
+
+  set_text_mode(mode);
+
+  GrContextOptions options;
+  apply_text_mode_context_options(options);
+
+  sk_sp<GrDirectContext> context = GrDirectContexts::MakeGL(GrGLMakeNativeInterface(), options);
+  if (!context) {
+    qFatal("Failed to create GrDirectContext!");
+  }
+
+  SkSurfaceProps surfaceProps = text_mode_surface_props();
+  sk_sp<SkSurface> surface = SkSurfaces::RenderTarget(context.get(), skgpu::Budgeted::kNo,
+                                                      SkImageInfo::Make(w, h, kRGBA_8888_SkColorType, kOpaque_SkAlphaType),
+                                                      0, kBottomLeft_GrSurfaceOrigin, &surfaceProps);
+  if (!surface) {
+    qFatal("Failed to create SkSurface");
+  }
+
+  std::unique_ptr<Scene> scene = create_scene("zoom");
+
+  SkGraphics::PurgeFontCache();
+
+  TextBenchmarkResult result;
+  size_t lastBytes = SkGraphics::GetFontCacheUsed();
+  int lastStrikes = SkGraphics::GetFontCacheCountUsed();
+
+  using Clock = std::chrono::steady_clock;
+  Clock::time_point start = Clock::now();
+
+  for (int frame = 0; frame < nFrames; frame++) {
+    Clock::time_point frameStart = Clock::now();
+
+    scene->render(surface->getCanvas(), w, h, frame);
+    context->flushAndSubmit(GrSyncCpu::kYes);
+
+    result.frameTimesMs.push_back(std::chrono::duration<float, std::milli>(Clock::now() - frameStart).count());
+
+    // The cache may also shrink when it is purged, hence the deltas are summed per frame.
+    size_t bytes = SkGraphics::GetFontCacheUsed();
+    int strikes = SkGraphics::GetFontCacheCountUsed();
+    result.newGlyphBytes += bytes > lastBytes ? bytes - lastBytes : 0;
+    result.newStrikes += std::max(0, strikes - lastStrikes);
+    lastBytes = bytes;
+    lastStrikes = strikes;
+  }
+
+  result.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+  // The next mode creates a new context, possibly at the same address.
+  release_text_mode_cache(context.get());
+
+  return result;
+}
+
+
+static float percentile(std::vector<float> values, float p)
+{
+  std::sort(values.begin(), values.end());
+  return values[std::min(values.size() - 1, size_t(p * values.size()))];
+}
+
+
+int run_text_zoom_benchmark(int nFrames)
+{
+  QOffscreenSurface offscreen;
+  offscreen.create();
+
+  QOpenGLContext glContext;
+  if (!glContext.create() || !glContext.makeCurrent(&offscreen)) {
+    fprintf(stderr, "cannot create OpenGL context\n");
+    return 1;
+  }
+
+  TextMode previousMode = text_mode();
+
+  printf("%-16s %10s %14s %16s %10s %10s\n", "text mode", "strikes/s", "glyph KB/s", "glyph KB total", "ms/frame", "p99 ms");
+
+  for (TextMode mode : {TextMode::Default, TextMode::DistanceField, TextMode::QuantizedSize}) {
+    TextBenchmarkResult r = run_mode(mode, nFrames);
+
+    printf("%-16s %10.1f %14.1f %16.1f %10.2f %10.2f\n", text_mode_name(mode),
+           r.newStrikes / r.seconds, r.newGlyphBytes / 1024.0 / r.seconds, r.newGlyphBytes / 1024.0,
+           r.seconds * 1000 / nFrames, percentile(r.frameTimesMs, 0.99f));
+  }
+
+  set_text_mode(previousMode);
+  glContext.doneCurrent();
+
+  return 0;
+}
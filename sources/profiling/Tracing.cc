@@ -0,0 +1,443 @@
+/*
+ * Copyright (C) 2025 by Dirk Farin, Kronenstr. 49b, 70174 Stuttgart, Germany
+ *
+ * 2-Clause BSD
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer
+ *    in the documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "Tracing.h"
+
+#include <utils/SkEventTracer.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+
+std::atomic<bool> g_tracing_enabled{false};
+
+
+// --- per-thread event buffers
+
+namespace {
+
+const size_t kEventsPerThread = 1 << 18;
+
+// Longer names of TRACE_EVENT_FLAG_COPY events are truncated.
+const size_t kMaxCopiedNameLength = 63;
+const size_t kNameChunkSize = 64 * 1024;
+
+const char kCategoryQtSkia[] = "qtskia";
+
+struct TraceEvent
+{
+  const char* name;
+  const char* category;
+  uint64_t beginNs;
+  uint64_t durationNs;
+  char phase;
+};
+
+// Written only by the owning thread. 'count' is published with release semantics, so the
+// writer of the trace file sees complete events without taking a lock.
+struct ThreadTraceBuffer
+{
+  uint32_t tid = 0;
+  std::string threadName;
+  std::unique_ptr<TraceEvent[]> events;
+  std::atomic<size_t> count{0};
+  std::atomic<size_t> dropped{0};
+
+  // Names of TRACE_EVENT_FLAG_COPY events (not string literals), packed into chunks that are
+  // allocated when needed and reused after the buffer has been emptied. Chunks are never freed,
+  // so the names stay valid while the trace file is written.
+  std::vector<std::unique_ptr<char[]>> nameChunks;
+  size_t nameChunksUsed = 0;
+  size_t nameChunkPos = 0;
+
+  // The buffer is emptied by its own thread when it sees that a trace has been written. Until
+  // then, its events belong to an earlier trace and are not written again. Stored after 'count'
+  // has been reset.
+  std::atomic<uint32_t> generation{0};
+};
+
+std::mutex sRegistryMutex;
+std::vector<std::unique_ptr<ThreadTraceBuffer>> sBuffers;
+std::string sTraceFile = "qtskia-trace.json";
+
+// Incremented whenever a trace file has been written.
+std::atomic<uint32_t> sTraceGeneration{0};
+
+thread_local ThreadTraceBuffer* tBuffer = nullptr;
+
+const auto sTraceEpoch = std::chrono::steady_clock::now();
+
+
+uint64_t now_ns()
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - sTraceEpoch).count();
+}
+
+
+ThreadTraceBuffer* thread_buffer()
+{
+  if (!tBuffer) {
+    auto buffer = std::make_unique<ThreadTraceBuffer>();
+    buffer->generation.store(sTraceGeneration.load(), std::memory_order_relaxed);
+
+    std::lock_guard<std::mutex> lock(sRegistryMutex);
+    buffer->tid = (uint32_t) sBuffers.size() + 1;
+    tBuffer = buffer.get();
+    sBuffers.push_back(std::move(buffer));
+  }
+
+  return tBuffer;
+}
+
+
+const char* copy_name(ThreadTraceBuffer* buffer, const char* name)
+{
+  size_t length = strnlen(name, kMaxCopiedNameLength);
+
+  if (buffer->nameChunksUsed == 0 || buffer->nameChunkPos + length + 1 > kNameChunkSize) {
+    if (buffer->nameChunksUsed == buffer->nameChunks.size()) {
+      buffer->nameChunks.emplace_back(new char[kNameChunkSize]);
+    }
+
+    buffer->nameChunksUsed++;
+    buffer->nameChunkPos = 0;
+  }
+
+  char* copy = buffer->nameChunks[buffer->nameChunksUsed - 1].get() + buffer->nameChunkPos;
+  memcpy(copy, name, length);
+  copy[length] = 0;
+  buffer->nameChunkPos += length + 1;
+
+  return copy;
+}
+
+
+// Returns a handle that can be used to set the duration later, or 0 if the buffer is full.
+// The handle is the generation of the buffer (upper 32 bits) and the index + 1.
+// With 'copyName', the name is copied into the buffer instead of being referenced.
+uint64_t add_event(char phase, const char* category, const char* name, bool copyName = false)
+{
+  ThreadTraceBuffer* buffer = thread_buffer();
+
+  // allocated on first use so that threads that never trace do not pay for it
+  if (!buffer->events) {
+    buffer->events.reset(new TraceEvent[kEventsPerThread]);
+  }
+
+  uint32_t generation = sTraceGeneration.load(std::memory_order_acquire);
+  if (buffer->generation.load(std::memory_order_relaxed) != generation) {
+    buffer->count.store(0, std::memory_order_relaxed);
+    buffer->dropped.store(0, std::memory_order_relaxed);
+    buffer->nameChunksUsed = 0;
+    buffer->nameChunkPos = 0;
+    buffer->generation.store(generation, std::memory_order_release);
+  }
+
+  size_t idx = buffer->count.load(std::memory_order_relaxed);
+  if (idx == kEventsPerThread) {
+    buffer->dropped.fetch_add(1, std::memory_order_relaxed);
+    return 0;
+  }
+
+  if (copyName) {
+    name = copy_name(buffer, name);
+  }
+
+  TraceEvent& event = buffer->events[idx];
+  event.name = name;
+  event.category = category;
+  event.beginNs = now_ns();
+  event.durationNs = 0;
+  event.phase = phase;
+
+  buffer->count.store(idx + 1, std::memory_order_release);
+
+  return (uint64_t(generation) << 32) | (idx + 1);
+}
+
+
+void set_event_duration(uint64_t handle)
+{
+  if (handle == 0 || !tBuffer) {
+    return;
+  }
+
+  // The buffer has been emptied since the event was added (the scope was open while a trace was
+  // written); the slot may hold another event now.
+  if (uint32_t(handle >> 32) != tBuffer->generation.load(std::memory_order_relaxed)) {
+    return;
+  }
+
+  TraceEvent& event = tBuffer->events[(handle & 0xFFFFFFFF) - 1];
+  event.durationNs = now_ns() - event.beginNs;
+}
+
+
+// --- SkEventTracer that records Skia's TRACE_EVENT spans into the same buffers
+
+class QtSkiaEventTracer : public SkEventTracer
+{
+public:
+  const uint8_t* getCategoryGroupEnabled(const char* name) override
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    for (size_t i = 0; i < mNumCategories; i++) {
+      if (mNames[i] == name) {
+        return &mFlags[i];
+      }
+    }
+
+    // Skia caches the returned pointer per call site, so the flags are a fixed array.
+    if (mNumCategories == kMaxCategories) {
+      return &mDisabledFlag;
+    }
+
+    size_t idx = mNumCategories++;
+    mNames[idx] = name;
+    mEnableWithTracing[idx] = strncmp(name, "disabled-by-default-", 20) != 0;
+    mFlags[idx] = flag_value(idx, tracing_enabled());
+    return &mFlags[idx];
+  }
+
+  const char* getCategoryGroupName(const uint8_t* categoryEnabledFlag) override
+  {
+    if (categoryEnabledFlag < mFlags || categoryEnabledFlag >= mFlags + kMaxCategories) {
+      return "unknown";
+    }
+
+    // entries are never changed once they have been handed out
+    return mNames[categoryEnabledFlag - mFlags].c_str();
+  }
+
+  SkEventTracer::Handle addTraceEvent(char phase,
+                                      const uint8_t* categoryEnabledFlag,
+                                      const char* name,
+                                      uint64_t id,
+                                      int32_t numArgs,
+                                      const char** argNames,
+                                      const uint8_t* argTypes,
+                                      const uint64_t* argValues,
+                                      uint8_t flags) override
+  {
+    if (!tracing_enabled()) {
+      return 0;
+    }
+
+    return add_event(phase, getCategoryGroupName(categoryEnabledFlag), name, flags & TRACE_EVENT_FLAG_COPY);
+  }
+
+  void updateTraceEventDuration(const uint8_t* categoryEnabledFlag,
+                                const char* name,
+                                SkEventTracer::Handle handle) override
+  {
+    set_event_duration(handle);
+  }
+
+  void setEnabled(bool enable)
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    for (size_t i = 0; i < mNumCategories; i++) {
+      mFlags[i] = flag_value(i, enable);
+    }
+  }
+
+private:
+  // Value of SkEventTracer::kEnabledForRecording_CategoryGroupEnabledFlags
+  static const uint8_t kEnabledForRecording = 1 << 0;
+
+  // Value of TRACE_EVENT_FLAG_COPY in SkTraceEventCommon.h
+  static const uint8_t TRACE_EVENT_FLAG_COPY = 1 << 0;
+
+  static const size_t kMaxCategories = 256;
+
+  std::mutex mMutex;
+  size_t mNumCategories = 0;
+  uint8_t mFlags[kMaxCategories]{};
+  std::string mNames[kMaxCategories];
+  bool mEnableWithTracing[kMaxCategories]{};
+  uint8_t mDisabledFlag = 0;
+
+  uint8_t flag_value(size_t idx, bool tracing) const
+  {
+    return (tracing && mEnableWithTracing[idx]) ? kEnabledForRecording : 0;
+  }
+};
+
+QtSkiaEventTracer* sSkiaTracer = nullptr;
+
+
+void write_json_string(FILE* fp, const char* s)
+{
+  fputc('"', fp);
+  for (; *s; s++) {
+    if (*s == '"' || *s == '\\') {
+      fputc('\\', fp);
+    }
+    if ((unsigned char) *s >= 0x20) {
+      fputc(*s, fp);
+    }
+  }
+  fputc('"', fp);
+}
+
+}
+
+
+void install_skia_event_tracer()
+{
+  if (sSkiaTracer) {
+    return;
+  }
+
+  sSkiaTracer = new QtSkiaEventTracer;
+  if (!SkEventTracer::SetInstance(sSkiaTracer)) {
+    delete sSkiaTracer;
+    sSkiaTracer = nullptr;
+  }
+}
+
+
+void set_tracing_enabled(bool enable)
+{
+  g_tracing_enabled.store(enable, std::memory_order_relaxed);
+
+  if (sSkiaTracer) {
+    sSkiaTracer->setEnabled(enable);
+  }
+}
+
+
+void set_trace_thread_name(const char* name)
+{
+  ThreadTraceBuffer* buffer = thread_buffer();
+
+  std::lock_guard<std::mutex> lock(sRegistryMutex);
+  buffer->threadName = name;
+}
+
+
+void set_trace_file(const std::string& path)
+{
+  std::lock_guard<std::mutex> lock(sRegistryMutex);
+  sTraceFile = path;
+}
+
+
+void toggle_tracing()
+{
+  if (!tracing_enabled()) {
+    set_tracing_enabled(true);
+    printf("tracing enabled\n");
+    return;
+  }
+
+  set_tracing_enabled(false);
+
+  std::string path;
+  {
+    std::lock_guard<std::mutex> lock(sRegistryMutex);
+    path = sTraceFile;
+  }
+
+  if (write_trace_file(path)) {
+    printf("trace written to %s\n", path.c_str());
+  }
+}
+
+
+bool write_trace_file(const std::string& path)
+{
+  FILE* fp = fopen(path.c_str(), "w");
+  if (!fp) {
+    fprintf(stderr, "cannot write trace file %s\n", path.c_str());
+    return false;
+  }
+
+  std::lock_guard<std::mutex> lock(sRegistryMutex);
+
+  fprintf(fp, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+
+  uint32_t generation = sTraceGeneration.load(std::memory_order_relaxed);
+
+  bool first = true;
+  for (const auto& buffer : sBuffers) {
+    if (!buffer->threadName.empty()) {
+      fprintf(fp, "%s{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":",
+              first ? "" : ",\n", buffer->tid);
+      write_json_string(fp, buffer->threadName.c_str());
+      fprintf(fp, "}}");
+      first = false;
+    }
+
+    // The thread has not traced since the last trace file was written.
+    if (buffer->generation.load(std::memory_order_acquire) != generation) {
+      continue;
+    }
+
+    size_t count = buffer->count.load(std::memory_order_acquire);
+    for (size_t i = 0; i < count; i++) {
+      const TraceEvent& event = buffer->events[i];
+
+      fprintf(fp, "%s{\"ph\":\"%c\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,", first ? "" : ",\n",
+              event.phase, buffer->tid, event.beginNs / 1000.0);
+      if (event.phase == 'X') {
+        fprintf(fp, "\"dur\":%.3f,", event.durationNs / 1000.0);
+      }
+      else if (event.phase == 'I' || event.phase == 'i') {
+        fprintf(fp, "\"s\":\"t\",");
+      }
+      fprintf(fp, "\"cat\":");
+      write_json_string(fp, event.category);
+      fprintf(fp, ",\"name\":");
+      write_json_string(fp, event.name);
+      fprintf(fp, "}");
+      first = false;
+    }
+
+    if (size_t dropped = buffer->dropped.load()) {
+      fprintf(stderr, "trace buffer of thread %u overflowed, %zu events dropped\n", buffer->tid, dropped);
+    }
+  }
+
+  // let each thread start the next recording with an empty buffer
+  sTraceGeneration.fetch_add(1, std::memory_order_release);
+
+  fprintf(fp, "\n]}\n");
+  fclose(fp);
+
+  return true;
+}
+
+
+uint64_t TraceScope::begin(const char* name)
+{
+  return add_event('X', kCategoryQtSkia, name);
+}
+
+
+void TraceScope::end(uint64_t handle)
+{
+  set_event_duration(handle);
+}
@@ -0,0 +1,93 @@
+/*
+ * Copyright (C) 2025 by Dirk Farin, Kronenstr. 49b, 70174 Stuttgart, Germany
+ *
+ * 2-Clause BSD
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer
+ *    in the documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef TRACING_H
+#define TRACING_H
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+
+// Records trace spans into per-thread buffers and writes them as a Chrome JSON trace
+// (load into https://ui.perfetto.dev or chrome://tracing).
+//
+// Besides our own TRACE_SCOPE() spans, an SkEventTracer is installed that records Skia's
+// internal TRACE_EVENT spans. Note that Skia only emits these when it was not built
+// with SK_DISABLE_TRACING (which is the default for official builds).
+//
+// When tracing is disabled, a span costs a single relaxed atomic load.
+
+extern std::atomic<bool> g_tracing_enabled;
+
+inline bool tracing_enabled() { return g_tracing_enabled.load(std::memory_order_relaxed); }
+
+// Must be called once before any Skia object is created.
+void install_skia_event_tracer();
+
+void set_tracing_enabled(bool enable);
+
+// Name shown for the calling thread in the trace viewer.
+void set_trace_thread_name(const char* name);
+
+// The file that toggle_tracing() writes to when tracing is switched off.
+void set_trace_file(const std::string& path);
+
+// Switches tracing on or off. When switching off, the recorded trace is written to the trace file.
+void toggle_tracing();
+
+// Writes all events recorded so far. Should be called while tracing is disabled.
+bool write_trace_file(const std::string& path);
+
+
+class TraceScope
+{
+public:
+  explicit TraceScope(const char* name)
+  {
+    if (tracing_enabled()) {
+      mHandle = begin(name);
+    }
+  }
+
+  ~TraceScope()
+  {
+    if (mHandle) {
+      end(mHandle);
+    }
+  }
+
+  TraceScope(const TraceScope&) = delete;
+  TraceScope& operator=(const TraceScope&) = delete;
+
+private:
+  uint64_t mHandle = 0;
+
+  static uint64_t begin(const char* name);
+  static void end(uint64_t handle);
+};
+
+
+#define TRACE_SCOPE_CONCAT2(a, b) a##b
+#define TRACE_SCOPE_CONCAT(a, b) TRACE_SCOPE_CONCAT2(a, b)
+
+// 'name' must be a string literal (or otherwise outlive the trace).
+#define TRACE_SCOPE(name) TraceScope TRACE_SCOPE_CONCAT(trace_scope_, __LINE__)(name)
+
+#endif
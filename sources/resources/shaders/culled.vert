@@ -0,0 +1,67 @@
+/*
+ * Copyright (C) 2025 by Dirk Farin, Kronenstr. 49b, 70174 Stuttgart, Germany
+ *
+ * 2-Clause BSD
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer
+ *    in the documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#version 450
+
+// Vertex shader of the GPU-culled draws. Same interface to color_frag as color_vert, but the
+// transform is built from the object selected by the instance index.
+
+layout(location = 0) in vec4 position;
+layout(location = 1) in vec3 color;
+
+layout(location = 0) out vec3 v_color;
+
+struct Object
+{
+  vec4 sphere;  // center, radius
+  vec4 params;  // x: rotation phase (degrees), y: scale
+};
+
+layout(std140, binding = 0) uniform FrameData
+{
+  mat4 viewProj;
+  vec4 planes[6];
+  float rotation;
+  uint objectCount;
+} frame;
+
+layout(std430, binding = 1) readonly buffer Objects
+{
+  Object objects[];
+};
+
+out gl_PerVertex
+{
+  vec4 gl_Position;
+};
+
+void main()
+{
+  Object object = objects[gl_InstanceIndex];
+
+  // rotation around the Y axis, like QMatrix4x4::rotate(angle, 0, 1, 0)
+  float angle = radians(frame.rotation + object.params.x);
+  float c = cos(angle);
+  float s = sin(angle);
+  vec3 p = position.xyz * object.params.y;
+  p = vec3(c * p.x + s * p.z, p.y, -s * p.x + c * p.z);
+
+  v_color = color;
+  gl_Position = frame.viewProj * vec4(object.sphere.xyz + p, 1.0);
+}
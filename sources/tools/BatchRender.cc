@@ -0,0 +1,292 @@
+/*
+ * Copyright (C) 2025 by Dirk Farin, Kronenstr. 49b, 70174 Stuttgart, Germany
+ *
+ * 2-Clause BSD
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer
+ *    in the documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+// qtskia-batch: renders many frames of a scene offline on all cores and reports the throughput
+// for different numbers of threads.
+//
+//   qtskia-batch [--scene spec] [--frames n] [--size WxH] [--threads 1,2,4,...]
+//                [--output dir] [--writers n] [--queue n] [--trace file]
+//
+// Pipeline: a work-stealing scheduler distributes the frame numbers over the render workers.
+// Each worker renders into its own raster surface and copies the result into a frame buffer
+// from a fixed pool. Writer threads encode the buffers to PNG (with --output) and return them
+// to the pool. When the writers fall behind, the pool runs empty and the workers wait.
+
+#include "core-config.h"
+#include "SkiaFontManager.h"
+#include "drawing/Drawing.h"
+#include "drawing/Scenes.h"
+#include "profiling/Tracing.h"
+#include "profiling/AllocTracker.h"
+#include "util/BoundedQueue.h"
+#include "util/WorkStealingScheduler.h"
+
+#include <core/SkCanvas.h>
+#include <core/SkPixmap.h>
+#include <core/SkStream.h>
+#include <core/SkSurface.h>
+#include <encode/SkPngEncoder.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+struct BatchOptions
+{
+  std::string scene = "default";
+  int frames = 1000;
+  int width = 1280;
+  int height = 720;
+  std::vector<int> threadCounts;
+  std::string outputDir; // empty = do not write
+  int writers = 1;
+  int queueSize = 0; // 0 = 2 per render thread
+};
+
+
+struct FrameBuffer
+{
+  int frame = 0;
+  std::vector<uint8_t> pixels;
+};
+
+
+struct BatchResult
+{
+  double seconds = 0;
+  uint64_t steals = 0;
+  double backpressureSeconds = 0; // time the render workers waited for free buffers
+};
+
+
+static BatchResult run_batch(const BatchOptions& opts, int nThreads)
+{
+  const SkImageInfo info = SkImageInfo::MakeN32Premul(opts.width, opts.height);
+  const size_t rowBytes = info.minRowBytes();
+
+  // --- per-worker state: surface and scene instance
+
+  struct Worker
+  {
+    sk_sp<SkSurface> surface;
+    std::unique_ptr<Scene> scene;
+  };
+
+  std::vector<Worker> workers(nThreads);
+  for (auto& w : workers) {
+    w.surface = SkSurfaces::Raster(info);
+    w.scene = create_scene(opts.scene);
+  }
+
+  // --- buffer pool and writer queue
+
+  int queueSize = opts.queueSize > 0 ? opts.queueSize : 2 * nThreads;
+  int nBuffers = queueSize + nThreads;
+
+  BoundedQueue<FrameBuffer*> freeBuffers(nBuffers);
+  BoundedQueue<FrameBuffer*> writeQueue(queueSize);
+
+  std::vector<FrameBuffer> buffers(nBuffers);
+  for (auto& b : buffers) {
+    b.pixels.resize(info.computeByteSize(rowBytes));
+    freeBuffers.push(&b);
+  }
+
+  std::atomic<int64_t> backpressureNs{0};
+
+  std::vector<std::thread> writers;
+  for (int i = 0; i < opts.writers; i++) {
+    writers.emplace_back([&] {
+      set_trace_thread_name("batch-writer");
+      set_alloc_thread_name("batch-writer");
+
+      FrameBuffer* buffer;
+      while (writeQueue.pop(buffer)) {
+        if (!opts.outputDir.empty()) {
+          TRACE_SCOPE("encode");
+
+          char filename[32];
+          snprintf(filename, sizeof(filename), "/frame%06d.png", buffer->frame);
+
+          SkFILEWStream stream((opts.outputDir + filename).c_str());
+          SkPixmap pixmap(info, buffer->pixels.data(), rowBytes);
+          if (!stream.isValid() || !SkPngEncoder::Encode(&stream, pixmap, {})) {
+            fprintf(stderr, "cannot write %s%s\n", opts.outputDir.c_str(), filename);
+          }
+        }
+
+        freeBuffers.push(buffer);
+      }
+    });
+  }
+
+  // --- render
+
+  WorkStealingScheduler scheduler(nThreads);
+
+  auto start = std::chrono::steady_clock::now();
+
+  scheduler.run(opts.frames, [&](int workerIdx, int frame) {
+    Worker& worker = workers[workerIdx];
+
+    draw_scene_frame(worker.scene.get(), worker.surface->getCanvas(), opts.width, opts.height, frame);
+
+    auto waitStart = std::chrono::steady_clock::now();
+    FrameBuffer* buffer;
+    freeBuffers.pop(buffer);
+    backpressureNs += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - waitStart).count();
+
+    buffer->frame = frame;
+    worker.surface->readPixels(info, buffer->pixels.data(), rowBytes, 0, 0);
+
+    writeQueue.push(buffer);
+  });
+
+  writeQueue.close();
+  for (auto& w : writers) {
+    w.join();
+  }
+
+  BatchResult result;
+  result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  result.steals = scheduler.stealCount();
+  result.backpressureSeconds = backpressureNs / 1e9;
+
+  return result;
+}
+
+
+static std::vector<int> default_thread_counts()
+{
+  int nCores = std::max(1, (int) std::thread::hardware_concurrency());
+
+  std::vector<int> counts;
+  for (int n = 1; n < nCores; n *= 2) {
+    counts.push_back(n);
+  }
+  counts.push_back(nCores);
+
+  return counts;
+}
+
+
+static std::vector<int> parse_int_list(const char* s)
+{
+  std::vector<int> values;
+  while (*s) {
+    char* end;
+    long v = strtol(s, &end, 10);
+    if (end == s) {
+      break;
+    }
+
+    if (v > 0) {
+      values.push_back((int) v);
+    }
+
+    s = (*end == ',') ? end + 1 : end;
+  }
+
+  return values;
+}
+
+
+static void usage()
+{
+  fprintf(stderr, "usage: qtskia-batch [--scene spec] [--frames n] [--size WxH] [--threads 1,2,4,...]\n"
+                  "                    [--output dir] [--writers n] [--queue n] [--trace file]\n");
+}
+
+
+int main(int argc, char** argv)
+{
+  install_skia_event_tracer();
+  set_trace_thread_name("main");
+  set_alloc_thread_name("main");
+
+  BatchOptions opts;
+
+  for (int i = 1; i < argc; i++) {
+    auto arg = [&](const char* name) { return strcmp(argv[i], name) == 0 && i + 1 < argc; };
+
+    if (arg("--scene")) { opts.scene = argv[++i]; }
+    else if (arg("--frames")) { opts.frames = atoi(argv[++i]); }
+    else if (arg("--size")) { sscanf(argv[++i], "%dx%d", &opts.width, &opts.height); }
+    else if (arg("--threads")) { opts.threadCounts = parse_int_list(argv[++i]); }
+    else if (arg("--output")) { opts.outputDir = argv[++i]; }
+    else if (arg("--writers")) { opts.writers = std::max(1, atoi(argv[++i])); }
+    else if (arg("--queue")) { opts.queueSize = atoi(argv[++i]); }
+    else if (arg("--trace")) {
+      set_trace_file(argv[++i]);
+      set_tracing_enabled(true);
+    }
+    else {
+      usage();
+      return 1;
+    }
+  }
+
+  if (opts.threadCounts.empty()) {
+    opts.threadCounts = default_thread_counts();
+  }
+
+  // The speedup is relative to a single thread, so that run always comes first.
+  opts.threadCounts.erase(std::remove(opts.threadCounts.begin(), opts.threadCounts.end(), 1), opts.threadCounts.end());
+  opts.threadCounts.insert(opts.threadCounts.begin(), 1);
+
+  set_global_skia_font_manager_from_fonts_directory(config_fonts_dir());
+
+  if (!create_scene(opts.scene)) {
+    fprintf(stderr, "unknown scene: %s\n", opts.scene.c_str());
+    return 1;
+  }
+
+  printf("scene %s, %d frames of %dx%d, %d writer(s)%s\n", opts.scene.c_str(), opts.frames, opts.width, opts.height,
+         opts.writers, opts.outputDir.empty() ? ", no output" : "");
+  printf("%8s %10s %9s %11s %8s %14s\n", "threads", "frames/s", "speedup", "efficiency", "steals", "backpressure");
+
+  double singleThreadFps = 0;
+
+  for (int nThreads : opts.threadCounts) {
+    BatchResult r = run_batch(opts, nThreads);
+
+    double fps = opts.frames / r.seconds;
+    if (nThreads == 1) {
+      singleThreadFps = fps;
+    }
+
+    double speedup = fps / singleThreadFps;
+    printf("%8d %10.1f %8.2fx %10.0f%% %8llu %12.2f s\n", nThreads, fps, speedup, 100 * speedup / nThreads,
+           (unsigned long long) r.steals, r.backpressureSeconds);
+  }
+
+  if (tracing_enabled()) {
+    toggle_tracing(); // writes the trace file
+  }
+
+  return 0;
+}
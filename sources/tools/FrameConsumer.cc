@@ -0,0 +1,233 @@
+/*
+ * Copyright (C) 2025 by Dirk Farin, Kronenstr. 49b, 70174 Stuttgart, Germany
+ *
+ * 2-Clause BSD
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer
+ *    in the documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+// qtskia-frame-consumer: test consumer for the frame export of qtskia (--export-socket).
+//
+//   qtskia-frame-consumer [--socket path] [--hold-ms n] [--seconds n]
+//
+// Maps the exported buffers once, reads every frame in place (touching each cache line, like
+// an encoder would) and gives the buffer back. Prints the throughput and the number of frames
+// the producer could not export once per second. With --hold-ms, each buffer is kept for the
+// given time to simulate a slow encoder.
+
+#include "drawing/FrameExport.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using frame_export::Message;
+using frame_export::MessageType;
+
+
+struct MappedBuffers
+{
+  std::vector<const uint8_t*> pixels;
+  size_t size = 0;
+  uint32_t generation = 0;
+
+  void unmap()
+  {
+    for (auto* p : pixels) {
+      munmap((void*) p, size);
+    }
+    pixels.clear();
+  }
+};
+
+
+static bool receive(int fd, Message* msg, int* fds, int* nFds)
+{
+  iovec iov{msg, sizeof(*msg)};
+
+  alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int) * frame_export::kMaxBuffers)];
+
+  msghdr mh{};
+  mh.msg_iov = &iov;
+  mh.msg_iovlen = 1;
+  mh.msg_control = control;
+  mh.msg_controllen = sizeof(control);
+
+  ssize_t n = recvmsg(fd, &mh, MSG_CMSG_CLOEXEC);
+  if (n != sizeof(*msg)) {
+    return false;
+  }
+
+  *nFds = 0;
+  for (cmsghdr* cmsg = CMSG_FIRSTHDR(&mh); cmsg; cmsg = CMSG_NXTHDR(&mh, cmsg)) {
+    if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS) {
+      *nFds = (int) ((cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int));
+      memcpy(fds, CMSG_DATA(cmsg), sizeof(int) * *nFds);
+    }
+  }
+
+  return true;
+}
+
+
+// Reads one 32-bit word per cache line.
+static uint32_t touch_frame(const uint8_t* pixels, const Message& frame)
+{
+  uint32_t sum = 0;
+  for (uint32_t y = 0; y < frame.height; y++) {
+    const uint8_t* row = pixels + (size_t) y * frame.rowBytes;
+    for (uint32_t x = 0; x < frame.width * 4; x += 64) {
+      uint32_t v;
+      memcpy(&v, row + x, sizeof(v));
+      sum += v;
+    }
+  }
+
+  return sum;
+}
+
+
+static void usage()
+{
+  fprintf(stderr, "usage: qtskia-frame-consumer [--socket path] [--hold-ms n] [--seconds n]\n");
+}
+
+
+int main(int argc, char** argv)
+{
+  std::string socketPath = "/tmp/qtskia-frames";
+  int holdMs = 0;
+  int seconds = 0; // 0 = until the producer disconnects
+
+  for (int i = 1; i < argc; i++) {
+    auto arg = [&](const char* name) { return strcmp(argv[i], name) == 0 && i + 1 < argc; };
+
+    if (arg("--socket")) { socketPath = argv[++i]; }
+    else if (arg("--hold-ms")) { holdMs = atoi(argv[++i]); }
+    else if (arg("--seconds")) { seconds = atoi(argv[++i]); }
+    else {
+      usage();
+      return 1;
+    }
+  }
+
+  int fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+
+  sockaddr_un addr{};
+  addr.sun_family = AF_UNIX;
+  strncpy(addr.sun_path, socketPath.c_str(), sizeof(addr.sun_path) - 1);
+
+  if (fd < 0 || connect(fd, (sockaddr*) &addr, sizeof(addr)) < 0) {
+    perror("connect");
+    return 1;
+  }
+
+  printf("connected to %s\n", socketPath.c_str());
+
+  using Clock = std::chrono::steady_clock;
+  const auto start = Clock::now();
+  auto intervalStart = start;
+
+  MappedBuffers buffers;
+  uint64_t lastSequence = 0;
+  bool haveSequence = false;
+  uint64_t intervalFrames = 0, intervalBytes = 0, intervalGaps = 0;
+  uint32_t checksum = 0;
+
+  for (;;) {
+    Message msg;
+    int fds[frame_export::kMaxBuffers];
+    int nFds = 0;
+
+    if (!receive(fd, &msg, fds, &nFds)) {
+      printf("producer disconnected\n");
+      break;
+    }
+
+    if (msg.type == MessageType::BufferSet) {
+      buffers.unmap();
+      buffers.size = msg.bufferSize;
+      buffers.generation = msg.generation;
+
+      for (int i = 0; i < nFds; i++) {
+        void* p = mmap(nullptr, msg.bufferSize, PROT_READ, MAP_SHARED, fds[i], 0);
+        close(fds[i]); // the mapping keeps the memory alive
+        if (p == MAP_FAILED) {
+          perror("mmap");
+          return 1;
+        }
+        buffers.pixels.push_back((const uint8_t*) p);
+      }
+
+      printf("buffers: %d x %u x %u (generation %u)\n", nFds, msg.width, msg.height, msg.generation);
+    }
+    else if (msg.type == MessageType::Frame) {
+      if (msg.generation != buffers.generation || msg.index >= buffers.pixels.size()) {
+        continue;
+      }
+
+      if (haveSequence && msg.sequence > lastSequence + 1) {
+        intervalGaps += msg.sequence - lastSequence - 1;
+      }
+      lastSequence = msg.sequence;
+      haveSequence = true;
+
+      checksum += touch_frame(buffers.pixels[msg.index], msg);
+
+      if (holdMs > 0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(holdMs));
+      }
+
+      Message release{};
+      release.type = MessageType::Release;
+      release.generation = msg.generation;
+      release.index = msg.index;
+      release.sequence = msg.sequence;
+      if (send(fd, &release, sizeof(release), MSG_NOSIGNAL) != sizeof(release)) {
+        printf("producer disconnected\n");
+        break;
+      }
+
+      intervalFrames++;
+      intervalBytes += (uint64_t) msg.rowBytes * msg.height;
+    }
+
+    auto now = Clock::now();
+    double dt = std::chrono::duration<double>(now - intervalStart).count();
+    if (dt >= 1.0) {
+      printf("%.1f frames/s  %.1f MB/s  %llu frames skipped by producer  (checksum %08x)\n",
+             intervalFrames / dt, intervalBytes / dt / (1024 * 1024),
+             (unsigned long long) intervalGaps, checksum);
+      intervalStart = now;
+      intervalFrames = intervalBytes = intervalGaps = 0;
+    }
+
+    if (seconds > 0 && now - start >= std::chrono::seconds(seconds)) {
+      break;
+    }
+  }
+
+  buffers.unmap();
+  close(fd);
+
+  return 0;
+}
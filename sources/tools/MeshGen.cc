@@ -0,0 +1,145 @@
+/*
+ * Copyright (C) 2025 by Dirk Farin, Kronenstr. 49b, 70174 Stuttgart, Germany
+ *
+ * 2-Clause BSD
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer
+ *    in the documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+// qtskia-meshgen: writes test meshes in the .qmesh format for the native Vulkan renderer (--mesh).
+//
+//   qtskia-meshgen [--segments n] [--check] output.qmesh
+//
+// The mesh is a sphere of radius 0.5 with n segments around and n/2 rings, (n+1)*(n/2+1)
+// vertices and 3*n*n triangles, colored by its normals. --segments 2000 gives about 2M vertices
+// (48 MB) and 12M indices (48 MB). --check maps the written file again and validates it.
+
+#include "drawing/MeshFile.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+
+static void usage()
+{
+  fprintf(stderr, "usage: qtskia-meshgen [--segments n] [--check] output.qmesh\n");
+}
+
+
+static void generate_sphere(int segments, std::vector<float>& vertices, std::vector<uint32_t>& indices)
+{
+  const int rings = std::max(2, segments / 2);
+  const float pi = 3.14159265f;
+
+  for (int r = 0; r <= rings; r++) {
+    float theta = pi * r / rings;
+
+    for (int s = 0; s <= segments; s++) {
+      float phi = 2 * pi * s / segments;
+
+      float nx = std::sin(theta) * std::cos(phi);
+      float ny = std::cos(theta);
+      float nz = std::sin(theta) * std::sin(phi);
+
+      const float v[6] = { 0.5f * nx, 0.5f * ny, 0.5f * nz, 0.5f + 0.5f * nx, 0.5f + 0.5f * ny, 0.5f + 0.5f * nz };
+      vertices.insert(vertices.end(), v, v + 6);
+    }
+  }
+
+  const uint32_t rowLength = segments + 1;
+
+  for (int r = 0; r < rings; r++) {
+    for (int s = 0; s < segments; s++) {
+      uint32_t a = r * rowLength + s;
+      uint32_t b = a + rowLength;
+
+      const uint32_t quad[6] = { a, b, a + 1, a + 1, b, b + 1 };
+      indices.insert(indices.end(), quad, quad + 6);
+    }
+  }
+}
+
+
+int main(int argc, char** argv)
+{
+  int segments = 64;
+  bool check = false;
+  std::string output;
+
+  for (int i = 1; i < argc; i++) {
+    auto arg = [&](const char* name) { return strcmp(argv[i], name) == 0 && i + 1 < argc; };
+
+    if (arg("--segments")) { segments = std::max(3, atoi(argv[++i])); }
+    else if (strcmp(argv[i], "--check") == 0) { check = true; }
+    else if (argv[i][0] != '-' && output.empty()) { output = argv[i]; }
+    else {
+      usage();
+      return 1;
+    }
+  }
+
+  if (output.empty()) {
+    usage();
+    return 1;
+  }
+
+  std::vector<float> vertices;
+  std::vector<uint32_t> indices;
+  generate_sphere(segments, vertices, indices);
+
+  uint32_t vertexCount = (uint32_t) (vertices.size() / 6);
+
+  if (!write_mesh_file(output, vertices.data(), vertexCount, indices.data(), (uint32_t) indices.size())) {
+    fprintf(stderr, "cannot write %s\n", output.c_str());
+    return 1;
+  }
+
+  printf("%s: %u vertices, %zu indices\n", output.c_str(), vertexCount, indices.size());
+
+  if (check) {
+    auto start = std::chrono::steady_clock::now();
+
+    MeshFile mesh;
+    std::string error;
+    if (!mesh.open(output, &error)) {
+      fprintf(stderr, "%s: %s\n", output.c_str(), error.c_str());
+      return 1;
+    }
+
+    // read every page, like the copy into a staging buffer
+    volatile uint8_t sink = 0;
+    for (size_t i = 0; i < mesh.vertexBytes(); i += 4096) sink = sink + mesh.vertexData()[i];
+    for (size_t i = 0; i < mesh.indexBytes(); i += 4096) sink = sink + mesh.indexData()[i];
+
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    double mb = mesh.fileSize() / (1024.0 * 1024.0);
+
+    bool same = mesh.header().vertexCount == vertexCount && mesh.header().indexCount == indices.size() &&
+                memcmp(mesh.vertexData(), vertices.data(), mesh.vertexBytes()) == 0;
+
+    printf("check: %s, %.1f MB mapped and read in %.2f ms (%.3f ms/MB)\n", same ? "ok" : "MISMATCH", mb, ms, ms / mb);
+
+    if (!same) {
+      return 1;
+    }
+  }
+
+  return 0;
+}
@@ -0,0 +1,407 @@
+/*
+ * Copyright (C) 2025 by Dirk Farin, Kronenstr. 49b, 70174 Stuttgart, Germany
+ *
+ * 2-Clause BSD
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer
+ *    in the documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+// qtskia-skp-replay: plays back a captured frame (.skp, see FrameCapture.h) many times and
+// reports the playback time and a breakdown by drawing operation.
+//
+//   qtskia-skp-replay [--runs n] [--backend raster|gl|all] file.skp ...
+//
+// For each backend, the picture is first played back 'runs' times as a whole (total time
+// statistics), then 'runs' times through a canvas that times each operation.
+//
+// With the raster backend, the time of an operation is the time to rasterize it. With OpenGL,
+// Skia only records the operations and executes them at flush, so the per-operation times are
+// CPU recording costs and the GPU work shows up as 'flush'.
+
+#include "core-config.h"
+#include "SkiaFontManager.h"
+#include "profiling/FrameCapture.h"
+
+#include <QGuiApplication>
+#include <QOffscreenSurface>
+#include <QOpenGLContext>
+
+#include <core/SkCanvas.h>
+#include <core/SkData.h>
+#include <core/SkPicture.h>
+#include <core/SkSurface.h>
+#include <utils/SkNWayCanvas.h>
+
+#ifdef _WIN32 // TODO(skia): how can we test the skia version?
+#include "gpu/GrDirectContext.h"
+#include <gpu/gl/GrGLInterface.h>
+#include <gpu/ganesh/gl/GrGLDirectContext.h>
+#include <gpu/ganesh/SkSurfaceGanesh.h>
+#else
+#include "gpu/ganesh/GrDirectContext.h"
+#include "gpu/ganesh/gl/GrGLInterface.h"
+#include <gpu/ganesh/gl/GrGLDirectContext.h>
+#include <gpu/ganesh/SkSurfaceGanesh.h>
+#endif
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+
+using Clock = std::chrono::steady_clock;
+
+
+enum class Op
+{
+  Paint, Points, Rect, Region, Oval, Arc, RRect, DRRect, Path, Image, ImageRect,
+  TextBlob, Vertices, SaveLayer, Restore, NumOps
+};
+
+static const char* const sOpNames[] = {
+    "drawPaint", "drawPoints", "drawRect", "drawRegion", "drawOval", "drawArc", "drawRRect",
+    "drawDRRect", "drawPath", "drawImage", "drawImageRect", "drawTextBlob", "drawVertices",
+    "saveLayer", "restore"
+};
+
+static_assert(sizeof(sOpNames) / sizeof(sOpNames[0]) == (int) Op::NumOps);
+
+
+struct OpTimes
+{
+  uint64_t count[(int) Op::NumOps]{};
+  double ms[(int) Op::NumOps]{};
+};
+
+
+// Forwards all drawing to the target canvas and measures the time of each operation.
+class TimingCanvas : public SkNWayCanvas
+{
+public:
+  TimingCanvas(SkCanvas* target, OpTimes* times)
+      : SkNWayCanvas(target->getBaseLayerSize().width(), target->getBaseLayerSize().height()),
+        mTimes(times)
+  {
+    addCanvas(target);
+  }
+
+private:
+  OpTimes* mTimes;
+
+  class Timer
+  {
+  public:
+    Timer(OpTimes* times, Op op) : mTimes(times), mOp(op), mStart(Clock::now()) {}
+
+    ~Timer()
+    {
+      mTimes->count[(int) mOp]++;
+      mTimes->ms[(int) mOp] += std::chrono::duration<double, std::milli>(Clock::now() - mStart).count();
+    }
+
+  private:
+    OpTimes* mTimes;
+    Op mOp;
+    Clock::time_point mStart;
+  };
+
+protected:
+  void onDrawPaint(const SkPaint& paint) override
+  {
+    Timer t(mTimes, Op::Paint);
+    SkNWayCanvas::onDrawPaint(paint);
+  }
+
+  void onDrawPoints(PointMode mode, size_t count, const SkPoint pts[], const SkPaint& paint) override
+  {
+    Timer t(mTimes, Op::Points);
+    SkNWayCanvas::onDrawPoints(mode, count, pts, paint);
+  }
+
+  void onDrawRect(const SkRect& rect, const SkPaint& paint) override
+  {
+    Timer t(mTimes, Op::Rect);
+    SkNWayCanvas::onDrawRect(rect, paint);
+  }
+
+  void onDrawRegion(const SkRegion& region, const SkPaint& paint) override
+  {
+    Timer t(mTimes, Op::Region);
+    SkNWayCanvas::onDrawRegion(region, paint);
+  }
+
+  void onDrawOval(const SkRect& rect, const SkPaint& paint) override
+  {
+    Timer t(mTimes, Op::Oval);
+    SkNWayCanvas::onDrawOval(rect, paint);
+  }
+
+  void onDrawArc(const SkRect& rect, SkScalar start, SkScalar sweep, bool useCenter, const SkPaint& paint) override
+  {
+    Timer t(mTimes, Op::Arc);
+    SkNWayCanvas::onDrawArc(rect, start, sweep, useCenter, paint);
+  }
+
+  void onDrawRRect(const SkRRect& rrect, const SkPaint& paint) override
+  {
+    Timer t(mTimes, Op::RRect);
+    SkNWayCanvas::onDrawRRect(rrect, paint);
+  }
+
+  void onDrawDRRect(const SkRRect& outer, const SkRRect& inner, const SkPaint& paint) override
+  {
+    Timer t(mTimes, Op::DRRect);
+    SkNWayCanvas::onDrawDRRect(outer, inner, paint);
+  }
+
+  void onDrawPath(const SkPath& path, const SkPaint& paint) override
+  {
+    Timer t(mTimes, Op::Path);
+    SkNWayCanvas::onDrawPath(path, paint);
+  }
+
+  void onDrawImage2(const SkImage* image, SkScalar x, SkScalar y, const SkSamplingOptions& sampling,
+                    const SkPaint* paint) override
+  {
+    Timer t(mTimes, Op::Image);
+    SkNWayCanvas::onDrawImage2(image, x, y, sampling, paint);
+  }
+
+  void onDrawImageRect2(const SkImage* image, const SkRect& src, const SkRect& dst, const SkSamplingOptions& sampling,
+                        const SkPaint* paint, SrcRectConstraint constraint) override
+  {
+    Timer t(mTimes, Op::ImageRect);
+    SkNWayCanvas::onDrawImageRect2(image, src, dst, sampling, paint, constraint);
+  }
+
+  void onDrawTextBlob(const SkTextBlob* blob, SkScalar x, SkScalar y, const SkPaint& paint) override
+  {
+    Timer t(mTimes, Op::TextBlob);
+    SkNWayCanvas::onDrawTextBlob(blob, x, y, paint);
+  }
+
+  void onDrawVerticesObject(const SkVertices* vertices, SkBlendMode mode, const SkPaint& paint) override
+  {
+    Timer t(mTimes, Op::Vertices);
+    SkNWayCanvas::onDrawVerticesObject(vertices, mode, paint);
+  }
+
+  // Nested pictures are played back through this canvas, so that their operations are timed too.
+  void onDrawPicture(const SkPicture* picture, const SkMatrix* matrix, const SkPaint* paint) override
+  {
+    SkCanvas::onDrawPicture(picture, matrix, paint);
+  }
+
+  SaveLayerStrategy getSaveLayerStrategy(const SaveLayerRec& rec) override
+  {
+    Timer t(mTimes, Op::SaveLayer);
+    return SkNWayCanvas::getSaveLayerStrategy(rec);
+  }
+
+  // Composites the layer when a saveLayer() is restored.
+  void willRestore() override
+  {
+    Timer t(mTimes, Op::Restore);
+    SkNWayCanvas::willRestore();
+  }
+};
+
+
+struct ReplayResult
+{
+  std::vector<double> totalMs;
+  OpTimes ops;
+  double timedPlaybackMs = 0;
+  double flushMs = 0;
+};
+
+
+static double ms_since(Clock::time_point start)
+{
+  return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+
+static ReplayResult replay(const SkPicture* picture, SkSurface* surface, GrDirectContext* context, int nRuns)
+{
+  ReplayResult result;
+  SkCanvas* canvas = surface->getCanvas();
+
+  auto finish = [&] {
+    if (context) {
+      context->flushAndSubmit(GrSyncCpu::kYes);
+    }
+  };
+
+  // warm-up: caches, glyph atlas, shader compilation
+  canvas->clear(SK_ColorWHITE);
+  canvas->drawPicture(picture);
+  finish();
+
+  for (int i = 0; i < nRuns; i++) {
+    auto start = Clock::now();
+    canvas->clear(SK_ColorWHITE);
+    canvas->drawPicture(picture);
+    finish();
+    result.totalMs.push_back(ms_since(start));
+  }
+
+  for (int i = 0; i < nRuns; i++) {
+    canvas->clear(SK_ColorWHITE);
+
+    TimingCanvas timingCanvas(canvas, &result.ops);
+
+    auto start = Clock::now();
+    picture->playback(&timingCanvas);
+    result.timedPlaybackMs += ms_since(start);
+
+    start = Clock::now();
+    finish();
+    result.flushMs += ms_since(start);
+  }
+
+  return result;
+}
+
+
+static void print_result(const char* backend, const ReplayResult& result, int nRuns, bool gpu)
+{
+  std::vector<double> total = result.totalMs;
+  std::sort(total.begin(), total.end());
+
+  printf("\n%s: %d runs, min %.3f ms, median %.3f ms, p90 %.3f ms, max %.3f ms\n", backend, nRuns,
+         total.front(), total[total.size() / 2], total[std::min(total.size() - 1, total.size() * 9 / 10)], total.back());
+
+  int order[(int) Op::NumOps];
+  for (int i = 0; i < (int) Op::NumOps; i++) {
+    order[i] = i;
+  }
+  std::sort(order, order + (int) Op::NumOps, [&](int a, int b) { return result.ops.ms[a] > result.ops.ms[b]; });
+
+  double timedSum = 0;
+  for (double ms : result.ops.ms) {
+    timedSum += ms;
+  }
+
+  double perRun = result.timedPlaybackMs / nRuns;
+
+  printf("  %-16s %10s %12s %12s %8s\n", "operation", "count/run", "ms/run", "us/op", "share");
+  for (int i : order) {
+    if (!result.ops.count[i]) {
+      continue;
+    }
+
+    printf("  %-16s %10llu %12.3f %12.2f %7.1f%%\n", sOpNames[i],
+           (unsigned long long) (result.ops.count[i] / nRuns), result.ops.ms[i] / nRuns,
+           1000.0 * result.ops.ms[i] / result.ops.count[i], 100.0 * result.ops.ms[i] / result.timedPlaybackMs);
+  }
+
+  // state changes (save, concat, clip) and operations that are not timed individually
+  printf("  %-16s %10s %12.3f %12s %7.1f%%\n", "other", "", (result.timedPlaybackMs - timedSum) / nRuns, "",
+         100.0 * (result.timedPlaybackMs - timedSum) / result.timedPlaybackMs);
+
+  if (gpu) {
+    printf("  %-16s %10s %12.3f   (GPU execution, per run)\n", "flush", "", result.flushMs / nRuns);
+  }
+
+  printf("  playback with timing: %.3f ms/run\n", perRun);
+}
+
+
+static void usage()
+{
+  fprintf(stderr, "usage: qtskia-skp-replay [--runs n] [--backend raster|gl|all] file.skp ...\n");
+}
+
+
+int main(int argc, char** argv)
+{
+  int nRuns = 50;
+  std::string backend = "all";
+  std::vector<std::string> files;
+
+  for (int i = 1; i < argc; i++) {
+    auto arg = [&](const char* name) { return strcmp(argv[i], name) == 0 && i + 1 < argc; };
+
+    if (arg("--runs")) { nRuns = std::max(1, atoi(argv[++i])); }
+    else if (arg("--backend")) { backend = argv[++i]; }
+    else if (argv[i][0] == '-') {
+      usage();
+      return 1;
+    }
+    else {
+      files.push_back(argv[i]);
+    }
+  }
+
+  if (files.empty() || (backend != "raster" && backend != "gl" && backend != "all")) {
+    usage();
+    return 1;
+  }
+
+  QGuiApplication app(argc, argv);
+
+  // The embedded typefaces are created through the font manager.
+  set_global_skia_font_manager_from_fonts_directory(config_fonts_dir());
+
+  for (const auto& file : files) {
+    sk_sp<SkData> data = SkData::MakeFromFileName(file.c_str());
+    sk_sp<SkPicture> picture = data ? deserialize_picture(data->data(), data->size()) : nullptr;
+    if (!picture) {
+      fprintf(stderr, "cannot read %s\n", file.c_str());
+      return 1;
+    }
+
+    SkIRect bounds = picture->cullRect().roundOut();
+    int w = std::max(1, bounds.right()), h = std::max(1, bounds.bottom());
+
+    printf("%s: %d x %d, %d operations\n", file.c_str(), w, h, picture->approximateOpCount(true));
+
+    if (backend == "raster" || backend == "all") {
+      sk_sp<SkSurface> surface = SkSurfaces::Raster(SkImageInfo::MakeN32Premul(w, h));
+      print_result("raster", replay(picture.get(), surface.get(), nullptr, nRuns), nRuns, false);
+    }
+
+    if (backend == "gl" || backend == "all") {
+      QOffscreenSurface offscreen;
+      offscreen.create();
+
+      QOpenGLContext glContext;
+      if (!glContext.create() || !glContext.makeCurrent(&offscreen)) {
+        fprintf(stderr, "cannot create OpenGL context\n");
+        return 1;
+      }
+
+      sk_sp<GrDirectContext> context = GrDirectContexts::MakeGL(GrGLMakeNativeInterface());
+      sk_sp<SkSurface> surface = context ? SkSurfaces::RenderTarget(context.get(), skgpu::Budgeted::kNo,
+                                                                    SkImageInfo::MakeN32Premul(w, h)) : nullptr;
+      if (!surface) {
+        fprintf(stderr, "cannot create OpenGL surface\n");
+        return 1;
+      }
+
+      print_result("opengl", replay(picture.get(), surface.get(), context.get(), nRuns), nRuns, true);
+
+      surface = nullptr;
+      context = nullptr;
+      glContext.doneCurrent();
+    }
+  }
+
+  return 0;
+}
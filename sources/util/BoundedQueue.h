@@ -0,0 +1,117 @@
+/*
+ * Copyright (C) 2025 by Dirk Farin, Kronenstr. 49b, 70174 Stuttgart, Germany
+ *
+ * 2-Clause BSD
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer
+ *    in the documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef BOUNDEDQUEUE_H
+#define BOUNDEDQUEUE_H
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+
+
+// Multi-producer/multi-consumer FIFO with a fixed capacity. push() blocks while the queue is
+// full, which slows producers down to the rate of the consumers (backpressure).
+
+template <class T>
+class BoundedQueue
+{
+public:
+  explicit BoundedQueue(size_t capacity) : mCapacity(capacity) {}
+
+  // Blocks while the queue is full. Returns false if the queue has been closed.
+  bool push(T item)
+  {
+    std::unique_lock<std::mutex> lock(mMutex);
+
+    if (mItems.size() >= mCapacity && !mClosed) {
+      auto start = std::chrono::steady_clock::now();
+      mNotFull.wait(lock, [this] { return mItems.size() < mCapacity || mClosed; });
+      mBlockedTime += std::chrono::steady_clock::now() - start;
+      mBlockedPushes++;
+    }
+
+    if (mClosed) {
+      return false;
+    }
+
+    mItems.push_back(std::move(item));
+    lock.unlock();
+
+    mNotEmpty.notify_one();
+    return true;
+  }
+
+  // Blocks while the queue is empty. Returns false if the queue is closed and empty.
+  bool pop(T& item)
+  {
+    std::unique_lock<std::mutex> lock(mMutex);
+    mNotEmpty.wait(lock, [this] { return !mItems.empty() || mClosed; });
+
+    if (mItems.empty()) {
+      return false;
+    }
+
+    item = std::move(mItems.front());
+    mItems.pop_front();
+    lock.unlock();
+
+    mNotFull.notify_one();
+    return true;
+  }
+
+  // Wakes up all waiting threads. Remaining items can still be popped.
+  void close()
+  {
+    {
+      std::lock_guard<std::mutex> lock(mMutex);
+      mClosed = true;
+    }
+
+    mNotEmpty.notify_all();
+    mNotFull.notify_all();
+  }
+
+  // Number of push() calls that had to wait, and their total waiting time.
+  int blockedPushes() const
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mBlockedPushes;
+  }
+
+  double blockedSeconds() const
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return std::chrono::duration<double>(mBlockedTime).count();
+  }
+
+private:
+  const size_t mCapacity;
+  std::deque<T> mItems;
+  bool mClosed = false;
+
+  mutable std::mutex mMutex;
+  std::condition_variable mNotEmpty;
+  std::condition_variable mNotFull;
+
+  int mBlockedPushes = 0;
+  std::chrono::steady_clock::duration mBlockedTime{};
+};
+
+#endif
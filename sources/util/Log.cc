@@ -0,0 +1,266 @@
+/*
+ * Copyright (C) 2025 by Dirk Farin, Kronenstr. 49b, 70174 Stuttgart, Germany
+ *
+ * 2-Clause BSD
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer
+ *    in the documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "Log.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+std::atomic<int> g_log_level{(int) LogLevel::Info};
+
+
+namespace {
+
+const size_t kRecordsPerThread = 512;
+const size_t kRecordTextSize = 240;
+
+struct LogRecord
+{
+  uint64_t timeNs;
+  LogLevel level;
+  char text[kRecordTextSize];
+};
+
+// Single producer (the owning thread), single consumer (whoever holds sDrainMutex).
+// 'head' is written by the producer, 'tail' by the consumer.
+struct ThreadLogBuffer
+{
+  uint32_t tid = 0;
+  std::string threadName;
+  std::unique_ptr<LogRecord[]> records;
+  std::atomic<size_t> head{0};
+  std::atomic<size_t> tail{0};
+  std::atomic<size_t> dropped{0};
+};
+
+// Never destroyed, so that threads may still log during static destruction.
+struct LogRegistry
+{
+  std::mutex mutex;
+  std::vector<std::unique_ptr<ThreadLogBuffer>> buffers;
+
+  std::mutex drainMutex;
+
+  std::mutex wakeMutex;
+  std::condition_variable wake;
+  bool urgent = false;
+};
+
+LogRegistry& registry()
+{
+  static LogRegistry* sRegistry = new LogRegistry;
+  return *sRegistry;
+}
+
+thread_local ThreadLogBuffer* tBuffer = nullptr;
+
+const auto sLogEpoch = std::chrono::steady_clock::now();
+
+const char kLevelChars[] = "TDIWE";
+
+struct
+{
+  LogLevel level;
+  const char* name;
+} sLogLevelNames[] = {
+    {LogLevel::Trace, "trace"},
+    {LogLevel::Debug, "debug"},
+    {LogLevel::Info, "info"},
+    {LogLevel::Warning, "warning"},
+    {LogLevel::Error, "error"}
+};
+
+
+void drain()
+{
+  LogRegistry& reg = registry();
+  std::lock_guard<std::mutex> drainLock(reg.drainMutex);
+
+  std::vector<ThreadLogBuffer*> buffers;
+  {
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    for (auto& b : reg.buffers) {
+      buffers.push_back(b.get());
+    }
+  }
+
+  // Messages are written per thread. Across threads, they may be out of order by up to one
+  // drain interval; the timestamps tell the real order.
+  for (ThreadLogBuffer* buffer : buffers) {
+    size_t tail = buffer->tail.load(std::memory_order_relaxed);
+    size_t head = buffer->head.load(std::memory_order_acquire);
+
+    for (; tail != head; tail++) {
+      const LogRecord& r = buffer->records[tail % kRecordsPerThread];
+      fprintf(stderr, "[%10.3f] %c %-12s %s\n", r.timeNs / 1e9, kLevelChars[(int) r.level],
+              buffer->threadName.c_str(), r.text);
+    }
+
+    buffer->tail.store(tail, std::memory_order_release);
+
+    size_t dropped = buffer->dropped.exchange(0, std::memory_order_relaxed);
+    if (dropped) {
+      fprintf(stderr, "[log] %zu messages of thread '%s' dropped\n", dropped, buffer->threadName.c_str());
+    }
+  }
+
+  fflush(stderr);
+}
+
+
+void drain_thread()
+{
+  LogRegistry& reg = registry();
+
+  for (;;) {
+    {
+      std::unique_lock<std::mutex> lock(reg.wakeMutex);
+      reg.wake.wait_for(lock, std::chrono::milliseconds(50), [&reg] { return reg.urgent; });
+      reg.urgent = false;
+    }
+
+    drain();
+  }
+}
+
+
+void start_drain_thread()
+{
+  static std::once_flag sStarted;
+  std::call_once(sStarted, [] {
+    std::thread(drain_thread).detach();
+    atexit(flush_log);
+  });
+}
+
+
+ThreadLogBuffer* thread_buffer()
+{
+  if (!tBuffer) {
+    start_drain_thread();
+
+    auto buffer = std::make_unique<ThreadLogBuffer>();
+
+    LogRegistry& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    buffer->tid = (uint32_t) reg.buffers.size() + 1;
+    buffer->threadName = "thread " + std::to_string(buffer->tid);
+    tBuffer = buffer.get();
+    reg.buffers.push_back(std::move(buffer));
+  }
+
+  return tBuffer;
+}
+
+}
+
+
+void set_log_level(LogLevel level)
+{
+  g_log_level.store((int) level, std::memory_order_relaxed);
+}
+
+
+const char* log_level_name(LogLevel level)
+{
+  for (const auto& l : sLogLevelNames) {
+    if (l.level == level) {
+      return l.name;
+    }
+  }
+
+  return "unknown";
+}
+
+
+bool parse_log_level(const std::string& name, LogLevel* level)
+{
+  for (const auto& l : sLogLevelNames) {
+    if (name == l.name) {
+      *level = l.level;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+
+void set_log_thread_name(const char* name)
+{
+  ThreadLogBuffer* buffer = thread_buffer();
+
+  // The name is read by the drain thread.
+  std::lock_guard<std::mutex> lock(registry().drainMutex);
+  buffer->threadName = name;
+}
+
+
+void log_message(LogLevel level, const char* format, ...)
+{
+  ThreadLogBuffer* buffer = thread_buffer();
+
+  // allocated on first use so that threads that only set their name do not pay for it
+  if (!buffer->records) {
+    buffer->records.reset(new LogRecord[kRecordsPerThread]);
+  }
+
+  size_t head = buffer->head.load(std::memory_order_relaxed);
+  if (head - buffer->tail.load(std::memory_order_acquire) == kRecordsPerThread) {
+    buffer->dropped.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+
+  LogRecord& r = buffer->records[head % kRecordsPerThread];
+  r.timeNs = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - sLogEpoch).count();
+  r.level = level;
+
+  va_list args;
+  va_start(args, format);
+  vsnprintf(r.text, kRecordTextSize, format, args);
+  va_end(args);
+
+  buffer->head.store(head + 1, std::memory_order_release);
+
+  // Errors are written right away, everything else with the next periodic drain.
+  if (level >= LogLevel::Error) {
+    LogRegistry& reg = registry();
+    {
+      std::lock_guard<std::mutex> lock(reg.wakeMutex);
+      reg.urgent = true;
+    }
+    reg.wake.notify_one();
+  }
+}
+
+
+void flush_log()
+{
+  drain();
+}
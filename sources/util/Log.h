@@ -0,0 +1,88 @@
+/*
+ * Copyright (C) 2025 by Dirk Farin, Kronenstr. 49b, 70174 Stuttgart, Germany
+ *
+ * 2-Clause BSD
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer
+ *    in the documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef LOG_H
+#define LOG_H
+
+#include <atomic>
+#include <string>
+
+
+// Logging for the render loops.
+//
+// A message is formatted into a fixed-size record in a buffer of the calling thread (no lock,
+// no allocation, no system call) and written to stderr later by a background thread. When a
+// thread logs faster than the messages are written, messages are dropped and counted.
+//
+// Levels below IM_LOG_MIN_LEVEL (CMake option IM_LOG_LEVEL) are removed at compile time,
+// including the evaluation of their arguments. Above that, set_log_level() filters at runtime
+// with a single relaxed atomic load.
+
+enum class LogLevel
+{
+  Trace = 0,
+  Debug = 1,
+  Info = 2,
+  Warning = 3,
+  Error = 4
+};
+
+#ifndef IM_LOG_MIN_LEVEL
+#define IM_LOG_MIN_LEVEL 0
+#endif
+
+extern std::atomic<int> g_log_level;
+
+inline bool log_enabled(LogLevel level) { return (int) level >= g_log_level.load(std::memory_order_relaxed); }
+
+// Default: Info
+void set_log_level(LogLevel);
+
+const char* log_level_name(LogLevel);
+
+bool parse_log_level(const std::string& name, LogLevel*);
+
+// Name shown for the calling thread in the log.
+void set_log_thread_name(const char* name);
+
+#if defined(__GNUC__)
+__attribute__((format(printf, 2, 3)))
+#endif
+void log_message(LogLevel, const char* format, ...);
+
+// Writes all pending messages. Called automatically at exit.
+void flush_log();
+
+
+#define IM_LOG(level, ...) \
+  do { \
+    if constexpr ((int) (level) >= IM_LOG_MIN_LEVEL) { \
+      if (log_enabled(level)) { \
+        log_message(level, __VA_ARGS__); \
+      } \
+    } \
+  } while (0)
+
+#define LOG_TRACE(...) IM_LOG(LogLevel::Trace, __VA_ARGS__)
+#define LOG_DEBUG(...) IM_LOG(LogLevel::Debug, __VA_ARGS__)
+#define LOG_INFO(...) IM_LOG(LogLevel::Info, __VA_ARGS__)
+#define LOG_WARNING(...) IM_LOG(LogLevel::Warning, __VA_ARGS__)
+#define LOG_ERROR(...) IM_LOG(LogLevel::Error, __VA_ARGS__)
+
+#endif
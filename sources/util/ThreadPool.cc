@@ -0,0 +1,104 @@
+/*
+ * Copyright (C) 2025 by Dirk Farin, Kronenstr. 49b, 70174 Stuttgart, Germany
+ *
+ * 2-Clause BSD
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer
+ *    in the documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "ThreadPool.h"
+#include "profiling/Tracing.h"
+#include "profiling/AllocTracker.h"
+#include "Log.h"
+
+#include <algorithm>
+
+
+ThreadPool::ThreadPool(int nThreads, const char* name)
+{
+  if (nThreads <= 0) {
+    nThreads = std::max(1, (int) std::thread::hardware_concurrency() - 1);
+  }
+
+  for (int i = 0; i < nThreads; i++) {
+    mThreads.emplace_back([this, name] { worker(name); });
+  }
+}
+
+
+ThreadPool::~ThreadPool()
+{
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mShutdown = true;
+    mTasks.clear();
+  }
+
+  mCond.notify_all();
+
+  for (auto& thread : mThreads) {
+    thread.join();
+  }
+}
+
+
+void ThreadPool::enqueue(std::function<void()> task)
+{
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mTasks.push_back(std::move(task));
+  }
+
+  mCond.notify_one();
+}
+
+
+size_t ThreadPool::pendingTasks() const
+{
+  std::lock_guard<std::mutex> lock(mMutex);
+  return mTasks.size();
+}
+
+
+void ThreadPool::worker(const char* name)
+{
+  set_trace_thread_name(name);
+  set_alloc_thread_name(name);
+  set_log_thread_name(name);
+
+  for (;;) {
+    std::function<void()> task;
+
+    {
+      std::unique_lock<std::mutex> lock(mMutex);
+      mCond.wait(lock, [this] { return mShutdown || !mTasks.empty(); });
+
+      if (mShutdown) {
+        return;
+      }
+
+      task = std::move(mTasks.front());
+      mTasks.pop_front();
+    }
+
+    task();
+  }
+}
+
+
+ThreadPool& background_thread_pool()
+{
+  static ThreadPool sPool(0, "background");
+  return sPool;
+}
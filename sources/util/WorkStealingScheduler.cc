@@ -0,0 +1,116 @@
+/*
+ * Copyright (C) 2025 by Dirk Farin, Kronenstr. 49b, 70174 Stuttgart, Germany
+ *
+ * 2-Clause BSD
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer
+ *    in the documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "WorkStealingScheduler.h"
+#include "profiling/Tracing.h"
+#include "profiling/AllocTracker.h"
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+
+WorkStealingScheduler::WorkStealingScheduler(int nThreads)
+    : mNumThreads(std::max(1, nThreads)),
+      mQueues(new WorkerQueue[std::max(1, nThreads)])
+{
+}
+
+
+void WorkStealingScheduler::run(int nItems, const std::function<void(int worker, int item)>& task)
+{
+  mSteals = 0;
+
+  // --- distribute contiguous blocks
+
+  for (int w = 0; w < mNumThreads; w++) {
+    int begin = (int) ((int64_t) nItems * w / mNumThreads);
+    int end = (int) ((int64_t) nItems * (w + 1) / mNumThreads);
+
+    // Reversed, because the owner takes items from the back.
+    std::lock_guard<std::mutex> lock(mQueues[w].mutex);
+    for (int i = end - 1; i >= begin; i--) {
+      mQueues[w].items.push_back(i);
+    }
+  }
+
+  // --- run workers; the calling thread is worker 0
+
+  std::vector<std::thread> threads;
+  for (int w = 1; w < mNumThreads; w++) {
+    threads.emplace_back([this, w, &task] {
+      set_trace_thread_name("batch-worker");
+      set_alloc_thread_name("batch-worker");
+      workerLoop(w, task);
+    });
+  }
+
+  workerLoop(0, task);
+
+  for (auto& thread : threads) {
+    thread.join();
+  }
+}
+
+
+bool WorkStealingScheduler::popOwn(int worker, int* item)
+{
+  WorkerQueue& queue = mQueues[worker];
+  std::lock_guard<std::mutex> lock(queue.mutex);
+
+  if (queue.items.empty()) {
+    return false;
+  }
+
+  *item = queue.items.back();
+  queue.items.pop_back();
+  return true;
+}
+
+
+bool WorkStealingScheduler::steal(int thief, int* item)
+{
+  // Visit the other workers starting at the next one, so that thieves spread over the victims.
+
+  for (int i = 1; i < mNumThreads; i++) {
+    WorkerQueue& victim = mQueues[(thief + i) % mNumThreads];
+    std::lock_guard<std::mutex> lock(victim.mutex);
+
+    if (!victim.items.empty()) {
+      *item = victim.items.front();
+      victim.items.pop_front();
+      mSteals++;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+
+void WorkStealingScheduler::workerLoop(int worker, const std::function<void(int worker, int item)>& task)
+{
+  // Items are only added in run() before the workers start, so when no queue has items left,
+  // all work has been taken.
+
+  int item;
+  while (popOwn(worker, &item) || steal(worker, &item)) {
+    task(worker, item);
+  }
+}
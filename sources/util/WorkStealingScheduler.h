@@ -0,0 +1,69 @@
+/*
+ * Copyright (C) 2025 by Dirk Farin, Kronenstr. 49b, 70174 Stuttgart, Germany
+ *
+ * 2-Clause BSD
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer
+ *    in the documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef WORKSTEALINGSCHEDULER_H
+#define WORKSTEALINGSCHEDULER_H
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+
+
+// Runs a range of independent work items on a fixed number of threads.
+//
+// Each worker starts with a contiguous block of the items in its own deque (consecutive frames
+// share caches) and takes work from its back. A worker whose deque is empty steals from the
+// front of another worker's deque, i.e. the items that its owner would process last.
+
+class WorkStealingScheduler
+{
+public:
+  explicit WorkStealingScheduler(int nThreads);
+
+  int threadCount() const { return mNumThreads; }
+
+  // Calls task(worker, item) for all items in [0, nItems) and returns when all are done.
+  // 'worker' is in [0, threadCount()) and identifies the calling thread for per-worker state.
+  void run(int nItems, const std::function<void(int worker, int item)>& task);
+
+  // Number of items that were stolen in the last run().
+  uint64_t stealCount() const { return mSteals; }
+
+private:
+  struct WorkerQueue
+  {
+    std::mutex mutex;
+    std::deque<int> items;
+  };
+
+  int mNumThreads;
+  std::unique_ptr<WorkerQueue[]> mQueues;
+  std::atomic<uint64_t> mSteals{0};
+
+  bool popOwn(int worker, int* item);
+
+  bool steal(int thief, int* item);
+
+  void workerLoop(int worker, const std::function<void(int worker, int item)>& task);
+};
+
+#endif